@@ -0,0 +1,57 @@
+# Build options every HaggleX contract has, the shared headers and the wasmcost check. A
+# contract's CMakeLists includes this file and calls hagglex_contract(<target>) after
+# add_contract; the ExternalProject builds pass the options through with
+# HAGGLEX_CONTRACT_ARGS.
+
+set(HAGGLEX_COMMON_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+# per-action metrics singleton and getmetrics action, see hagglex_common/metrics.hpp
+option(HAGGLEX_METRICS "Count action and branch hits on chain" OFF)
+
+# failed checks report only a numeric code (see hagglex_common/error_codes.hpp), which
+# drops the message strings and their formatting code from the wasm
+option(COMPACT_ERRORS "Fail checks with error codes instead of messages" OFF)
+
+# debug build: every action prints the heap bytes it allocated and the memory pages it
+# ends with, see hagglex_common/heap_stats.hpp
+option(HAGGLEX_HEAP_STATS "Print per-action heap allocation" OFF)
+
+# debug build: compile in the contracts' prints, see hagglex_common/events.hpp
+option(HAGGLEX_DEBUG "Compile in debug prints" OFF)
+
+set(HAGGLEX_CONTRACT_OPTIONS HAGGLEX_METRICS COMPACT_ERRORS HAGGLEX_HEAP_STATS HAGGLEX_DEBUG)
+
+# every build is checked by wasmcost (see tools/README.md) when a host build of the tools
+# is found: a table scan with no exit test on a counter that is not on
+# tools/tests/wasmcost.allow fails the build
+find_program(HAGGLEX_WASMCOST wasmcost
+   PATHS ${HAGGLEX_COMMON_DIR}/../build
+   DOC "wasmcost run on every contract build"
+   NO_CMAKE_FIND_ROOT_PATH)
+if(NOT HAGGLEX_WASMCOST)
+   message(STATUS "wasmcost not found, contract builds are not checked; build tools/ into build/ first")
+endif()
+
+set(HAGGLEX_CONTRACT_ARGS "")
+foreach(opt ${HAGGLEX_CONTRACT_OPTIONS})
+   list(APPEND HAGGLEX_CONTRACT_ARGS -D${opt}=${${opt}})
+endforeach()
+if(HAGGLEX_WASMCOST)
+   list(APPEND HAGGLEX_CONTRACT_ARGS -DHAGGLEX_WASMCOST=${HAGGLEX_WASMCOST})
+endif()
+
+function(hagglex_contract target)
+   foreach(opt ${HAGGLEX_CONTRACT_OPTIONS})
+      if(${opt})
+         target_compile_definitions(${target} PUBLIC ${opt})
+      endif()
+   endforeach()
+   target_include_directories(${target} PUBLIC ${HAGGLEX_COMMON_DIR}/include)
+   if(HAGGLEX_WASMCOST)
+      add_custom_command(TARGET ${target} POST_BUILD
+         COMMAND ${HAGGLEX_WASMCOST} --allow ${HAGGLEX_COMMON_DIR}/../tools/tests/wasmcost.allow
+                 --contract ${target}=$<TARGET_FILE:${target}>,$<TARGET_FILE_DIR:${target}>/${target}.abi
+         COMMENT "wasmcost ${target}"
+         VERBATIM)
+   endif()
+endfunction()
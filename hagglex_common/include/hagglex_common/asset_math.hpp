@@ -0,0 +1,33 @@
+#pragma once
+
+#include <eosio/asset.hpp>
+
+#include <hagglex_common/fixed_point.hpp>
+
+// Asset arithmetic on top of fixed_point: scaling by a rate and converting between
+// symbols of different precision at a price.
+
+namespace hagglex {
+
+   constexpr int64_t pow10( uint8_t exponent ) {
+      int64_t r = 1;
+      for( uint8_t i = 0; i < exponent; ++i ) r *= 10;
+      return r;
+   }
+
+   // quantity * rate in the same symbol, truncated
+   inline eosio::asset scale( const eosio::asset& quantity, const fixed_point& rate ) {
+      return eosio::asset{ rate.apply( quantity.amount ), quantity.symbol };
+   }
+
+   // quantity priced in units of `to` per unit of quantity's symbol, truncated
+   inline eosio::asset convert( const eosio::asset& quantity, const fixed_point& price, const eosio::symbol& to ) {
+      fixed_point units = price;
+      if( to.precision() > quantity.symbol.precision() )
+         units = units * fixed_point::from_int( pow10( to.precision() - quantity.symbol.precision() ) );
+      else if( to.precision() < quantity.symbol.precision() )
+         units = units / fixed_point::from_int( pow10( quantity.symbol.precision() - to.precision() ) );
+      return eosio::asset{ units.apply( quantity.amount ), to };
+   }
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/symbol.hpp>
+
+// Account names, action names and symbols shared by the HaggleX contracts. All of
+// them are constexpr, so no string is parsed into a name or symbol at run time.
+
+namespace hagglex {
+
+   namespace accounts {
+      inline constexpr eosio::name token       = "hagglextoken"_n;
+      inline constexpr eosio::name sale        = "hagglexsale"_n;
+      inline constexpr eosio::name stake       = "hagglexstake"_n;
+      inline constexpr eosio::name eosio_token = "eosio.token"_n;
+   }
+
+   namespace actions {
+      inline constexpr eosio::name transfer     = "transfer"_n;
+      inline constexpr eosio::name blacklist    = "blacklist"_n;
+      inline constexpr eosio::name unblacklist  = "unblacklist"_n;
+      inline constexpr eosio::name clrblacklist = "clrblacklist"_n;
+   }
+
+   namespace permissions {
+      inline constexpr eosio::name active = "active"_n;
+   }
+
+   namespace symbols {
+      inline constexpr uint8_t       hag_precision = 4;
+      inline constexpr eosio::symbol hag   { "HAG", hag_precision };
+      inline constexpr eosio::symbol eos   { "EOS", 4 };
+      inline constexpr eosio::symbol voice { "VOICE", 4 };
+   }
+
+}
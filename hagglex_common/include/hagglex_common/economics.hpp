@@ -0,0 +1,89 @@
+#pragma once
+
+#include <hagglex_common/fixed_point.hpp>
+
+#include <array>
+#include <cstdint>
+
+// The token economics the contracts run on: stake durations and their interest, interest
+// accrual, and the mint schedule. hagglexstake and hagglextoken call these, and so does
+// the tools/stakesim simulator, which passes its own terms and schedule to project a
+// change before it is made.
+//
+// This header has no eosio dependency so host tools can include it.
+
+namespace hagglex::economics {
+
+   // a stake duration and the yearly interest percent a position of that duration earns
+   struct stake_term {
+      uint16_t days;
+      uint16_t percent;
+   };
+
+   using stake_terms = std::array<stake_term, 3>;
+
+   inline constexpr stake_terms default_stake_terms {{ { 90, 15 }, { 180, 30 }, { 360, 55 } }};
+
+   inline constexpr uint32_t seconds_per_day  = 24 * 60 * 60;
+   inline constexpr uint32_t seconds_per_year = 365 * seconds_per_day;
+
+   // yearly interest percent for a stake of `days`, 0 when no term has that duration
+   constexpr uint16_t interest_percent( uint16_t days, const stake_terms& terms = default_stake_terms ) {
+      for( const auto& term : terms )
+         if( term.days == days ) return term.percent;
+      return 0;
+   }
+
+   // share of the staked amount that accrues at yearly `rate` over `seconds`
+   constexpr fixed_point accrual_factor( const fixed_point& rate, uint32_t seconds ) {
+      return rate * fixed_point::ratio( seconds, seconds_per_year );
+   }
+
+   // interest accrued on `staked` base units at yearly `rate` over `seconds`, truncated
+   constexpr int64_t accrued( int64_t staked, const fixed_point& rate, uint32_t seconds ) {
+      return accrual_factor( rate, seconds ).apply( staked );
+   }
+
+   // what a claim at `now` pays on a position of `staked` base units at yearly `rate`, last
+   // paid at `paid` and expiring at `expiration`: pro rata by the second since it was paid,
+   // nothing past expiration. Under one base unit it pays 0 and the position keeps accruing
+   // from `paid`, so frequent claims lose nothing to truncation but what a claim drops.
+   constexpr int64_t claimable( int64_t staked, const fixed_point& rate, uint32_t paid, uint32_t expiration,
+                                uint32_t now ) {
+      const uint32_t until = now < expiration ? now : expiration;
+      if( until <= paid ) return 0;
+      return accrued( staked, rate, until - paid );
+   }
+
+   // one step of the mint schedule: at or below `max_supply` whole tokens, a mint issues
+   // `reward` (in base units of a 4 decimal symbol) times mint_scale
+   struct reward_tier {
+      int64_t max_supply;
+      int64_t reward;
+   };
+
+   using reward_schedule = std::array<reward_tier, 6>;
+
+   // tiers are tried in order and the first match wins
+   inline constexpr reward_schedule default_reward_schedule {{
+      { 233600, 160 }, { 116800, 80 }, { 58400, 40 }, { 29200, 20 }, { 14600, 10 }, { 7300, 5 } }};
+
+   inline constexpr int64_t  mint_scale    = 10000;
+   inline constexpr int64_t  mint_cap      = 9000000;            // whole tokens
+   inline constexpr uint32_t mint_delay    = 90 * seconds_per_day;
+   inline constexpr uint32_t mint_interval = seconds_per_day;
+
+   // reward for the next mint at `supply` base units, before mint_scale
+   constexpr int64_t reward( int64_t supply, const reward_schedule& schedule = default_reward_schedule ) {
+      for( const auto& tier : schedule )
+         if( supply / 10000 <= tier.max_supply ) return tier.reward;
+      return 0;
+   }
+
+   // whether a mint at `now` issues: supply under the cap, the launch delay over, and more
+   // than a mint interval since the last issue
+   constexpr bool mint_due( int64_t supply, uint32_t starttime, uint32_t minetime, uint32_t now ) {
+      return supply / 10000 <= mint_cap && now > starttime + mint_delay && now > minetime + mint_interval;
+   }
+
+}
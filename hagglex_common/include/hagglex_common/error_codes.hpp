@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+
+// Error codes of the HaggleX contracts. Built with COMPACT_ERRORS, a failed check
+// reports only its code (eosio_assert_code); clients turn it back into a message
+// with this table, printed by tools/errcodes. Codes are grouped by contract:
+// 1xxx hagglextoken, 2xxx hagglexsale, 3xxx hagglexstake, 9xxx hagglex_common.
+//
+// Each list entry is X( code, identifier, message ). Codes are part of the public
+// interface: never renumber or reuse one, only append.
+//
+// This header has no eosio dependency so host tools can include it.
+
+#define HAGGLEX_TOKEN_ERRORS( X ) \
+   X( 1001, invalid_symbol,          "invalid symbol name" ) \
+   X( 1002, invalid_supply,          "invalid supply" ) \
+   X( 1003, max_supply_not_positive, "max-supply must be positive" ) \
+   X( 1004, token_exists,            "token with symbol already exists" ) \
+   X( 1005, memo_too_long,           "memo has more than 256 bytes" ) \
+   X( 1006, issue_unknown_token,     "token with symbol does not exist, create token before issue" ) \
+   X( 1007, issue_to_non_issuer,     "tokens can only be issued to issuer account" ) \
+   X( 1008, invalid_quantity,        "invalid quantity" ) \
+   X( 1009, issue_not_positive,      "must issue positive quantity" ) \
+   X( 1010, symbol_mismatch,         "symbol precision mismatch" ) \
+   X( 1011, exceeds_supply,          "quantity exceeds available supply" ) \
+   X( 1012, unknown_token,           "token with symbol does not exist" ) \
+   X( 1013, burn_not_positive,       "must burn positive quantity" ) \
+   X( 1014, from_blacklisted,        "account blacklisted(from)" ) \
+   X( 1015, to_blacklisted,          "account blacklisted(to)" ) \
+   X( 1016, transfer_to_self,        "cannot transfer to self" ) \
+   X( 1017, to_account_missing,      "to account does not exist" ) \
+   X( 1018, transfer_not_positive,   "must transfer positive quantity" ) \
+   X( 1019, no_balance,              "no balance object found" ) \
+   X( 1020, overdrawn,               "overdrawn balance" ) \
+   X( 1021, owner_missing,           "owner account does not exist" ) \
+   X( 1022, close_missing_row,       "Balance row already deleted or never existed. Action won't have any effect." ) \
+   X( 1023, close_nonzero,           "Cannot close because the balance is not zero." ) \
+   X( 1024, already_blacklisted,     "blacklist account already exists" ) \
+   X( 1025, not_blacklisted,         "blacklist account not exists" ) \
+   X( 1026, unknown_snapshot,        "unknown snapshot" ) \
+   X( 1027, migrate_batch_too_large, "too many owners in one batch" ) \
+   X( 1028, richlist_limit,          "limit is too large" ) \
+   X( 1029, gc_rows,                 "max_rows must be between 1 and the gc limit" ) \
+   X( 1030, gc_batch_too_large,      "too many owners in one batch" ) \
+   X( 1031, symbol_not_found,        "symbol does not exist" )
+
+#define HAGGLEX_SALE_ERRORS( X ) \
+   X( 2001, already_initialized,     "Already Initialzed" ) \
+   X( 2002, start_after_finish,      "Start must be less than finish" ) \
+   X( 2003, admin_is_self,           "Admin should be different than contract deployer" ) \
+   X( 2004, memo_too_long,           "memo has more than 256 bytes" ) \
+   X( 2005, buy_currency,            "Can only buy with EOS or VOICE on this window" ) \
+   X( 2006, invalid_quantity,        "invalid quantity" ) \
+   X( 2007, paused,                  "Crowdsale has been paused" ) \
+   X( 2008, not_started,             "Crowdsale hasn't started" ) \
+   X( 2009, above_max_contribution,  "Can not purchase more than the Maximum Contribution" ) \
+   X( 2010, goal_reached,            "GOAL reached" ) \
+   X( 2011, contribution_too_low,    "Contribution too low" ) \
+   X( 2012, contribution_too_high,   "Contribution too high" ) \
+   X( 2013, price_stale,             "price feed is stale" ) \
+   X( 2014, to_account_missing,      "to account does not exist" ) \
+   X( 2015, not_hag,                 "Can issue only HAG coins" ) \
+   X( 2016, class1_cap,              "Cannot issue more than Core Team quantity" ) \
+   X( 2017, class2_cap,              "Cannot issue more than Advisors quantity" ) \
+   X( 2018, class3_cap,              "Cannot issue more than Core Investors quantity" ) \
+   X( 2019, class4_cap,              "Cannot issue more than Reserved quantity" ) \
+   X( 2020, class5_cap,              "Cannot issue more than ICO quantity" ) \
+   X( 2021, class6_cap,              "Cannot issue more than Charity  quantity" ) \
+   X( 2022, class7_cap,              "Cannot issue more than Founding Team quantity" ) \
+   X( 2023, class8_cap,              "Cannot issue more than Airgrab quantity" ) \
+   X( 2024, withdraw_currency,       "Can only withdraw EOS or VOICE" ) \
+   X( 2025, not_ended,               "Crowdsale not ended yet" ) \
+   X( 2026, soft_cap_missed,         "Soft cap was not reached" ) \
+   X( 2027, feed_currency,           "Can only set a feed for EOS or VOICE" ) \
+   X( 2028, oracle_missing,          "oracle account does not exist" ) \
+   X( 2029, no_feed,                 "no price feed for this currency" ) \
+   X( 2030, price_not_positive,      "price must be positive" ) \
+   X( 2031, price_same_second,       "price already pushed in this second" ) \
+   X( 2032, gc_rows,                 "max_rows must be between 1 and the gc limit" ) \
+   X( 2033, not_finalized,           "Crowdsale has not been finalized" ) \
+   X( 2034, finalized,               "Crowdsale has been finalized" )
+
+#define HAGGLEX_STAKE_ERRORS( X ) \
+   X( 3001, staking_contract_missing, "Staking token contract is not a valid account." ) \
+   X( 3002, interest_contract_missing, "Interest token contract is not a valid account." ) \
+   X( 3003, staking_symbol_invalid,   "Staking token symbol is not a valid symbol." ) \
+   X( 3004, interest_symbol_invalid,  "Interest token symbol is not a valid symbol." ) \
+   X( 3005, paused,                   "HaggleX Staking contract is paused. Try again later." ) \
+   X( 3006, wrong_symbol,             "Only HAG tokens are allowed. Wrong token symbol." ) \
+   X( 3007, wrong_contract,           "Only HAG tokens are allowed. Wrong token contract." ) \
+   X( 3008, deposit_contract_changed, "Transfer does not match existing token contract." ) \
+   X( 3009, invalid_duration,         "Can only stake for 90Days, 180Days or 360days." ) \
+   X( 3010, position_not_found,       "Position ID is not found" ) \
+   X( 3011, not_expired,              "Cannot unstake. Staking time has not yet expired." ) \
+   X( 3012, insufficient_funds,       "Insufficient funds." ) \
+   X( 3013, nothing_to_claim,         "Nothing to do. Position has expired and all interest has been claimed. You should unstake it." ) \
+   X( 3014, page_limit,               "page limit is too large" ) \
+   X( 3015, gc_rows,                  "max_rows must be between 1 and the gc limit" ) \
+   X( 3016, gc_batch_too_large,       "too many owners in one batch" ) \
+   X( 3017, no_balance,               "No balance of this token to withdraw." )
+
+#define HAGGLEX_COMMON_ERRORS( X ) \
+   X( 9001, fixed_point_overflow,     "fixed_point overflow" ) \
+   X( 9002, fixed_point_range,        "fixed_point result out of range" ) \
+   X( 9003, fixed_point_div_zero,     "fixed_point division by zero" ) \
+   X( 9004, row_too_large,            "row does not fit the fixed row buffer" ) \
+   X( 9005, buffer_overflow,          "fixed buffer capacity exceeded" )
+
+namespace hagglex::errors {
+
+#define HAGGLEX_ERROR_ENUMERATOR( code, id, message ) id = code,
+#define HAGGLEX_ERROR_MESSAGE_CASE( code, id, message ) case code: return message;
+
+   enum class token : uint64_t  { HAGGLEX_TOKEN_ERRORS( HAGGLEX_ERROR_ENUMERATOR ) };
+   enum class sale : uint64_t   { HAGGLEX_SALE_ERRORS( HAGGLEX_ERROR_ENUMERATOR ) };
+   enum class stake : uint64_t  { HAGGLEX_STAKE_ERRORS( HAGGLEX_ERROR_ENUMERATOR ) };
+   enum class common : uint64_t { HAGGLEX_COMMON_ERRORS( HAGGLEX_ERROR_ENUMERATOR ) };
+
+   // message of an error code, one table per enum so that a contract's wasm holds only
+   // its own messages and the common ones; nullptr when the code is unknown
+   constexpr const char* message( token code ) {
+      switch( static_cast<uint64_t>(code) ) { HAGGLEX_TOKEN_ERRORS( HAGGLEX_ERROR_MESSAGE_CASE ) }
+      return nullptr;
+   }
+
+   constexpr const char* message( sale code ) {
+      switch( static_cast<uint64_t>(code) ) { HAGGLEX_SALE_ERRORS( HAGGLEX_ERROR_MESSAGE_CASE ) }
+      return nullptr;
+   }
+
+   constexpr const char* message( stake code ) {
+      switch( static_cast<uint64_t>(code) ) { HAGGLEX_STAKE_ERRORS( HAGGLEX_ERROR_MESSAGE_CASE ) }
+      return nullptr;
+   }
+
+   constexpr const char* message( common code ) {
+      switch( static_cast<uint64_t>(code) ) { HAGGLEX_COMMON_ERRORS( HAGGLEX_ERROR_MESSAGE_CASE ) }
+      return nullptr;
+   }
+
+#undef HAGGLEX_ERROR_MESSAGE_CASE
+#undef HAGGLEX_ERROR_ENUMERATOR
+
+}
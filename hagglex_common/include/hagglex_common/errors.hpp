@@ -0,0 +1,33 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+
+#include <hagglex_common/error_codes.hpp>
+
+// Checks that fail with a HaggleX error code, see error_codes.hpp.
+//
+// By default a failed check aborts with the code's message, as before. Built with
+// COMPACT_ERRORS it aborts with only the numeric code, so the messages and the string
+// code building them drop out of the wasm. HAGGLEX_CHECK_MSG takes a message
+// expression that is evaluated only when the check fails, and never in compact builds.
+
+namespace hagglex {
+
+   template<typename Error>
+   inline void check( bool pred, Error code ) {
+#ifdef COMPACT_ERRORS
+      eosio::check( pred, static_cast<uint64_t>(code) );
+#else
+      if( !pred ) eosio::check( false, errors::message( code ) );
+#endif
+   }
+
+}
+
+#ifdef COMPACT_ERRORS
+#define HAGGLEX_CHECK_MSG( pred, code, message ) \
+   ::eosio::check( (pred), static_cast<uint64_t>(code) )
+#else
+#define HAGGLEX_CHECK_MSG( pred, code, message ) \
+   do { if( !(pred) ) ::eosio::check( false, (message) ); } while( 0 )
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <eosio/print.hpp>
+
+#include <hagglex_common/inline_action.hpp>
+
+// Log actions and debug prints.
+//
+// A state-changing action reports what it did by sending a log action (logbuy, logstake,
+// ...) inline to its own contract. The log action's body only checks that the contract
+// sent it, so it changes nothing; its typed data sits in the action trace, where an
+// indexer reads it through the ABI instead of diffing tables. print output is dropped by
+// production nodes, so prints are compiled in only by debug builds (HAGGLEX_DEBUG).
+
+#ifdef HAGGLEX_DEBUG
+#define HAGGLEX_PRINT(...) ::eosio::print(__VA_ARGS__)
+#else
+#define HAGGLEX_PRINT(...) ((void)0)
+#endif
+
+namespace hagglex {
+
+   // log action `log` of `self`, sent to itself under its active permission with `fields`
+   // packed in the order the action declares them
+   template<typename... Fields>
+   inline void send_log( const eosio::name& self, eosio::name log, const Fields&... fields ) {
+      inline_action<128> act( self, log, { self, permissions::active } );
+      ( act << ... << fields );
+      act.send();
+   }
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#ifdef HAGGLEX_HOST
+#include <hagglex_common/error_codes.hpp>
+#include <stdexcept>
+#else
+#include <hagglex_common/errors.hpp>
+#endif
+
+#include <cstdint>
+
+// Signed 128-bit fixed point with 18 decimals, for rates, prices and fees in place of
+// float/double. Every operation is exact up to the final truncation toward zero, and
+// fails the action through hagglex::check on overflow or division by zero; in a constant
+// expression the same failures are compile errors. Host tools build with HAGGLEX_HOST,
+// where a failure throws std::range_error instead.
+
+namespace hagglex {
+
+   class fixed_point {
+      public:
+         using raw_type = __int128;
+
+         static constexpr raw_type scale = 1000000000000000000;     // 10^18
+
+         constexpr fixed_point() = default;
+
+         static constexpr fixed_point from_raw( raw_type raw ) { fixed_point f; f.value = raw; return f; }
+         static constexpr fixed_point from_int( int64_t v )    { return from_raw( raw_type(v) * scale ); }
+
+         // num / den, e.g. ratio(314, 100) for 3.14
+         static constexpr fixed_point ratio( int64_t num, int64_t den ) {
+            return from_int( num ).div( from_int( den ) );
+         }
+         static constexpr fixed_point percent( int64_t p )   { return ratio( p, 100 ); }
+         static constexpr fixed_point bps( int64_t b )       { return ratio( b, 10000 ); }
+
+         constexpr raw_type raw() const { return value; }
+
+         constexpr fixed_point operator+( const fixed_point& o ) const {
+            raw_type r = 0;
+            if( __builtin_add_overflow( value, o.value, &r ) ) fail( errors::common::fixed_point_overflow );
+            return from_raw( r );
+         }
+
+         constexpr fixed_point operator-( const fixed_point& o ) const {
+            raw_type r = 0;
+            if( __builtin_sub_overflow( value, o.value, &r ) ) fail( errors::common::fixed_point_overflow );
+            return from_raw( r );
+         }
+
+         constexpr fixed_point operator*( const fixed_point& o ) const { return from_raw( mul_scaled( value, o.value ) ); }
+         constexpr fixed_point operator/( const fixed_point& o ) const { return div( o ); }
+
+         // amount * this, truncated; the usual way to apply a rate to an asset amount
+         constexpr int64_t apply( int64_t amount ) const {
+            raw_type r = mul_scaled( raw_type(amount) * scale, value ) / scale;
+            if( r < INT64_MIN || r > INT64_MAX ) fail( errors::common::fixed_point_range );
+            return int64_t(r);
+         }
+
+         // integer part, truncated toward zero
+         constexpr int64_t to_int64() const {
+            raw_type r = value / scale;
+            if( r < INT64_MIN || r > INT64_MAX ) fail( errors::common::fixed_point_range );
+            return int64_t(r);
+         }
+
+         double to_double() const { return double(value) / double(scale); }
+
+         friend constexpr bool operator==( const fixed_point& a, const fixed_point& b ) { return a.value == b.value; }
+         friend constexpr bool operator!=( const fixed_point& a, const fixed_point& b ) { return a.value != b.value; }
+         friend constexpr bool operator<( const fixed_point& a, const fixed_point& b )  { return a.value < b.value; }
+         friend constexpr bool operator<=( const fixed_point& a, const fixed_point& b ) { return a.value <= b.value; }
+         friend constexpr bool operator>( const fixed_point& a, const fixed_point& b )  { return a.value > b.value; }
+         friend constexpr bool operator>=( const fixed_point& a, const fixed_point& b ) { return a.value >= b.value; }
+
+      private:
+         raw_type value = 0;
+
+         // only reached on failure, which also keeps successful constant evaluation legal
+         static void fail( errors::common code ) {
+#ifdef HAGGLEX_HOST
+            throw std::range_error( errors::message( code ) );
+#else
+            hagglex::check( false, code );
+#endif
+         }
+
+         static constexpr raw_type checked_mul( raw_type a, raw_type b ) {
+            raw_type r = 0;
+            if( __builtin_mul_overflow( a, b, &r ) ) fail( errors::common::fixed_point_overflow );
+            return r;
+         }
+
+         static constexpr raw_type checked_add( raw_type a, raw_type b ) {
+            raw_type r = 0;
+            if( __builtin_add_overflow( a, b, &r ) ) fail( errors::common::fixed_point_overflow );
+            return r;
+         }
+
+         // a * b / scale without the 256-bit intermediate: split both into whole and
+         // fractional parts, (qa S + ra)(qb S + rb) / S = qa qb S + qa rb + ra qb + ra rb / S
+         static constexpr raw_type mul_scaled( raw_type a, raw_type b ) {
+            raw_type qa = a / scale, ra = a % scale;
+            raw_type qb = b / scale, rb = b % scale;
+            raw_type r = checked_mul( checked_mul( qa, qb ), scale );
+            r = checked_add( r, checked_mul( qa, rb ) );
+            r = checked_add( r, checked_mul( ra, qb ) );
+            return checked_add( r, ra * rb / scale );
+         }
+
+         // this * scale / o, long-dividing the remainder when it cannot be scaled in one step
+         constexpr fixed_point div( const fixed_point& o ) const {
+            if( o.value == 0 ) fail( errors::common::fixed_point_div_zero );
+            raw_type q = value / o.value, rem = value % o.value;
+            raw_type r = checked_mul( q, scale );
+            raw_type scaled = 0;
+            if( !__builtin_mul_overflow( rem, scale, &scaled ) ) return from_raw( checked_add( r, scaled / o.value ) );
+            raw_type frac = 0;
+            for( raw_type unit = scale / 10; unit > 0; unit /= 10 ) {
+               rem *= 10;
+               frac += (rem / o.value) * unit;
+               rem %= o.value;
+            }
+            return from_raw( checked_add( r, frac ) );
+         }
+   };
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+#include <eosio/symbol.hpp>
+
+#include <hagglex_common/raw_table.hpp>
+
+// Garbage collection of balance rows nobody closes. When an owner's balance row drops to
+// zero the contract queues the owner; its gc action, which anyone may call, walks the
+// queue from a persisted cursor, erases the rows still empty and drops the entries it is
+// done with. Erasing a row refunds whoever paid for it. Every row gc reads counts against
+// the caller's max_rows, queue entries included, so a call is bounded however long the
+// queue has grown.
+
+namespace hagglex::gc {
+
+   // an owner with a balance row that went to zero; the owner pays for the entry, and
+   // gets it back with the row
+   TABLE candidate {
+      eosio::name          owner;
+      eosio::symbol_code   sym;
+
+      uint64_t primary_key()const { return owner.value; }
+   };
+
+   // where the last gc call stopped: the owner it was on and the key of the first row of
+   // that owner it had not read, 0 when it stopped between owners
+   TABLE cursor {
+      uint64_t    owner;
+      uint64_t    key;
+   };
+
+   typedef eosio::multi_index< "gcqueue"_n, candidate > queue_t;
+   typedef eosio::singleton< "gccursor"_n, cursor > cursor_t;
+
+   // queue `owner`, once; `payer` must have authorized the action
+   inline void enqueue( eosio::name self, eosio::name owner, eosio::symbol_code sym, eosio::name payer ) {
+      if( raw::exists( self, self.value, "gcqueue"_n, owner.value ) ) return;
+      raw::store( self.value, "gcqueue"_n, payer, owner.value, candidate{ owner, sym } );
+   }
+
+   // walks the queue from the cursor with a budget of max_rows rows.
+   // collect(candidate, from_key, budget) handles one owner's rows from `from_key` on,
+   // taking one from `budget` per row it reads, and returns the key to resume at when the
+   // budget runs out first, 0 when it finished the owner
+   template<typename F>
+   void sweep( eosio::name self, uint32_t max_rows, F&& collect ) {
+      cursor at{ 0, 0 };
+      raw::get( self, self.value, "gccursor"_n, "gccursor"_n.value, at );
+
+      uint32_t budget = max_rows;
+      bool stopped = false;
+      raw::walk( self, self.value, "gcqueue"_n, at.owner, [&]( int32_t itr ) {
+         if( budget == 0 ) {
+            stopped = true;
+            return false;
+         }
+         --budget;
+         const candidate c = raw::read<candidate>( itr );
+         const uint64_t from = c.owner.value == at.owner ? at.key : 0;
+         at = cursor{ c.owner.value, collect( c, from, budget ) };
+         if( at.key != 0 ) {
+            stopped = true;
+            return false;
+         }
+         raw::erase( itr );
+         return true;
+      });
+      // at the end of the queue, start over so owners queued behind the cursor get a turn
+      if( !stopped ) at = cursor{ 0, 0 };
+      raw::set( self, self.value, "gccursor"_n, "gccursor"_n.value, self, at );
+   }
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+
+#include <cstdlib>
+
+// Debug-build heap accounting shared by the HaggleX contracts.
+//
+// Built with HAGGLEX_HEAP_STATS defined, every METRICS_ACTION scope also prints, when
+// the action ends, the heap bytes it allocated and the linear memory pages it ends
+// with (and how many it grew):
+//
+//    heap transfer: 0 bytes, 1 pages (+0)
+//
+// The contract allocator is a bump allocator that never frees, so the distance between
+// two one-byte probe allocations is what was allocated in between, plus the probe.
+// Nested scopes (an action calling another action's method) report separately.
+
+#ifdef HAGGLEX_HEAP_STATS
+
+namespace hagglex {
+
+   class heap_scope {
+      public:
+         explicit heap_scope( const eosio::name& action ) : action(action), start_mark(mark()), start_pages(pages()) {}
+
+         ~heap_scope() {
+            // the probe taken at start_mark is part of the distance
+            const uintptr_t bytes = mark() - start_mark - probe_size;
+            const uint32_t  now   = pages();
+            eosio::print( "heap ", action, ": ", uint64_t(bytes), " bytes, ", now, " pages (+", now - start_pages, ")\n" );
+         }
+
+      private:
+         // smallest block the allocator hands out, alignment included
+         static constexpr uintptr_t probe_size = 16;
+
+         eosio::name    action;
+         uintptr_t      start_mark;
+         uint32_t       start_pages;
+
+         static uintptr_t mark() { return reinterpret_cast<uintptr_t>( malloc( 1 ) ); }
+
+         static uint32_t pages() {
+#ifdef __wasm__
+            return uint32_t( __builtin_wasm_memory_size( 0 ) );
+#else
+            return 0;
+#endif
+         }
+   };
+
+}
+
+#define HEAP_STATS_SCOPE(action)   hagglex::heap_scope heap_scope_( action );
+
+#else
+
+#define HEAP_STATS_SCOPE(action)
+
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/eosio.hpp>
+
+#include <hagglex_common/constants.hpp>
+#include <hagglex_common/errors.hpp>
+
+#include <string_view>
+
+// Inline actions and memos built in stack buffers. eosio::action packs its data and
+// authorization into heap vectors and memos are usually std::string concatenations;
+// on the hot paths both are replaced by these, which never touch the heap.
+
+namespace hagglex {
+
+   // a string built in place; appending past the capacity fails the action
+   template<size_t Capacity>
+   class fixed_string {
+      public:
+         fixed_string& operator<<( std::string_view s ) {
+            hagglex::check( s.size() <= Capacity - length, errors::common::buffer_overflow );
+            for( char c : s ) buffer[length++] = c;
+            return *this;
+         }
+
+         fixed_string& operator<<( const eosio::name& n ) {
+            char text[13];
+            char* end = n.write_as_string( text, text + sizeof(text) );
+            return *this << std::string_view( text, size_t(end - text) );
+         }
+
+         fixed_string& operator<<( uint64_t v ) {
+            char digits[20];
+            size_t count = 0;
+            do { digits[sizeof(digits) - ++count] = char('0' + v % 10); v /= 10; } while( v );
+            return *this << std::string_view( digits + sizeof(digits) - count, count );
+         }
+
+         std::string_view view() const { return std::string_view( buffer, length ); }
+         operator std::string_view() const { return view(); }
+
+      private:
+         char     buffer[Capacity];
+         size_t   length = 0;
+   };
+
+   // an action whose data is packed into a fixed buffer and sent with send_inline
+   template<size_t Capacity = 512>
+   class inline_action {
+      public:
+         inline_action( eosio::name account, eosio::name action, eosio::permission_level authorization )
+            : account(account), action(action), authorization(authorization), ds( data, Capacity ) {}
+
+         template<typename T>
+         inline_action& operator<<( const T& v ) {
+            ds << v;
+            return *this;
+         }
+
+         // packed like std::string, without building one
+         inline_action& operator<<( std::string_view s ) {
+            ds << eosio::unsigned_int( uint32_t(s.size()) );
+            ds.write( s.data(), s.size() );
+            return *this;
+         }
+
+         inline_action& operator<<( const char* s ) { return *this << std::string_view( s ); }
+
+         void send() {
+            char packed[Capacity + 64];
+            eosio::datastream<char*> out( packed, sizeof(packed) );
+            out << account << action << eosio::unsigned_int( 1 ) << authorization
+                << eosio::unsigned_int( uint32_t(ds.tellp()) );
+            out.write( data, ds.tellp() );
+            eosio::internal_use_do_not_use::send_inline( packed, out.tellp() );
+         }
+
+      private:
+         eosio::name                account;
+         eosio::name                action;
+         eosio::permission_level    authorization;
+         char                       data[Capacity];
+         eosio::datastream<char*>   ds;
+   };
+
+   // token::transfer sent by `self` under its active permission
+   inline void send_transfer( const eosio::name& self, const eosio::name& token_contract, const eosio::name& from,
+                              const eosio::name& to, const eosio::asset& quantity, std::string_view memo ) {
+      inline_action<> act( token_contract, actions::transfer, { self, permissions::active } );
+      act << from << to << quantity << memo;
+      act.send();
+   }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+#include <hagglex_common/heap_stats.hpp>
+
+#include <map>
+
+// Opt-in action metrics shared by the HaggleX contracts.
+//
+// Built with HAGGLEX_METRICS defined, each contract keeps a "metrics" singleton of
+// per-action and per-branch hit counters plus db read/write tallies. Counts gathered
+// while an action runs are written once, when its outermost METRICS_ACTION scope ends.
+// Without HAGGLEX_METRICS every METRICS_* macro expands to nothing, except that
+// METRICS_ACTION still opens the heap_stats.hpp scope in HAGGLEX_HEAP_STATS builds.
+
+#ifdef HAGGLEX_METRICS
+
+namespace hagglex {
+
+   struct [[eosio::table("metrics")]] metrics_t {
+      std::map<eosio::name, uint64_t>  counters;        // hits by action or branch name
+      uint64_t                         db_reads  = 0;
+      uint64_t                         db_writes = 0;
+   };
+
+   typedef eosio::singleton<"metrics"_n, metrics_t> metrics_table;
+
+   // counts of the running action, not yet written
+   struct pending_metrics_t {
+      std::map<eosio::name, uint64_t>  counters;
+      uint64_t                         db_reads  = 0;
+      uint64_t                         db_writes = 0;
+      uint32_t                         depth     = 0;   // nested metrics_scope count
+   };
+
+   inline pending_metrics_t& pending_metrics() {
+      static pending_metrics_t pending;
+      return pending;
+   }
+
+   // counts one action hit, and flushes the pending counts when the outermost scope ends
+   class metrics_scope {
+      public:
+         metrics_scope( const eosio::name& self, const eosio::name& action ) : self(self) {
+            auto& pending = pending_metrics();
+            pending.depth++;
+            pending.counters[action]++;
+         }
+
+         ~metrics_scope() {
+            auto& pending = pending_metrics();
+            if( --pending.depth > 0 ) return;
+
+            metrics_table table( self, self.value );
+            auto m = table.get_or_default();
+            for( const auto& c : pending.counters ) {
+               m.counters[c.first] += c.second;
+            }
+            m.db_reads  += pending.db_reads;
+            m.db_writes += pending.db_writes;
+            table.set( m, self );
+
+            pending = pending_metrics_t();
+         }
+
+      private:
+         eosio::name self;
+   };
+
+   inline metrics_t get_metrics( const eosio::name& self ) {
+      metrics_table table( self, self.value );
+      return table.get_or_default();
+   }
+
+}
+
+#define METRICS_ACTION(action)   HEAP_STATS_SCOPE(action) hagglex::metrics_scope metrics_scope_( get_self(), action )
+#define METRICS_BRANCH(branch)   (hagglex::pending_metrics().counters[branch]++)
+#define METRICS_DB_READ(n)       (hagglex::pending_metrics().db_reads += (n))
+#define METRICS_DB_WRITE(n)      (hagglex::pending_metrics().db_writes += (n))
+
+#else
+
+#define METRICS_ACTION(action)   HEAP_STATS_SCOPE(action)
+#define METRICS_BRANCH(branch)
+#define METRICS_DB_READ(n)
+#define METRICS_DB_WRITE(n)
+
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <eosio/asset.hpp>
+
+#include <hagglex_common/inline_action.hpp>
+
+#include <algorithm>
+#include <string_view>
+
+// Outgoing token transfers of one action, coalesced. A contract queues its payments with
+// pay() instead of sending each one: payments in the same token (contract and symbol) to
+// the same recipient add up, and flush() sends one transfer per recipient, ordered by
+// token contract, recipient and symbol. A transfer of several payments carries the
+// outbox's merged memo, '#' standing for their number ("Interest Payment from #
+// positions"), or without one the memo of the first payment; the log actions still
+// record every payment on its own.
+
+namespace hagglex {
+
+   template<size_t Slots = 4, size_t MemoCapacity = 96>
+   class transfer_outbox {
+      public:
+         explicit transfer_outbox( eosio::name self, std::string_view merged_memo = {} )
+            : self(self), merged_memo(merged_memo) {}
+
+         // the contract is destroyed once its action returns; anything still queued goes then
+         ~transfer_outbox() { flush(); }
+
+         transfer_outbox( const transfer_outbox& ) = delete;
+         transfer_outbox& operator=( const transfer_outbox& ) = delete;
+
+         void pay( const eosio::name& token_contract, const eosio::name& to, const eosio::asset& quantity,
+                   std::string_view memo ) {
+            for( size_t i = 0; i < used; ++i ) {
+               payment& p = queue[i];
+               if( p.token_contract == token_contract && p.to == to && p.quantity.symbol == quantity.symbol ) {
+                  p.quantity += quantity;
+                  ++p.merged;
+                  return;
+               }
+            }
+            // more recipients than slots: send what is queued and start over
+            if( used == Slots ) flush();
+            payment& p = queue[used++];
+            p.token_contract = token_contract;
+            p.to = to;
+            p.quantity = quantity;
+            p.merged = 1;
+            p.memo = {};
+            p.memo << memo;
+         }
+
+         // sends the queued transfers now; an inline action that must follow them, such as
+         // blacklisting the recipient, is sent after an explicit flush
+         void flush() {
+            std::sort( queue, queue + used, []( const payment& a, const payment& b ) {
+               if( a.token_contract != b.token_contract ) return a.token_contract < b.token_contract;
+               if( a.to != b.to ) return a.to < b.to;
+               return a.quantity.symbol.raw() < b.quantity.symbol.raw();
+            });
+            for( size_t i = 0; i < used; ++i ) {
+               payment& p = queue[i];
+               if( p.merged > 1 && !merged_memo.empty() ) {
+                  const size_t at = merged_memo.find( '#' );
+                  p.memo = {};
+                  if( at == std::string_view::npos ) p.memo << merged_memo;
+                  else p.memo << merged_memo.substr( 0, at ) << uint64_t(p.merged) << merged_memo.substr( at + 1 );
+               }
+               send_transfer( self, p.token_contract, self, p.to, p.quantity, p.memo );
+            }
+            used = 0;
+         }
+
+      private:
+         struct payment {
+            eosio::name                   token_contract;
+            eosio::name                   to;
+            eosio::asset                  quantity;
+            uint32_t                      merged;     // payments added up in this one
+            fixed_string<MemoCapacity>    memo;
+         };
+
+         eosio::name       self;
+         std::string_view  merged_memo;
+         payment           queue[Slots];
+         size_t            used = 0;
+   };
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <eosio/datastream.hpp>
+#include <eosio/eosio.hpp>
+#include <eosio/multi_index.hpp>
+
+#include <hagglex_common/errors.hpp>
+
+// Row access through the db intrinsics, with each row packed in a stack buffer.
+//
+// multi_index heap-allocates a cached object for every row it loads, plus the vector
+// tracking them, and the contract allocator never frees. These helpers read and write
+// fixed-size rows without touching the heap, for the hot paths. The layout is the one
+// multi_index uses, so both can serve the same table, with two rules: a row written
+// here must not also be held by a multi_index instance in the same action, and rows
+// stored here must have their secondary index entries stored too (see index_table).
+
+namespace hagglex::raw {
+
+   using namespace eosio::internal_use_do_not_use;
+
+   inline constexpr size_t max_row_size = 512;
+
+   // table holding secondary index `number` (0-based, in indexed_by order) of a multi_index
+   constexpr uint64_t index_table( eosio::name table, uint8_t number ) {
+      return (table.value & 0xFFFFFFFFFFFFFFF0ULL) | (number & 0x000000000000000FULL);
+   }
+
+   // iterator of a row, negative when there is none
+   inline int32_t find( eosio::name code, uint64_t scope, eosio::name table, uint64_t primary_key ) {
+      return db_find_i64( code.value, scope, table.value, primary_key );
+   }
+
+   inline bool exists( eosio::name code, uint64_t scope, eosio::name table, uint64_t primary_key ) {
+      return find( code, scope, table, primary_key ) >= 0;
+   }
+
+   // copies the packed row at `itr` into `buffer` and returns its size
+   inline size_t read_bytes( int32_t itr, char* buffer, size_t capacity ) {
+      const int32_t size = db_get_i64( itr, buffer, uint32_t(capacity) );
+      hagglex::check( size <= int32_t(capacity), errors::common::row_too_large );
+      return size_t(size);
+   }
+
+   template<typename T, size_t Capacity = max_row_size>
+   T read( int32_t itr ) {
+      char buffer[Capacity];
+      eosio::datastream<const char*> ds( buffer, read_bytes( itr, buffer, Capacity ) );
+      T row;
+      ds >> row;
+      return row;
+   }
+
+   // reads a row into `row`; false, leaving `row` alone, when there is none
+   template<typename T, size_t Capacity = max_row_size>
+   bool get( eosio::name code, uint64_t scope, eosio::name table, uint64_t primary_key, T& row ) {
+      const int32_t itr = find( code, scope, table, primary_key );
+      if( itr < 0 ) return false;
+      row = read<T, Capacity>( itr );
+      return true;
+   }
+
+   // rewrites the row at `itr`; a payer of same_payer keeps the current one
+   template<typename T, size_t Capacity = max_row_size>
+   void update( int32_t itr, eosio::name payer, const T& row ) {
+      char buffer[Capacity];
+      eosio::datastream<char*> ds( buffer, Capacity );
+      ds << row;
+      db_update_i64( itr, payer.value, buffer, uint32_t(ds.tellp()) );
+   }
+
+   template<typename T, size_t Capacity = max_row_size>
+   int32_t store( uint64_t scope, eosio::name table, eosio::name payer, uint64_t primary_key, const T& row ) {
+      char buffer[Capacity];
+      eosio::datastream<char*> ds( buffer, Capacity );
+      ds << row;
+      return db_store_i64( scope, table.value, payer.value, primary_key, buffer, uint32_t(ds.tellp()) );
+   }
+
+   // updates the row when it exists and stores it otherwise
+   template<typename T, size_t Capacity = max_row_size>
+   void set( eosio::name code, uint64_t scope, eosio::name table, uint64_t primary_key, eosio::name payer, const T& row ) {
+      const int32_t itr = find( code, scope, table, primary_key );
+      if( itr >= 0 ) update<T, Capacity>( itr, payer, row );
+      else store<T, Capacity>( scope, table, payer, primary_key, row );
+   }
+
+   // removes the row at `itr`, refunding its payer; a row with secondary indexes needs its
+   // index entries removed too
+   inline void erase( int32_t itr ) {
+      db_remove_i64( itr );
+   }
+
+   // calls f(itr) for the rows of a table in primary key order, from the first key not
+   // below `primary_key`, until f returns false. f may erase the row it is given.
+   template<typename F>
+   void walk( eosio::name code, uint64_t scope, eosio::name table, uint64_t primary_key, F&& f ) {
+      int32_t itr = db_lowerbound_i64( code.value, scope, table.value, primary_key );
+      while( itr >= 0 ) {
+         uint64_t next_key = 0;
+         const int32_t next = db_next_i64( itr, &next_key );
+         if( !f( itr ) ) return;
+         itr = next;
+      }
+   }
+
+   // the primary key multi_index::available_primary_key would hand out
+   inline uint64_t available_primary_key( eosio::name code, uint64_t scope, eosio::name table ) {
+      const int32_t end = db_end_i64( code.value, scope, table.value );
+      if( db_lowerbound_i64( code.value, scope, table.value, 0 ) == end ) return 0;
+      uint64_t last = 0;
+      db_previous_i64( end, &last );
+      return last + 1;
+   }
+
+   // stores a row's entry in its uint64_t secondary index `number`
+   inline void store_secondary( uint64_t scope, eosio::name table, uint8_t number, eosio::name payer,
+                                uint64_t primary_key, uint64_t key ) {
+      db_idx64_store( scope, index_table( table, number ), payer.value, primary_key, &key );
+   }
+
+   // removes a row's entry from its uint64_t secondary index `number`
+   inline void erase_secondary( eosio::name code, uint64_t scope, eosio::name table, uint8_t number, uint64_t primary_key ) {
+      uint64_t secondary = 0;
+      const int32_t itr = db_idx64_find_primary( code.value, scope, index_table( table, number ), &secondary, primary_key );
+      if( itr >= 0 ) db_idx64_remove( itr );
+   }
+
+   // whether a row has `key` in its uint64_t secondary index `number`
+   inline bool has_secondary( eosio::name code, uint64_t scope, eosio::name table, uint8_t number, uint64_t key ) {
+      uint64_t primary = 0;
+      return db_idx64_find_secondary( code.value, scope, index_table( table, number ), &key, &primary ) >= 0;
+   }
+
+   // whether a row has `key` in its uint128_t secondary index `number`
+   inline bool has_secondary( eosio::name code, uint64_t scope, eosio::name table, uint8_t number, const uint128_t& key ) {
+      uint64_t primary = 0;
+      return db_idx128_find_secondary( code.value, scope, index_table( table, number ), &key, &primary ) >= 0;
+   }
+
+   // calls f(primary_key) for every row whose uint64_t secondary index `number` equals key,
+   // in primary key order, until f returns false
+   template<typename F>
+   void for_each_secondary( eosio::name code, uint64_t scope, eosio::name table, uint8_t number, uint64_t key, F&& f ) {
+      const uint64_t index = index_table( table, number );
+      uint64_t secondary = key;
+      uint64_t primary = 0;
+      int32_t itr = db_idx64_lowerbound( code.value, scope, index, &secondary, &primary );
+      while( itr >= 0 && secondary == key ) {
+         if( !f( primary ) ) return;
+         itr = db_idx64_next( itr, &primary );
+         if( itr < 0 ) return;
+         // db_idx64_next only reports the primary key; look the secondary up again
+         db_idx64_find_primary( code.value, scope, index, &secondary, primary );
+      }
+   }
+
+   // calls f(secondary, primary_key) for the rows of uint64_t secondary index `number` in
+   // index order, (secondary, primary key), starting at (key, primary_key), until f
+   // returns false. Resuming from the row a previous walk stopped at is one lookup; the
+   // skip over rows sharing `key` is only needed when that row has gone since.
+   template<typename F>
+   void walk_secondary( eosio::name code, uint64_t scope, eosio::name table, uint8_t number,
+                        uint64_t key, uint64_t primary_key, F&& f ) {
+      const uint64_t index = index_table( table, number );
+      uint64_t secondary = 0;
+      uint64_t primary = primary_key;
+      int32_t itr = db_idx64_find_primary( code.value, scope, index, &secondary, primary_key );
+      if( itr < 0 || secondary != key ) {
+         secondary = key;
+         itr = db_idx64_lowerbound( code.value, scope, index, &secondary, &primary );
+         while( itr >= 0 && secondary == key && primary < primary_key ) {
+            itr = db_idx64_next( itr, &primary );
+            if( itr >= 0 ) db_idx64_find_primary( code.value, scope, index, &secondary, primary );
+         }
+      }
+      while( itr >= 0 ) {
+         if( !f( secondary, primary ) ) return;
+         itr = db_idx64_next( itr, &primary );
+         if( itr < 0 ) return;
+         db_idx64_find_primary( code.value, scope, index, &secondary, primary );
+      }
+   }
+
+}
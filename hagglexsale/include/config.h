@@ -13,6 +13,29 @@
 #define RATE 1
 #define RATE2 1.5
 
+// fee charged on every EOS or VOICE purchase, in basis points (3%)
+#define FEE_BPS 300
+
+// oracle prices are HAG units per payment unit, scaled by PRICE_SCALE
+#define PRICE_SCALE 1000000
+
+// prices used while no oracle feed exists for a currency (3.14 HAG per EOS, 2.38 HAG per VOICE)
+#define DEFAULT_EOS_PRICE 3140000
+#define DEFAULT_VOICE_PRICE 2380000
+
+// samples kept in each price feed ring; the TWAP window spans all of them
+#define PRICE_SAMPLES 24
+
+// purchases are refused when the newest oracle sample is older than this (seconds)
+#define PRICE_MAX_AGE 3600
+
+// purchase totals are kept in this many counter rows, picked by buyer, so purchases
+// by different buyers do not all write the one state row
+#define SALE_SHARDS 16
+
+// gc erases at most this many deposit rows per call
+#define MAX_GC_ROWS 100
+
 
 #define ADMIN tokensaleadm
 
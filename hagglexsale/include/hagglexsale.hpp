@@ -6,6 +6,15 @@
 #include <eosio/system.hpp>
 #include <eosio/asset.hpp>
 
+#include <hagglex_common/asset_math.hpp>
+#include <hagglex_common/constants.hpp>
+#include <hagglex_common/errors.hpp>
+#include <hagglex_common/events.hpp>
+#include <hagglex_common/gc.hpp>
+#include <hagglex_common/inline_action.hpp>
+#include <hagglex_common/metrics.hpp>
+#include <hagglex_common/raw_table.hpp>
+
 using namespace std;
 using namespace eosio;
 
@@ -18,8 +27,8 @@ CONTRACT hagglexsale : public contract
         contract(receiver, code, ds),
         state_singleton(get_self(), get_self().value), // code and scope both set to the contract's account
         reserved_singleton(get_self(), get_self().value),
-        state(state_singleton.get_or_default(default_state())),
-        reserved(reserved_singleton.get_or_default(default_reserved()))        
+        state(load_singleton("state"_n, default_state())),
+        reserved(load_singleton("reserved"_n, default_reserved()))
         //state(state_singleton.exists() ? state_singleton.get() : default_state()), // get the singleton if it exists already
         //reserved(reserved_singleton.exists() ? reserved_singleton.get() : default_reserved())
         {}
@@ -27,15 +36,19 @@ CONTRACT hagglexsale : public contract
     // destructor
     ~hagglexsale() 
     {
-        state_singleton.set(state, get_self()); // persist the state of the crowdsale before destroying instance
+        // read-only actions and purchases settled on a shard leave the stored state untouched
+        if (state_unchanged) return;
 
-        print("\nSaving state to the RAM");
-        print(state.toString());
+        store_singleton("state"_n, state); // persist the state of the crowdsale before destroying instance
 
-        reserved_singleton.set(reserved, get_self()); // persist the state of the crowdsale before destroying instance
+        store_singleton("reserved"_n, reserved); // persist the state of the crowdsale before destroying instance
 
+#ifdef HAGGLEX_DEBUG
+        print("\nSaving state to the RAM");
+        state.print();
         print("Saving state to the RAM ");
-        print(reserved.toString());   
+        reserved.print();
+#endif
     }
 
     ACTION init(const name& admin, const eosio::time_point_sec& start, const eosio::time_point_sec& finish); // initialize the crowdsale
@@ -50,7 +63,40 @@ CONTRACT hagglexsale : public contract
 
     ACTION pause(); // for pause/unpause contract
 
-    ACTION finalize(); // for unlocking the transfer of tokens after ICO sale
+    // ends the sale for good: unlocks the transfer of HAG, and from then on every purchase
+    // and quote fails with "Crowdsale has been finalized", before and after gc has erased
+    // the deposits that MAX_CONTRIB is checked against
+    ACTION finalize();
+
+    ACTION gc(const uint32_t& max_rows); // erase up to max_rows deposits of a finalized sale that has ended or is paused; anyone may call it
+
+    // result of pricing a purchase, returned by the quote action
+    struct quote_t
+    {
+        asset   tokens;           // HAG the buyer would receive
+        asset   fees;             // fees taken from the payment
+        asset   remaining_cap;    // HAG the buyer may still receive after this payment
+        asset   remaining_goal;   // HAG left to sell before GOAL after this payment
+    };
+
+    // read-only quote of a payment, priced by the same code path as buyhagglex
+    [[eosio::action, eosio::read_only]]
+    quote_t quote(const name& buyer, const asset& quantity);
+
+    ACTION setfeed(const symbol& currency, const name& oracle); // create a price feed for EOS or VOICE, or change its oracle
+
+    ACTION pushprice(const symbol& currency, const uint64_t& price); // oracle pushes a new price sample
+
+    // log actions, sent by this contract to itself for indexers to read from the action
+    // traces, see hagglex_common/events.hpp
+    ACTION logbuy(const name& buyer, const asset& paid, const asset& fees, const asset& tokens, const bool& returning);
+    ACTION logissue(const name& to, const asset& quantity, const uint64_t& _class);
+    ACTION logwithdraw(const name& admin, const asset& quantity);
+
+#ifdef HAGGLEX_METRICS
+    [[eosio::action, eosio::read_only]]
+    hagglex::metrics_t getmetrics(); // dump the action and branch counters
+#endif
     
 
     
@@ -58,18 +104,22 @@ CONTRACT hagglexsale : public contract
 
   private:
 
-    const symbol sy_hag = symbol("HAG", 4);
-    const symbol sy_eos = symbol("EOS", 4);
-    const symbol sy_voice = symbol("VOICE", 4);
+    // failure codes of this contract, see hagglex_common/error_codes.hpp
+    using error = hagglex::errors::sale;
+
+    static constexpr symbol sy_hag = hagglex::symbols::hag;
+    static constexpr symbol sy_eos = hagglex::symbols::eos;
+    static constexpr symbol sy_voice = hagglex::symbols::voice;
 
-    const asset zero_hag = asset(0, symbol("HAG", 4 )); 
-    const asset zero_eos = asset(0, symbol("EOS", 4 )); 
-    const asset zero_voice = asset(0, symbol("VOICE", 4 )); 
+    const asset zero_hag = asset(0, sy_hag); 
+    const asset zero_eos = asset(0, sy_eos); 
+    const asset zero_voice = asset(0, sy_voice); 
 
     
 
 
-    // type for defining state
+    // type for defining state; the totals are exact only after merge_shards, purchases
+    // since then are still on the shards
     struct state_t
     {
         name                admin;
@@ -81,17 +131,15 @@ CONTRACT hagglexsale : public contract
         time_point_sec      finish;
         bool                pause;
 
-        // utility method for converting this object to string
-        string toString()
+        // print this object without building a string
+        void print() const
         {
-            string str =    " RECIPIENT " + admin.to_string() +
-                            " \nPAUSED " + std::to_string(pause) +
-                            " \nHAG TOKENS " + std::to_string(total_hag_tokens/10000) +
-                            " \nALL EOSIO TOKENS " + std::to_string(total_eosio_tokens/10000) +
-                            " \nSTART " + std::to_string(start.utc_seconds) +
-                            " \nFINISH " + std::to_string(finish.utc_seconds);
-
-        return str;
+            eosio::print(" RECIPIENT ", admin,
+                         " \nPAUSED ", uint64_t(pause),
+                         " \nHAG TOKENS ", total_hag_tokens/10000,
+                         " \nALL EOSIO TOKENS ", total_eosio_tokens/10000,
+                         " \nSTART ", start.utc_seconds,
+                         " \nFINISH ", finish.utc_seconds);
         }
     };
 
@@ -107,22 +155,81 @@ CONTRACT hagglexsale : public contract
         asset class7;
         asset class8;
 
-        // utility method for converting this object to string
-        std::string toString()
+        // print this object without building a string
+        void print() const
         {
-            std::string str = " Core Team "  + std::to_string(class1.amount/10000)  +
-                              " Advisors " +  std::to_string(class2.amount/10000)  +
-                              " Core Investors " + std::to_string(class3.amount/10000) +
-                              " Reserved " +  std::to_string(class4.amount/10000)  +
-                              " ICO " + std::to_string(class5.amount) +
-                              " Charity " + std::to_string(class6.amount/10000) +
-                              " Founding Team " + std::to_string(class7.amount/10000) +
-                              " Airgrab " + std::to_string(class8.amount/10000);
-
-            return str;
+            eosio::print(" Core Team ", class1.amount/10000,
+                         " Advisors ", class2.amount/10000,
+                         " Core Investors ", class3.amount/10000,
+                         " Reserved ", class4.amount/10000,
+                         " ICO ", class5.amount,
+                         " Charity ", class6.amount/10000,
+                         " Founding Team ", class7.amount/10000,
+                         " Airgrab ", class8.amount/10000);
         }
     };
 
+    // one oracle observation of a payment currency
+    struct price_sample_t
+    {
+        time_point_sec      time;
+        uint64_t            price;          // HAG units per payment unit, scaled by PRICE_SCALE
+        uint128_t           cumulative;     // sum of price * seconds from the first sample up to time
+    };
+
+    // fixed-capacity ring buffer of oracle prices for one payment currency.
+    // samples is sized once when the feed is created, so the row never grows; every
+    // sample carries the running price-seconds sum, so push and twap are both O(1)
+    struct pricefeed_t
+    {
+        name                        oracle;
+        uint32_t                    head;       // slot of the newest sample
+        uint32_t                    count;      // samples held, at most samples.size()
+        vector<price_sample_t>      samples;
+
+        // packed sizes of a sample (time, price, cumulative) and of what precedes the
+        // samples (oracle, head, count, at most 5 bytes of varuint32 length), so
+        // current_price can size a buffer that holds the whole row
+        static constexpr size_t packed_sample_size = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint128_t);
+        static constexpr size_t packed_header_size = sizeof(uint64_t) + 2 * sizeof(uint32_t) + 5;
+
+        const price_sample_t& newest() const { return samples[head]; }
+
+        const price_sample_t& oldest() const
+        {
+            return samples[(head + samples.size() + 1 - count) % samples.size()];
+        }
+
+        // overwrite the oldest slot with a new sample
+        void push(const time_point_sec& now, uint64_t price)
+        {
+            uint128_t cumulative = 0;
+            if (count > 0)
+            {
+                const price_sample_t& last = newest();
+                cumulative = last.cumulative + uint128_t(last.price) * (now.utc_seconds - last.time.utc_seconds);
+                head = (head + 1) % samples.size();
+            }
+
+            samples[head] = price_sample_t{now, price, cumulative};
+            if (count < samples.size()) count++;
+        }
+
+        // time-weighted average price from the oldest sample up to now
+        uint64_t twap(const time_point_sec& now) const
+        {
+            return twap(oldest(), newest(), now);
+        }
+
+        static uint64_t twap(const price_sample_t& first, const price_sample_t& last, const time_point_sec& now)
+        {
+            const uint32_t elapsed = now.utc_seconds - first.time.utc_seconds;
+            if (elapsed == 0) return last.price;
+
+            const uint128_t cumulative = last.cumulative + uint128_t(last.price) * (now.utc_seconds - last.time.utc_seconds);
+            return uint64_t((cumulative - first.cumulative) / elapsed);
+        }
+    };
   
     // table for holding investors information
     TABLE deposit_t
@@ -133,12 +240,46 @@ CONTRACT hagglexsale : public contract
         uint64_t primary_key() const { return account.value; }
     };
 
+    // purchase totals added by one shard since the last merge
+    struct sale_totals_t
+    {
+        uint64_t    hag_tokens;
+        uint64_t    eos_tokens;
+        uint64_t    voice_tokens;
+        uint64_t    eosio_tokens;
+        int64_t     class5_spent;       // taken off reserved.class5
+
+        sale_totals_t& operator+=(const sale_totals_t& o)
+        {
+            hag_tokens += o.hag_tokens;
+            eos_tokens += o.eos_tokens;
+            voice_tokens += o.voice_tokens;
+            eosio_tokens += o.eosio_tokens;
+            class5_spent += o.class5_spent;
+            return *this;
+        }
+    };
+
+    // one of SALE_SHARDS counter rows. A purchase adds to its buyer's shard as long as the
+    // shard stays within its allowance, a share of the HAG left before GOAL handed out at
+    // the last merge, so the sum of all shards never takes the sale past GOAL
+    TABLE shard_t
+    {
+        uint64_t        id;
+        uint64_t        allowance;
+        sale_totals_t   totals;
+        uint64_t primary_key() const { return id; }
+    };
+
     // persists the state of the aplication in a singleton. Only one instance will be strored in the RAM for this application
     eosio::singleton<"state"_n, state_t> state_singleton;
 
         // persists the state of reserved tokens 
     eosio::singleton<"reserved"_n, reserved_t> reserved_singleton;
 
+    // price feed of a payment currency, scoped by its symbol code
+    typedef eosio::singleton<"pricefeed"_n, pricefeed_t> pricefeeds;
+
     // store investors and balances with contributions in the RAM
     typedef eosio::multi_index<"deposit"_n, deposit_t> deposits;
 
@@ -148,6 +289,76 @@ CONTRACT hagglexsale : public contract
     // holds reserved tokens state for all classes
     reserved_t reserved;
 
+    // set by read-only actions, and by purchases that only touched a shard, so the
+    // destructor does not persist the singletons
+    bool state_unchanged = false;
+
+    // a priced purchase, see price_purchase
+    struct purchase_t
+    {
+        asset       fees;
+        int64_t     tokens_to_give;
+        int64_t     contributed;      // tokens already on the buyer's deposit
+        bool        returning;        // buyer already has a deposit row
+    };
+
+    // validate a payment against the sale state and price it, without changing any state
+    purchase_t price_purchase(const name& buyer, const asset& quantity);
+
+    // finalize writes gc's cursor row and nothing erases it, so it records that the sale
+    // was finalized for as long as the contract lives
+    bool is_finalized() const
+    {
+        return hagglex::raw::exists(get_self(), get_self().value, "gccursor"_n, "gccursor"_n.value);
+    }
+
+    // shard of a buyer, see config.h SALE_SHARDS
+    static uint64_t shard_of(const name& buyer);
+
+    shard_t load_shard(uint64_t id) const
+    {
+        shard_t shard{id, 0, sale_totals_t{0, 0, 0, 0, 0}};
+        hagglex::raw::get(get_self(), get_self().value, "shard"_n, id, shard);
+        return shard;
+    }
+
+    // add a shard's totals to state and reserved
+    void apply_totals(const sale_totals_t& totals)
+    {
+        state.total_hag_tokens += totals.hag_tokens;
+        state.total_eos_tokens += totals.eos_tokens;
+        state.total_voice_tokens += totals.voice_tokens;
+        state.total_eosio_tokens += totals.eosio_tokens;
+        reserved.class5.amount -= totals.class5_spent;
+    }
+
+    // purchases not merged into state yet, summed over every shard; writes nothing
+    sale_totals_t pending_totals() const;
+
+    // fold every shard into state and reserved; the caller ends with refill_shards
+    void fold_shards();
+
+    // zero every shard and share the HAG left before GOAL out between them
+    void refill_shards();
+
+    // current HAG price of a payment currency: the feed's TWAP, or the default when no feed has samples
+    uint64_t current_price(const symbol& currency);
+
+    // a singleton of this contract read and written through hagglex::raw, off the heap
+    template<typename T>
+    T load_singleton(const name& table, const T& def) const
+    {
+        T value = def;
+        hagglex::raw::get(get_self(), get_self().value, table, table.value, value);
+        return value;
+    }
+
+    template<typename T>
+    void store_singleton(const name& table, const T& value)
+    {
+        hagglex::raw::set(get_self(), get_self().value, table, table.value, get_self(), value);
+    }
+
     // a utility function to return default parameters for the state of the crowdsale
     state_t default_state() const
     {
@@ -178,43 +389,37 @@ CONTRACT hagglexsale : public contract
         return res;
     }
 
-    // handle transfer of tokens
-    void inline_transfer(const name& from, const name& to, asset& quantity, const string& memo){
-        action(
-            eosio::permission_level(get_self(), "active"_n),
-            name("hagglextoken"),
-            name("transfer"),
-            make_tuple(from, to, quantity, name{to}.to_string() +  memo)
-        ).send();
+    // send a transfer of tokens; the memo is the recipient's name followed by `memo`.
+    // Every action of the sale pays once, so there is nothing to coalesce.
+    void inline_transfer(const name& to, const asset& quantity, std::string_view memo){
+        hagglex::fixed_string<96> full_memo;
+        full_memo << to << memo;
+        hagglex::send_transfer(get_self(), hagglex::accounts::token, get_self(), to, quantity, full_memo);
     }
 
     // handle blacklisting of accounts
-    void inline_blacklist(const name& investor, const string& memo) {
-        action(
-            eosio::permission_level(get_self(), "active"_n),
-            name("hagglextoken"),
-            name("blacklist"),
-            make_tuple(investor, memo)
-        ).send();
+    void inline_blacklist(const name& investor, std::string_view memo) {
+        hagglex::inline_action<> act(hagglex::accounts::token, hagglex::actions::blacklist,
+                                     {get_self(), hagglex::permissions::active});
+        act << investor << memo;
+        act.send();
     }
 
     // handle unblacklisting of accounts
     void inline_unblacklist(const name& investor) {
-        action(
-            eosio::permission_level(get_self(), "active"_n),
-            name("hagglextoken"),
-            name("unblacklist"),
-            make_tuple(investor)
-        ).send();
+        hagglex::inline_action<> act(hagglex::accounts::token, hagglex::actions::unblacklist,
+                                     {get_self(), hagglex::permissions::active});
+        act << investor;
+        act.send();
     }
 
 
     //clear blacklist 
     void inline_clrblacklist() {
         action(
-            eosio::permission_level(get_self(), "active"_n),
-            name("hagglextoken"),
-            name("clrblacklist"),
+            eosio::permission_level(get_self(), hagglex::permissions::active),
+            hagglex::accounts::token,
+            hagglex::actions::clrblacklist,
             make_tuple("")
         ).send();
     }
@@ -222,26 +427,17 @@ CONTRACT hagglexsale : public contract
 
     // update contract balances and send HAG tokens to the investor
     void handle_investment(const name& investor, const uint64_t& tokens_to_give){   
-        deposits _deposit(get_self(), get_self().value);
-        auto it = _deposit.find(investor.value);
+        METRICS_DB_READ(1);
+        METRICS_DB_WRITE(1);
 
         // if the depositor account was found, store his updated balance
-        asset entire_tokens = asset(tokens_to_give, symbol("HAG", 4));
+        asset entire_tokens = asset(tokens_to_give, sy_hag);
 
         // if the depositor was not found create a new entry in the database, else update his balance
-            if (it == _deposit.end())
-            {
-                _deposit.emplace(get_self(), [investor, entire_tokens](auto &deposit) {
-                    deposit.account = investor;
-                    deposit.tokens = entire_tokens;
-                });
-            }
-            else
-            {
-                _deposit.modify(it, get_self(), [investor, entire_tokens](auto &deposit) {
-                    deposit.tokens += entire_tokens;
-                });
-            }
+        deposit_t deposit{investor, asset(0, sy_hag)};
+        hagglex::raw::get(get_self(), get_self().value, "deposit"_n, investor.value, deposit);
+        deposit.tokens += entire_tokens;
+        hagglex::raw::set(get_self(), get_self().value, "deposit"_n, investor.value, get_self(), deposit);
 
         //Blacklist the account not to transfer the tokens at first
         inline_blacklist(investor, "ICO Sale");
@@ -1,13 +1,16 @@
 #include <hagglexsale.hpp>
 #include <config.h>                        
 
+static constexpr hagglex::fixed_point fee_rate = hagglex::fixed_point::bps(FEE_BPS);
+
 // initialize the crowdfund
 ACTION hagglexsale::init(const name& admin, const time_point_sec& start, const time_point_sec& finish)
 {
-    check(!state_singleton.exists(), "Already Initialzed");
-    check(start < finish, "Start must be less than finish");
+    METRICS_ACTION("init"_n);
+    hagglex::check(!state_singleton.exists(), error::already_initialized);
+    hagglex::check(start < finish, error::start_after_finish);
     require_auth(get_self());
-    check(admin != get_self(), "Admin should be different than contract deployer");
+    hagglex::check(admin != get_self(), error::admin_is_self);
 
     // update state
     state.admin = admin;
@@ -18,7 +21,7 @@ ACTION hagglexsale::init(const name& admin, const time_point_sec& start, const t
     //Update ICO Reserve(Class5)
     reserved.class5.amount += CLASS5MAX/10000; 
     
-    const asset goal = asset(GOAL, symbol("HAG", 4));
+    const asset goal = asset(GOAL, sy_hag);
 
 }
 
@@ -27,87 +30,225 @@ ACTION hagglexsale::init(const name& admin, const time_point_sec& start, const t
 // handle transfers to this contract
 void hagglexsale::buyhagglex(const name& from, const name& to, asset& quantity, const string& memo)
 {   
+    METRICS_ACTION("buyhagglex"_n);
     //to ensure the conttract is not transfering to itself
     if (to != get_self() || from == get_self())
     {
-        print("These are not the droids you are looking for.");
+        HAGGLEX_PRINT("These are not the droids you are looking for.");
+        METRICS_BRANCH("buyskip"_n);
         return;
     }
 
-    //make sure you are receiving the right coin in exchange to purchase the HAG tokens
-    check(quantity.symbol == sy_eos || quantity.symbol == sy_voice, "Can only buy with EOS or VOICE on this window");
+    hagglex::check( memo.size() <= 256, error::memo_too_long );
+
+    const purchase_t purchase = price_purchase(from, quantity);
+
+    //returning buyers are unblacklisted until handle_investment blacklists them again
+    if(purchase.returning) {
+        METRICS_BRANCH("buyreturn"_n);
+        inline_unblacklist(from);
+    } else {
+        METRICS_BRANCH("buynew"_n);
+    }
+
+    HAGGLEX_PRINT(purchase.fees);
+    const int64_t tokens_to_give = purchase.tokens_to_give;
+    const asset paid = quantity;
+    quantity-=purchase.fees;
+    // dont send fees to _self
+    // else HAG supply would increase
+
+    // the total eoses received, HAG sold and ICO reserve taken by this purchase
+    const sale_totals_t added{
+        uint64_t(tokens_to_give),
+        paid.symbol == sy_eos ? uint64_t(paid.amount) : 0,
+        paid.symbol == sy_voice ? uint64_t(paid.amount) : 0,
+        uint64_t(paid.amount),
+        quantity.amount};
+
+    // while the buyer's shard has allowance left, the other shards together cannot hold
+    // more than theirs, so the sale stays within GOAL without reading them
+    shard_t shard = load_shard(shard_of(from));
+    METRICS_DB_READ(1);
+    if (shard.totals.hag_tokens + added.hag_tokens <= shard.allowance) {
+        METRICS_BRANCH("buyshard"_n);
+        METRICS_DB_WRITE(1);
+        shard.totals += added;
+        hagglex::raw::set(get_self(), get_self().value, "shard"_n, shard.id, get_self(), shard);
+        state_unchanged = true;
+    } else {
+        // allowance used up: merge for the exact total, then hand out what is left
+        METRICS_BRANCH("buymerge"_n);
+        METRICS_DB_READ(SALE_SHARDS);
+        METRICS_DB_WRITE(SALE_SHARDS + 2);
+        fold_shards();
+        hagglex::check(state.total_hag_tokens <= GOAL, error::goal_reached);
+        apply_totals(added);
+        refill_shards();
+    }
+
 
 
-    check( quantity.is_valid(), "invalid quantity" );
-    check( memo.size() <= 256, "memo has more than 256 bytes" );
+    // set the amounts to transfer, then call inline transfer action to update balances in the token contract
+    asset amount = asset(tokens_to_give, sy_hag);
 
-    check(state.pause == false, "Crowdsale has been paused" );
+    //Finally, send the HAG tokens to the to the buyer
+    inline_transfer(from, amount, " purchased HAG tokens SUCCESSFULLY");
+    
+    
+    //enlist investor/buyer and blacklist them; the HAG must reach them first
+    handle_investment(from, tokens_to_give);
+
+    hagglex::send_log(get_self(), "logbuy"_n, from, paid, purchase.fees, amount, purchase.returning);
+
+    HAGGLEX_PRINT(from, " ", to, " ", quantity, " ", memo);
+}
+
+
+
+
+// price a purchase the way buyhagglex does, without touching the sale state
+hagglexsale::quote_t hagglexsale::quote(const name& buyer, const asset& quantity)
+{
+    state_unchanged = true;
+
+    const purchase_t purchase = price_purchase(buyer, quantity);
+
+    const uint64_t sold = state.total_hag_tokens + pending_totals().hag_tokens;
+    hagglex::check(sold <= GOAL, error::goal_reached);
+
+    const int64_t goal_left = GOAL - int64_t(sold) - purchase.tokens_to_give;
+    const int64_t cap_left = MAX_CONTRIB - purchase.contributed - purchase.tokens_to_give;
+
+    quote_t result;
+    result.tokens = asset(purchase.tokens_to_give, sy_hag);
+    result.fees = purchase.fees;
+    result.remaining_cap = asset(cap_left > 0 ? cap_left : 0, sy_hag);
+    result.remaining_goal = asset(goal_left > 0 ? goal_left : 0, sy_hag);
+    return result;
+}
+
+
+
+// validate a payment against the sale state and price it
+hagglexsale::purchase_t hagglexsale::price_purchase(const name& buyer, const asset& quantity)
+{
+    //make sure you are receiving the right coin in exchange to purchase the HAG tokens
+    hagglex::check(quantity.symbol == sy_eos || quantity.symbol == sy_voice, error::buy_currency);
+
+    hagglex::check( quantity.is_valid(), error::invalid_quantity );
+    // quote takes any amount; a negative one would wrap in the uint128_t price below
+    hagglex::check( quantity.amount > 0, error::invalid_quantity );
+
+    hagglex::check(state.pause == false, error::paused);
     
     // check timings of the HAG crowdsale
-    check(current_time_point().sec_since_epoch() >= state.start.utc_seconds, "Crowdsale hasn't started");
+    hagglex::check(current_time_point().sec_since_epoch() >= state.start.utc_seconds, error::not_started);
+
+    // a finalized sale takes no more purchases; gc erases the deposits, so one would
+    // find no deposit and get past MAX_CONTRIB
+    hagglex::check(!is_finalized(), error::finalized);
+
+    purchase_t purchase;
+    purchase.contributed = 0;
+    purchase.returning = false;
 
     //check if account exists with the corresponding balance
-    deposits _deposit(get_self(), get_self().value);
-    auto it = _deposit.find(from.value);
-    if(it != _deposit.end()) {   
-        check((it->tokens.amount + quantity.amount) <= MAX_CONTRIB, "Can not purchase more than the Maximum Contribution");
-        inline_unblacklist(from);
+    deposit_t deposit;
+    METRICS_DB_READ(1);
+    if(hagglex::raw::get(get_self(), get_self().value, "deposit"_n, buyer.value, deposit)) {   
+        hagglex::check((deposit.tokens.amount + quantity.amount) <= MAX_CONTRIB, error::above_max_contribution);
+        purchase.contributed = deposit.tokens.amount;
+        purchase.returning = true;
     }
 
-    // check if the Goal was reached
-    check(state.total_hag_tokens <= GOAL, "GOAL reached");
+    //calculate 3% fees on buying EOS or VOICE
+    //calculate the amount of tokens to give
+    purchase.fees = hagglex::scale(quantity, fee_rate);
+    const uint64_t price = current_price(quantity.symbol);
+    purchase.tokens_to_give = static_cast<int64_t>((uint128_t(quantity.amount) * price / PRICE_SCALE)/RATE);
 
-     //update the total eoses received
-    state.total_eosio_tokens += quantity.amount;
+       // check the minimum and maximum contribution
+    hagglex::check(purchase.tokens_to_give >= MIN_CONTRIB, error::contribution_too_low);
+    hagglex::check(purchase.tokens_to_give <= MAX_CONTRIB, error::contribution_too_high);
 
-    //calculate 3% fees on buying EOS or VOICE
-    //calculate the amount of tokens to give and update the total tokens
-        asset fees ;
-        int64_t tokens_to_give;
-        fees.amount = quantity.amount*0.03;
-    if(quantity.symbol == sy_eos){
-        fees.symbol = sy_eos;  
-        print(fees);
-        state.total_eos_tokens += quantity.amount;
-        tokens_to_give = (quantity.amount * 3.14)/RATE;
-    } else if (quantity.symbol == sy_voice){
-        fees.symbol = sy_voice; 
-        print(fees);
-        state.total_voice_tokens += quantity.amount;
-        tokens_to_give = (quantity.amount * 2.38)/RATE;
+    return purchase;
+}
+
+
+
+
+// names shorter than 12 characters all share their low bits, so hash before reducing
+uint64_t hagglexsale::shard_of(const name& buyer)
+{
+    return (buyer.value * 0x9e3779b97f4a7c15ull >> 32) % SALE_SHARDS;
+}
+
+
+
+// sum of every shard's totals
+hagglexsale::sale_totals_t hagglexsale::pending_totals() const
+{
+    sale_totals_t sum{0, 0, 0, 0, 0};
+    for (uint64_t id = 0; id < SALE_SHARDS; ++id) {
+        sum += load_shard(id).totals;
     }
+    return sum;
+}
 
-    quantity-=fees;
-    // dont send fees to _self
-    // else HAG supply would increase
-  
-    //update the total HAG tokens 
-    state.total_hag_tokens += tokens_to_give; 
 
-       // check the minimum and maximum contribution
-    check(tokens_to_give >= MIN_CONTRIB, "Contribution too low");
-    check(tokens_to_give <= MAX_CONTRIB, "Contribution too high");
 
-    
-    //update the ICO reserve accordingly
-    reserved.class5.amount -= quantity.amount;
+// add every shard to state and reserved, making their totals exact
+void hagglexsale::fold_shards()
+{
+    apply_totals(pending_totals());
+}
 
 
 
-    // set the amounts to transfer, then call inline transfer action to update balances in the token contract
-    asset amount = asset(tokens_to_give, symbol("HAG", 4));
+// zero the shards and give each an equal part of the HAG left before GOAL
+void hagglexsale::refill_shards()
+{
+    const uint64_t left = state.total_hag_tokens < GOAL ? GOAL - state.total_hag_tokens : 0;
+    for (uint64_t id = 0; id < SALE_SHARDS; ++id) {
+        const shard_t shard{id, left / SALE_SHARDS, sale_totals_t{0, 0, 0, 0, 0}};
+        hagglex::raw::set(get_self(), get_self().value, "shard"_n, id, get_self(), shard);
+    }
+}
 
-    //Finally, send the HAG tokens to the to the buyer
-    inline_transfer(get_self(), from, amount, " purchased HAG tokens SUCCESSFULLY");
-    
-    
-    //enlist investor/buyer and blacklist them
-    handle_investment(from, tokens_to_give);
 
-    print(from);
-    print(to);
-    print(quantity);
-    print(memo);
+
+
+// HAG price of a payment currency, read from its oracle feed when one has samples
+uint64_t hagglexsale::current_price(const symbol& currency)
+{
+    // decode only the newest and oldest samples from the packed row, instead of
+    // unpacking the whole ring into a heap vector
+    const int32_t itr = hagglex::raw::find(get_self(), currency.code().raw(), "pricefeed"_n, "pricefeed"_n.value);
+    if (itr >= 0) {
+        char buffer[pricefeed_t::packed_header_size + PRICE_SAMPLES * pricefeed_t::packed_sample_size];
+        datastream<const char*> ds(buffer, hagglex::raw::read_bytes(itr, buffer, sizeof(buffer)));
+        name oracle;
+        uint32_t head, count;
+        unsigned_int slots;
+        ds >> oracle >> head >> count >> slots;
+        if (count > 0) {
+            // every sample packs to the same size, fixed-width fields only
+            constexpr size_t packed_sample_size = pricefeed_t::packed_sample_size;
+            const size_t first_sample = ds.tellp();
+            price_sample_t oldest, newest;
+            ds.seekp(first_sample + packed_sample_size * ((head + slots.value + 1 - count) % slots.value));
+            ds >> oldest;
+            ds.seekp(first_sample + packed_sample_size * head);
+            ds >> newest;
+
+            const time_point_sec now = time_point_sec(current_time_point());
+            hagglex::check(now.utc_seconds - newest.time.utc_seconds <= PRICE_MAX_AGE, error::price_stale);
+            return pricefeed_t::twap(oldest, newest, now);
+        }
+    }
+
+    return currency == sy_eos ? DEFAULT_EOS_PRICE : DEFAULT_VOICE_PRICE;
 }
 
 
@@ -116,47 +257,55 @@ void hagglexsale::buyhagglex(const name& from, const name& to, asset& quantity,
 // issuance of only reserved HAG tokens
 ACTION hagglexsale::issue(const name& to, asset& quantity, const uint64_t& _class, const std::string& memo)
 {
+    METRICS_ACTION("issue"_n);
     require_auth(state.admin);
-    check( is_account( to ), "to account does not exist" );
-    check( quantity.symbol == sy_hag ,"Can issue only HAG coins");
+    hagglex::check( is_account( to ), error::to_account_missing );
+    hagglex::check( quantity.symbol == sy_hag, error::not_hag );
+    // class 5 is the ICO reserve purchases draw on; merge them in first
+    if(_class == 5) {
+        fold_shards();
+        refill_shards();
+    }
     switch(_class){
         case 1:
-        check((reserved.class1.amount + quantity.amount) <= CLASS1MAX, "Cannot issue more than Core Team quantity");
+        hagglex::check((reserved.class1.amount + quantity.amount) <= CLASS1MAX, error::class1_cap);
         reserved.class1 += quantity;
         break;
         case 2:
-        check((reserved.class2.amount + quantity.amount) <= CLASS2MAX, "Cannot issue more than Advisors quantity");
+        hagglex::check((reserved.class2.amount + quantity.amount) <= CLASS2MAX, error::class2_cap);
         reserved.class2 += quantity;
         break;        
         case 3:
-        check((reserved.class3.amount + quantity.amount) <= CLASS3MAX, "Cannot issue more than Core Investors quantity");
+        hagglex::check((reserved.class3.amount + quantity.amount) <= CLASS3MAX, error::class3_cap);
         reserved.class3 += quantity;
         break;
         case 4:
-        check((reserved.class4.amount + quantity.amount) <= CLASS4MAX, "Cannot issue more than Reserved quantity");
+        hagglex::check((reserved.class4.amount + quantity.amount) <= CLASS4MAX, error::class4_cap);
         reserved.class4 += quantity;
         break;
         case 5:
-        check((reserved.class5.amount + quantity.amount) <= CLASS5MAX, "Cannot issue more than ICO quantity");
+        hagglex::check((reserved.class5.amount + quantity.amount) <= CLASS5MAX, error::class5_cap);
         reserved.class5 += quantity;
         break;
         case 6:
-        check((reserved.class6.amount + quantity.amount) <= CLASS6MAX, "Cannot issue more than Charity  quantity");
+        hagglex::check((reserved.class6.amount + quantity.amount) <= CLASS6MAX, error::class6_cap);
         reserved.class6 += quantity;
         case 7:
-        check((reserved.class7.amount + quantity.amount) <= CLASS7MAX, "Cannot issue more than Founding Team quantity");
+        hagglex::check((reserved.class7.amount + quantity.amount) <= CLASS7MAX, error::class7_cap);
         reserved.class7 += quantity;
         break;
         case 8:
-        check((reserved.class8.amount + quantity.amount) <= CLASS8MAX, "Cannot issue more than Airgrab quantity");
+        hagglex::check((reserved.class8.amount + quantity.amount) <= CLASS8MAX, error::class8_cap);
         reserved.class8 += quantity;
         }
 
     // issues HAG tokens to the beneficiary class
-    inline_transfer(get_self(), to, quantity, " got Issued tokens to the Beneficiary Class SUCCESSFULLY");
+    inline_transfer(to, quantity, " got Issued tokens to the Beneficiary Class SUCCESSFULLY");
     
-    //enlist investor/buyer and blacklist them
+    //enlist investor/buyer and blacklist them; the HAG must reach them first
     handle_investment(to, quantity.amount);
+
+    hagglex::send_log(get_self(), "logissue"_n, to, quantity, _class);
 }
 
 
@@ -166,29 +315,36 @@ ACTION hagglexsale::issue(const name& to, asset& quantity, const uint64_t& _clas
 // used by ADMIN to withdraw EOS and VOICE tokens.
 ACTION hagglexsale::withdraw(const symbol_code& sym)
 {
+    METRICS_ACTION("withdraw"_n);
     require_auth(state.admin);
 
     //make sure you are receiving the right coin in exchange to purchase the HAG tokens
-    check(sym.raw() == sy_eos.code().raw() || sym.raw() == sy_voice.code().raw(), "Can only withdraw EOS or VOICE");
+    hagglex::check(sym.raw() == sy_eos.code().raw() || sym.raw() == sy_voice.code().raw(), error::withdraw_currency);
+
+    // the totals paid out below must include the purchases still on the shards
+    fold_shards();
+    refill_shards();
 
-    check(current_time_point().sec_since_epoch() <= state.finish.utc_seconds, "Crowdsale not ended yet" );
-    check(state.total_eosio_tokens <= SOFT_CAP_TKN, "Soft cap was not reached");
+    hagglex::check(current_time_point().sec_since_epoch() <= state.finish.utc_seconds, error::not_ended);
+    hagglex::check(state.total_eosio_tokens <= SOFT_CAP_TKN, error::soft_cap_missed);
 
     
     if(sym.raw() == sy_eos.code().raw()) {
-        asset all_eos = asset(state.total_eos_tokens, symbol("EOS", 4));
+        asset all_eos = asset(state.total_eos_tokens, sy_eos);
 
         //transfer all the EOS on the smart contract account to the Recepient
-        inline_transfer(get_self(), state.admin, all_eos, "withdrew EOS tokens");
+        inline_transfer(state.admin, all_eos, "withdrew EOS tokens");
+        hagglex::send_log(get_self(), "logwithdraw"_n, state.admin, all_eos);
 
         //update the total EOS tokens state to 0;
         state.total_eos_tokens = 0;
     } 
     else if(sym.raw() == sy_voice.code().raw()) {
-         asset all_voice = asset(state.total_eos_tokens, symbol("VOICE", 4));
+         asset all_voice = asset(state.total_eos_tokens, sy_voice);
 
         //transfer all the VOICE on the smart contract account to the Recepient
-        inline_transfer(get_self(), state.admin, all_voice, " withdrew VOICE tokens");
+        inline_transfer(state.admin, all_voice, " withdrew VOICE tokens");
+        hagglex::send_log(get_self(), "logwithdraw"_n, state.admin, all_voice);
 
         //update the totale VOICE tokens state to 0;
         state.total_voice_tokens = 0;
@@ -202,6 +358,7 @@ ACTION hagglexsale::withdraw(const symbol_code& sym)
 // toggles unpause / pause contract
 ACTION hagglexsale::pause()
 {
+    METRICS_ACTION("pause"_n);
     require_auth(state.admin);
     if (state.pause == false){
         state.pause = true; 
@@ -216,6 +373,7 @@ ACTION hagglexsale::pause()
 
 //toggles the unlock of the transfer of HAG tokens
 ACTION hagglexsale::finalize() {
+    METRICS_ACTION("finalize"_n);
     require_auth(state.admin);
 	//check(current_time_point().sec_since_epoch() > state.finish.utc_seconds, "Crowdsale hasn't finished");
 	//check(state.total_eosio_tokens >= SOFT_CAP_TKN, "Soft cap was not reached");
@@ -223,15 +381,123 @@ ACTION hagglexsale::finalize() {
     //Toggle the lock action again to FALSE after the ICO.
 	inline_clrblacklist();
 
-    // Delete all records in _messages table
-    deposits _deposit(get_self(), get_self().value);
-    auto itr = _deposit.begin();
-    while (itr != _deposit.end()) {
-        itr = _deposit.erase(itr);
-  }
+    // the deposits are erased by gc, a bounded batch per call; its cursor row
+    // existing is what lets it start, and what closes the sale (see is_finalized)
+    hagglex::raw::set(get_self(), get_self().value, "gccursor"_n, "gccursor"_n.value, get_self(), hagglex::gc::cursor{0, 0});
     
 }
 
 
 
 
+// erase deposit rows left by a finalized sale, from where the last call stopped;
+// cursor.owner is the account of the next deposit
+ACTION hagglexsale::gc(const uint32_t& max_rows)
+{
+    METRICS_ACTION("gc"_n);
+    state_unchanged = true;
+    hagglex::check(max_rows > 0 && max_rows <= MAX_GC_ROWS, error::gc_rows);
+
+    hagglex::gc::cursor cursor;
+    hagglex::check(hagglex::raw::get(get_self(), get_self().value, "gccursor"_n, "gccursor"_n.value, cursor), error::not_finalized);
+    hagglex::check(state.pause || current_time_point().sec_since_epoch() > state.finish.utc_seconds, error::not_ended);
+
+    // back to the first deposit unless the batch runs out first
+    const uint64_t from = cursor.owner;
+    cursor.owner = 0;
+    uint32_t erased = 0;
+    hagglex::raw::walk(get_self(), get_self().value, "deposit"_n, from, [&](int32_t itr) {
+        const deposit_t deposit = hagglex::raw::read<deposit_t>(itr);
+        if (erased == max_rows) {
+            cursor.owner = deposit.account.value;
+            return false;
+        }
+        hagglex::raw::erase(itr);
+        ++erased;
+        return true;
+    });
+    METRICS_DB_WRITE(erased);
+    hagglex::raw::set(get_self(), get_self().value, "gccursor"_n, "gccursor"_n.value, get_self(), cursor);
+}
+
+
+
+
+
+
+
+
+// create the price feed of a payment currency, or hand it to another oracle
+ACTION hagglexsale::setfeed(const symbol& currency, const name& oracle)
+{
+    METRICS_ACTION("setfeed"_n);
+    require_auth(state.admin);
+    hagglex::check(currency == sy_eos || currency == sy_voice, error::feed_currency);
+    hagglex::check(is_account(oracle), error::oracle_missing);
+
+    pricefeeds feed(get_self(), currency.code().raw());
+    pricefeed_t pf;
+    if (feed.exists()) {
+        pf = feed.get();
+    } else {
+        pf.head = 0;
+        pf.count = 0;
+        pf.samples.resize(PRICE_SAMPLES);
+    }
+    pf.oracle = oracle;
+    feed.set(pf, get_self());
+}
+
+
+
+// record a price sample from the oracle; overwrites the oldest one once the ring is full
+ACTION hagglexsale::pushprice(const symbol& currency, const uint64_t& price)
+{
+    METRICS_ACTION("pushprice"_n);
+    // the feed is scoped by symbol code only; the precision must match too
+    hagglex::check(currency == sy_eos || currency == sy_voice, error::feed_currency);
+    pricefeeds feed(get_self(), currency.code().raw());
+    hagglex::check(feed.exists(), error::no_feed);
+
+    pricefeed_t pf = feed.get();
+    require_auth(pf.oracle);
+    hagglex::check(price > 0, error::price_not_positive);
+
+    const time_point_sec now = time_point_sec(current_time_point());
+    hagglex::check(pf.count == 0 || now > pf.newest().time, error::price_same_second);
+
+    pf.push(now, price);
+    feed.set(pf, get_self());
+}
+
+
+
+
+// log actions: nothing to do but check the sender; the data is in the action trace
+ACTION hagglexsale::logbuy(const name& buyer, const asset& paid, const asset& fees, const asset& tokens, const bool& returning)
+{
+    state_unchanged = true;
+    require_auth(get_self());
+}
+
+ACTION hagglexsale::logissue(const name& to, const asset& quantity, const uint64_t& _class)
+{
+    state_unchanged = true;
+    require_auth(get_self());
+}
+
+ACTION hagglexsale::logwithdraw(const name& admin, const asset& quantity)
+{
+    state_unchanged = true;
+    require_auth(get_self());
+}
+
+
+
+#ifdef HAGGLEX_METRICS
+hagglex::metrics_t hagglexsale::getmetrics()
+{
+    state_unchanged = true;
+    return hagglex::get_metrics(get_self());
+}
+#endif
\ No newline at end of file
@@ -5,6 +5,17 @@
 #include <eosio/asset.hpp>
 #include <math.h>
 
+#include <hagglex_common/asset_math.hpp>
+#include <hagglex_common/constants.hpp>
+#include <hagglex_common/economics.hpp>
+#include <hagglex_common/errors.hpp>
+#include <hagglex_common/events.hpp>
+#include <hagglex_common/gc.hpp>
+#include <hagglex_common/inline_action.hpp>
+#include <hagglex_common/metrics.hpp>
+#include <hagglex_common/outbox.hpp>
+#include <hagglex_common/raw_table.hpp>
+
 using namespace eosio;
 using std::string;
 
@@ -18,11 +29,11 @@ CONTRACT hagglexstake : public contract {
          std::map<name, uint8_t>     settings;
 
 
-         name                    staking_token_contract     = "hagglexstake"_n;
-         symbol                  staking_token_symbol       = symbol ("HAG", 4);
+         name                    staking_token_contract     = hagglex::accounts::stake;
+         symbol                  staking_token_symbol       = hagglex::symbols::hag;
 
-         name                    interest_token_contract    = "hagglextoken"_n;
-         symbol                  interest_token_symbol      = symbol ("HAG", 4);
+         name                    interest_token_contract    = hagglex::accounts::token;
+         symbol                  interest_token_symbol      = hagglex::symbols::hag;
 
          // if staking HAG and paying HAG, this would be the price of HAG.
          float                   staking_token_to_interest_token_price        = 0;
@@ -95,67 +106,169 @@ CONTRACT hagglexstake : public contract {
 
       ACTION rewind (const uint64_t& position_id, const uint32_t& rewind_days);
 
+      // erase balances withdrawn to zero of owners with no positions left, reading at most
+      // max_rows rows (see hagglex_common/gc.hpp); anyone may call it
+      ACTION gc (const uint32_t& max_rows);
+
+      // queue up to MAX_GC_ROWS owners whose staking token balance is already zero, rows
+      // withdrawn before gc existed; the contract pays for their queue entries
+      ACTION gcseed (const std::vector<name>& owners);
+
       [[eosio::on_notify("*::transfer")]]
       void deposit ( const name& from, const name& to, const asset& quantity, const string& memo );
       void withdraw (const name& position_owner, const asset& quantity);
       ACTION withdrawall (const name& position_owner);
 
+      // log actions, sent by this contract to itself for indexers to read from the action
+      // traces, see hagglex_common/events.hpp
+      ACTION logdeposit (const name& owner, const asset& quantity, const asset& balance);
+      ACTION logstake (const uint64_t& position_id, const name& owner, const asset& quantity,
+                       const uint16_t& interest_percent, const time_point_sec& expiration);
+      ACTION logclaim (const uint64_t& position_id, const name& owner, const asset& interest, const asset& interest_paid);
+      ACTION logunstake (const uint64_t& position_id, const name& owner, const asset& quantity);
+      ACTION logwithdraw (const name& owner, const asset& quantity, const asset& balance);
+
+      struct position_interest {
+         Position                position                   ;
+         asset                   accrued_interest           ;     // what claim would pay now
+      };
+
+      struct owner_positions_result {
+         std::vector<position_interest>   positions         ;     // by position_id
+         bool                             more              ;
+         uint64_t                         next_id           ;     // cursor of the next page when more
+      };
+
+      struct expiring_positions_result {
+         std::vector<position_interest>   positions         ;     // soonest expiration first
+         bool                             more              ;
+         time_point_sec                   next_expiration   ;     // cursor of the next page when more
+         uint64_t                         next_id           ;
+      };
+
+      // up to `limit` of owner's positions, from position_id `cursor` on (0 for the first page)
+      [[eosio::action, eosio::read_only]]
+      owner_positions_result getpositions (const name& owner, const uint64_t& cursor, const uint32_t& limit);
+
+      // up to `limit` positions expiring at `from` or later, from position `cursor` among those
+      // expiring exactly at `from` (0 for the first page)
+      [[eosio::action, eosio::read_only]]
+      expiring_positions_result getexpiring (const time_point_sec& from, const uint64_t& cursor, const uint32_t& limit);
+
+#ifdef HAGGLEX_METRICS
+      [[eosio::action, eosio::read_only]]
+      hagglex::metrics_t getmetrics ();
+#endif
+
    private:
-      const uint64_t SCALER   = 1000000;
-      const uint64_t SECONDS_PER_YEAR  =  (uint64_t) 365 * 24 * 60 * 60;
 
-      const uint16_t THREE_MONTHS = 90;
-      const uint16_t SIX_MONTHS = 180;
-      const uint16_t TWELVE_MONTHS = 360;
+      // failure codes of this contract, see hagglex_common/error_codes.hpp
+      using error = hagglex::errors::stake;
 
-      const uint16_t THREE_MONTHS_INTEREST = 15;
-      const uint16_t SIX_MONTHS_INTEREST = 30;
-      const uint16_t TWELVE_MONTHS_INTEREST = 55;
+      // interest this action pays out, one transfer per owner and token when it returns;
+      // claimall and unstake pay through claim, and withdraw flushes its own transfer
+      hagglex::transfer_outbox<> payouts { get_self(), "Interest Payment from # positions" };
+      const uint64_t SCALER   = 1000000;
 
+      // stake durations, their interest and the accrual itself are in
+      // hagglex_common/economics.hpp, shared with tools/stakesim
 
 
 
-      asset adjust_asset(const asset &original_asset, const float &adjustment)
+      asset adjust_asset(const asset &original_asset, const hagglex::fixed_point &adjustment)
       {
-         return asset{static_cast<int64_t>(original_asset.amount * adjustment), original_asset.symbol};
+         return hagglex::scale(original_asset, adjustment);
       }
 
-      asset get_staked_balance (const name& account) {
-         position_table p_t (get_self(), get_self().value);
-         auto owner_index = p_t.get_index<"byowner"_n>();
-         auto owner_itr = owner_index.find (account.value);
-         
-         config_table      config_s (get_self(), get_self().value);
-         config c = config_s.get_or_create (get_self(), config());
-         asset staked_balance { 0, c.staking_token_symbol };
-
-         while (owner_itr != owner_index.end() && owner_itr->position_owner == account) {
-            staked_balance += owner_itr->staked_asset;
-            owner_itr++;
+      // secondary indices of position_table, in indexed_by order
+      enum position_index : uint8_t { by_owner_index, by_amount_index, by_staked_time_index,
+                                      by_expiration_time_index, by_duration_index, by_rate_index };
+
+      // the config fields the hot paths need, decoded from the packed singleton row
+      // without unpacking the settings map; defaults when the row does not exist yet
+      struct config_fields {
+         uint8_t                 active                     = 0;
+         name                    staking_token_contract     = hagglex::accounts::stake;
+         symbol                  staking_token_symbol       = hagglex::symbols::hag;
+         name                    interest_token_contract    = hagglex::accounts::token;
+         symbol                  interest_token_symbol      = hagglex::symbols::hag;
+         float                   staking_token_to_interest_token_price   = 0;
+      };
+
+      config_fields get_config_fields () const {
+         config_fields f;
+         const int32_t itr = hagglex::raw::find (get_self(), get_self().value, "configs"_n, "configs"_n.value);
+         if (itr < 0) return f;
+
+         char buffer[hagglex::raw::max_row_size];
+         datastream<const char*> ds (buffer, hagglex::raw::read_bytes (itr, buffer, sizeof(buffer)));
+         unsigned_int settings;
+         ds >> settings;
+         for (uint32_t i = 0; i < settings.value; ++i) {
+            name     key;
+            uint8_t  value;
+            ds >> key >> value;
+            if (key == "active"_n) f.active = value;
          }
+         ds >> f.staking_token_contract >> f.staking_token_symbol >> f.interest_token_contract >> f.interest_token_symbol
+            >> f.staking_token_to_interest_token_price;
+         return f;
+      }
 
-         return staked_balance;
+      // float row fields (rates, prices) as fixed_point, rounded to SCALER so the float's
+      // representation error does not carry into the interest
+      hagglex::fixed_point from_float (float value) const {
+         return hagglex::fixed_point::ratio (llround (double(value) * SCALER), SCALER);
       }
 
-      asset get_available_balance (const name& account) {
+      // interest accrued on a position and not yet claimed at `now`, economics::claimable
+      // in the interest token. claim pays exactly this amount, and getpositions and
+      // getexpiring report it.
+      asset accrued_interest (const Position& p, const config_fields& c, uint32_t now) const {
+         const uint32_t paid = std::max (p.last_interest_paid_time, p.position_staked_time).sec_since_epoch();
+         const int64_t amount = hagglex::economics::claimable (p.staked_asset.amount, from_float (p.interest_rate), paid,
+                                                               p.position_expiration_time.sec_since_epoch(), now);
+         if (amount == 0) return asset { 0, c.interest_token_symbol };
+
+         const asset interest { amount, p.staked_asset.symbol };
+         if (c.interest_token_symbol == p.staked_asset.symbol) return interest;
+         return hagglex::convert (interest, from_float (c.staking_token_to_interest_token_price), c.interest_token_symbol);
+      }
 
-         config_table      config_s (get_self(), get_self().value);
-         config c = config_s.get_or_create (get_self(), config());
+      position_interest get_position_interest (uint64_t position_id, const config_fields& c, uint32_t now) const {
+         position_interest row;
+         hagglex::raw::get (get_self(), get_self().value, "positions"_n, position_id, row.position);
+         row.accrued_interest = accrued_interest (row.position, c, now);
+         return row;
+      }
+
+      asset get_staked_balance (const name& account, const symbol& staking_token_symbol) {
+         asset staked_balance { 0, staking_token_symbol };
+         hagglex::raw::for_each_secondary (get_self(), get_self().value, "positions"_n, by_owner_index, account.value,
+            [&](uint64_t position_id) {
+               Position p;
+               hagglex::raw::get (get_self(), get_self().value, "positions"_n, position_id, p);
+               staked_balance += p.staked_asset;
+               return true;
+            });
 
-         balance_table balances(get_self(), account.value);
-         auto it = balances.find(c.staking_token_symbol.code().raw());
+         return staked_balance;
+      }
 
-         return it->funds - get_staked_balance (account);
+      bool has_positions (const name& account) const {
+         return hagglex::raw::has_secondary (get_self(), get_self().value, "positions"_n, by_owner_index, account.value);
       }
 
-      uint8_t get_setting (const name& setting) {
-         config_table      config_s (get_self(), get_self().value);
-         config c = config_s.get_or_create (get_self(), config());
+      asset get_available_balance (const name& account) {
+         const config_fields c = get_config_fields ();
+
+         balance b { asset { 0, c.staking_token_symbol } };
+         hagglex::raw::get (get_self(), account.value, "balances"_n, c.staking_token_symbol.code().raw(), b);
 
-         return c.settings[setting];
+         return b.funds - get_staked_balance (account, c.staking_token_symbol);
       }
 
       bool is_paused () {
-         return get_setting("active"_n) == 0;
+         return get_config_fields().active == 0;
       }
 };
\ No newline at end of file
@@ -1,7 +1,14 @@
 #include <hagglexstake.hpp>
 
+// getpositions and getexpiring return at most this many positions per page
+#define MAX_POSITION_PAGE 100
+
+// gc reads at most this many rows per call
+#define MAX_GC_ROWS 100
+
 
 void hagglexstake::setprice (const float& staking_token_to_interest_token_price) {
+   METRICS_ACTION("setprice"_n);
    require_auth (get_self());
 
    config_table      config_s (get_self(), get_self().value);
@@ -14,19 +21,20 @@ void hagglexstake::setprice (const float& staking_token_to_interest_token_price)
 
 void hagglexstake::setconfig (const name& staking_token_contract, const symbol& staking_token_symbol,
                         const name& interest_token_contract, const symbol& interest_token_symbol) {
+   METRICS_ACTION("setconfig"_n);
 
    require_auth (get_self());
 
-   check (is_account(staking_token_contract), "Staking token contract " + 
+   HAGGLEX_CHECK_MSG (is_account(staking_token_contract), error::staking_contract_missing, "Staking token contract " + 
       staking_token_contract.to_string() + " is not a valid account.");
 
-   check (is_account(interest_token_contract), "Interest token contract " + 
+   HAGGLEX_CHECK_MSG (is_account(interest_token_contract), error::interest_contract_missing, "Interest token contract " + 
       interest_token_contract.to_string() + " is not a valid account.");
 
-   check (staking_token_symbol.is_valid(), "Staking token symbol " + 
+   HAGGLEX_CHECK_MSG (staking_token_symbol.is_valid(), error::staking_symbol_invalid, "Staking token symbol " + 
       staking_token_symbol.code().to_string() + " is not a valid symbol.");
 
-   check (interest_token_symbol.is_valid(), "Interest token symbol " + 
+   HAGGLEX_CHECK_MSG (interest_token_symbol.is_valid(), error::interest_symbol_invalid, "Interest token symbol " + 
       interest_token_symbol.code().to_string() + " is not a valid symbol.");
 
    config_table      config_s (get_self(), get_self().value);
@@ -39,47 +47,48 @@ void hagglexstake::setconfig (const name& staking_token_contract, const symbol&
 }
 
 void hagglexstake::deposit (const name& from, const name& to, const asset& quantity, const string& memo) {
+   METRICS_ACTION("deposit"_n);
 
    if (to != get_self()) { return; }
-   if (memo == "NODEPOSIT") { return; }   // use memo of NODEPOSIT to transfer without depositing
+   if (memo == "NODEPOSIT") { METRICS_BRANCH("depskip"_n); return; }   // use memo of NODEPOSIT to transfer without depositing
 
-   config_table      config_s (get_self(), get_self().value);
-   config c = config_s.get_or_create (get_self(), config());
+   const config_fields c = get_config_fields ();
 
-   check (! is_paused(), "HaggleX Token Staking is paused. Try again later.");
-   check (c.staking_token_symbol == quantity.symbol, "Only HAG tokens are allowed. You sent " +
+   hagglex::check (c.active != 0, error::paused);
+   HAGGLEX_CHECK_MSG (c.staking_token_symbol == quantity.symbol, error::wrong_symbol, "Only HAG tokens are allowed. You sent " +
       quantity.symbol.code().to_string() + "; Staking Token symbol: " + c.staking_token_symbol.code().to_string());
 
-   check (c.staking_token_contract == get_first_receiver(), "Only HAG tokens are allowed. You sent from " +
+   HAGGLEX_CHECK_MSG (c.staking_token_contract == get_first_receiver(), error::wrong_contract, "Only HAG tokens are allowed. You sent from " +
       get_first_receiver().to_string() + "; Valid staking token contract: " + c.staking_token_contract.to_string());
 
 
-   balance_table balances(get_self(), from.value);
+   const uint64_t balance_key = quantity.symbol.code().raw();
+   const int32_t it = hagglex::raw::find (get_self(), from.value, "balances"_n, balance_key);
    asset new_balance;
-   auto it = balances.find(quantity.symbol.code().raw());
-   if(it != balances.end()) {
-      check (it->token_contract == get_first_receiver(), "Transfer does not match existing token contract.");
-      balances.modify(it, get_self(), [&](auto& bal){
-         bal.funds += quantity;
-         new_balance = bal.funds;
-      });
+   METRICS_DB_READ(1);
+   METRICS_DB_WRITE(1);
+   if(it >= 0) {
+      METRICS_BRANCH("depadd"_n);
+      balance bal = hagglex::raw::read<balance> (it);
+      hagglex::check (bal.token_contract == get_first_receiver(), error::deposit_contract_changed);
+      bal.funds += quantity;
+      new_balance = bal.funds;
+      hagglex::raw::update (it, get_self(), bal);
    }
    else {
-      balances.emplace(get_self(), [&](auto& bal){
-         bal.funds = quantity;
-         bal.token_contract  = get_first_receiver();
-         new_balance = quantity;
-      });
+      METRICS_BRANCH("depnew"_n);
+      hagglex::raw::store (from.value, "balances"_n, get_self(), balance_key, balance { quantity, get_first_receiver() });
+      new_balance = quantity;
    }
 
-   print ("\n");
-   print(name{from}, " deposited:       ", quantity, "\n");
-   print(name{from}, " funds available: ", new_balance);
-   print ("\n");
+   hagglex::send_log (get_self(), "logdeposit"_n, from, quantity, new_balance);
+
+   HAGGLEX_PRINT (name{from}, " deposited: ", quantity, ", funds available: ", new_balance, "\n");
 }
 
 
 void hagglexstake::setsetting ( const name& setting_name, const uint8_t& setting_value ) {
+   METRICS_ACTION("setsetting"_n);
    require_auth (get_self());
 
    config_table      config_s (get_self(), get_self().value);
@@ -97,34 +106,17 @@ void hagglexstake::activate () {
 }
 
 void hagglexstake::stake (const name& account, const asset& quantity, const uint16_t& staked_duration_days) {
+   METRICS_ACTION("stake"_n);
    
-   check (! is_paused(), "HaggleX Staking contract is paused. Try again later.");
-
-   config_table config_s (get_self(), get_self().value);
-   config c = config_s.get_or_create (get_self(), config());
+   const config_fields c = get_config_fields ();
+   hagglex::check (c.active != 0, error::paused);
    
-   //Check valid duration for staking
-   check(staked_duration_days == THREE_MONTHS || staked_duration_days == SIX_MONTHS || staked_duration_days == TWELVE_MONTHS, "Can only stake for 90Days, 180Days or 360days.");
-
-   //Calculate duration rate 
-   float duration_interest_rate;
-   uint64_t duration_stakers = 0; //
-   if (staked_duration_days == THREE_MONTHS){
-      duration_interest_rate = (float) THREE_MONTHS_INTEREST / 100;
-      duration_stakers++;
-   } 
-   else if (staked_duration_days == SIX_MONTHS){
-      duration_interest_rate = (float) SIX_MONTHS_INTEREST / 100;
-      duration_stakers++;
-   }
-   else if (staked_duration_days == TWELVE_MONTHS){
-      duration_interest_rate = (float) TWELVE_MONTHS_INTEREST / 100;
-      duration_stakers++;
-   } else {
-      print("Invalid Duration");
-      return;
-   }
-   print ("Duration interest rate    : ", std::to_string(duration_interest_rate), "\n");
+   //Check valid duration for staking, and its rate
+   const uint16_t duration_interest_percent = hagglex::economics::interest_percent (staked_duration_days);
+   hagglex::check (duration_interest_percent != 0, error::invalid_duration);
+   const uint64_t duration_stakers = 1;
+   const hagglex::fixed_point duration_interest_rate = hagglex::fixed_point::percent(duration_interest_percent);
+   HAGGLEX_PRINT ("Duration interest rate    : ", duration_interest_percent, "%\n");
 
 
    
@@ -141,74 +133,93 @@ void hagglexstake::stake (const name& account, const asset& quantity, const uint
 
    //Populate the position table
 
-   position_table p_t (get_self(), get_self().value);
-   p_t.emplace (get_self(), [&](auto &p) {
-      p.position_id                          = p_t.available_primary_key();
-      p.position_owner                       = account;
-      p.staked_asset                         = quantity;
-      p.position_expiration_time             = time_point_sec(current_time_point().sec_since_epoch() + staked_duration_days * 24 * 60 * 60);
-      p.interest_rate                        = duration_interest_rate;
-      p.interest_paid                        = asset { 0, c.interest_token_symbol };
-
-      p.three_stakers                        += duration_stakers;
-      p.six_stakers                          += duration_stakers;
-      p.twelve_stakers                       += duration_stakers;
-   });
+   // stored through the db intrinsics, with one entry per position_table index,
+   // so a new position does not load a multi_index row cache
+   Position p;
+   p.position_id                          = hagglex::raw::available_primary_key (get_self(), get_self().value, "positions"_n);
+   p.position_owner                       = account;
+   p.staked_asset                         = quantity;
+   p.position_expiration_time             = time_point_sec(current_time_point().sec_since_epoch() + staked_duration_days * 24 * 60 * 60);
+   p.interest_rate                        = duration_interest_rate.to_double();   // row layout keeps the float
+   p.interest_paid                        = asset { 0, c.interest_token_symbol };
+
+   p.three_stakers                        += duration_stakers;
+   p.six_stakers                          += duration_stakers;
+   p.twelve_stakers                       += duration_stakers;
+
+   const uint64_t scope = get_self().value;
+   hagglex::raw::store (scope, "positions"_n, get_self(), p.position_id, p);
+   hagglex::raw::store_secondary (scope, "positions"_n, by_owner_index, get_self(), p.position_id, p.by_owner());
+   hagglex::raw::store_secondary (scope, "positions"_n, by_amount_index, get_self(), p.position_id, p.by_amount());
+   hagglex::raw::store_secondary (scope, "positions"_n, by_staked_time_index, get_self(), p.position_id, p.by_staked_time());
+   hagglex::raw::store_secondary (scope, "positions"_n, by_expiration_time_index, get_self(), p.position_id, p.by_expiration_time());
+   hagglex::raw::store_secondary (scope, "positions"_n, by_duration_index, get_self(), p.position_id, p.by_duration());
+   hagglex::raw::store_secondary (scope, "positions"_n, by_rate_index, get_self(), p.position_id, p.by_rate());
+
+   hagglex::send_log (get_self(), "logstake"_n, p.position_id, account, quantity, duration_interest_percent,
+                      p.position_expiration_time);
 }
 
 
 void hagglexstake::unstake (const uint64_t& position_id) {
-   check (! is_paused(), "HaggleX Staking contract is paused. Try again later.");
+   METRICS_ACTION("unstake"_n);
+   hagglex::check (! is_paused(), error::paused);
 
-   position_table p_t (get_self(), get_self().value);
-   auto p_itr = p_t.find (position_id);
-   check (p_itr != p_t.end(), "Position ID is not found: " + std::to_string(position_id));
-   require_auth (p_itr->position_owner);
+   // read and erased through the db intrinsics: claim rewrites the same row, which a
+   // multi_index holding it would not see
+   const uint64_t scope = get_self().value;
+   const int32_t p_row = hagglex::raw::find (get_self(), scope, "positions"_n, position_id);
+   HAGGLEX_CHECK_MSG (p_row >= 0, error::position_not_found, "Position ID is not found: " + std::to_string(position_id));
+   const Position position = hagglex::raw::read<Position> (p_row);
+   require_auth (position.position_owner);
 
    // confirm that expiration date has passed
-   check (current_time_point().sec_since_epoch() >= p_itr->position_expiration_time.sec_since_epoch(),
-      "Cannot unstake. Staking time has not yet expired.");
+   hagglex::check (current_time_point().sec_since_epoch() >= position.position_expiration_time.sec_since_epoch(),
+      error::not_expired);
 
-   if (p_itr->last_interest_paid_time < p_itr->position_expiration_time) {
+   if (position.last_interest_paid_time < position.position_expiration_time) {
       claim (position_id);
    }
 
-   p_t.erase (p_itr);
+   hagglex::send_log (get_self(), "logunstake"_n, position_id, position.position_owner, position.staked_asset);
+   for (uint8_t index = by_owner_index; index <= by_rate_index; ++index) {
+      hagglex::raw::erase_secondary (get_self(), scope, "positions"_n, index, position_id);
+   }
+   hagglex::raw::erase (p_row);
 }
 
 
 
 //Withdraw specific amount of tokens from the account after Staking period is over. 
 void hagglexstake::withdraw (const name& position_owner, const asset& quantity) {
+   METRICS_ACTION("withdraw"_n);
    require_auth (position_owner);
-   check (!is_paused(), "HaggleX Staking contract is paused. Try again later.");   
+   const config_fields c = get_config_fields ();
+   hagglex::check (c.active != 0, error::paused);   
 
-   asset available_balance = get_available_balance (position_owner);
-   check (available_balance >= quantity, "Insufficient funds. You requested " +
-      quantity.to_string() + " but your available balance is only " + available_balance.to_string());
+   const int32_t it = hagglex::raw::find (get_self(), position_owner.value, "balances"_n, quantity.symbol.code().raw());
+   hagglex::check (it >= 0, error::no_balance);
+   balance bal = hagglex::raw::read<balance> (it);
 
-   balance_table balances(get_self(), position_owner.value);
-   auto it = balances.find(quantity.symbol.code().raw());
-   balances.modify(it, get_self(), [&](auto& bal){
-      bal.funds -= quantity;
-   });
+   asset available_balance = bal.funds - get_staked_balance (position_owner, c.staking_token_symbol);
+   HAGGLEX_CHECK_MSG (available_balance >= quantity, error::insufficient_funds, "Insufficient funds. You requested " +
+      quantity.to_string() + " but your available balance is only " + available_balance.to_string());
 
-   config_table      config_s (get_self(), get_self().value);
-   config c = config_s.get_or_create (get_self(), config());
+   bal.funds -= quantity;
+   hagglex::raw::update (it, get_self(), bal);
+   if (bal.funds.amount == 0) hagglex::gc::enqueue (get_self(), position_owner, bal.funds.symbol.code(), position_owner);
 
-   string send_memo { "Withdrawal from hagglexstake" };
-   action(
-      permission_level{get_self(), "active"_n},
-      c.interest_token_contract, 
-      "transfer"_n,
-      std::make_tuple(get_self(), position_owner, quantity, send_memo))
-   .send();
+   // the log follows the transfer it records
+   payouts.pay (c.interest_token_contract, position_owner, quantity, "Withdrawal from hagglexstake");
+   payouts.flush ();
+   hagglex::send_log (get_self(), "logwithdraw"_n, position_owner, quantity, bal.funds);
 }
 
 
 
 
 void hagglexstake::withdrawall (const name& position_owner) {
+   METRICS_ACTION("withdrawall"_n);
    require_auth (position_owner);
    withdraw (position_owner, get_available_balance (position_owner));
 }
@@ -217,83 +228,183 @@ void hagglexstake::withdrawall (const name& position_owner) {
 
 
 void hagglexstake::claim (const uint64_t& position_id) {
-   check (! is_paused(), "HaggleX Staking token contract is paused. Try again later.");
-   position_table p_t (get_self(), get_self().value);
-   auto p_itr = p_t.find (position_id);
-   check (p_itr != p_t.end(), "Position ID is not found: " + std::to_string(position_id));
-   require_auth (p_itr->position_owner);
+   METRICS_ACTION("claim"_n);
+   const config_fields c = get_config_fields ();
+   hagglex::check (c.active != 0, error::paused);
+   // the position is read and rewritten through the db intrinsics; the fields claim
+   // changes are not secondary keys, so the index entries stay valid
+   const int32_t p_row = hagglex::raw::find (get_self(), get_self().value, "positions"_n, position_id);
+   HAGGLEX_CHECK_MSG (p_row >= 0, error::position_not_found, "Position ID is not found: " + std::to_string(position_id));
+   Position position = hagglex::raw::read<Position> (p_row);
+   require_auth (position.position_owner);
 
    // confirm that there is interest left to be paid
-   check (p_itr->last_interest_paid_time < p_itr->position_expiration_time,
+   HAGGLEX_CHECK_MSG (position.last_interest_paid_time < position.position_expiration_time, error::nothing_to_claim,
       "Nothing to do. Position has expired and all interest has been claimed. You should unstake it. Position #" +
       std::to_string(position_id));
 
-   // seconds since interest was last claimed
+   const asset interest_to_pay = accrued_interest (position, c, current_time_point().sec_since_epoch());
+   if (interest_to_pay.amount == 0) { METRICS_BRANCH("claimzero"_n); return; }   // keep the fraction accruing
+
+   position.interest_paid += interest_to_pay;
+   position.last_interest_paid_time = time_point_sec(current_time_point());
+   hagglex::raw::update (p_row, get_self(), position);
 
-   uint64_t duration = (p_itr->position_expiration_time.sec_since_epoch() - p_itr->position_staked_time.sec_since_epoch()) / (60 * 60 * 24);
-   auto interest_to_pay;
+   hagglex::fixed_string<64> send_memo;
+   send_memo << "Interest Payment from Position #" << position_id;
+   payouts.pay (c.interest_token_contract, position.position_owner, interest_to_pay, send_memo);
+   hagglex::send_log (get_self(), "logclaim"_n, position_id, position.position_owner, interest_to_pay, position.interest_paid);
+}
 
-   if(duration >= THREE_MONTHS){
-      auto duration_index = p_t.get_index<"byduration"_n>();
-      auto duration_itr = duration_index.find(duration);
-      asset total_staked;
-      
-      while (duration_itr != duration_index.end()) {
-         total_staked += duration_itr=>staked_asset;
-         duration_itr++;
-      }
 
-      interest_to_pay = 
 
-   }
 
- 
+void hagglexstake::claimall (const name& account) {
+   METRICS_ACTION("claimall"_n);
+   require_auth (account);
+   hagglex::check (! is_paused(), error::paused);
+
+   // claim rewrites each position through the db intrinsics, so the owner index is walked
+   // the same way; the fields claim changes are not secondary keys
+   hagglex::raw::walk_secondary (get_self(), get_self().value, "positions"_n, by_owner_index, account.value, 0,
+      [&](uint64_t position_owner, uint64_t position_id) {
+         if (position_owner != account.value) return false;
+         claim (position_id);
+         return true;
+      });
+}
+
+
 
 
+void hagglexstake::rewind (const uint64_t& position_id, const uint32_t& rewind_days) {
+   METRICS_ACTION("rewind"_n);
+   position_table p_t (get_self(), get_self().value);
+   auto p_itr = p_t.find (position_id);
+   HAGGLEX_CHECK_MSG (p_itr != p_t.end(), error::position_not_found, "Position ID is not found: " + std::to_string(position_id));
+   require_auth (get_self());
+
    p_t.modify (p_itr, get_self(), [&](auto &p) {
-      p.interest_paid += interest_to_pay;
-      p.last_interest_paid_time = time_point_sec(current_time_point());
+      p.position_staked_time -= (60 * 60 * 24 * rewind_days);
    });
+}
+
 
-   config_table      config_s (get_self(), get_self().value);
-   config c = config_s.get_or_create (get_self(), config());
 
-   string send_memo { "Interest Payment from Position #" + std::to_string(position_id) };
-   action(
-      permission_level{get_self(), "active"_n},
-      c.interest_token_contract, 
-      "transfer"_n,
-      std::make_tuple(get_self(), p_itr->position_owner, interest_to_pay, send_memo))
-   .send();
+// stake does not check an owner's funds, so a balance at zero can still have positions;
+// those balances are kept for the owner's next deposit to find
+void hagglexstake::gc (const uint32_t& max_rows) {
+   METRICS_ACTION("gc"_n);
+   hagglex::check (max_rows > 0 && max_rows <= MAX_GC_ROWS, error::gc_rows);
+
+   hagglex::gc::sweep (get_self(), max_rows, [&](const hagglex::gc::candidate& c, uint64_t from, uint32_t& budget) {
+      uint64_t resume = 0;
+      const bool staking = has_positions (c.owner);
+      hagglex::raw::walk (get_self(), c.owner.value, "balances"_n, from, [&](int32_t itr) {
+         const balance bal = hagglex::raw::read<balance> (itr);
+         if (budget == 0) {
+            resume = bal.funds.symbol.code().raw();
+            return false;
+         }
+         --budget;
+         if (bal.funds.amount == 0 && !staking) hagglex::raw::erase (itr);
+         return true;
+      });
+      return resume;
+   });
 }
 
 
 
+void hagglexstake::gcseed (const std::vector<name>& owners) {
+   METRICS_ACTION("gcseed"_n);
+   require_auth (get_self());
+   hagglex::check (owners.size() <= MAX_GC_ROWS, error::gc_batch_too_large);
+   const config_fields c = get_config_fields ();
 
-void hagglexstake::claimall (const name& account) {
-   require_auth (account);
-   check (! is_paused(), "HaggleX Staking contract is paused. Try again later.");
+   for (const auto& owner : owners) {
+      const int32_t it = hagglex::raw::find (get_self(), owner.value, "balances"_n, c.staking_token_symbol.code().raw());
+      if (it < 0 || hagglex::raw::read<balance> (it).funds.amount != 0) continue;
+      hagglex::gc::enqueue (get_self(), owner, c.staking_token_symbol.code(), get_self());
+   }
+}
 
-   position_table p_t (get_self(), get_self().value);
-   auto owner_index = p_t.get_index<"byowner"_n>();
-   auto owner_itr = owner_index.find (account.value);
 
-   while (owner_itr != owner_index.end() && owner_itr->position_owner == account) {
-      claim (owner_itr->position_id);
-      owner_itr++;
-   }
+
+// log actions: nothing to do but check the sender; the data is in the action trace
+void hagglexstake::logdeposit (const name& owner, const asset& quantity, const asset& balance) {
+   require_auth (get_self());
 }
 
+void hagglexstake::logstake (const uint64_t& position_id, const name& owner, const asset& quantity,
+                             const uint16_t& interest_percent, const time_point_sec& expiration) {
+   require_auth (get_self());
+}
 
+void hagglexstake::logclaim (const uint64_t& position_id, const name& owner, const asset& interest, const asset& interest_paid) {
+   require_auth (get_self());
+}
 
+void hagglexstake::logunstake (const uint64_t& position_id, const name& owner, const asset& quantity) {
+   require_auth (get_self());
+}
 
-void hagglexstake::rewind (const uint64_t& position_id, const uint32_t& rewind_days) {
-   position_table p_t (get_self(), get_self().value);
-   auto p_itr = p_t.find (position_id);
-   check (p_itr != p_t.end(), "Position ID is not found: " + std::to_string(position_id));
+void hagglexstake::logwithdraw (const name& owner, const asset& quantity, const asset& balance) {
    require_auth (get_self());
+}
 
-   p_t.modify (p_itr, get_self(), [&](auto &p) {
-      p.position_staked_time -= (60 * 60 * 24 * rewind_days);
-   });
-}
\ No newline at end of file
+
+
+hagglexstake::owner_positions_result hagglexstake::getpositions (const name& owner, const uint64_t& cursor, const uint32_t& limit) {
+   hagglex::check (limit <= MAX_POSITION_PAGE, error::page_limit);
+
+   const config_fields c = get_config_fields ();
+   const uint32_t now = current_time_point().sec_since_epoch();
+
+   owner_positions_result result { {}, false, 0 };
+   result.positions.reserve (limit);
+   hagglex::raw::walk_secondary (get_self(), get_self().value, "positions"_n, by_owner_index, owner.value, cursor,
+      [&](uint64_t position_owner, uint64_t position_id) {
+         if (position_owner != owner.value) return false;
+         if (result.positions.size() == limit) {
+            result.more = true;
+            result.next_id = position_id;
+            return false;
+         }
+         result.positions.push_back (get_position_interest (position_id, c, now));
+         return true;
+      });
+   return result;
+}
+
+
+
+hagglexstake::expiring_positions_result hagglexstake::getexpiring (const time_point_sec& from, const uint64_t& cursor, const uint32_t& limit) {
+   hagglex::check (limit <= MAX_POSITION_PAGE, error::page_limit);
+
+   const config_fields c = get_config_fields ();
+   const uint32_t now = current_time_point().sec_since_epoch();
+
+   expiring_positions_result result { {}, false, time_point_sec(), 0 };
+   result.positions.reserve (limit);
+   hagglex::raw::walk_secondary (get_self(), get_self().value, "positions"_n, by_expiration_time_index, from.sec_since_epoch(), cursor,
+      [&](uint64_t expiration, uint64_t position_id) {
+         if (result.positions.size() == limit) {
+            result.more = true;
+            result.next_expiration = time_point_sec(uint32_t(expiration));
+            result.next_id = position_id;
+            return false;
+         }
+         result.positions.push_back (get_position_interest (position_id, c, now));
+         return true;
+      });
+   return result;
+}
+
+
+
+#ifdef HAGGLEX_METRICS
+hagglex::metrics_t hagglexstake::getmetrics () {
+   return hagglex::get_metrics (get_self());
+}
+#endif
\ No newline at end of file
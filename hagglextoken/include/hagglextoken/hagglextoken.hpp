@@ -2,8 +2,18 @@
 
 #include <eosio/asset.hpp>
 #include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
 #include <eosio/system.hpp>
 
+#include <hagglex_common/constants.hpp>
+#include <hagglex_common/economics.hpp>
+#include <hagglex_common/errors.hpp>
+#include <hagglex_common/events.hpp>
+#include <hagglex_common/gc.hpp>
+#include <hagglex_common/metrics.hpp>
+#include <hagglex_common/raw_table.hpp>
+
+#include <hagglextoken/policies.hpp>
 
 #include <string>
 
@@ -15,6 +25,31 @@ using namespace eosio;
 
    using std::string;
 
+   // the token's features, picked by the build options (see CMakeLists.txt); the
+   // sidechain bridge token builds with TOKEN_BLACKLIST and TOKEN_EMISSION off
+   using token_config = hagglex::token::config<
+#ifdef TOKEN_NO_BLACKLIST
+      hagglex::token::no_lock,
+#else
+      hagglex::token::blacklist_lock< hagglex::accounts::sale.value >,
+#endif
+#ifdef TOKEN_NO_EMISSION
+      hagglex::token::no_emission,
+#else
+      hagglex::token::halving_emission,
+#endif
+#ifdef HOLDER_REGISTRY
+      hagglex::token::holder_registry,
+#else
+      hagglex::token::no_holders,
+#endif
+#ifdef HAGGLEX_METRICS
+      hagglex::token::counted_metrics
+#else
+      hagglex::token::no_metrics
+#endif
+   >;
+
    CONTRACT hagglextoken : public contract {
       public:
          using contract::contract;
@@ -44,10 +79,14 @@ using namespace eosio;
          void close( const name& owner, const symbol& symbol );
 
 
+#ifndef TOKEN_NO_EMISSION
          [[eosio::action]]
          void mint(const symbol_code& sym);
+#endif
          
 
+#ifndef TOKEN_NO_BLACKLIST
+         // only the lock policy's authority may change the blacklist
          [[eosio::action]]
          void blacklist( const name& account, const string& memo );
 
@@ -58,59 +97,104 @@ using namespace eosio;
 
          [[eosio::action]]
          void clrblacklist();
+#endif
+
+
+         [[eosio::action]]
+         void snapshot();
+
+
+         // erase balance rows left at zero, reading at most max_rows rows (see
+         // hagglex_common/gc.hpp); anyone may call it
+         [[eosio::action]]
+         void gc( const uint32_t& max_rows );
+
+         // queue up to MAX_GC_ROWS owners whose balance row of the symbol is already zero,
+         // rows emptied before gc existed; the contract pays for their queue entries
+         [[eosio::action]]
+         void gcseed( const symbol_code& sym_code, const std::vector<name>& owners );
+
+
+         [[eosio::action, eosio::read_only]]
+         asset balanceat( const name& owner, const symbol_code& sym_code, const uint64_t& snapshot_id );
+
+
+         struct holder_balance {
+            name     owner;
+            asset    balance;
+            bool     locked;     // owner is on the blacklist, always false without one
+         };
+
+         struct balances_result {
+            asset                    supply;
+            std::vector<holder_balance> holders;
+         };
+
+         [[eosio::action, eosio::read_only]]
+         balances_result getbalances( const std::vector<name>& owners, const symbol_code& sym_code );
+
+#ifdef HAGGLEX_METRICS
+         [[eosio::action, eosio::read_only]]
+         hagglex::metrics_t getmetrics();
+#endif
+
+#ifdef COMPACT_BALANCES
+         // move up to MAX_MIGRATE_BATCH owners' accounts rows into the compact table
+         [[eosio::action]]
+         void migrate( const symbol_code& sym_code, const std::vector<name>& owners );
+#endif
+
+#ifdef HOLDER_REGISTRY
+         // registry row mirroring one accounts row, scoped by symbol code
+         using holder = hagglex::token::holder;
+
+         struct richlist_result {
+            uint64_t             holders;    // balance rows open for the symbol
+            std::vector<holder>  top;        // largest balances first
+         };
+
+         [[eosio::action, eosio::read_only]]
+         richlist_result richlist( const symbol_code& sym_code, const uint32_t& limit );
+#endif
 
 
          static asset get_supply( const name& token_contract_account, const symbol_code& sym_code )
          {
             stats statstable( token_contract_account, sym_code.raw() );
-            const auto& st = statstable.get( sym_code.raw() );
-            return st.supply;
+            auto existing = statstable.find( sym_code.raw() );
+            hagglex::check( existing != statstable.end(), error::symbol_not_found );
+            return existing->supply;
          }
 
 
          static asset get_balance( const name& token_contract_account, const name& owner, const symbol_code& sym_code )
          {
+#ifdef COMPACT_BALANCES
+            compact_accounts compacttable( token_contract_account, sym_code.raw() );
+            auto cac = compacttable.find( owner.value );
+            if( cac != compacttable.end() ) return asset{cac->amount, get_supply( token_contract_account, sym_code ).symbol};
+#endif
             accounts accountstable( token_contract_account, owner.value );
-            const auto& ac = accountstable.get( sym_code.raw() );
-            return ac.balance;
+            auto ac = accountstable.find( sym_code.raw() );
+            hagglex::check( ac != accountstable.end(), error::no_balance );
+            return ac->balance;
          }
 
 
+         // like get_balance, but an owner without a balance row holds zero
+         static asset get_balance( const name& token_contract_account, const name& owner, const symbol& sym )
+         {
+#ifdef COMPACT_BALANCES
+            compact_accounts compacttable( token_contract_account, sym.code().raw() );
+            auto cac = compacttable.find( owner.value );
+            if( cac != compacttable.end() ) return asset{cac->amount, sym};
+#endif
+            accounts accountstable( token_contract_account, owner.value );
+            auto ac = accountstable.find( sym.code().raw() );
+            return ac == accountstable.end() ? asset{0, sym} : ac->balance;
+         }
 
-         asset get_reward( asset currentsupply, symbol_code sym ){
-
-            asset reward;
-
-            if (currentsupply.amount/10000 <= 233600 ){ //halvening 0
-               reward =  asset(160, symbol(sym, 4));
-            }
-            else if (currentsupply.amount/10000 <= 116800) {//halvening 1
-               reward =  asset(80, symbol(sym, 4));
-            }
-            else if (currentsupply.amount/10000 <= 58400) {//halvening 2
-               
-               reward =  asset(40, symbol(sym, 4));
-            }
-            else if (currentsupply.amount/10000 <= 29200) { //halvening 3
-               
-               reward =  asset(20, symbol(sym, 4));
-            }
-            else if (currentsupply.amount/10000 <= 14600) { //halvening 4
-               
-               reward =  asset(10, symbol(sym, 4));
-            }
-            else if (currentsupply.amount/10000 <= 7300) { //halvening 5
-               
-               reward =  asset(5, symbol(sym, 4));
-            }
-            else {
-
-               reward =  asset(0, symbol(sym, 4));
-            }
-            return reward;
-         } 
 
-   
 
          using create_action = eosio::action_wrapper<"create"_n, &hagglextoken::create>;
          using issue_action = eosio::action_wrapper<"issue"_n, &hagglextoken::issue>;
@@ -121,6 +205,15 @@ using namespace eosio;
 
          
       private:
+
+         // failure codes of this contract, see hagglex_common/error_codes.hpp
+         using error = hagglex::errors::token;
+
+         using lock = token_config::lock;
+         using emission = token_config::emission;
+         using holder_tracking = token_config::holders;
+         using metrics = token_config::metrics;
+
          TABLE account {
             asset    balance;
 
@@ -138,21 +231,56 @@ using namespace eosio;
             uint64_t primary_key()const { return supply.symbol.code().raw(); }
          };
 
-          TABLE blacklist_table {
-            name      account;
+        
 
-            auto primary_key() const {  return account.value;  }
+         // balance an owner held when snapshot_id was taken, written on the first
+         // balance change after that snapshot; scoped by owner
+         TABLE checkpoint {
+            uint64_t    key;
+            uint64_t    snapshot_id;
+            asset       balance;
+
+            uint64_t primary_key()const { return key; }
+            uint128_t by_snapshot()const { return (uint128_t(balance.symbol.code().raw()) << 64) | snapshot_id; }
          };
 
-        
+         TABLE snapshot_state {
+            uint64_t          id;
+            time_point_sec    time;
+         };
+
+
 
          typedef eosio::multi_index< "accounts"_n, account > accounts;
          typedef eosio::multi_index< "stat"_n, currency_stats > stats;
-         typedef eosio::multi_index< "blacklist"_n, blacklist_table > blacklist_t;
+         typedef eosio::multi_index< "checkpoints"_n, checkpoint,
+            indexed_by< "bysnapshot"_n, const_mem_fun<checkpoint, uint128_t, &checkpoint::by_snapshot> >
+         > checkpoints;
+         typedef eosio::singleton< "snapstate"_n, snapshot_state > snapstate;
+
+#ifdef COMPACT_BALANCES
+         // compact balance row, scoped by symbol code instead of by owner. A transfer to a
+         // new holder bills 232 bytes of RAM on the default build, the holder's own table
+         // plus the row (wasmprof's ram column on tools/tests/token.script); here the row
+         // joins the symbol's table, 124 bytes by nodeos' billable sizes. The
+         // wasmprof_token_compact test checks the figure on a COMPACT_BALANCES build
+         TABLE compact_account {
+            name        owner;
+            int64_t     amount;
+
+            uint64_t primary_key()const { return owner.value; }
+         };
+
+         typedef eosio::multi_index< "cbalances"_n, compact_account > compact_accounts;
 
+         compact_accounts::const_iterator find_compact( compact_accounts& table, const name& owner, const symbol& sym, const name& ram_payer );
+         int32_t find_compact_raw( const name& owner, const symbol& sym, const name& ram_payer );
+#endif
 
 
          void sub_balance( const name& owner, const asset& value );
          void add_balance( const name& owner, const asset& value, const name& ram_payer );
+         void checkpoint_balance( const name& owner, const asset& balance, const name& ram_payer );
+         uint64_t collect( const hagglex::gc::candidate& c, uint64_t from, uint32_t& budget );
    };
 
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+#include <hagglex_common/constants.hpp>
+#include <hagglex_common/economics.hpp>
+#include <hagglex_common/errors.hpp>
+#include <hagglex_common/metrics.hpp>
+#include <hagglex_common/raw_table.hpp>
+
+// Feature policies of hagglextoken. The contract calls its policies' static hooks
+// unconditionally; every feature has a no-op policy whose hooks are empty inline
+// functions, so a build that picks it gets neither the checks nor the table reads on the
+// transfer path. hagglextoken.hpp assembles one policy of each kind into token_config
+// from the build options.
+
+namespace hagglex::token {
+
+   using eosio::asset;
+   using eosio::name;
+   using eosio::symbol_code;
+
+   // --- lock: accounts that may neither send nor receive -----------------------------
+
+   struct no_lock {
+      static constexpr bool enabled = false;
+
+      static void check_transfer( const name& self, const name& from, const name& to ) {}
+      static bool locked( const name& self, const name& account ) { return false; }
+   };
+
+#ifndef TOKEN_NO_BLACKLIST
+   // the ABI generator only sees tables at namespace scope, not members of a template
+   TABLE blacklist_table {
+      name      account;
+
+      auto primary_key() const {  return account.value;  }
+   };
+
+   typedef eosio::multi_index< "blacklist"_n, blacklist_table > blacklist_t;
+
+   // a blacklist kept by one authority; the HAG deployment gives it to the crowdsale,
+   // which locks buyers until finalize clears the list
+   template<uint64_t Authority>
+   struct blacklist_lock {
+      static constexpr bool enabled = true;
+      static constexpr name authority = name( Authority );
+
+      // rows are read through hagglex::raw so that a transfer does not touch the heap
+      static void check_transfer( const name& self, const name& from, const name& to ) {
+         hagglex::check( !locked( self, from ), errors::token::from_blacklisted );
+         hagglex::check( !locked( self, to ), errors::token::to_blacklisted );
+      }
+
+      static bool locked( const name& self, const name& account ) {
+         return hagglex::raw::exists( self, self.value, "blacklist"_n, account.value );
+      }
+
+      static void lock( const name& self, const name& account ) {
+         blacklist_t _blacklist( self, self.value );
+         auto existing = _blacklist.find( account.value );
+         hagglex::check( existing == _blacklist.end(), errors::token::already_blacklisted );
+
+         _blacklist.emplace( self, [&]( auto& b ) {
+            b.account = account;
+         });
+      }
+
+      static void unlock( const name& self, const name& account ) {
+         blacklist_t _blacklist( self, self.value );
+         auto existing = _blacklist.find( account.value );
+         hagglex::check( existing != _blacklist.end(), errors::token::not_blacklisted );
+
+         _blacklist.erase( existing );
+      }
+
+      static void clear( const name& self ) {
+         blacklist_t _blacklist( self, self.value );
+         auto list_itr = _blacklist.begin();
+         while( list_itr != _blacklist.end() ) {
+            list_itr = _blacklist.erase( list_itr );
+         }
+      }
+   };
+#endif
+
+   // --- emission: new supply minted by the issuer over time --------------------------
+
+   struct no_emission {
+      static constexpr bool enabled = false;
+   };
+
+   // the halving schedule of hagglex_common/economics.hpp, shared with tools/stakesim
+   struct halving_emission {
+      static constexpr bool enabled = true;
+
+      static bool due( int64_t supply, uint32_t start, uint32_t last_mint, uint32_t now ) {
+         return hagglex::economics::mint_due( supply, start, last_mint, now );
+      }
+
+      // what one mint issues, scaled by mint_scale
+      static asset reward( const asset& supply, const symbol_code& sym ) {
+         const eosio::symbol reward_symbol( sym, hagglex::symbols::hag_precision );
+         return asset( hagglex::economics::reward( supply.amount ), reward_symbol ) * hagglex::economics::mint_scale;
+      }
+   };
+
+   // --- holder tracking: a registry of balances for the rich list --------------------
+
+   struct no_holders {
+      static constexpr bool enabled = false;
+
+      static void track( const name& self, const name& owner, const asset& balance, const name& ram_payer ) {}
+      static void untrack( const name& self, const name& owner, const symbol_code& sym_code ) {}
+   };
+
+#ifdef HOLDER_REGISTRY
+   // one row per balance row, scoped by symbol code and indexed by balance
+   TABLE holder {
+      name     owner;
+      asset    balance;
+
+      uint64_t primary_key()const { return owner.value; }
+      uint64_t by_balance()const { return balance.amount; }
+   };
+
+   TABLE holder_count {
+      uint64_t    count;
+   };
+
+   typedef eosio::multi_index< "holders"_n, holder,
+      eosio::indexed_by< "bybalance"_n, eosio::const_mem_fun<holder, uint64_t, &holder::by_balance> >
+   > holders;
+   typedef eosio::singleton< "holdercount"_n, holder_count > holdercount;
+
+   struct holder_registry {
+      static constexpr bool enabled = true;
+
+      // mirror an owner's balance row into the registry of its symbol
+      static void track( const name& self, const name& owner, const asset& balance, const name& ram_payer ) {
+         holders hl( self, balance.symbol.code().raw() );
+         auto it = hl.find( owner.value );
+         if( it != hl.end() ) {
+            hl.modify( it, eosio::same_payer, [&]( auto& h ){
+               h.balance = balance;
+            });
+            return;
+         }
+
+         hl.emplace( ram_payer, [&]( auto& h ){
+            h.owner   = owner;
+            h.balance = balance;
+         });
+
+         holdercount cnt( self, balance.symbol.code().raw() );
+         auto c = cnt.get_or_default( holder_count{0} );
+         c.count += 1;
+         cnt.set( c, self );
+      }
+
+      static void untrack( const name& self, const name& owner, const symbol_code& sym_code ) {
+         holders hl( self, sym_code.raw() );
+         auto it = hl.find( owner.value );
+         if( it == hl.end() ) return;
+         hl.erase( it );
+
+         holdercount cnt( self, sym_code.raw() );
+         auto c = cnt.get_or_default( holder_count{0} );
+         if( c.count > 0 ) c.count -= 1;
+         cnt.set( c, self );
+      }
+   };
+#endif
+
+   // --- metrics: the counters of hagglex_common/metrics.hpp --------------------------
+
+   struct no_metrics {
+      static constexpr bool enabled = false;
+
+      struct scope {
+         scope( const name& self, const name& action ) {}
+      };
+
+      static void branch( const name& b ) {}
+      static void reads( uint64_t n ) {}
+      static void writes( uint64_t n ) {}
+   };
+
+#ifdef HAGGLEX_METRICS
+   struct counted_metrics {
+      static constexpr bool enabled = true;
+
+      using scope = hagglex::metrics_scope;
+
+      static void branch( const name& b ) { METRICS_BRANCH( b ); }
+      static void reads( uint64_t n ) { METRICS_DB_READ( n ); }
+      static void writes( uint64_t n ) { METRICS_DB_WRITE( n ); }
+   };
+#endif
+
+   // one policy of each kind
+   template<typename Lock, typename Emission, typename Holders, typename Metrics>
+   struct config {
+      using lock     = Lock;
+      using emission = Emission;
+      using holders  = Holders;
+      using metrics  = Metrics;
+   };
+
+}
@@ -4,18 +4,31 @@
 
 using namespace eosio;
 
+// richlist returns at most this many holders per call
+#define MAX_RICHLIST 500
+
+// migrate moves at most this many owners per call
+#define MAX_MIGRATE_BATCH 100
+
+// gc reads at most this many rows per call
+#define MAX_GC_ROWS 100
+
+// opens an action's heap_stats scope and its metrics policy scope
+#define TOKEN_ACTION(action)   HEAP_STATS_SCOPE(action) metrics::scope metrics_scope_( get_self(), action )
+
 void hagglextoken::create( const name&   issuer,
                     const asset&  maximum_supply ){
+   TOKEN_ACTION("create"_n);
     require_auth( get_self() );
 
     auto sym = maximum_supply.symbol;
-    check( sym.is_valid(), "invalid symbol name" );
-    check( maximum_supply.is_valid(), "invalid supply");
-    check( maximum_supply.amount > 0, "max-supply must be positive");
+    hagglex::check( sym.is_valid(), error::invalid_symbol );
+    hagglex::check( maximum_supply.is_valid(), error::invalid_supply );
+    hagglex::check( maximum_supply.amount > 0, error::max_supply_not_positive );
 
     stats statstable( get_self(), sym.code().raw() );
     auto existing = statstable.find( sym.code().raw() );
-    check( existing == statstable.end(), "token with symbol already exists" );
+    hagglex::check( existing == statstable.end(), error::token_exists );
 
      statstable.emplace( get_self(), [&]( auto& s ) {
        s.supply.symbol = maximum_supply.symbol;
@@ -29,22 +42,23 @@ void hagglextoken::create( const name&   issuer,
 
 
 void hagglextoken::issue( const name& to, const asset& quantity, const string& memo ) {
+   TOKEN_ACTION("issue"_n);
     auto sym = quantity.symbol;
-    check( sym.is_valid(), "invalid symbol name" );
-    check( memo.size() <= 256, "memo has more than 256 bytes" );
+    hagglex::check( sym.is_valid(), error::invalid_symbol );
+    hagglex::check( memo.size() <= 256, error::memo_too_long );
 
     stats statstable( get_self(), sym.code().raw() );
     auto existing = statstable.find( sym.code().raw() );
-    check( existing != statstable.end(), "token with symbol does not exist, create token before issue" );
+    hagglex::check( existing != statstable.end(), error::issue_unknown_token );
     const auto& st = *existing;
-    check( to == st.issuer, "tokens can only be issued to issuer account" );
+    hagglex::check( to == st.issuer, error::issue_to_non_issuer );
 
     require_auth( st.issuer );
-    check( quantity.is_valid(), "invalid quantity" );
-    check( quantity.amount > 0, "must issue positive quantity" );
+    hagglex::check( quantity.is_valid(), error::invalid_quantity );
+    hagglex::check( quantity.amount > 0, error::issue_not_positive );
 
-    check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
-    check( quantity.amount <= st.max_supply.amount - st.supply.amount, "quantity exceeds available supply" );
+    hagglex::check( quantity.symbol == st.supply.symbol, error::symbol_mismatch );
+    hagglex::check( quantity.amount <= st.max_supply.amount - st.supply.amount, error::exceeds_supply );
 
     statstable.modify( st, same_payer, [&]( auto& s ) {
        s.supply += quantity;
@@ -57,20 +71,21 @@ void hagglextoken::issue( const name& to, const asset& quantity, const string& m
 
 
 void hagglextoken::burn( const asset& quantity, const string& memo ) {
+   TOKEN_ACTION("burn"_n);
     auto sym = quantity.symbol;
-    check( sym.is_valid(), "invalid symbol name" );
-    check( memo.size() <= 256, "memo has more than 256 bytes" );
+    hagglex::check( sym.is_valid(), error::invalid_symbol );
+    hagglex::check( memo.size() <= 256, error::memo_too_long );
 
     stats statstable( get_self(), sym.code().raw() );
     auto existing = statstable.find( sym.code().raw() );
-    check( existing != statstable.end(), "token with symbol does not exist" );
+    hagglex::check( existing != statstable.end(), error::unknown_token );
     const auto& st = *existing;
 
     require_auth( st.issuer );
-    check( quantity.is_valid(), "invalid quantity" );
-    check( quantity.amount > 0, "must burn positive quantity" );
+    hagglex::check( quantity.is_valid(), error::invalid_quantity );
+    hagglex::check( quantity.amount > 0, error::burn_not_positive );
 
-    check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+    hagglex::check( quantity.symbol == st.supply.symbol, error::symbol_mismatch );
 
    /* statstable.modify( st, same_payer, [&]( auto& s ) {
        s.supply -= quantity;
@@ -84,28 +99,26 @@ void hagglextoken::transfer( const name&    from,
                       const name&    to,
                       const asset&   quantity,
                       const string&  memo ) {
+   TOKEN_ACTION("transfer"_n);
 
 
-    blacklist_t _blacklist(get_self(), get_self().value);
-    auto fromexisting = _blacklist.find( from.value );
-    check( fromexisting == _blacklist.end(), "account blacklisted(from)" );
-    auto toexisting = _blacklist.find( to.value );
-    check( toexisting == _blacklist.end(), "account blacklisted(to)" );
+    // an empty call with the no_lock policy
+    lock::check_transfer( get_self(), from, to );
 
-    check( from != to, "cannot transfer to self" );
+    hagglex::check( from != to, error::transfer_to_self );
     require_auth( from );
-    check( is_account( to ), "to account does not exist");
+    hagglex::check( is_account( to ), error::to_account_missing );
     auto sym = quantity.symbol.code();
-    stats statstable( get_self(), sym.raw() );
-    const auto& st = statstable.get( sym.raw() );
+    currency_stats st;
+    hagglex::check( hagglex::raw::get( get_self(), sym.raw(), "stat"_n, sym.raw(), st ), error::unknown_token );
 
     require_recipient( from );
     require_recipient( to );
    
-    check( quantity.is_valid(), "invalid quantity" );
-    check( quantity.amount > 0, "must transfer positive quantity" );
-    check( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
-    check( memo.size() <= 256, "memo has more than 256 bytes" );
+    hagglex::check( quantity.is_valid(), error::invalid_quantity );
+    hagglex::check( quantity.amount > 0, error::transfer_not_positive );
+    hagglex::check( quantity.symbol == st.supply.symbol, error::symbol_mismatch );
+    hagglex::check( memo.size() <= 256, error::memo_too_long );
 
     auto payer = has_auth( to ) ? to : from;
 
@@ -114,142 +127,440 @@ void hagglextoken::transfer( const name&    from,
 }
 
 
+#ifdef COMPACT_BALANCES
+// find an owner's compact balance row, moving a legacy accounts row over on first touch.
+// The moved row is billed to `ram_payer`: the owner when the owner authorized the action,
+// the contract otherwise, so nobody pays for another account's row by sending it tokens
+hagglextoken::compact_accounts::const_iterator hagglextoken::find_compact( compact_accounts& table, const name& owner, const symbol& sym, const name& ram_payer ) {
+   auto it = table.find( owner.value );
+   if( it != table.end() ) return it;
+
+   accounts acnts( get_self(), owner.value );
+   auto legacy = acnts.find( sym.code().raw() );
+   if( legacy == acnts.end() ) return it;
+
+   const int64_t amount = legacy->balance.amount;
+   acnts.erase( legacy );
+   return table.emplace( ram_payer, [&]( auto& a ){
+      a.owner  = owner;
+      a.amount = amount;
+   });
+}
+
+// iterator of an owner's compact row, migrating a legacy accounts row on first touch
+int32_t hagglextoken::find_compact_raw( const name& owner, const symbol& sym, const name& ram_payer ) {
+   const uint64_t scope = sym.code().raw();
+   int32_t itr = hagglex::raw::find( get_self(), scope, "cbalances"_n, owner.value );
+   if( itr >= 0 ) return itr;
+
+   // the multi_index instance is gone before the row is touched again
+   {
+      compact_accounts table( get_self(), scope );
+      find_compact( table, owner, sym, ram_payer );
+   }
+   return hagglex::raw::find( get_self(), scope, "cbalances"_n, owner.value );
+}
+
 void hagglextoken::sub_balance( const name& owner, const asset& value ) {
-   accounts from_acnts( get_self(), owner.value );
+   const int32_t itr = find_compact_raw( owner, value.symbol, owner );
+   hagglex::check( itr >= 0, error::no_balance );
+   compact_account from = hagglex::raw::read<compact_account>( itr );
+   hagglex::check( from.amount >= value.amount, error::overdrawn );
+   metrics::reads(1);
 
-   const auto& from = from_acnts.get( value.symbol.code().raw(), "no balance object found" );
-   check( from.balance.amount >= value.amount, "overdrawn balance" );
+   checkpoint_balance( owner, asset{from.amount, value.symbol}, owner );
 
-   from_acnts.modify( from, owner, [&]( auto& a ) {
-         a.balance -= value;
-      });
+   from.amount -= value.amount;
+   hagglex::raw::update( itr, owner, from );
+   metrics::writes(1);
+
+   holder_tracking::track( get_self(), owner, asset{from.amount, value.symbol}, owner );
+   if( from.amount == 0 ) hagglex::gc::enqueue( get_self(), owner, value.symbol.code(), owner );
 }
 
 void hagglextoken::add_balance( const name& owner, const asset& value, const name& ram_payer ) {
-   accounts to_acnts( get_self(), owner.value );
-   auto to = to_acnts.find( value.symbol.code().raw() );
-   if( to == to_acnts.end() ) {
-      to_acnts.emplace( ram_payer, [&]( auto& a ){
-        a.balance = value;
-      });
+   const int32_t itr = find_compact_raw( owner, value.symbol, get_self() );
+   compact_account to{ owner, 0 };
+   if( itr >= 0 ) to = hagglex::raw::read<compact_account>( itr );
+   checkpoint_balance( owner, asset{to.amount, value.symbol}, ram_payer );
+   metrics::reads(1);
+
+   to.amount += value.amount;
+   if( itr < 0 ) {
+      metrics::branch("addemplace"_n);
+      hagglex::raw::store( value.symbol.code().raw(), "cbalances"_n, ram_payer, owner.value, to );
    } else {
-      to_acnts.modify( to, same_payer, [&]( auto& a ) {
-        a.balance += value;
-      });
+      metrics::branch("addmodify"_n);
+      hagglex::raw::update( itr, same_payer, to );
+   }
+
+   holder_tracking::track( get_self(), owner, asset{to.amount, value.symbol}, ram_payer );
+}
+
+#else
+void hagglextoken::sub_balance( const name& owner, const asset& value ) {
+   const int32_t itr = hagglex::raw::find( get_self(), owner.value, "accounts"_n, value.symbol.code().raw() );
+   hagglex::check( itr >= 0, error::no_balance );
+   account from = hagglex::raw::read<account>( itr );
+   hagglex::check( from.balance.amount >= value.amount, error::overdrawn );
+   metrics::reads(1);
+
+   checkpoint_balance( owner, from.balance, owner );
+
+   from.balance -= value;
+   hagglex::raw::update( itr, owner, from );
+   metrics::writes(1);
+
+   holder_tracking::track( get_self(), owner, from.balance, owner );
+   if( from.balance.amount == 0 ) hagglex::gc::enqueue( get_self(), owner, value.symbol.code(), owner );
+}
+
+void hagglextoken::add_balance( const name& owner, const asset& value, const name& ram_payer ) {
+   const int32_t itr = hagglex::raw::find( get_self(), owner.value, "accounts"_n, value.symbol.code().raw() );
+   account to{ asset{0, value.symbol} };
+   if( itr >= 0 ) to = hagglex::raw::read<account>( itr );
+   checkpoint_balance( owner, to.balance, ram_payer );
+   metrics::reads(1);
+
+   to.balance += value;
+   if( itr < 0 ) {
+      metrics::branch("addemplace"_n);
+      hagglex::raw::store( owner.value, "accounts"_n, ram_payer, value.symbol.code().raw(), to );
+   } else {
+      metrics::branch("addmodify"_n);
+      hagglex::raw::update( itr, same_payer, to );
    }
+
+   holder_tracking::track( get_self(), owner, to.balance, ram_payer );
+}
+#endif
+
+// record the balance an owner held at the current snapshot, once per snapshot
+void hagglextoken::checkpoint_balance( const name& owner, const asset& balance, const name& ram_payer ) {
+   snapshot_state snap;
+   metrics::reads(1);
+   if( !hagglex::raw::get( get_self(), get_self().value, "snapstate"_n, "snapstate"_n.value, snap ) ) return;
+   const uint64_t snapshot_id = snap.id;
+
+   metrics::reads(1);
+   const uint128_t key = (uint128_t(balance.symbol.code().raw()) << 64) | snapshot_id;
+   if( hagglex::raw::has_secondary( get_self(), owner.value, "checkpoints"_n, 0, key ) ) return;
+
+   checkpoints cps( get_self(), owner.value );
+
+   metrics::branch("checkpoint"_n);
+   metrics::writes(1);
+
+   cps.emplace( ram_payer, [&]( auto& c ){
+      c.key         = cps.available_primary_key();
+      c.snapshot_id = snapshot_id;
+      c.balance     = balance;
+   });
 }
 
 void hagglextoken::open( const name& owner, const symbol& symbol, const name& ram_payer ) {
+   TOKEN_ACTION("open"_n);
    require_auth( ram_payer );
 
-   check( is_account( owner ), "owner account does not exist" );
+   hagglex::check( is_account( owner ), error::owner_missing );
 
    auto sym_code_raw = symbol.code().raw();
-   print (sym_code_raw);
+   HAGGLEX_PRINT (sym_code_raw);
    stats statstable( get_self(), sym_code_raw );
-   const auto& st = statstable.get( sym_code_raw, "symbol does not exist" );
-   check( st.supply.symbol == symbol, "symbol precision mismatch" );
-
+   auto existing = statstable.find( sym_code_raw );
+   hagglex::check( existing != statstable.end(), error::symbol_not_found );
+   const auto& st = *existing;
+   hagglex::check( st.supply.symbol == symbol, error::symbol_mismatch );
+
+#ifdef COMPACT_BALANCES
+   compact_accounts acnts( get_self(), sym_code_raw );
+   auto it = find_compact( acnts, owner, symbol, ram_payer == owner ? owner : get_self() );
+   if( it == acnts.end() ) {
+      acnts.emplace( ram_payer, [&]( auto& a ){
+        a.owner  = owner;
+        a.amount = 0;
+      });
+#else
    accounts acnts( get_self(), owner.value );
    auto it = acnts.find( sym_code_raw );
    if( it == acnts.end() ) {
       acnts.emplace( ram_payer, [&]( auto& a ){
         a.balance = asset{0, symbol};
       });
+#endif
+
+      holder_tracking::track( get_self(), owner, asset{0, symbol}, ram_payer );
    }
 }
 
 
 void hagglextoken::close( const name& owner, const symbol& symbol ) {
+   TOKEN_ACTION("close"_n);
    require_auth( owner );
+#ifdef COMPACT_BALANCES
+   compact_accounts acnts( get_self(), symbol.code().raw() );
+   auto it = find_compact( acnts, owner, symbol, owner );
+   hagglex::check( it != acnts.end(), error::close_missing_row );
+   hagglex::check( it->amount == 0, error::close_nonzero );
+#else
    accounts acnts( get_self(), owner.value );
    auto it = acnts.find( symbol.code().raw() );
-   check( it != acnts.end(), "Balance row already deleted or never existed. Action won't have any effect." );
-   check( it->balance.amount == 0, "Cannot close because the balance is not zero." );
+   hagglex::check( it != acnts.end(), error::close_missing_row );
+   hagglex::check( it->balance.amount == 0, error::close_nonzero );
+#endif
    acnts.erase( it );
+
+   holder_tracking::untrack( get_self(), owner, symbol.code() );
 }
 
 
 
+#ifndef TOKEN_NO_BLACKLIST
 void hagglextoken::blacklist( const name& account, const string& memo ) {
-    require_auth( name("hagglexsale") );
-    check( memo.size() <= 256, "memo has more than 256 bytes" );
-    
-    blacklist_t _blacklist( get_self(), get_self().value);
-    auto existing = _blacklist.find( account.value );
-    check( existing == _blacklist.end(), "blacklist account already exists" );
-
-    _blacklist.emplace( get_self(), [&]( auto& b ) {
-       b.account = account;
-    });
+   TOKEN_ACTION("blacklist"_n);
+    require_auth( lock::authority );
+    hagglex::check( memo.size() <= 256, error::memo_too_long );
+
+    lock::lock( get_self(), account );
 }
 
 
 
 void hagglextoken::unblacklist( const name& account) {
-    require_auth( name("hagglexsale") );
-
-    blacklist_t _blacklist( get_self(), get_self().value);
-    auto existing = _blacklist.find( account.value );
-    check( existing != _blacklist.end(), "blacklist account not exists" );
+   TOKEN_ACTION("unblacklist"_n);
+    require_auth( lock::authority );
 
-    _blacklist.erase(existing);
+    lock::unlock( get_self(), account );
 }
 
 
 
 void hagglextoken::clrblacklist() {
-  require_auth( name("hagglexsale") );
+   TOKEN_ACTION("clrblacklist"_n);
+  require_auth( lock::authority );
 
-  blacklist_t _blacklist(get_self(), get_self().value);
-
-  // Delete all records in _messages table
-  auto list_itr = _blacklist.begin();
-  while (list_itr != _blacklist.end()) {
-    list_itr = _blacklist.erase(list_itr);
-  }
+  lock::clear( get_self() );
 }
 
+#define LOCK_ACTIONS (blacklist)(unblacklist)(clrblacklist)
+#else
+#define LOCK_ACTIONS
+#endif
+
 
 
+#ifndef TOKEN_NO_EMISSION
 void hagglextoken::mint(const symbol_code& sym){ 
+   TOKEN_ACTION("mint"_n);
    
    //check that the symbol is valid
-   check( sym.is_valid(), "invalid symbol name" );
+   hagglex::check( sym.is_valid(), error::invalid_symbol );
 
    stats statstable( get_self(), sym.raw() );
-   const auto& st = statstable.get( sym.raw() );
+   auto existing = statstable.find( sym.raw() );
+   hagglex::check( existing != statstable.end(), error::symbol_not_found );
+   const auto& st = *existing;
    
    require_auth(st.issuer);
 
-   const uint32_t one_day = 86400;
-   const uint32_t ninety_days = 90 * one_day;
+   const uint32_t currenttime = current_time_point().sec_since_epoch();
+
+   if( emission::due( st.supply.amount, st.starttime, st.minetime, currenttime ) ){
+
+      action{
+            permission_level{get_self(), "active"_n}, 
+            get_self(),
+            "issue"_n,
+            std::make_tuple(get_self(), emission::reward(st.supply, sym), std::string("Issue tokens"))
+         }.send(); 
+   }
+}
 
-   if( st.supply.amount/10000 <= 9000000 ){
+#define EMISSION_ACTIONS (mint)
+#else
+#define EMISSION_ACTIONS
+#endif
 
-      asset reward = get_reward(st.supply, sym);
-      uint32_t currenttime = current_time_point().sec_since_epoch();
 
-      if( currenttime > (st.starttime + ninety_days) ){
 
-         if( currenttime > (st.minetime + one_day) ){
+void hagglextoken::snapshot() {
+   TOKEN_ACTION("snapshot"_n);
+   require_auth( get_self() );
 
-            action{
-                  permission_level{get_self(), "active"_n}, 
-                  get_self(),
-                  "issue"_n,
-                  std::make_tuple(get_self(), reward * 10000, std::string("Issue tokens"))
-               }.send(); 
-            }
-         } 
-      }//if
+   snapstate snap( get_self(), get_self().value );
+   auto st = snap.get_or_default( snapshot_state{0, time_point_sec(0)} );
+   st.id  += 1;
+   st.time = time_point_sec( current_time_point() );
+   snap.set( st, get_self() );
 }
 
 
 
+void hagglextoken::gc( const uint32_t& max_rows ) {
+   TOKEN_ACTION("gc"_n);
+   hagglex::check( max_rows > 0 && max_rows <= MAX_GC_ROWS, error::gc_rows );
+
+   hagglex::gc::sweep( get_self(), max_rows, [&]( const hagglex::gc::candidate& c, uint64_t from, uint32_t& budget ) {
+      return collect( c, from, budget );
+   });
+}
+
+void hagglextoken::gcseed( const symbol_code& sym_code, const std::vector<name>& owners ) {
+   TOKEN_ACTION("gcseed"_n);
+   require_auth( get_self() );
+   hagglex::check( owners.size() <= MAX_GC_ROWS, error::gc_batch_too_large );
+
+   for( const auto& owner : owners ) {
+#ifdef COMPACT_BALANCES
+      // legacy accounts rows are moved over by migrate first
+      const int32_t itr = hagglex::raw::find( get_self(), sym_code.raw(), "cbalances"_n, owner.value );
+      if( itr < 0 || hagglex::raw::read<compact_account>( itr ).amount != 0 ) continue;
+#else
+      const int32_t itr = hagglex::raw::find( get_self(), owner.value, "accounts"_n, sym_code.raw() );
+      if( itr < 0 || hagglex::raw::read<account>( itr ).balance.amount != 0 ) continue;
+#endif
+      hagglex::gc::enqueue( get_self(), owner, sym_code, get_self() );
+   }
+}
+
+#ifdef COMPACT_BALANCES
+// a queued owner's compact row of the symbol it emptied
+uint64_t hagglextoken::collect( const hagglex::gc::candidate& c, uint64_t from, uint32_t& budget ) {
+   if( budget == 0 ) return c.sym.raw();
+   --budget;
+
+   const int32_t itr = hagglex::raw::find( get_self(), c.sym.raw(), "cbalances"_n, c.owner.value );
+   if( itr >= 0 && hagglex::raw::read<compact_account>( itr ).amount == 0 ) {
+      hagglex::raw::erase( itr );
+      holder_tracking::untrack( get_self(), c.owner, c.sym );
+   }
+   return 0;
+}
+#else
+// every empty accounts row of a queued owner, whichever symbol it emptied
+uint64_t hagglextoken::collect( const hagglex::gc::candidate& c, uint64_t from, uint32_t& budget ) {
+   uint64_t resume = 0;
+   hagglex::raw::walk( get_self(), c.owner.value, "accounts"_n, from, [&]( int32_t itr ) {
+      const account row = hagglex::raw::read<account>( itr );
+      if( budget == 0 ) {
+         resume = row.balance.symbol.code().raw();
+         return false;
+      }
+      --budget;
+      if( row.balance.amount == 0 ) {
+         hagglex::raw::erase( itr );
+         holder_tracking::untrack( get_self(), c.owner, row.balance.symbol.code() );
+      }
+      return true;
+   });
+   return resume;
+}
+#endif
+
+
+
+asset hagglextoken::balanceat( const name& owner, const symbol_code& sym_code, const uint64_t& snapshot_id ) {
+   snapstate snap( get_self(), get_self().value );
+   hagglex::check( snap.exists() && snapshot_id > 0 && snapshot_id <= snap.get().id, error::unknown_snapshot );
+
+   stats statstable( get_self(), sym_code.raw() );
+   auto existing = statstable.find( sym_code.raw() );
+   hagglex::check( existing != statstable.end(), error::symbol_not_found );
+   const auto& st = *existing;
+
+   // the first checkpoint at or after the snapshot holds the balance as it was then
+   checkpoints cps( get_self(), owner.value );
+   auto by_snapshot = cps.get_index<"bysnapshot"_n>();
+   auto cp = by_snapshot.lower_bound( (uint128_t(sym_code.raw()) << 64) | snapshot_id );
+   if( cp != by_snapshot.end() && cp->balance.symbol.code() == sym_code ) {
+      return cp->balance;
+   }
+
+   // untouched since the snapshot, so the current balance still applies
+   return get_balance( get_self(), owner, st.supply.symbol );
+}
+
+
+
+hagglextoken::balances_result hagglextoken::getbalances( const std::vector<name>& owners, const symbol_code& sym_code ) {
+   balances_result result;
+   result.supply = get_supply( get_self(), sym_code );
+   result.holders.reserve( owners.size() );
+
+   for( const auto& owner : owners ) {
+      result.holders.push_back( holder_balance{
+         owner,
+         get_balance( get_self(), owner, result.supply.symbol ),
+         lock::locked( get_self(), owner )
+      });
+   }
+   return result;
+}
+
+
+
+#ifdef HAGGLEX_METRICS
+hagglex::metrics_t hagglextoken::getmetrics() {
+   return hagglex::get_metrics( get_self() );
+}
+
+#define METRICS_ACTIONS (getmetrics)
+#else
+#define METRICS_ACTIONS
+#endif
+
+
+
+#ifdef COMPACT_BALANCES
+void hagglextoken::migrate( const symbol_code& sym_code, const std::vector<name>& owners ) {
+   TOKEN_ACTION("migrate"_n);
+   require_auth( get_self() );
+   hagglex::check( owners.size() <= MAX_MIGRATE_BATCH, error::migrate_batch_too_large );
+
+   stats statstable( get_self(), sym_code.raw() );
+   auto existing = statstable.find( sym_code.raw() );
+   hagglex::check( existing != statstable.end(), error::symbol_not_found );
+   const auto& st = *existing;
+
+   compact_accounts acnts( get_self(), sym_code.raw() );
+   for( const auto& owner : owners ) {
+      find_compact( acnts, owner, st.supply.symbol, get_self() );
+   }
+}
+
+#define COMPACT_BALANCES_ACTIONS (migrate)
+#else
+#define COMPACT_BALANCES_ACTIONS
+#endif
+
+
+
+#ifdef HOLDER_REGISTRY
+hagglextoken::richlist_result hagglextoken::richlist( const symbol_code& sym_code, const uint32_t& limit ) {
+   hagglex::check( limit <= MAX_RICHLIST, error::richlist_limit );
+
+   richlist_result result;
+   hagglex::token::holdercount cnt( get_self(), sym_code.raw() );
+   result.holders = cnt.get_or_default( hagglex::token::holder_count{0} ).count;
+
+   hagglex::token::holders hl( get_self(), sym_code.raw() );
+   auto by_balance = hl.get_index<"bybalance"_n>();
+   for( auto it = by_balance.rbegin(); it != by_balance.rend() && result.top.size() < limit; ++it ) {
+      result.top.push_back( *it );
+   }
+   return result;
+}
+
+#define HOLDER_REGISTRY_ACTIONS (richlist)
+#else
+#define HOLDER_REGISTRY_ACTIONS
+#endif
+
+
+
 
 
 
 
 
-EOSIO_DISPATCH( hagglextoken, (create)(issue)(transfer)(burn)(open)(close)(mint)(blacklist)(unblacklist)(clrblacklist))
+EOSIO_DISPATCH( hagglextoken, (create)(issue)(transfer)(burn)(open)(close)(snapshot)(gc)(gcseed)(balanceat)(getbalances) EMISSION_ACTIONS LOCK_ACTIONS COMPACT_BALANCES_ACTIONS HOLDER_REGISTRY_ACTIONS METRICS_ACTIONS )
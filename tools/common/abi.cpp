@@ -0,0 +1,392 @@
+#include "abi.hpp"
+
+#include "crypto.hpp"
+
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+namespace hagglex {
+
+   static constexpr int max_depth = 32;
+
+   std::string read_file( const std::string& path ) {
+      std::ifstream in( path, std::ios::binary );
+      if( !in ) throw std::runtime_error( "cannot open " + path );
+      std::ostringstream ss;
+      ss << in.rdbuf();
+      return ss.str();
+   }
+
+   abi::abi( const json& def ) {
+      if( const json* t = def.find( "types" ) )
+         for( const auto& td : t->items() )
+            typedefs[td["new_type_name"].as_string()] = td["type"].as_string();
+
+      if( const json* s = def.find( "structs" ) ) {
+         for( const auto& sd : s->items() ) {
+            struct_def d;
+            d.base = sd["base"].as_string();
+            for( const auto& f : sd["fields"].items() )
+               d.fields.push_back( field{ f["name"].as_string(), f["type"].as_string() } );
+            structs[sd["name"].as_string()] = std::move(d);
+         }
+      }
+
+      if( const json* v = def.find( "variants" ) ) {
+         for( const auto& vd : v->items() ) {
+            std::vector<std::string> types;
+            for( const auto& t : vd["types"].items() ) types.push_back( t.as_string() );
+            variants[vd["name"].as_string()] = std::move(types);
+         }
+      }
+
+      if( const json* a = def.find( "actions" ) )
+         for( const auto& ad : a->items() )
+            actions[string_to_name( ad["name"].as_string() )] = ad["type"].as_string();
+
+      if( const json* t = def.find( "tables" ) )
+         for( const auto& td : t->items() )
+            tables[string_to_name( td["name"].as_string() )] = td["type"].as_string();
+   }
+
+   abi abi::load( const std::string& path ) {
+      return abi( json::parse( read_file( path ) ) );
+   }
+
+   std::string abi::action_type( uint64_t action ) const {
+      auto it = actions.find( action );
+      return it == actions.end() ? std::string() : it->second;
+   }
+
+   std::string abi::table_type( uint64_t table ) const {
+      auto it = tables.find( table );
+      return it == tables.end() ? std::string() : it->second;
+   }
+
+   std::vector<std::pair<std::string, std::string>> abi::struct_fields( const std::string& type ) const {
+      std::vector<std::pair<std::string, std::string>> out;
+      auto it = structs.find( resolve( type ) );
+      if( it == structs.end() ) return out;
+      if( !it->second.base.empty() ) out = struct_fields( it->second.base );
+      for( const auto& f : it->second.fields ) out.push_back( { f.name, resolve( f.type ) } );
+      return out;
+   }
+
+   std::string abi::resolve( std::string type ) const {
+      for( int i = 0; i < max_depth; ++i ) {
+         auto it = typedefs.find( type );
+         if( it == typedefs.end() ) return type;
+         type = it->second;
+      }
+      throw format_error( "abi: typedef loop at " + type );
+   }
+
+   std::vector<char> abi::json_to_bin( const std::string& type, const json& value ) const {
+      bin_writer out;
+      write( type, value, out, 0 );
+      return std::move(out.data);
+   }
+
+   json abi::bin_to_json( const std::string& type, bin_reader& in ) const {
+      return read( type, in, 0 );
+   }
+
+   json abi::bin_to_json( const std::string& type, const std::vector<char>& data ) const {
+      bin_reader in( data );
+      return read( type, in, 0 );
+   }
+
+   // ---- time ----
+
+   static int64_t parse_iso( const std::string& s, int64_t& usec ) {
+      std::tm tm{};
+      int frac = 0, frac_digits = 0;
+      const char* p = strptime( s.c_str(), "%Y-%m-%dT%H:%M:%S", &tm );
+      if( !p ) throw format_error( "invalid time: " + s );
+      if( *p == '.' ) {
+         ++p;
+         while( *p >= '0' && *p <= '9' ) {
+            if( frac_digits < 6 ) { frac = frac * 10 + (*p - '0'); ++frac_digits; }
+            ++p;
+         }
+      }
+      if( *p == 'Z' ) ++p;
+      if( *p ) throw format_error( "invalid time: " + s );
+      while( frac_digits++ < 6 ) frac *= 10;
+      usec = frac;
+      return int64_t(timegm( &tm ));
+   }
+
+   uint32_t parse_time_point_sec( const std::string& s ) {
+      int64_t usec;
+      return uint32_t(parse_iso( s, usec ));
+   }
+
+   int64_t parse_time_point( const std::string& s ) {
+      int64_t usec;
+      int64_t sec = parse_iso( s, usec );
+      return sec * 1000000 + usec;
+   }
+
+   std::string format_time_point_sec( uint32_t sec ) {
+      std::time_t t = sec;
+      std::tm tm{};
+      gmtime_r( &t, &tm );
+      char buf[32];
+      std::strftime( buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm );
+      return buf;
+   }
+
+   std::string format_time_point( int64_t usec ) {
+      char ms[8];
+      std::snprintf( ms, sizeof(ms), ".%03d", int((usec % 1000000) / 1000) );
+      return format_time_point_sec( uint32_t(usec / 1000000) ) + ms;
+   }
+
+   // ---- 128-bit decimal ----
+
+   static unsigned __int128 parse_u128( const std::string& s ) {
+      if( s.empty() ) throw format_error( "empty integer" );
+      unsigned __int128 v = 0;
+      for( char c : s ) {
+         if( c < '0' || c > '9' ) throw format_error( "invalid integer: " + s );
+         v = v * 10 + (c - '0');
+      }
+      return v;
+   }
+
+   static std::string format_u128( unsigned __int128 v ) {
+      std::string s;
+      do {
+         s.insert( s.begin(), char('0' + int(v % 10)) );
+         v /= 10;
+      } while( v );
+      return s;
+   }
+
+   // ---- writing ----
+
+   void abi::write_struct( const std::string& type, const json& value, bin_writer& out, int depth ) const {
+      const struct_def& def = structs.at( type );
+      if( !def.base.empty() ) write_struct( resolve( def.base ), value, out, depth + 1 );
+      for( const auto& f : def.fields ) {
+         const json* v = value.find( f.name );
+         if( !v ) {
+            if( !f.type.empty() && f.type.back() == '$' ) return;   // trailing binary extensions may be absent
+            throw format_error( "abi: missing field '" + f.name + "' of " + type );
+         }
+         write( f.type, *v, out, depth + 1 );
+      }
+   }
+
+   void abi::write( const std::string& raw_type, const json& value, bin_writer& out, int depth ) const {
+      if( depth > max_depth ) throw format_error( "abi: nesting too deep" );
+      std::string type = resolve( raw_type );
+
+      if( type.size() > 2 && type.compare( type.size() - 2, 2, "[]" ) == 0 ) {
+         std::string elem = type.substr( 0, type.size() - 2 );
+         out.varuint32( value.size() );
+         for( const auto& v : value.items() ) write( elem, v, out, depth + 1 );
+         return;
+      }
+      if( !type.empty() && type.back() == '?' ) {
+         out.raw( uint8_t(value.is_null() ? 0 : 1) );
+         if( !value.is_null() ) write( type.substr( 0, type.size() - 1 ), value, out, depth + 1 );
+         return;
+      }
+      if( !type.empty() && type.back() == '$' ) {
+         write( type.substr( 0, type.size() - 1 ), value, out, depth + 1 );
+         return;
+      }
+
+      if( type == "bool" )      { out.raw( uint8_t(value.as_bool() ? 1 : 0) ); return; }
+      if( type == "int8" )      { out.raw( int8_t(value.as_int64()) ); return; }
+      if( type == "uint8" )     { out.raw( uint8_t(value.as_uint64()) ); return; }
+      if( type == "int16" )     { out.raw( int16_t(value.as_int64()) ); return; }
+      if( type == "uint16" )    { out.raw( uint16_t(value.as_uint64()) ); return; }
+      if( type == "int32" )     { out.raw( int32_t(value.as_int64()) ); return; }
+      if( type == "uint32" )    { out.raw( uint32_t(value.as_uint64()) ); return; }
+      if( type == "int64" )     { out.raw( int64_t(value.as_int64()) ); return; }
+      if( type == "uint64" )    { out.raw( uint64_t(value.as_uint64()) ); return; }
+      if( type == "varuint32" ) { out.varuint32( value.as_uint64() ); return; }
+      if( type == "varint32" )  { out.varint32( int32_t(value.as_int64()) ); return; }
+      if( type == "uint128" || type == "int128" ) {
+         std::string s = value.as_string();
+         bool neg = !s.empty() && s[0] == '-';
+         unsigned __int128 v = parse_u128( neg ? s.substr( 1 ) : s );
+         if( neg ) v = ~v + 1;
+         out.raw( v );
+         return;
+      }
+      if( type == "float32" )   { out.raw( float(value.as_double()) ); return; }
+      if( type == "float64" )   { out.raw( double(value.as_double()) ); return; }
+      if( type == "name" )      { out.raw( string_to_name( value.as_string() ) ); return; }
+      if( type == "string" )    { out.string( value.as_string() ); return; }
+      if( type == "bytes" ) {
+         auto b = from_hex( value.as_string() );
+         out.varuint32( b.size() );
+         out.bytes( b.data(), b.size() );
+         return;
+      }
+      if( type == "checksum160" || type == "checksum256" || type == "checksum512" || type == "float128" ) {
+         auto b = from_hex( value.as_string() );
+         size_t want = type == "checksum160" ? 20 : type == "checksum512" ? 64 : type == "float128" ? 16 : 32;
+         if( b.size() != want ) throw format_error( "abi: wrong length for " + type );
+         out.bytes( b.data(), b.size() );
+         return;
+      }
+      if( type == "public_key" || type == "signature" ) {
+         auto b = type == "public_key" ? parse_public_key( value.as_string() ) : parse_signature( value.as_string() );
+         out.raw( uint8_t(0) );      // K1
+         out.bytes( b.data(), b.size() );
+         return;
+      }
+      if( type == "time_point_sec" ) { out.raw( parse_time_point_sec( value.as_string() ) ); return; }
+      if( type == "time_point" )     { out.raw( parse_time_point( value.as_string() ) ); return; }
+      if( type == "block_timestamp_type" ) {
+         int64_t ms = parse_time_point( value.as_string() ) / 1000;
+         out.raw( uint32_t((ms - 946684800000ll) / 500) );
+         return;
+      }
+      if( type == "symbol_code" ) { out.raw( string_to_symbol_code( value.as_string() ) ); return; }
+      if( type == "symbol" )      { out.raw( string_to_symbol( value.as_string() ) ); return; }
+      if( type == "asset" ) {
+         asset a = string_to_asset( value.as_string() );
+         out.raw( a.amount );
+         out.raw( a.symbol );
+         return;
+      }
+      if( type == "extended_asset" ) {
+         write( "asset", value["quantity"], out, depth + 1 );
+         write( "name", value["contract"], out, depth + 1 );
+         return;
+      }
+
+      auto v = variants.find( type );
+      if( v != variants.end() ) {
+         // variants are written as ["type", value]
+         const std::string& alt = value[0].as_string();
+         for( size_t i = 0; i < v->second.size(); ++i ) {
+            if( v->second[i] == alt ) {
+               out.varuint32( i );
+               write( alt, value[1], out, depth + 1 );
+               return;
+            }
+         }
+         throw format_error( "abi: " + alt + " is not an alternative of " + type );
+      }
+
+      if( structs.count( type ) ) {
+         write_struct( type, value, out, depth );
+         return;
+      }
+      throw format_error( "abi: unknown type " + type );
+   }
+
+   // ---- reading ----
+
+   void abi::read_struct( const std::string& type, bin_reader& in, json& out, int depth ) const {
+      const struct_def& def = structs.at( type );
+      if( !def.base.empty() ) read_struct( resolve( def.base ), in, out, depth + 1 );
+      for( const auto& f : def.fields ) {
+         if( !f.type.empty() && f.type.back() == '$' && in.remaining() == 0 ) return;
+         out.set( f.name, read( f.type, in, depth + 1 ) );
+      }
+   }
+
+   json abi::read( const std::string& raw_type, bin_reader& in, int depth ) const {
+      if( depth > max_depth ) throw format_error( "abi: nesting too deep" );
+      std::string type = resolve( raw_type );
+
+      if( type.size() > 2 && type.compare( type.size() - 2, 2, "[]" ) == 0 ) {
+         std::string elem = type.substr( 0, type.size() - 2 );
+         size_t n = in.varuint32();
+         json arr = json::array();
+         for( size_t i = 0; i < n; ++i ) arr.push_back( read( elem, in, depth + 1 ) );
+         return arr;
+      }
+      if( !type.empty() && type.back() == '?' ) {
+         if( !in.raw<uint8_t>() ) return json();
+         return read( type.substr( 0, type.size() - 1 ), in, depth + 1 );
+      }
+      if( !type.empty() && type.back() == '$' )
+         return read( type.substr( 0, type.size() - 1 ), in, depth + 1 );
+
+      if( type == "bool" )      return json( in.raw<uint8_t>() != 0 );
+      if( type == "int8" )      return json::number( int64_t(in.raw<int8_t>()) );
+      if( type == "uint8" )     return json::number( uint64_t(in.raw<uint8_t>()) );
+      if( type == "int16" )     return json::number( int64_t(in.raw<int16_t>()) );
+      if( type == "uint16" )    return json::number( uint64_t(in.raw<uint16_t>()) );
+      if( type == "int32" )     return json::number( int64_t(in.raw<int32_t>()) );
+      if( type == "uint32" )    return json::number( uint64_t(in.raw<uint32_t>()) );
+      if( type == "int64" )     return json::number( in.raw<int64_t>() );
+      if( type == "uint64" )    return json::number( in.raw<uint64_t>() );
+      if( type == "varuint32" ) return json::number( in.varuint32() );
+      if( type == "varint32" )  return json::number( int64_t(in.varint32()) );
+      if( type == "uint128" )   return json( format_u128( in.raw<unsigned __int128>() ) );
+      if( type == "int128" ) {
+         __int128 v = in.raw<__int128>();
+         return json( v < 0 ? "-" + format_u128( ~(unsigned __int128)v + 1 ) : format_u128( (unsigned __int128)v ) );
+      }
+      if( type == "float32" || type == "float64" ) {
+         double d = type == "float32" ? double(in.raw<float>()) : in.raw<double>();
+         char buf[40];
+         std::snprintf( buf, sizeof(buf), "%.17g", d );
+         return json::number( std::string( buf ) );
+      }
+      if( type == "name" )      return json( name_to_string( in.raw<uint64_t>() ) );
+      if( type == "string" )    return json( in.string() );
+      if( type == "bytes" ) {
+         size_t n = in.varuint32();
+         return json( to_hex( in.skip( n ), n ) );
+      }
+      if( type == "checksum160" || type == "checksum256" || type == "checksum512" || type == "float128" ) {
+         size_t n = type == "checksum160" ? 20 : type == "checksum512" ? 64 : type == "float128" ? 16 : 32;
+         return json( to_hex( in.skip( n ), n ) );
+      }
+      if( type == "public_key" || type == "signature" ) {
+         if( in.raw<uint8_t>() != 0 ) throw format_error( "abi: only K1 keys and signatures are supported" );
+         size_t n = type == "public_key" ? 33 : 65;
+         const char* p = in.skip( n );
+         std::vector<uint8_t> b( p, p + n );
+         return json( type == "public_key" ? public_key_to_string( b ) : signature_to_string( b ) );
+      }
+      if( type == "time_point_sec" ) return json( format_time_point_sec( in.raw<uint32_t>() ) );
+      if( type == "time_point" )     return json( format_time_point( in.raw<int64_t>() ) );
+      if( type == "block_timestamp_type" )
+         return json( format_time_point( (int64_t(in.raw<uint32_t>()) * 500 + 946684800000ll) * 1000 ) );
+      if( type == "symbol_code" ) return json( symbol_code_to_string( in.raw<uint64_t>() ) );
+      if( type == "symbol" )      return json( symbol_to_string( in.raw<uint64_t>() ) );
+      if( type == "asset" ) {
+         asset a;
+         a.amount = in.raw<int64_t>();
+         a.symbol = in.raw<uint64_t>();
+         return json( asset_to_string( a ) );
+      }
+      if( type == "extended_asset" ) {
+         json o = json::object();
+         o.set( "quantity", read( "asset", in, depth + 1 ) );
+         o.set( "contract", read( "name", in, depth + 1 ) );
+         return o;
+      }
+
+      auto v = variants.find( type );
+      if( v != variants.end() ) {
+         size_t i = in.varuint32();
+         if( i >= v->second.size() ) throw format_error( "abi: bad variant index for " + type );
+         json arr = json::array();
+         arr.push_back( json( v->second[i] ) );
+         arr.push_back( read( v->second[i], in, depth + 1 ) );
+         return arr;
+      }
+
+      if( structs.count( type ) ) {
+         json o = json::object();
+         read_struct( type, in, o, depth );
+         return o;
+      }
+      throw format_error( "abi: unknown type " + type );
+   }
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "eosio.hpp"
+#include "json.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hagglex {
+
+   // Converts action data and table rows between JSON and the EOSIO binary format,
+   // driven by a contract ABI (eosio::abi/1.x as written by eosio-abigen).
+   class abi {
+      public:
+         abi() = default;
+         explicit abi( const json& def );
+
+         static abi load( const std::string& path );
+
+         std::vector<char> json_to_bin( const std::string& type, const json& value ) const;
+         json              bin_to_json( const std::string& type, bin_reader& in ) const;
+         json              bin_to_json( const std::string& type, const std::vector<char>& data ) const;
+
+         // struct type of an action or table, empty when the ABI does not declare it
+         std::string action_type( uint64_t action ) const;
+         std::string table_type( uint64_t table ) const;
+
+         // the declared actions and their struct types
+         const std::map<uint64_t, std::string>& action_types() const { return actions; }
+
+         // (name, type) of a struct's fields, base struct first, typedefs resolved
+         std::vector<std::pair<std::string, std::string>> struct_fields( const std::string& type ) const;
+
+      private:
+         struct field {
+            std::string name;
+            std::string type;
+         };
+         struct struct_def {
+            std::string        base;
+            std::vector<field> fields;
+         };
+
+         std::map<std::string, std::string>              typedefs;
+         std::map<std::string, struct_def>               structs;
+         std::map<std::string, std::vector<std::string>> variants;
+         std::map<uint64_t, std::string>                 actions;
+         std::map<uint64_t, std::string>                 tables;
+
+         std::string resolve( std::string type ) const;
+         void write( const std::string& type, const json& value, bin_writer& out, int depth ) const;
+         json read( const std::string& type, bin_reader& in, int depth ) const;
+         void write_struct( const std::string& type, const json& value, bin_writer& out, int depth ) const;
+         void read_struct( const std::string& type, bin_reader& in, json& out, int depth ) const;
+   };
+
+   // ISO-8601 UTC ("2021-10-14T12:00:00", optional ".mmm") <-> seconds/microseconds since epoch
+   uint32_t    parse_time_point_sec( const std::string& s );
+   std::string format_time_point_sec( uint32_t sec );
+   int64_t     parse_time_point( const std::string& s );
+   std::string format_time_point( int64_t usec );
+
+   std::string read_file( const std::string& path );
+
+}
@@ -0,0 +1,711 @@
+#include "chain.hpp"
+
+#include "eosio.hpp"
+
+#include <hagglex_common/error_codes.hpp>
+
+#include <cstring>
+#include <type_traits>
+
+namespace hagglex::chain {
+
+   using wasm::instance;
+   using wasm::trap;
+
+   // raised by eosio_assert and friends; unwinds the whole transaction
+   struct assertion : trap {
+      using trap::trap;
+   };
+
+   // iterator handles of one kind of table (primary, idx64 or idx128): non-negative
+   // values index `handles`, -(table index + 2) is a table's end iterator and -1 the end
+   // of a table that does not exist
+   struct iterators {
+      std::vector<table_id>                            tables;
+      std::vector<std::pair<uint32_t, uint64_t>>       handles;   // table index, primary key
+      std::map<std::pair<uint32_t, uint64_t>, int32_t> cache;
+
+      int32_t table_index( const table_id& t ) {
+         for( size_t i = 0; i < tables.size(); ++i )
+            if( !(tables[i] < t) && !(t < tables[i]) ) return int32_t(i);
+         tables.push_back( t );
+         return int32_t(tables.size() - 1);
+      }
+
+      int32_t end_iterator( uint32_t t ) const { return -int32_t(t) - 2; }
+
+      int32_t iterator( uint32_t t, uint64_t primary ) {
+         auto key = std::make_pair( t, primary );
+         auto it = cache.find( key );
+         if( it != cache.end() ) return it->second;
+         handles.push_back( key );
+         int32_t handle = int32_t(handles.size() - 1);
+         cache.emplace( key, handle );
+         return handle;
+      }
+   };
+
+   struct controller::context {
+      uint64_t                receiver = 0;
+      const action*           act = nullptr;
+      instance*               inst = nullptr;
+      std::vector<uint64_t>*  notified = nullptr;
+      std::vector<action>*    inlines = nullptr;
+      std::string             console;
+      std::vector<row_access> accesses;
+
+      iterators               primary;
+      iterators               idx64;
+      iterators               idx128;
+
+      template<typename Key>
+      iterators& secondary() {
+         if constexpr( std::is_same_v<Key, uint64_t> ) return idx64;
+         else return idx128;
+      }
+
+      void record( const table_id& t, uint64_t key, access_kind kind ) { accesses.push_back( { t, key, kind } ); }
+   };
+
+   namespace {
+
+      constexpr uint64_t n( const char* s ) {
+         // compile-time name for the handful of accounts and permissions the host needs
+         uint64_t value = 0;
+         int i = 0;
+         for( ; s[i] && i < 12; ++i ) {
+            char c = s[i];
+            uint64_t v = (c >= 'a' && c <= 'z') ? uint64_t(c - 'a' + 6) : (c >= '1' && c <= '5') ? uint64_t(c - '1' + 1) : 0;
+            value |= (v & 0x1f) << (64 - 5 * (i + 1));
+         }
+         return value;
+      }
+
+      std::string read_cstring( instance& in, uint32_t addr ) {
+         std::string out;
+         for( uint32_t p = addr;; ++p ) {
+            char c = char(*in.memory( p, 1 ));
+            if( !c ) return out;
+            out.push_back( c );
+         }
+      }
+
+      __float128 f128( uint64_t lo, uint64_t hi ) {
+         uint64_t parts[2] = { lo, hi };
+         __float128 v;
+         std::memcpy( &v, parts, sizeof(v) );
+         return v;
+      }
+
+      void store_f128( instance& in, uint32_t addr, __float128 v ) {
+         std::memcpy( in.writable( addr, 16 ), &v, 16 );
+      }
+
+      float as_f32( uint64_t bits ) { float f; uint32_t b = uint32_t(bits); std::memcpy( &f, &b, 4 ); return f; }
+      double as_f64( uint64_t bits ) { double d; std::memcpy( &d, &bits, 8 ); return d; }
+      uint64_t f32_bits( float f ) { uint32_t b; std::memcpy( &b, &f, 4 ); return b; }
+      uint64_t f64_bits( double d ) { uint64_t b; std::memcpy( &b, &d, 8 ); return b; }
+
+      bool unordered( __float128 a, __float128 b ) { return a != a || b != b; }
+
+   }
+
+   std::vector<char> pack_action( const action& act ) {
+      bin_writer w;
+      w.raw( act.account );
+      w.raw( act.name );
+      w.varuint32( act.authorization.size() );
+      for( const auto& p : act.authorization ) {
+         w.raw( p.actor );
+         w.raw( p.permission );
+      }
+      w.varuint32( act.data.size() );
+      w.bytes( act.data.data(), act.data.size() );
+      return w.data;
+   }
+
+   action unpack_action( const char* data, size_t size ) {
+      bin_reader r( data, size );
+      action act;
+      act.account = r.raw<uint64_t>();
+      act.name = r.raw<uint64_t>();
+      size_t auths = r.varuint32();
+      for( size_t i = 0; i < auths; ++i ) {
+         permission_level p;
+         p.actor = r.raw<uint64_t>();
+         p.permission = r.raw<uint64_t>();
+         act.authorization.push_back( p );
+      }
+      size_t len = r.varuint32();
+      const char* p = r.skip( len );
+      act.data.assign( p, p + len );
+      return act;
+   }
+
+   controller::controller() {
+      for( const char* a : { "eosio", "eosio.token" } ) create_account( n( a ) );
+   }
+
+   controller::~controller() = default;
+
+   void controller::create_account( uint64_t account ) {
+      accounts.insert( account );
+   }
+
+   void controller::set_code( uint64_t account, const std::string& wasm_path ) {
+      auto m = wasm::module::load( wasm_path );
+      set_code( account, std::make_shared<wasm::program>( std::move(m), [this]( const wasm::import_entry& imp ) { return resolve( imp ); } ) );
+   }
+
+   void controller::set_code( uint64_t account, std::shared_ptr<const wasm::program> prog ) {
+      create_account( account );
+      code[account] = std::move(prog);
+   }
+
+   std::shared_ptr<const wasm::program> controller::code_of( uint64_t account ) const {
+      auto it = code.find( account );
+      return it == code.end() ? nullptr : it->second;
+   }
+
+   std::vector<action_trace> controller::push_action( const action& act ) {
+      return push_transaction( { act } );
+   }
+
+   std::vector<action_trace> controller::push_transaction( const std::vector<action>& actions ) {
+      for( const auto& act : actions ) {
+         if( !is_account( act.account ) ) throw chain_error( "unknown account " + name_to_string( act.account ) );
+         for( const auto& p : act.authorization )
+            if( !is_account( p.actor ) ) throw chain_error( "unknown authorizing account " + name_to_string( p.actor ) );
+      }
+
+      database saved = tables;
+      secondary_database<uint64_t> saved64 = idx64;
+      secondary_database<unsigned __int128> saved128 = idx128;
+      std::vector<action_trace> traces;
+      try {
+         for( const auto& act : actions ) execute( act, 0, traces );
+      } catch( const trap& e ) {
+         tables = std::move(saved);
+         idx64 = std::move(saved64);
+         idx128 = std::move(saved128);
+         ctx = nullptr;
+         throw chain_error( e.what() );
+      }
+      return traces;
+   }
+
+   // the receiver first, then every account it notified, then the inline actions
+   // they queued, each of those recursively: the order nodeos uses
+   uint64_t controller::ram_bytes() const {
+      constexpr uint64_t table_object = 108, row_object = 108, idx64_object = 128, idx128_object = 136;
+      uint64_t bytes = 0;
+      for( const auto& [id, t] : tables ) {
+         if( t.empty() ) continue;
+         bytes += table_object;
+         for( const auto& [key, r] : t ) bytes += row_object + r.value.size();
+      }
+      for( const auto& [id, t] : idx64 )
+         if( !t.rows.empty() ) bytes += table_object + idx64_object * t.rows.size();
+      for( const auto& [id, t] : idx128 )
+         if( !t.rows.empty() ) bytes += table_object + idx128_object * t.rows.size();
+      return bytes;
+   }
+
+   void controller::execute( const action& act, uint32_t depth, std::vector<action_trace>& traces ) {
+      if( depth > 4 ) throw trap( "max inline action depth exceeded" );
+      std::vector<uint64_t> notified{ act.account };
+      std::vector<action>   inlines;
+      for( size_t i = 0; i < notified.size(); ++i )
+         apply( notified[i], act, depth, traces, notified, inlines );
+      for( const auto& a : inlines ) execute( a, depth + 1, traces );
+   }
+
+   void controller::apply( uint64_t receiver, const action& act, uint32_t depth, std::vector<action_trace>& traces,
+                           std::vector<uint64_t>& notified, std::vector<action>& inlines ) {
+      action_trace t;
+      t.receiver = receiver;
+      t.act = act;
+      t.depth = depth;
+
+      auto it = code.find( receiver );
+      if( it == code.end() ) {
+         traces.push_back( std::move(t) );
+         return;
+      }
+
+      instance inst( *it->second );
+      context c;
+      c.receiver = receiver;
+      c.act = &act;
+      c.inst = &inst;
+      c.notified = &notified;
+      c.inlines = &inlines;
+
+      int64_t entry = it->second->mod().export_index( "apply" );
+      if( entry < 0 ) throw trap( name_to_string( receiver ) + " does not export apply" );
+
+      context* outer = ctx;
+      ctx = &c;
+      try {
+         inst.call( uint32_t(entry), { receiver, act.account, act.name } );
+      } catch( ... ) {
+         ctx = outer;
+         throw;
+      }
+      ctx = outer;
+
+      t.executed = true;
+      t.console = std::move(c.console);
+      t.stats = std::move(inst.stats);
+      t.accesses = std::move(c.accesses);
+      traces.push_back( std::move(t) );
+   }
+
+   wasm::host_function controller::resolve( const wasm::import_entry& imp ) {
+      if( imp.module != "env" ) return {};
+      const std::string& f = imp.field;
+      auto self = this;
+      // an exact find reads one key, whether it is there or not; a bound depends on
+      // which keys exist
+      auto db_find = [self]( uint64_t code, uint64_t scope, uint64_t tbl, uint64_t id, bool lower ) -> int32_t {
+         context& c = *self->ctx;
+         table_id tid{ code, scope, tbl };
+         if( lower ) c.record( tid, 0, access_kind::scan );
+         else c.record( tid, id, access_kind::read );
+         auto t = self->tables.find( tid );
+         if( t == self->tables.end() ) return -1;
+         uint32_t ti = uint32_t(c.primary.table_index( tid ));
+         auto r = lower ? t->second.lower_bound( id ) : t->second.find( id );
+         if( r == t->second.end() ) return c.primary.end_iterator( ti );
+         if( lower ) c.record( tid, r->first, access_kind::read );
+         return c.primary.iterator( ti, r->first );
+      };
+      // resolves a live iterator to its table and row
+      auto deref = [self]( int32_t itr ) -> std::pair<table*, table::iterator> {
+         context& c = *self->ctx;
+         if( itr < 0 || size_t(itr) >= c.primary.handles.size() ) throw trap( "invalid iterator" );
+         auto [ti, primary] = c.primary.handles[itr];
+         auto t = self->tables.find( c.primary.tables[ti] );
+         if( t == self->tables.end() ) throw trap( "dereference of deleted object" );
+         auto r = t->second.find( primary );
+         if( r == t->second.end() ) throw trap( "dereference of deleted object" );
+         return { &t->second, r };
+      };
+
+      // database
+      if( f == "db_find_i64" )
+         return [db_find]( instance&, const uint64_t* a, uint64_t* r ) { *r = uint32_t(db_find( a[0], a[1], a[2], a[3], false )); };
+      if( f == "db_lowerbound_i64" )
+         return [db_find]( instance&, const uint64_t* a, uint64_t* r ) { *r = uint32_t(db_find( a[0], a[1], a[2], a[3], true )); };
+      if( f == "db_upperbound_i64" )
+         return [db_find]( instance&, const uint64_t* a, uint64_t* r ) {
+            *r = uint32_t(a[3] == UINT64_MAX ? db_find( a[0], a[1], a[2], a[3], false ) : db_find( a[0], a[1], a[2], a[3] + 1, true ));
+         };
+      if( f == "db_end_i64" )
+         return [self]( instance&, const uint64_t* a, uint64_t* r ) {
+            table_id tid{ a[0], a[1], a[2] };
+            self->ctx->record( tid, 0, access_kind::scan );
+            *r = self->tables.count( tid ) ? uint32_t(self->ctx->primary.end_iterator( self->ctx->primary.table_index( tid ) )) : uint32_t(-1);
+         };
+      if( f == "db_store_i64" )
+         return [self]( instance& in, const uint64_t* a, uint64_t* r ) {
+            context& c = *self->ctx;
+            uint64_t payer = a[2];
+            if( !self->is_account( payer ) ) throw trap( "invalid payer" );
+            table_id tid{ c.receiver, a[0], a[1] };
+            const char* p = reinterpret_cast<const char*>( in.memory( uint32_t(a[4]), uint32_t(a[5]) ) );
+            table& t = self->tables[tid];
+            if( t.count( a[3] ) ) throw assertion( "could not insert object, most likely a uniqueness constraint was violated" );
+            t[a[3]] = row{ payer, std::vector<char>( p, p + uint32_t(a[5]) ) };
+            c.record( tid, a[3], access_kind::write );
+            c.record( tid, 0, access_kind::membership );
+            *r = uint32_t(c.primary.iterator( c.primary.table_index( tid ), a[3] ));
+         };
+      if( f == "db_update_i64" )
+         return [self, deref]( instance& in, const uint64_t* a, uint64_t* ) {
+            auto [t, it] = deref( int32_t(a[0]) );
+            const table_id& tid = self->ctx->primary.tables[self->ctx->primary.handles[int32_t(a[0])].first];
+            if( tid.code != self->ctx->receiver ) throw trap( "db access violation" );
+            const char* p = reinterpret_cast<const char*>( in.memory( uint32_t(a[2]), uint32_t(a[3]) ) );
+            if( a[1] ) it->second.payer = a[1];
+            it->second.value.assign( p, p + uint32_t(a[3]) );
+            self->ctx->record( tid, it->first, access_kind::write );
+         };
+      if( f == "db_remove_i64" )
+         return [self, deref]( instance&, const uint64_t* a, uint64_t* ) {
+            auto [t, it] = deref( int32_t(a[0]) );
+            const table_id tid = self->ctx->primary.tables[self->ctx->primary.handles[int32_t(a[0])].first];
+            if( tid.code != self->ctx->receiver ) throw trap( "db access violation" );
+            self->ctx->record( tid, it->first, access_kind::write );
+            self->ctx->record( tid, 0, access_kind::membership );
+            t->erase( it );
+            if( t->empty() ) self->tables.erase( tid );
+         };
+      if( f == "db_get_i64" )
+         return [self, deref]( instance& in, const uint64_t* a, uint64_t* r ) {
+            auto [t, it] = deref( int32_t(a[0]) );
+            self->ctx->record( self->ctx->primary.tables[self->ctx->primary.handles[int32_t(a[0])].first], it->first, access_kind::read );
+            const auto& v = it->second.value;
+            uint32_t size = uint32_t(a[2]);
+            if( size == 0 ) { *r = v.size(); return; }
+            uint32_t copy = std::min<uint32_t>( size, uint32_t(v.size()) );
+            std::memcpy( in.writable( uint32_t(a[1]), copy ), v.data(), copy );
+            *r = copy;
+         };
+      if( f == "db_next_i64" || f == "db_previous_i64" ) {
+         bool next = f == "db_next_i64";
+         return [self, next]( instance& in, const uint64_t* a, uint64_t* r ) {
+            context& c = *self->ctx;
+            int32_t itr = int32_t(a[0]);
+            uint32_t ti;
+            table::iterator pos;
+            table* t;
+            if( itr < -1 ) {
+               // previous from the end iterator is the last row
+               ti = uint32_t(-itr - 2);
+               if( next ) { *r = uint32_t(-1); return; }
+               auto found = self->tables.find( c.primary.tables[ti] );
+               if( found == self->tables.end() || found->second.empty() ) { *r = uint32_t(-1); return; }
+               t = &found->second;
+               pos = t->end();
+            } else {
+               if( itr < 0 || size_t(itr) >= c.primary.handles.size() ) throw trap( "invalid iterator" );
+               ti = c.primary.handles[itr].first;
+               auto found = self->tables.find( c.primary.tables[ti] );
+               if( found == self->tables.end() ) throw trap( "dereference of deleted object" );
+               t = &found->second;
+               pos = t->find( c.primary.handles[itr].second );
+               if( pos == t->end() ) throw trap( "dereference of deleted object" );
+            }
+            c.record( c.primary.tables[ti], 0, access_kind::scan );
+            if( next ) {
+               ++pos;
+               if( pos == t->end() ) { *r = uint32_t(c.primary.end_iterator( ti )); return; }
+            } else {
+               if( pos == t->begin() ) { *r = uint32_t(-1); return; }
+               --pos;
+            }
+            c.record( c.primary.tables[ti], pos->first, access_kind::read );
+            std::memcpy( in.writable( uint32_t(a[1]), 8 ), &pos->first, 8 );
+            *r = uint32_t(c.primary.iterator( ti, pos->first ));
+         };
+      }
+
+      if( f.rfind( "db_idx64_", 0 ) == 0 ) return resolve_secondary<uint64_t>( f.substr( 9 ) );
+      if( f.rfind( "db_idx128_", 0 ) == 0 ) return resolve_secondary<unsigned __int128>( f.substr( 10 ) );
+
+      // memory
+      if( f == "memcpy" )
+         return []( instance& in, const uint64_t* a, uint64_t* r ) {
+            uint32_t dst = uint32_t(a[0]), src = uint32_t(a[1]), len = uint32_t(a[2]);
+            if( (dst > src ? dst - src : src - dst) < len ) throw trap( "memcpy can only accept non-aliasing pointers" );
+            std::memcpy( in.writable( dst, len ), in.memory( src, len ), len );
+            *r = dst;
+         };
+      if( f == "memmove" )
+         return []( instance& in, const uint64_t* a, uint64_t* r ) {
+            uint32_t dst = uint32_t(a[0]), src = uint32_t(a[1]), len = uint32_t(a[2]);
+            std::memmove( in.writable( dst, len ), in.memory( src, len ), len );
+            *r = dst;
+         };
+      if( f == "memset" )
+         return []( instance& in, const uint64_t* a, uint64_t* r ) {
+            std::memset( in.writable( uint32_t(a[0]), uint32_t(a[2]) ), int(a[1] & 0xff), uint32_t(a[2]) );
+            *r = uint32_t(a[0]);
+         };
+      if( f == "memcmp" )
+         return []( instance& in, const uint64_t* a, uint64_t* r ) {
+            int cmp = std::memcmp( in.memory( uint32_t(a[0]), uint32_t(a[2]) ), in.memory( uint32_t(a[1]), uint32_t(a[2]) ), uint32_t(a[2]) );
+            *r = uint32_t(cmp < 0 ? -1 : cmp > 0 ? 1 : 0);
+         };
+
+      // action context
+      if( f == "action_data_size" )
+         return [self]( instance&, const uint64_t*, uint64_t* r ) { *r = self->ctx->act->data.size(); };
+      if( f == "read_action_data" )
+         return [self]( instance& in, const uint64_t* a, uint64_t* r ) {
+            const auto& d = self->ctx->act->data;
+            uint32_t size = uint32_t(a[1]);
+            if( size == 0 ) { *r = d.size(); return; }
+            uint32_t copy = std::min<uint32_t>( size, uint32_t(d.size()) );
+            std::memcpy( in.writable( uint32_t(a[0]), copy ), d.data(), copy );
+            *r = copy;
+         };
+      if( f == "current_receiver" )
+         return [self]( instance&, const uint64_t*, uint64_t* r ) { *r = self->ctx->receiver; };
+      if( f == "current_time" )
+         return [self]( instance&, const uint64_t*, uint64_t* r ) { *r = uint64_t(self->time_us); };
+      if( f == "publication_time" )
+         return [self]( instance&, const uint64_t*, uint64_t* r ) { *r = uint64_t(self->time_us); };
+      if( f == "is_account" )
+         return [self]( instance&, const uint64_t* a, uint64_t* r ) { *r = self->is_account( a[0] ) ? 1 : 0; };
+
+      // authorization and notifications
+      auto authorized = [self]( uint64_t account ) {
+         for( const auto& p : self->ctx->act->authorization )
+            if( p.actor == account ) return true;
+         return false;
+      };
+      if( f == "require_auth" )
+         return [authorized]( instance&, const uint64_t* a, uint64_t* ) {
+            if( !authorized( a[0] ) ) throw assertion( "missing authority of " + name_to_string( a[0] ) );
+         };
+      if( f == "require_auth2" )
+         return [self]( instance&, const uint64_t* a, uint64_t* ) {
+            for( const auto& p : self->ctx->act->authorization )
+               if( p.actor == a[0] && p.permission == a[1] ) return;
+            throw assertion( "missing authority of " + name_to_string( a[0] ) + "@" + name_to_string( a[1] ) );
+         };
+      if( f == "has_auth" )
+         return [authorized]( instance&, const uint64_t* a, uint64_t* r ) { *r = authorized( a[0] ) ? 1 : 0; };
+      if( f == "require_recipient" )
+         return [self]( instance&, const uint64_t* a, uint64_t* ) {
+            if( !self->is_account( a[0] ) ) throw assertion( "notified account does not exist" );
+            auto& list = *self->ctx->notified;
+            for( auto x : list ) if( x == a[0] ) return;
+            list.push_back( a[0] );
+         };
+      if( f == "send_inline" )
+         return [self]( instance& in, const uint64_t* a, uint64_t* ) {
+            context& c = *self->ctx;
+            action act = unpack_action( reinterpret_cast<const char*>( in.memory( uint32_t(a[0]), uint32_t(a[1]) ) ), uint32_t(a[1]) );
+            if( !self->is_account( act.account ) ) throw assertion( "inline action's code account does not exist" );
+            // the contract may act for itself (eosio.code) or pass on authority it was given
+            for( const auto& p : act.authorization ) {
+               bool ok = p.actor == c.receiver;
+               for( const auto& q : c.act->authorization ) ok = ok || (q.actor == p.actor && q.permission == p.permission);
+               if( !ok ) throw assertion( "inline action not authorized by " + name_to_string( p.actor ) );
+            }
+            c.inlines->push_back( std::move(act) );
+         };
+
+      // assertions
+      if( f == "eosio_assert" )
+         return []( instance& in, const uint64_t* a, uint64_t* ) {
+            if( !uint32_t(a[0]) ) throw assertion( "assertion failure with message: " + read_cstring( in, uint32_t(a[1]) ) );
+         };
+      if( f == "eosio_assert_message" )
+         return []( instance& in, const uint64_t* a, uint64_t* ) {
+            if( !uint32_t(a[0]) ) {
+               const char* p = reinterpret_cast<const char*>( in.memory( uint32_t(a[1]), uint32_t(a[2]) ) );
+               throw assertion( "assertion failure with message: " + std::string( p, uint32_t(a[2]) ) );
+            }
+         };
+      if( f == "eosio_assert_code" )
+         return []( instance&, const uint64_t* a, uint64_t* ) {
+            if( !uint32_t(a[0]) ) throw assertion( "assertion failure with error code: " + std::to_string( a[1] ) );
+         };
+      if( f == "abort" )
+         return []( instance&, const uint64_t*, uint64_t* ) { throw assertion( "abort() called" ); };
+      if( f == "eosio_exit" )
+         return []( instance&, const uint64_t*, uint64_t* ) { throw trap( "eosio_exit is not supported" ); };
+
+      // console
+      if( f == "prints" )
+         return [self]( instance& in, const uint64_t* a, uint64_t* ) { self->ctx->console += read_cstring( in, uint32_t(a[0]) ); };
+      if( f == "prints_l" )
+         return [self]( instance& in, const uint64_t* a, uint64_t* ) {
+            self->ctx->console.append( reinterpret_cast<const char*>( in.memory( uint32_t(a[0]), uint32_t(a[1]) ) ), uint32_t(a[1]) );
+         };
+      if( f == "printi" )
+         return [self]( instance&, const uint64_t* a, uint64_t* ) { self->ctx->console += std::to_string( int64_t(a[0]) ); };
+      if( f == "printui" )
+         return [self]( instance&, const uint64_t* a, uint64_t* ) { self->ctx->console += std::to_string( a[0] ); };
+      if( f == "printn" )
+         return [self]( instance&, const uint64_t* a, uint64_t* ) { self->ctx->console += name_to_string( a[0] ); };
+      if( f == "printhex" )
+         return [self]( instance& in, const uint64_t* a, uint64_t* ) {
+            self->ctx->console += to_hex( in.memory( uint32_t(a[0]), uint32_t(a[1]) ), uint32_t(a[1]) );
+         };
+
+      // 128-bit float support routines the compiler emits for long double
+      if( f == "__addtf3" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), f128( a[1], a[2] ) + f128( a[3], a[4] ) ); };
+      if( f == "__subtf3" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), f128( a[1], a[2] ) - f128( a[3], a[4] ) ); };
+      if( f == "__multf3" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), f128( a[1], a[2] ) * f128( a[3], a[4] ) ); };
+      if( f == "__divtf3" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), f128( a[1], a[2] ) / f128( a[3], a[4] ) ); };
+      if( f == "__negtf2" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), -f128( a[1], a[2] ) ); };
+      if( f == "__extendsftf2" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), __float128( as_f32( a[1] ) ) ); };
+      if( f == "__extenddftf2" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), __float128( as_f64( a[1] ) ) ); };
+      if( f == "__floatsitf" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), __float128( int32_t(a[1]) ) ); };
+      if( f == "__floatunsitf" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), __float128( uint32_t(a[1]) ) ); };
+      if( f == "__floatditf" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), __float128( int64_t(a[1]) ) ); };
+      if( f == "__floatunditf" ) return []( instance& in, const uint64_t* a, uint64_t* ) { store_f128( in, uint32_t(a[0]), __float128( a[1] ) ); };
+      if( f == "__trunctfdf2" ) return []( instance&, const uint64_t* a, uint64_t* r ) { *r = f64_bits( double( f128( a[0], a[1] ) ) ); };
+      if( f == "__trunctfsf2" ) return []( instance&, const uint64_t* a, uint64_t* r ) { *r = f32_bits( float( f128( a[0], a[1] ) ) ); };
+      if( f == "__fixtfsi" ) return []( instance&, const uint64_t* a, uint64_t* r ) { *r = uint32_t(int32_t( f128( a[0], a[1] ) )); };
+      if( f == "__fixunstfsi" ) return []( instance&, const uint64_t* a, uint64_t* r ) { *r = uint32_t( f128( a[0], a[1] ) ); };
+      if( f == "__fixtfdi" ) return []( instance&, const uint64_t* a, uint64_t* r ) { *r = uint64_t(int64_t( f128( a[0], a[1] ) )); };
+      if( f == "__fixunstfdi" ) return []( instance&, const uint64_t* a, uint64_t* r ) { *r = uint64_t( f128( a[0], a[1] ) ); };
+      if( f == "__unordtf2" ) return []( instance&, const uint64_t* a, uint64_t* r ) { *r = unordered( f128( a[0], a[1] ), f128( a[2], a[3] ) ) ? 1 : 0; };
+      if( f == "__eqtf2" || f == "__netf2" )
+         return []( instance&, const uint64_t* a, uint64_t* r ) { *r = f128( a[0], a[1] ) == f128( a[2], a[3] ) ? 0 : 1; };
+      if( f == "__letf2" || f == "__lttf2" || f == "__getf2" || f == "__gttf2" ) {
+         // unordered compares as "greater" for le/lt and "less" for ge/gt, so the caller's test fails
+         int32_t unord = (f == "__letf2" || f == "__lttf2") ? 1 : -1;
+         return [unord]( instance&, const uint64_t* a, uint64_t* r ) {
+            __float128 x = f128( a[0], a[1] ), y = f128( a[2], a[3] );
+            int32_t c = unordered( x, y ) ? unord : x < y ? -1 : x > y ? 1 : 0;
+            *r = uint32_t(c);
+         };
+      }
+
+      // privileged and producer intrinsics are linked but never reached by these contracts
+      return [name = f]( instance&, const uint64_t*, uint64_t* ) { throw trap( "unsupported host function " + name ); };
+   }
+
+   // db_idx64_* and db_idx128_*, `op` being the part after the prefix. Handles are
+   // numbered apart from the primary ones, as in nodeos; secondary keys are passed by
+   // pointer and bounds write the key they land on back.
+   template<typename Key>
+   wasm::host_function controller::resolve_secondary( const std::string& op ) {
+      auto self = this;
+      auto db = [self]() -> secondary_database<Key>& {
+         if constexpr( std::is_same_v<Key, uint64_t> ) return self->idx64;
+         else return self->idx128;
+      };
+      auto load = []( instance& in, uint64_t addr ) {
+         Key k;
+         std::memcpy( &k, in.memory( uint32_t(addr), sizeof(Key) ), sizeof(Key) );
+         return k;
+      };
+      auto save = []( instance& in, uint64_t addr, const void* v, size_t size ) {
+         std::memcpy( in.writable( uint32_t(addr), uint32_t(size) ), v, size );
+      };
+      // resolves a live iterator to its table id, index and row
+      auto deref = [self, db]( int32_t itr ) {
+         iterators& its = self->ctx->secondary<Key>();
+         if( itr < 0 || size_t(itr) >= its.handles.size() ) throw trap( "invalid iterator" );
+         auto [ti, primary] = its.handles[itr];
+         auto t = db().find( its.tables[ti] );
+         if( t == db().end() ) throw trap( "dereference of deleted object" );
+         auto r = t->second.rows.find( primary );
+         if( r == t->second.rows.end() ) throw trap( "dereference of deleted object" );
+         return std::make_tuple( its.tables[ti], ti, &t->second, r );
+      };
+
+      if( op == "store" )
+         return [self, db, load]( instance& in, const uint64_t* a, uint64_t* r ) {
+            context& c = *self->ctx;
+            if( !self->is_account( a[2] ) ) throw trap( "invalid payer" );
+            table_id tid{ c.receiver, a[0], a[1] };
+            secondary_table<Key>& t = db()[tid];
+            if( t.rows.count( a[3] ) ) throw assertion( "could not insert object, most likely a uniqueness constraint was violated" );
+            const Key key = load( in, a[4] );
+            t.rows[a[3]] = secondary_row<Key>{ key, a[2] };
+            t.order.insert( { key, a[3] } );
+            c.record( tid, a[3], access_kind::write );
+            c.record( tid, 0, access_kind::membership );
+            iterators& its = c.secondary<Key>();
+            *r = uint32_t(its.iterator( uint32_t(its.table_index( tid )), a[3] ));
+         };
+      if( op == "update" )
+         return [self, deref, load]( instance& in, const uint64_t* a, uint64_t* ) {
+            auto [tid, ti, t, it] = deref( int32_t(a[0]) );
+            if( tid.code != self->ctx->receiver ) throw trap( "db access violation" );
+            // a new secondary key moves the entry in the iteration order
+            const Key key = load( in, a[2] );
+            t->order.erase( { it->second.key, it->first } );
+            t->order.insert( { key, it->first } );
+            it->second.key = key;
+            if( a[1] ) it->second.payer = a[1];
+            self->ctx->record( tid, it->first, access_kind::write );
+            self->ctx->record( tid, 0, access_kind::membership );
+         };
+      if( op == "remove" )
+         return [self, db, deref]( instance&, const uint64_t* a, uint64_t* ) {
+            auto [tid, ti, t, it] = deref( int32_t(a[0]) );
+            if( tid.code != self->ctx->receiver ) throw trap( "db access violation" );
+            self->ctx->record( tid, it->first, access_kind::write );
+            self->ctx->record( tid, 0, access_kind::membership );
+            t->order.erase( { it->second.key, it->first } );
+            t->rows.erase( it );
+            if( t->rows.empty() ) db().erase( tid );
+         };
+      if( op == "next" || op == "previous" ) {
+         bool next = op == "next";
+         return [self, db, save, next]( instance& in, const uint64_t* a, uint64_t* r ) {
+            context& c = *self->ctx;
+            iterators& its = c.secondary<Key>();
+            int32_t itr = int32_t(a[0]);
+            uint32_t ti;
+            secondary_table<Key>* t;
+            typename std::set<std::pair<Key, uint64_t>>::iterator pos;
+            if( itr < -1 ) {
+               // previous from the end iterator is the last entry
+               ti = uint32_t(-itr - 2);
+               if( next ) { *r = uint32_t(-1); return; }
+               auto found = db().find( its.tables[ti] );
+               if( found == db().end() ) { *r = uint32_t(-1); return; }
+               t = &found->second;
+               pos = t->order.end();
+            } else {
+               if( itr < 0 || size_t(itr) >= its.handles.size() ) throw trap( "invalid iterator" );
+               ti = its.handles[itr].first;
+               auto found = db().find( its.tables[ti] );
+               if( found == db().end() ) throw trap( "dereference of deleted object" );
+               t = &found->second;
+               auto row = t->rows.find( its.handles[itr].second );
+               if( row == t->rows.end() ) throw trap( "dereference of deleted object" );
+               pos = t->order.find( { row->second.key, row->first } );
+            }
+            c.record( its.tables[ti], 0, access_kind::scan );
+            if( next ) {
+               ++pos;
+               if( pos == t->order.end() ) { *r = uint32_t(its.end_iterator( ti )); return; }
+            } else {
+               if( pos == t->order.begin() ) { *r = uint32_t(-1); return; }
+               --pos;
+            }
+            c.record( its.tables[ti], pos->second, access_kind::read );
+            save( in, a[1], &pos->second, 8 );
+            *r = uint32_t(its.iterator( ti, pos->second ));
+         };
+      }
+      if( op == "find_primary" )
+         return [self, db, save]( instance& in, const uint64_t* a, uint64_t* r ) {
+            context& c = *self->ctx;
+            table_id tid{ a[0], a[1], a[2] };
+            c.record( tid, a[4], access_kind::read );
+            auto t = db().find( tid );
+            if( t == db().end() ) { *r = uint32_t(-1); return; }
+            iterators& its = c.secondary<Key>();
+            uint32_t ti = uint32_t(its.table_index( tid ));
+            auto row = t->second.rows.find( a[4] );
+            if( row == t->second.rows.end() ) { *r = uint32_t(its.end_iterator( ti )); return; }
+            save( in, a[3], &row->second.key, sizeof(Key) );
+            *r = uint32_t(its.iterator( ti, a[4] ));
+         };
+      // find_secondary: the first entry with exactly that key; lowerbound and upperbound:
+      // the first at or past it, writing back where they landed
+      if( op == "find_secondary" || op == "lowerbound" || op == "upperbound" ) {
+         enum { exact, lower, upper } mode = op == "find_secondary" ? exact : op == "lowerbound" ? lower : upper;
+         return [self, db, load, save, mode]( instance& in, const uint64_t* a, uint64_t* r ) {
+            context& c = *self->ctx;
+            table_id tid{ a[0], a[1], a[2] };
+            c.record( tid, 0, access_kind::scan );
+            auto t = db().find( tid );
+            if( t == db().end() ) { *r = uint32_t(-1); return; }
+            iterators& its = c.secondary<Key>();
+            uint32_t ti = uint32_t(its.table_index( tid ));
+            const Key key = load( in, a[3] );
+            auto& order = t->second.order;
+            auto pos = mode == upper ? order.upper_bound( { key, UINT64_MAX } ) : order.lower_bound( { key, 0 } );
+            if( pos == order.end() || (mode == exact && pos->first != key) ) { *r = uint32_t(its.end_iterator( ti )); return; }
+            c.record( tid, pos->second, access_kind::read );
+            if( mode != exact ) save( in, a[3], &pos->first, sizeof(Key) );
+            save( in, a[4], &pos->second, 8 );
+            *r = uint32_t(its.iterator( ti, pos->second ));
+         };
+      }
+      if( op == "end" )
+         return [self, db]( instance&, const uint64_t* a, uint64_t* r ) {
+            context& c = *self->ctx;
+            table_id tid{ a[0], a[1], a[2] };
+            c.record( tid, 0, access_kind::scan );
+            iterators& its = c.secondary<Key>();
+            *r = db().count( tid ) ? uint32_t(its.end_iterator( uint32_t(its.table_index( tid )) )) : uint32_t(-1);
+         };
+      return [op]( instance&, const uint64_t*, uint64_t* ) { throw trap( "unsupported host function db_idx*_" + op ); };
+   }
+
+}
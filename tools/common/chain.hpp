@@ -0,0 +1,148 @@
+#pragma once
+
+#include "interpreter.hpp"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// A single-node, in-memory stand-in for nodeos: enough of the EOSIO host API
+// (i64 tables and their idx64/idx128 indexes, action data, auth, notifications, inline
+// actions, console, softfloat) to run the compiled contracts under the counting
+// interpreter. Every database access is recorded in the action's trace.
+
+namespace hagglex::chain {
+
+   struct chain_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   struct permission_level {
+      uint64_t actor = 0;
+      uint64_t permission = 0;
+   };
+
+   struct action {
+      uint64_t                       account = 0;
+      uint64_t                       name = 0;
+      std::vector<permission_level>  authorization;
+      std::vector<char>              data;
+   };
+
+   struct table_id {
+      uint64_t code = 0;
+      uint64_t scope = 0;
+      uint64_t table = 0;
+      bool operator<( const table_id& o ) const {
+         return std::tie( code, scope, table ) < std::tie( o.code, o.scope, o.table );
+      }
+   };
+
+   enum class access_kind : uint8_t {
+      read,          // a row's value, or that its key is absent
+      write,         // a row's value
+      scan,          // which keys the table holds: bounds, end and iteration
+      membership     // adds or removes a key
+   };
+
+   // one database access at row granularity. A secondary index is a table of its own,
+   // named like nodeos does: the primary table's name with the index number in its low
+   // 4 bits; its rows are keyed by their primary key.
+   struct row_access {
+      table_id      table;
+      uint64_t      primary = 0;          // unused for scan and membership
+      access_kind   kind = access_kind::read;
+   };
+
+   // one execution of one contract: the receiver of an action or of its notification
+   struct action_trace {
+      uint64_t          receiver = 0;
+      action            act;
+      uint32_t          depth = 0;        // 0 for the pushed action, +1 per inline hop
+      bool              executed = false; // false when the receiver has no code
+      std::string       console;
+      wasm::exec_stats  stats;
+      std::vector<row_access> accesses;   // in execution order, repeats included
+   };
+
+   struct row {
+      uint64_t           payer = 0;
+      std::vector<char>  value;
+   };
+
+   using table = std::map<uint64_t, row>;
+   using database = std::map<table_id, table>;
+
+   template<typename Key>
+   struct secondary_row {
+      Key         key {};
+      uint64_t    payer = 0;
+   };
+
+   // a secondary index: each primary key's secondary key, and the (secondary, primary)
+   // order iteration follows
+   template<typename Key>
+   struct secondary_table {
+      std::map<uint64_t, secondary_row<Key>>   rows;
+      std::set<std::pair<Key, uint64_t>>       order;
+   };
+
+   template<typename Key>
+   using secondary_database = std::map<table_id, secondary_table<Key>>;
+
+   class controller {
+      public:
+         controller();
+         ~controller();
+
+         void create_account( uint64_t account );
+         bool is_account( uint64_t account ) const { return accounts.count( account ) > 0; }
+
+         void set_code( uint64_t account, const std::string& wasm_path );
+         void set_code( uint64_t account, std::shared_ptr<const wasm::program> code );
+         std::shared_ptr<const wasm::program> code_of( uint64_t account ) const;
+
+         // microseconds since the epoch, as returned by current_time()
+         int64_t now() const { return time_us; }
+         void    set_time( int64_t usec ) { time_us = usec; }
+
+         // runs one action as its own transaction; on failure the database is rolled
+         // back and chain_error carries the assertion message
+         std::vector<action_trace> push_action( const action& act );
+
+         // runs the actions in order as one transaction, rolled back as a whole on failure
+         std::vector<action_trace> push_transaction( const std::vector<action>& actions );
+
+         const database& db() const { return tables; }
+
+         // bytes nodeos would bill for everything the database holds: each table, each
+         // row with its data, and each secondary index entry (config::billable_size)
+         uint64_t ram_bytes() const;
+
+      private:
+         struct context;
+
+         std::set<uint64_t>                                          accounts;
+         std::map<uint64_t, std::shared_ptr<const wasm::program>>    code;
+         database                                                    tables;
+         secondary_database<uint64_t>                                idx64;
+         secondary_database<unsigned __int128>                       idx128;
+         int64_t                                                     time_us = 0;
+         context*                                                    ctx = nullptr;
+
+         wasm::host_function resolve( const wasm::import_entry& imp );
+         template<typename Key>
+         wasm::host_function resolve_secondary( const std::string& op );
+         void execute( const action& act, uint32_t depth, std::vector<action_trace>& traces );
+         void apply( uint64_t receiver, const action& act, uint32_t depth, std::vector<action_trace>& traces,
+                     std::vector<uint64_t>& notified, std::vector<action>& inlines );
+   };
+
+   // packs an action the way send_inline expects it
+   std::vector<char> pack_action( const action& act );
+   action            unpack_action( const char* data, size_t size );
+
+}
@@ -0,0 +1,249 @@
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include "crypto.hpp"
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace hagglex {
+
+   namespace {
+
+      const char* base58_alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+      void digest( const char* md, const void* data, size_t size, uint8_t* out ) {
+         unsigned int len = 0;
+         if( !EVP_Digest( data, size, out, &len, EVP_get_digestbyname( md ), nullptr ) )
+            throw std::runtime_error( std::string( md ) + " is not available" );
+      }
+
+      // EOSIO key/signature checksum: ripemd160 over the payload and the key-type suffix
+      std::array<uint8_t, 4> checksum( const std::vector<uint8_t>& payload, const std::string& suffix ) {
+         std::vector<uint8_t> buf( payload );
+         buf.insert( buf.end(), suffix.begin(), suffix.end() );
+         auto h = ripemd160( buf.data(), buf.size() );
+         return { h[0], h[1], h[2], h[3] };
+      }
+
+      std::vector<uint8_t> decode_checked( const std::string& text, size_t payload, const std::string& suffix ) {
+         auto raw = base58_decode( text );
+         if( raw.size() != payload + 4 ) throw std::runtime_error( "wrong key or signature length" );
+         std::vector<uint8_t> data( raw.begin(), raw.begin() + payload );
+         auto sum = checksum( data, suffix );
+         if( !std::equal( sum.begin(), sum.end(), raw.begin() + payload ) ) throw std::runtime_error( "checksum mismatch in " + text );
+         return data;
+      }
+
+      std::string encode_checked( const std::vector<uint8_t>& data, const std::string& suffix ) {
+         auto sum = checksum( data, suffix );
+         std::vector<uint8_t> raw( data );
+         raw.insert( raw.end(), sum.begin(), sum.end() );
+         return base58_encode( raw );
+      }
+
+      struct bn_ctx {
+         BN_CTX* ctx = BN_CTX_new();
+         ~bn_ctx() { BN_CTX_free( ctx ); }
+      };
+
+      EC_GROUP* secp256k1() {
+         static EC_GROUP* group = EC_GROUP_new_by_curve_name( NID_secp256k1 );
+         return group;
+      }
+
+      std::vector<uint8_t> compress( const EC_POINT* p ) {
+         std::vector<uint8_t> out( 33 );
+         bn_ctx c;
+         if( EC_POINT_point2oct( secp256k1(), p, POINT_CONVERSION_COMPRESSED, out.data(), out.size(), c.ctx ) != 33 )
+            throw std::runtime_error( "cannot encode public key" );
+         return out;
+      }
+
+      // r and s must each fit 32 bytes without a leading sign bit, as nodeos requires
+      bool is_canonical( const uint8_t* sig ) {
+         return !(sig[1] & 0x80) && !(sig[1] == 0 && !(sig[2] & 0x80)) &&
+                !(sig[33] & 0x80) && !(sig[33] == 0 && !(sig[34] & 0x80));
+      }
+
+   }
+
+   checksum256 sha256( const void* data, size_t size ) {
+      checksum256 out;
+      digest( "SHA256", data, size, out.data() );
+      return out;
+   }
+
+   std::array<uint8_t, 20> ripemd160( const void* data, size_t size ) {
+      std::array<uint8_t, 20> out;
+      digest( "RIPEMD160", data, size, out.data() );
+      return out;
+   }
+
+   std::string base58_encode( const std::vector<uint8_t>& data ) {
+      std::vector<uint8_t> digits;     // base-58 digits, least significant first
+      for( uint8_t byte : data ) {
+         int carry = byte;
+         for( auto& d : digits ) {
+            carry += d << 8;
+            d = carry % 58;
+            carry /= 58;
+         }
+         while( carry ) {
+            digits.push_back( carry % 58 );
+            carry /= 58;
+         }
+      }
+      std::string out;
+      for( size_t i = 0; i < data.size() && data[i] == 0; ++i ) out.push_back( '1' );
+      for( auto it = digits.rbegin(); it != digits.rend(); ++it ) out.push_back( base58_alphabet[*it] );
+      return out;
+   }
+
+   std::vector<uint8_t> base58_decode( const std::string& text ) {
+      std::vector<uint8_t> bytes;      // least significant first
+      for( char c : text ) {
+         const char* p = std::strchr( base58_alphabet, c );
+         if( !p || !c ) throw std::runtime_error( "invalid base58 character" );
+         int carry = int(p - base58_alphabet);
+         for( auto& b : bytes ) {
+            carry += b * 58;
+            b = carry & 0xff;
+            carry >>= 8;
+         }
+         while( carry ) {
+            bytes.push_back( carry & 0xff );
+            carry >>= 8;
+         }
+      }
+      for( size_t i = 0; i < text.size() && text[i] == '1'; ++i ) bytes.push_back( 0 );
+      std::reverse( bytes.begin(), bytes.end() );
+      return bytes;
+   }
+
+   std::vector<uint8_t> parse_public_key( const std::string& text ) {
+      if( text.rfind( "PUB_K1_", 0 ) == 0 ) return decode_checked( text.substr( 7 ), 33, "K1" );
+      if( text.rfind( "EOS", 0 ) == 0 ) return decode_checked( text.substr( 3 ), 33, "" );
+      throw std::runtime_error( "unsupported public key format " + text );
+   }
+
+   std::string public_key_to_string( const std::vector<uint8_t>& compressed ) {
+      return "EOS" + encode_checked( compressed, "" );
+   }
+
+   std::vector<uint8_t> parse_signature( const std::string& text ) {
+      if( text.rfind( "SIG_K1_", 0 ) != 0 ) throw std::runtime_error( "unsupported signature format" );
+      return decode_checked( text.substr( 7 ), 65, "K1" );
+   }
+
+   std::string signature_to_string( const std::vector<uint8_t>& compact ) {
+      return "SIG_K1_" + encode_checked( compact, "K1" );
+   }
+
+   struct private_key::impl {
+      EC_KEY* key = nullptr;
+      ~impl() { EC_KEY_free( key ); }
+   };
+
+   private_key::private_key( const std::string& wif ) : my(new impl) {
+      auto raw = base58_decode( wif );
+      if( raw.size() != 37 || raw[0] != 0x80 ) throw std::runtime_error( "not a WIF private key" );
+      auto h1 = sha256( raw.data(), 33 );
+      auto h2 = sha256( h1.data(), h1.size() );
+      if( !std::equal( h2.begin(), h2.begin() + 4, raw.begin() + 33 ) ) throw std::runtime_error( "private key checksum mismatch" );
+
+      bn_ctx c;
+      my->key = EC_KEY_new();
+      EC_KEY_set_group( my->key, secp256k1() );
+      BIGNUM* d = BN_bin2bn( raw.data() + 1, 32, nullptr );
+      EC_POINT* pub = EC_POINT_new( secp256k1() );
+      EC_POINT_mul( secp256k1(), pub, d, nullptr, nullptr, c.ctx );
+      EC_KEY_set_private_key( my->key, d );
+      EC_KEY_set_public_key( my->key, pub );
+      EC_POINT_free( pub );
+      BN_clear_free( d );
+   }
+
+   private_key::~private_key() = default;
+
+   std::vector<uint8_t> private_key::public_key() const {
+      return compress( EC_KEY_get0_public_key( my->key ) );
+   }
+
+   std::vector<uint8_t> private_key::sign( const checksum256& digest ) const {
+      bn_ctx c;
+      const BIGNUM* order = EC_GROUP_get0_order( secp256k1() );
+      BIGNUM* half = BN_dup( order );
+      BN_rshift1( half, half );
+      auto pub = public_key();
+
+      for( int attempt = 0; attempt < 64; ++attempt ) {
+         ECDSA_SIG* sig = ECDSA_do_sign( digest.data(), int(digest.size()), my->key );
+         if( !sig ) continue;
+         const BIGNUM* r = ECDSA_SIG_get0_r( sig );
+         BIGNUM* s = BN_dup( ECDSA_SIG_get0_s( sig ) );
+         if( BN_cmp( s, half ) > 0 ) BN_sub( s, order, s );     // low-S form
+
+         std::vector<uint8_t> out( 65 );
+         BN_bn2binpad( r, out.data() + 1, 32 );
+         BN_bn2binpad( s, out.data() + 33, 32 );
+         BN_free( s );
+         ECDSA_SIG_free( sig );
+         if( !is_canonical( out.data() ) ) continue;
+
+         for( uint8_t recid = 0; recid < 4; ++recid ) {
+            out[0] = 27 + 4 + recid;
+            try {
+               if( recover_public_key( digest, out ) == pub ) {
+                  BN_free( half );
+                  return out;
+               }
+            } catch( const std::runtime_error& ) {
+            }
+         }
+      }
+      BN_free( half );
+      throw std::runtime_error( "could not produce a canonical signature" );
+   }
+
+   std::vector<uint8_t> recover_public_key( const checksum256& digest, const std::vector<uint8_t>& compact ) {
+      if( compact.size() != 65 || compact[0] < 27 || compact[0] > 34 ) throw std::runtime_error( "invalid compact signature" );
+      int recid = (compact[0] - 27) & 3;
+      EC_GROUP* g = secp256k1();
+      bn_ctx c;
+      const BIGNUM* order = EC_GROUP_get0_order( g );
+
+      BIGNUM* r = BN_bin2bn( compact.data() + 1, 32, nullptr );
+      BIGNUM* s = BN_bin2bn( compact.data() + 33, 32, nullptr );
+      BIGNUM* e = BN_bin2bn( digest.data(), 32, nullptr );
+      BIGNUM* x = BN_dup( r );
+      if( recid & 2 ) BN_add( x, x, order );
+
+      EC_POINT* R = EC_POINT_new( g );
+      EC_POINT* Q = EC_POINT_new( g );
+      BIGNUM* rinv = BN_mod_inverse( nullptr, r, order, c.ctx );
+      BIGNUM* u1 = BN_new();
+      BIGNUM* u2 = BN_new();
+      bool ok = rinv && EC_POINT_set_compressed_coordinates( g, R, x, recid & 1, c.ctx );
+      if( ok ) {
+         // Q = r^-1 (sR - eG)
+         BN_mod_mul( u1, e, rinv, order, c.ctx );
+         BN_sub( u1, order, u1 );
+         BN_mod_mul( u2, s, rinv, order, c.ctx );
+         ok = EC_POINT_mul( g, Q, u1, R, u2, c.ctx ) && !EC_POINT_is_at_infinity( g, Q );
+      }
+      std::vector<uint8_t> out;
+      if( ok ) out = compress( Q );
+      for( BIGNUM* b : { r, s, e, x, rinv, u1, u2 } ) BN_free( b );
+      EC_POINT_free( R );
+      EC_POINT_free( Q );
+      if( !ok ) throw std::runtime_error( "public key recovery failed" );
+      return out;
+   }
+
+}
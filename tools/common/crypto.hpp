@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// secp256k1 keys and signatures in the EOSIO text formats (WIF, EOS.../PUB_K1_...,
+// SIG_K1_...), backed by OpenSSL's libcrypto.
+
+namespace hagglex {
+
+   using checksum256 = std::array<uint8_t, 32>;
+
+   checksum256 sha256( const void* data, size_t size );
+   std::array<uint8_t, 20> ripemd160( const void* data, size_t size );
+
+   std::string       base58_encode( const std::vector<uint8_t>& data );
+   std::vector<uint8_t> base58_decode( const std::string& text );
+
+   // 33-byte compressed key; the binary form adds a leading key-type byte (0 = K1)
+   std::vector<uint8_t> parse_public_key( const std::string& text );
+   std::string          public_key_to_string( const std::vector<uint8_t>& compressed );
+
+   // 65-byte compact signature (recovery byte, r, s)
+   std::vector<uint8_t> parse_signature( const std::string& text );
+   std::string          signature_to_string( const std::vector<uint8_t>& compact );
+
+   class private_key {
+      public:
+         explicit private_key( const std::string& wif );
+         ~private_key();
+         private_key( const private_key& ) = delete;
+         private_key& operator=( const private_key& ) = delete;
+
+         std::vector<uint8_t> public_key() const;     // compressed
+         std::string          public_key_string() const { return public_key_to_string( public_key() ); }
+
+         // canonical compact signature over a 32-byte digest
+         std::vector<uint8_t> sign( const checksum256& digest ) const;
+
+      private:
+         struct impl;
+         std::unique_ptr<impl> my;
+   };
+
+   // recovers the compressed public key that produced a compact signature
+   std::vector<uint8_t> recover_public_key( const checksum256& digest, const std::vector<uint8_t>& compact );
+
+}
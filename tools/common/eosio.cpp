@@ -0,0 +1,129 @@
+#include "eosio.hpp"
+
+namespace hagglex {
+
+   static uint64_t char_to_symbol( char c ) {
+      if( c >= 'a' && c <= 'z' ) return (c - 'a') + 6;
+      if( c >= '1' && c <= '5' ) return (c - '1') + 1;
+      if( c == '.' ) return 0;
+      throw format_error( std::string("invalid character in name: ") + c );
+   }
+
+   uint64_t string_to_name( const std::string& s ) {
+      if( s.size() > 13 ) throw format_error( "name too long: " + s );
+      uint64_t value = 0;
+      for( size_t i = 0; i < s.size() && i < 12; ++i ) {
+         value |= (char_to_symbol( s[i] ) & 0x1f) << (64 - 5 * (i + 1));
+      }
+      if( s.size() == 13 ) {
+         uint64_t c = char_to_symbol( s[12] );
+         if( c > 0x0f ) throw format_error( "thirteenth character of name must be in [.1-5a-j]: " + s );
+         value |= c;
+      }
+      return value;
+   }
+
+   std::string name_to_string( uint64_t value ) {
+      static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+      std::string str( 13, '.' );
+      uint64_t tmp = value;
+      for( int i = 0; i <= 12; ++i ) {
+         char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+         str[12 - i] = c;
+         tmp >>= (i == 0 ? 4 : 5);
+      }
+      while( !str.empty() && str.back() == '.' ) str.pop_back();
+      return str;
+   }
+
+   uint64_t string_to_symbol_code( const std::string& s ) {
+      if( s.empty() || s.size() > 7 ) throw format_error( "invalid symbol code: " + s );
+      uint64_t code = 0;
+      for( size_t i = 0; i < s.size(); ++i ) {
+         if( s[i] < 'A' || s[i] > 'Z' ) throw format_error( "invalid symbol code: " + s );
+         code |= uint64_t(uint8_t(s[i])) << (8 * i);
+      }
+      return code;
+   }
+
+   std::string symbol_code_to_string( uint64_t code ) {
+      std::string s;
+      while( code ) {
+         s += char(code & 0xff);
+         code >>= 8;
+      }
+      return s;
+   }
+
+   uint64_t string_to_symbol( const std::string& s ) {
+      auto comma = s.find( ',' );
+      if( comma == std::string::npos ) throw format_error( "symbol needs a precision: " + s );
+      uint64_t precision = std::stoul( s.substr( 0, comma ) );
+      if( precision > 18 ) throw format_error( "symbol precision too large: " + s );
+      return (string_to_symbol_code( s.substr( comma + 1 ) ) << 8) | precision;
+   }
+
+   std::string symbol_to_string( uint64_t sym ) {
+      return std::to_string( sym & 0xff ) + "," + symbol_code_to_string( sym >> 8 );
+   }
+
+   asset string_to_asset( const std::string& s ) {
+      auto space = s.find( ' ' );
+      if( space == std::string::npos ) throw format_error( "asset needs a symbol: " + s );
+      std::string amount = s.substr( 0, space );
+      std::string code = s.substr( space + 1 );
+
+      bool negative = !amount.empty() && amount[0] == '-';
+      if( negative ) amount.erase( 0, 1 );
+
+      auto dot = amount.find( '.' );
+      uint64_t precision = dot == std::string::npos ? 0 : amount.size() - dot - 1;
+      if( dot != std::string::npos ) amount.erase( dot, 1 );
+      if( amount.empty() || amount.find_first_not_of( "0123456789" ) != std::string::npos )
+         throw format_error( "invalid asset amount: " + s );
+
+      asset a;
+      a.amount = int64_t(std::stoull( amount ));
+      if( negative ) a.amount = -a.amount;
+      a.symbol = (string_to_symbol_code( code ) << 8) | precision;
+      return a;
+   }
+
+   std::string asset_to_string( const asset& a ) {
+      uint64_t precision = a.symbol & 0xff;
+      uint64_t magnitude = a.amount < 0 ? uint64_t(-(a.amount + 1)) + 1 : uint64_t(a.amount);
+      std::string digits = std::to_string( magnitude );
+      if( precision ) {
+         if( digits.size() <= precision ) digits.insert( 0, precision - digits.size() + 1, '0' );
+         digits.insert( digits.size() - precision, "." );
+      }
+      return (a.amount < 0 ? "-" : "") + digits + " " + symbol_code_to_string( a.symbol >> 8 );
+   }
+
+   std::string to_hex( const void* data, size_t size ) {
+      static const char* hex = "0123456789abcdef";
+      const uint8_t* p = static_cast<const uint8_t*>(data);
+      std::string out;
+      out.reserve( size * 2 );
+      for( size_t i = 0; i < size; ++i ) {
+         out += hex[p[i] >> 4];
+         out += hex[p[i] & 15];
+      }
+      return out;
+   }
+
+   std::vector<char> from_hex( const std::string& hex ) {
+      auto nibble = []( char c ) -> int {
+         if( c >= '0' && c <= '9' ) return c - '0';
+         if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+         if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+         throw format_error( std::string("invalid hex digit: ") + c );
+      };
+      if( hex.size() % 2 ) throw format_error( "odd length hex string" );
+      std::vector<char> out( hex.size() / 2 );
+      for( size_t i = 0; i < out.size(); ++i )
+         out[i] = char((nibble( hex[2 * i] ) << 4) | nibble( hex[2 * i + 1] ));
+      return out;
+   }
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Host-side helpers for the EOSIO wire format shared by the HaggleX tools:
+// account names, symbols, assets and the little-endian/varuint binary encoding.
+
+namespace hagglex {
+
+   struct format_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   uint64_t    string_to_name( const std::string& s );
+   std::string name_to_string( uint64_t value );
+
+   // "4,HAG" <-> raw symbol (precision in the low byte, code above it)
+   uint64_t    string_to_symbol( const std::string& s );
+   std::string symbol_to_string( uint64_t sym );
+   uint64_t    string_to_symbol_code( const std::string& s );
+   std::string symbol_code_to_string( uint64_t code );
+
+   struct asset {
+      int64_t  amount = 0;
+      uint64_t symbol = 0;
+   };
+
+   // "10.0000 HAG" <-> asset
+   asset       string_to_asset( const std::string& s );
+   std::string asset_to_string( const asset& a );
+
+   // append-only binary writer
+   class bin_writer {
+      public:
+         std::vector<char> data;
+
+         void bytes( const void* p, size_t n ) {
+            const char* c = static_cast<const char*>(p);
+            data.insert( data.end(), c, c + n );
+         }
+         template<typename T> void raw( const T& v ) { bytes( &v, sizeof(T) ); }
+         void varuint32( uint64_t v ) {
+            do {
+               uint8_t b = v & 0x7f;
+               v >>= 7;
+               if( v ) b |= 0x80;
+               raw( b );
+            } while( v );
+         }
+         void varint32( int32_t v ) { varuint32( (uint32_t(v) << 1) ^ uint32_t(v >> 31) ); }
+         void string( const std::string& s ) { varuint32( s.size() ); bytes( s.data(), s.size() ); }
+   };
+
+   // bounds-checked binary reader over borrowed memory
+   class bin_reader {
+      public:
+         bin_reader( const char* begin, size_t size ) : pos(begin), end(begin + size) {}
+         explicit bin_reader( const std::vector<char>& v ) : bin_reader( v.data(), v.size() ) {}
+
+         size_t remaining() const { return end - pos; }
+         const char* cursor() const { return pos; }
+
+         void bytes( void* out, size_t n ) {
+            need( n );
+            std::memcpy( out, pos, n );
+            pos += n;
+         }
+         const char* skip( size_t n ) {
+            need( n );
+            const char* p = pos;
+            pos += n;
+            return p;
+         }
+         template<typename T> T raw() {
+            T v;
+            bytes( &v, sizeof(T) );
+            return v;
+         }
+         uint64_t varuint32() {
+            uint64_t v = 0;
+            int shift = 0;
+            while( true ) {
+               uint8_t b = raw<uint8_t>();
+               v |= uint64_t(b & 0x7f) << shift;
+               if( !(b & 0x80) ) return v;
+               shift += 7;
+               if( shift > 35 ) throw format_error( "varuint32 too long" );
+            }
+         }
+         int32_t varint32() {
+            uint32_t v = uint32_t(varuint32());
+            return int32_t(v >> 1) ^ -int32_t(v & 1);
+         }
+         std::string string() {
+            size_t n = varuint32();
+            const char* p = skip( n );
+            return std::string( p, n );
+         }
+
+      private:
+         const char* pos;
+         const char* end;
+
+         void need( size_t n ) const {
+            if( size_t(end - pos) < n ) throw format_error( "read past end of data" );
+         }
+   };
+
+   std::string to_hex( const void* data, size_t size );
+   std::vector<char> from_hex( const std::string& hex );
+
+}
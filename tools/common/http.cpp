@@ -0,0 +1,142 @@
+#include "http.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace hagglex {
+
+   http_client::http_client( const std::string& url ) {
+      std::string rest = url;
+      if( rest.rfind( "http://", 0 ) == 0 ) rest = rest.substr( 7 );
+      else if( rest.find( "://" ) != std::string::npos ) throw http_error( "only http:// endpoints are supported" );
+      auto slash = rest.find( '/' );
+      if( slash != std::string::npos ) rest = rest.substr( 0, slash );
+      auto colon = rest.rfind( ':' );
+      host = colon == std::string::npos ? rest : rest.substr( 0, colon );
+      port = colon == std::string::npos ? "80" : rest.substr( colon + 1 );
+   }
+
+   http_client::~http_client() {
+      disconnect();
+   }
+
+   void http_client::connect() {
+      addrinfo hints{};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      addrinfo* res = nullptr;
+      if( getaddrinfo( host.c_str(), port.c_str(), &hints, &res ) != 0 ) throw http_error( "cannot resolve " + host );
+      for( addrinfo* a = res; a; a = a->ai_next ) {
+         fd = ::socket( a->ai_family, a->ai_socktype, a->ai_protocol );
+         if( fd < 0 ) continue;
+         if( ::connect( fd, a->ai_addr, a->ai_addrlen ) == 0 ) break;
+         ::close( fd );
+         fd = -1;
+      }
+      freeaddrinfo( res );
+      if( fd < 0 ) throw http_error( "cannot connect to " + host + ":" + port );
+      int one = 1;
+      setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+      buffer.clear();
+   }
+
+   void http_client::disconnect() {
+      if( fd >= 0 ) ::close( fd );
+      fd = -1;
+      buffer.clear();
+   }
+
+   bool http_client::fill() {
+      char chunk[16384];
+      ssize_t n = ::recv( fd, chunk, sizeof(chunk), 0 );
+      if( n <= 0 ) return false;
+      buffer.append( chunk, size_t(n) );
+      return true;
+   }
+
+   http_response http_client::post( const std::string& path, const std::string& body ) {
+      std::string request = "POST " + path + " HTTP/1.1\r\nHost: " + host + ":" + port +
+                            "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string( body.size() ) +
+                            "\r\nConnection: keep-alive\r\n\r\n" + body;
+      // a kept-alive connection may have been closed by the server: retry once on a fresh one
+      for( int attempt = 0;; ++attempt ) {
+         try {
+            if( fd < 0 ) connect();
+            return exchange( request );
+         } catch( const http_error& ) {
+            disconnect();
+            if( attempt ) throw;
+         }
+      }
+   }
+
+   http_response http_client::exchange( const std::string& request ) {
+      for( size_t sent = 0; sent < request.size(); ) {
+         ssize_t n = ::send( fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL );
+         if( n <= 0 ) throw http_error( "send failed" );
+         sent += size_t(n);
+      }
+
+      size_t header_end;
+      while( (header_end = buffer.find( "\r\n\r\n" )) == std::string::npos )
+         if( !fill() ) throw http_error( "connection closed before response headers" );
+
+      http_response res;
+      std::string headers = buffer.substr( 0, header_end );
+      buffer.erase( 0, header_end + 4 );
+      if( headers.rfind( "HTTP/1.", 0 ) != 0 || headers.size() < 12 ) throw http_error( "malformed response" );
+      res.status = std::atoi( headers.c_str() + 9 );
+
+      long content_length = -1;
+      bool chunked = false, close_after = false;
+      size_t pos = headers.find( "\r\n" );
+      while( pos != std::string::npos ) {
+         size_t next = headers.find( "\r\n", pos + 2 );
+         std::string line = headers.substr( pos + 2, next == std::string::npos ? std::string::npos : next - pos - 2 );
+         auto colon = line.find( ':' );
+         if( colon != std::string::npos ) {
+            std::string key = line.substr( 0, colon );
+            std::string value = line.substr( colon + 1 );
+            while( !value.empty() && value[0] == ' ' ) value.erase( 0, 1 );
+            if( !strcasecmp( key.c_str(), "content-length" ) ) content_length = std::atol( value.c_str() );
+            else if( !strcasecmp( key.c_str(), "transfer-encoding" ) ) chunked = value.find( "chunked" ) != std::string::npos;
+            else if( !strcasecmp( key.c_str(), "connection" ) ) close_after = !strncasecmp( value.c_str(), "close", 5 );
+         }
+         pos = next;
+      }
+
+      if( chunked ) {
+         while( true ) {
+            size_t eol;
+            while( (eol = buffer.find( "\r\n" )) == std::string::npos )
+               if( !fill() ) throw http_error( "connection closed inside chunked body" );
+            size_t size = std::strtoul( buffer.c_str(), nullptr, 16 );
+            buffer.erase( 0, eol + 2 );
+            while( buffer.size() < size + 2 )
+               if( !fill() ) throw http_error( "connection closed inside chunked body" );
+            res.body.append( buffer, 0, size );
+            buffer.erase( 0, size + 2 );
+            if( size == 0 ) break;
+         }
+      } else if( content_length >= 0 ) {
+         while( buffer.size() < size_t(content_length) )
+            if( !fill() ) throw http_error( "connection closed inside response body" );
+         res.body = buffer.substr( 0, size_t(content_length) );
+         buffer.erase( 0, size_t(content_length) );
+      } else {
+         while( fill() ) {}
+         res.body.swap( buffer );
+         close_after = true;
+      }
+      if( close_after ) disconnect();
+      return res;
+   }
+
+}
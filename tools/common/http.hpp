@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// Minimal blocking HTTP/1.1 client for the nodeos chain API: plain http, keep-alive,
+// Content-Length and chunked responses.
+
+namespace hagglex {
+
+   struct http_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   struct http_response {
+      int         status = 0;
+      std::string body;
+   };
+
+   class http_client {
+      public:
+         explicit http_client( const std::string& url );     // http://host[:port]
+         ~http_client();
+         http_client( const http_client& ) = delete;
+         http_client& operator=( const http_client& ) = delete;
+
+         http_response post( const std::string& path, const std::string& body );
+
+      private:
+         std::string host;
+         std::string port;
+         int         fd = -1;
+         std::string buffer;     // bytes read past the previous response
+
+         void connect();
+         void disconnect();
+         http_response exchange( const std::string& request );
+         bool fill();
+   };
+
+}
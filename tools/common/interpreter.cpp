@@ -0,0 +1,554 @@
+#include "interpreter.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace hagglex::wasm {
+
+   program::program( module mod, const std::function<host_function( const import_entry& )>& resolve ) : m(std::move(mod)) {
+      for( const auto& f : m.functions ) bodies.push_back( decode( m, f ) );
+      for( const auto& i : m.imports ) {
+         if( i.kind != ext_func ) continue;
+         hosts.push_back( resolve( i ) );
+         names.push_back( i.field );
+      }
+   }
+
+   namespace {
+
+      template<typename T> T bits_to( uint64_t v ) {
+         T out;
+         std::memcpy( &out, &v, sizeof(T) );
+         return out;
+      }
+
+      template<typename T> uint64_t to_bits( T v ) {
+         uint64_t out = 0;
+         std::memcpy( &out, &v, sizeof(T) );
+         return out;
+      }
+
+      inline uint64_t f32_bits( float v ) { return to_bits( v ); }
+      inline uint64_t f64_bits( double v ) { return to_bits( v ); }
+
+      template<typename T> T fmin_wasm( T a, T b ) {
+         if( std::isnan( a ) || std::isnan( b ) ) return std::numeric_limits<T>::quiet_NaN();
+         if( a == 0 && b == 0 ) return std::signbit( a ) ? a : b;
+         return a < b ? a : b;
+      }
+
+      template<typename T> T fmax_wasm( T a, T b ) {
+         if( std::isnan( a ) || std::isnan( b ) ) return std::numeric_limits<T>::quiet_NaN();
+         if( a == 0 && b == 0 ) return std::signbit( a ) ? b : a;
+         return a > b ? a : b;
+      }
+
+      // float -> integer truncation that traps like the spec on NaN and overflow
+      template<typename I, typename F> I trunc_checked( F v ) {
+         if( std::isnan( v ) ) throw trap( "invalid conversion to integer" );
+         F t = std::trunc( v );
+         if( t < F(std::numeric_limits<I>::min()) || t >= -F(std::numeric_limits<I>::min()) )
+            throw trap( "integer overflow in conversion" );
+         return I(t);
+      }
+
+      template<typename I, typename F> I trunc_unsigned_checked( F v ) {
+         if( std::isnan( v ) ) throw trap( "invalid conversion to integer" );
+         F t = std::trunc( v );
+         if( t <= F(-1) || t >= F(std::numeric_limits<I>::max()) + F(1) ) throw trap( "integer overflow in conversion" );
+         return I(t);
+      }
+
+      template<typename I, typename F> I trunc_sat( F v ) {
+         if( std::isnan( v ) ) return 0;
+         if( v <= F(std::numeric_limits<I>::min()) ) return std::numeric_limits<I>::min();
+         if( v >= F(std::numeric_limits<I>::max()) ) return std::numeric_limits<I>::max();
+         return I(std::trunc( v ));
+      }
+
+      bool same_signature( const func_type& a, const func_type& b ) {
+         return a.params == b.params && a.results == b.results;
+      }
+
+      struct label {
+         uint32_t cont;      // instruction index to continue at
+         uint32_t height;    // value stack height at entry
+         uint32_t arity;     // values carried by a branch
+      };
+
+   }
+
+   instance::instance( const program& p ) : prog(p) {
+      const module& m = prog.mod();
+      mem.resize( size_t(m.memory.present ? m.memory.initial : 0) * page_size );
+      for( const auto& d : m.data ) {
+         if( uint64_t(d.offset) + d.bytes.size() > mem.size() ) throw trap( "data segment out of bounds" );
+         std::memcpy( mem.data() + d.offset, d.bytes.data(), d.bytes.size() );
+      }
+      for( const auto& g : m.globals ) globals.push_back( g.init );
+      table.assign( m.table.present ? m.table.initial : 0, -1 );
+      for( const auto& e : m.elements ) {
+         if( uint64_t(e.offset) + e.functions.size() > table.size() ) throw trap( "element segment out of bounds" );
+         for( size_t i = 0; i < e.functions.size(); ++i ) table[e.offset + i] = e.functions[i];
+      }
+      stats.host_calls_by_import.assign( m.num_imported_functions, 0 );
+      stats.pages = uint32_t(mem.size() / page_size);
+      stack.reserve( 1 << 16 );
+   }
+
+   uint8_t* instance::memory( uint64_t addr, uint64_t size ) {
+      if( addr + size > mem.size() || addr + size < addr ) throw trap( "memory access out of bounds" );
+      return mem.data() + addr;
+   }
+
+   uint8_t* instance::writable( uint64_t addr, uint64_t size ) {
+      uint8_t* p = memory( addr, size );
+      if( addr + size > stats.high_water ) stats.high_water = addr + size;
+      return p;
+   }
+
+   uint64_t instance::call( uint32_t func_index, const std::vector<uint64_t>& args ) {
+      const func_type& t = prog.mod().function_type( func_index );
+      if( args.size() != t.params.size() ) throw trap( "wrong argument count" );
+      size_t base = stack.size();
+      for( auto a : args ) push( a );
+      invoke( func_index );
+      uint64_t result = t.results.empty() ? 0 : stack.back();
+      stack.resize( base );
+      stats.pages = uint32_t(mem.size() / page_size);
+      return result;
+   }
+
+   void instance::invoke( uint32_t func_index ) {
+      const module& m = prog.mod();
+      if( m.is_import( func_index ) ) {
+         const func_type& t = m.function_type( func_index );
+         const host_function& h = prog.host( func_index );
+         if( !h ) throw trap( "call to unresolved import " + prog.host_names()[func_index] );
+         stats.host_calls++;
+         stats.host_calls_by_import[func_index]++;
+         size_t n = t.params.size();
+         uint64_t args[16] = {};
+         if( n > 16 ) throw trap( "too many host arguments" );
+         for( size_t i = 0; i < n; ++i ) args[i] = stack[stack.size() - n + i];
+         stack.resize( stack.size() - n );
+         uint64_t result = 0;
+         h( *this, args, &result );
+         if( !t.results.empty() ) {
+            if( t.results[0] == i32 ) result &= 0xffffffffu;
+            push( result );
+         }
+         return;
+      }
+      if( ++depth > max_call_depth ) throw trap( "call depth exceeded" );
+      execute( func_index - m.num_imported_functions );
+      --depth;
+   }
+
+   void instance::execute( uint32_t defined_index ) {
+      const module&           m = prog.mod();
+      const function_body&    body = m.functions[defined_index];
+      const func_type&        type = m.types[body.type];
+      const decoded_function& fn = prog.code( defined_index );
+      const std::vector<instr>& code = fn.code;
+
+      const size_t nparams = type.params.size();
+      std::vector<uint64_t> locals( nparams + body.locals.size(), 0 );
+      for( size_t i = 0; i < nparams; ++i ) locals[i] = stack[stack.size() - nparams + i];
+      stack.resize( stack.size() - nparams );
+
+      const uint32_t frame_height = uint32_t(stack.size());
+      const uint32_t result_arity = uint32_t(type.results.size());
+      std::vector<label> labels;
+      labels.reserve( 16 );
+
+      // move the top `arity` values down to `height`
+      auto unwind = [&]( uint32_t height, uint32_t arity ) {
+         size_t top = stack.size();
+         if( top - arity != height ) {
+            for( uint32_t i = 0; i < arity; ++i ) stack[height + i] = stack[top - arity + i];
+            stack.resize( height + arity );
+         }
+      };
+
+      // branch to the label `depth` levels out; returns false when it leaves the function
+      auto branch = [&]( uint32_t depth, uint32_t& pc ) -> bool {
+         if( depth >= labels.size() ) {
+            unwind( frame_height, result_arity );
+            return false;
+         }
+         const label l = labels[labels.size() - 1 - depth];
+         unwind( l.height, l.arity );
+         const instr& target = code[l.cont];
+         // the target label stays: a loop re-enters its body, a block's end pops it
+         labels.resize( labels.size() - depth );
+         pc = target.op == op::loop ? l.cont + 1 : l.cont;
+         return true;
+      };
+
+      auto addr = [&]( const instr& in, uint32_t size ) -> uint64_t {
+         uint64_t a = uint64_t(uint32_t(pop())) + in.b;
+         if( a + size > mem.size() ) throw trap( "memory access out of bounds" );
+         return a;
+      };
+
+      auto store_addr = [&]( const instr& in, uint32_t size, uint64_t base ) -> uint8_t* {
+         uint64_t a = uint64_t(uint32_t(base)) + in.b;
+         return writable( a, size );
+      };
+
+      uint32_t pc = 0;
+      const uint32_t n = uint32_t(code.size());
+      while( pc < n ) {
+         const instr& in = code[pc];
+         stats.instructions++;
+         uint32_t next = pc + 1;
+
+#define POP_I32()  uint32_t(pop())
+#define POP_I64()  uint64_t(pop())
+#define POP_F32()  bits_to<float>( pop() )
+#define POP_F64()  bits_to<double>( pop() )
+#define BIN_I32(expr) { uint32_t b_ = POP_I32(); uint32_t a_ = POP_I32(); (void)a_; (void)b_; push( uint32_t(expr) ); break; }
+#define BIN_I64(expr) { uint64_t b_ = POP_I64(); uint64_t a_ = POP_I64(); (void)a_; (void)b_; push( uint64_t(expr) ); break; }
+#define BIN_F32(expr) { float b_ = POP_F32(); float a_ = POP_F32(); push( f32_bits( expr ) ); break; }
+#define BIN_F64(expr) { double b_ = POP_F64(); double a_ = POP_F64(); push( f64_bits( expr ) ); break; }
+#define CMP_I32(expr) { uint32_t b_ = POP_I32(); uint32_t a_ = POP_I32(); push( (expr) ? 1 : 0 ); break; }
+#define CMP_I64(expr) { uint64_t b_ = POP_I64(); uint64_t a_ = POP_I64(); push( (expr) ? 1 : 0 ); break; }
+#define CMP_F32(expr) { float b_ = POP_F32(); float a_ = POP_F32(); push( (expr) ? 1 : 0 ); break; }
+#define CMP_F64(expr) { double b_ = POP_F64(); double a_ = POP_F64(); push( (expr) ? 1 : 0 ); break; }
+#define UN_I32(expr)  { uint32_t a_ = POP_I32(); push( uint32_t(expr) ); break; }
+#define UN_I64(expr)  { uint64_t a_ = POP_I64(); push( uint64_t(expr) ); break; }
+#define UN_F32(expr)  { float a_ = POP_F32(); push( f32_bits( expr ) ); break; }
+#define UN_F64(expr)  { double a_ = POP_F64(); push( f64_bits( expr ) ); break; }
+#define LOAD(T, conv) { uint64_t a_ = addr( in, sizeof(T) ); T v_; std::memcpy( &v_, mem.data() + a_, sizeof(T) ); push( conv ); break; }
+#define STORE(T)      { T v_ = T(pop()); uint64_t base_ = pop(); std::memcpy( store_addr( in, sizeof(T), base_ ), &v_, sizeof(T) ); break; }
+
+         switch( in.op ) {
+            case op::unreachable: throw trap( "unreachable executed" );
+            case op::nop: break;
+            case op::block:
+               labels.push_back( label{ uint32_t(in.b), uint32_t(stack.size()), in.a } );
+               break;
+            case op::loop:
+               labels.push_back( label{ pc, uint32_t(stack.size()), 0 } );
+               break;
+            case op::if_: {
+               uint32_t cond = POP_I32();
+               labels.push_back( label{ uint32_t(in.b), uint32_t(stack.size()), in.a } );
+               if( !cond ) next = in.match == in.b ? uint32_t(in.b) : in.match + 1;
+               break;
+            }
+            case op::else_:
+               // end of the then-branch: continue at the if's end, which pops its label
+               next = uint32_t(code[in.match].b);
+               break;
+            case op::end:
+               if( !labels.empty() ) labels.pop_back();
+               else next = n;
+               break;
+            case op::br:
+               if( !branch( in.a, next ) ) next = n;
+               break;
+            case op::br_if:
+               if( POP_I32() && !branch( in.a, next ) ) next = n;
+               break;
+            case op::br_table: {
+               const auto& targets = fn.br_tables[in.a];
+               uint32_t i = POP_I32();
+               uint32_t depth = i < targets.size() - 1 ? targets[i] : targets.back();
+               if( !branch( depth, next ) ) next = n;
+               break;
+            }
+            case op::return_:
+               unwind( frame_height, result_arity );
+               next = n;
+               break;
+            case op::call:
+               invoke( in.a );
+               break;
+            case op::call_indirect: {
+               uint32_t slot = POP_I32();
+               if( slot >= table.size() || table[slot] < 0 ) throw trap( "undefined table element" );
+               uint32_t target = uint32_t(table[slot]);
+               if( !same_signature( m.types[in.a], m.function_type( target ) ) ) throw trap( "indirect call signature mismatch" );
+               invoke( target );
+               break;
+            }
+            case op::drop: pop(); break;
+            case op::select: {
+               uint32_t c = POP_I32();
+               uint64_t b = pop();
+               uint64_t a = pop();
+               push( c ? a : b );
+               break;
+            }
+            case op::local_get: push( locals[in.a] ); break;
+            case op::local_set: locals[in.a] = pop(); break;
+            case op::local_tee: locals[in.a] = stack.back(); break;
+            case op::global_get: push( globals[in.a] ); break;
+            case op::global_set: globals[in.a] = pop(); break;
+
+            case 0x28: LOAD( uint32_t, uint64_t(v_) )
+            case 0x29: LOAD( uint64_t, v_ )
+            case 0x2a: LOAD( uint32_t, uint64_t(v_) )
+            case 0x2b: LOAD( uint64_t, v_ )
+            case 0x2c: LOAD( int8_t, uint64_t(uint32_t(int32_t(v_))) )
+            case 0x2d: LOAD( uint8_t, uint64_t(v_) )
+            case 0x2e: LOAD( int16_t, uint64_t(uint32_t(int32_t(v_))) )
+            case 0x2f: LOAD( uint16_t, uint64_t(v_) )
+            case 0x30: LOAD( int8_t, uint64_t(int64_t(v_)) )
+            case 0x31: LOAD( uint8_t, uint64_t(v_) )
+            case 0x32: LOAD( int16_t, uint64_t(int64_t(v_)) )
+            case 0x33: LOAD( uint16_t, uint64_t(v_) )
+            case 0x34: LOAD( int32_t, uint64_t(int64_t(v_)) )
+            case 0x35: LOAD( uint32_t, uint64_t(v_) )
+            case 0x36: STORE( uint32_t )
+            case 0x37: STORE( uint64_t )
+            case 0x38: STORE( uint32_t )
+            case 0x39: STORE( uint64_t )
+            case 0x3a: STORE( uint8_t )
+            case 0x3b: STORE( uint16_t )
+            case 0x3c: STORE( uint8_t )
+            case 0x3d: STORE( uint16_t )
+            case 0x3e: STORE( uint32_t )
+            case op::memory_size: push( mem.size() / page_size ); break;
+            case op::memory_grow: {
+               uint32_t delta = POP_I32();
+               uint64_t old_pages = mem.size() / page_size;
+               uint64_t limit = m.memory.has_max ? std::min<uint64_t>( m.memory.maximum, max_pages ) : max_pages;
+               if( old_pages + delta > limit ) {
+                  push( uint32_t(-1) );
+               } else {
+                  mem.resize( (old_pages + delta) * page_size, 0 );
+                  push( old_pages );
+               }
+               break;
+            }
+            case op::i32_const:
+            case op::i64_const:
+            case op::f32_const:
+            case op::f64_const:
+               push( in.b );
+               break;
+
+            case 0x45: UN_I32( a_ == 0 )
+            case 0x46: CMP_I32( a_ == b_ )
+            case 0x47: CMP_I32( a_ != b_ )
+            case 0x48: CMP_I32( int32_t(a_) < int32_t(b_) )
+            case 0x49: CMP_I32( a_ < b_ )
+            case 0x4a: CMP_I32( int32_t(a_) > int32_t(b_) )
+            case 0x4b: CMP_I32( a_ > b_ )
+            case 0x4c: CMP_I32( int32_t(a_) <= int32_t(b_) )
+            case 0x4d: CMP_I32( a_ <= b_ )
+            case 0x4e: CMP_I32( int32_t(a_) >= int32_t(b_) )
+            case 0x4f: CMP_I32( a_ >= b_ )
+            case 0x50: { uint64_t a_ = POP_I64(); push( a_ == 0 ? 1 : 0 ); break; }
+            case 0x51: CMP_I64( a_ == b_ )
+            case 0x52: CMP_I64( a_ != b_ )
+            case 0x53: CMP_I64( int64_t(a_) < int64_t(b_) )
+            case 0x54: CMP_I64( a_ < b_ )
+            case 0x55: CMP_I64( int64_t(a_) > int64_t(b_) )
+            case 0x56: CMP_I64( a_ > b_ )
+            case 0x57: CMP_I64( int64_t(a_) <= int64_t(b_) )
+            case 0x58: CMP_I64( a_ <= b_ )
+            case 0x59: CMP_I64( int64_t(a_) >= int64_t(b_) )
+            case 0x5a: CMP_I64( a_ >= b_ )
+            case 0x5b: CMP_F32( a_ == b_ )
+            case 0x5c: CMP_F32( a_ != b_ )
+            case 0x5d: CMP_F32( a_ < b_ )
+            case 0x5e: CMP_F32( a_ > b_ )
+            case 0x5f: CMP_F32( a_ <= b_ )
+            case 0x60: CMP_F32( a_ >= b_ )
+            case 0x61: CMP_F64( a_ == b_ )
+            case 0x62: CMP_F64( a_ != b_ )
+            case 0x63: CMP_F64( a_ < b_ )
+            case 0x64: CMP_F64( a_ > b_ )
+            case 0x65: CMP_F64( a_ <= b_ )
+            case 0x66: CMP_F64( a_ >= b_ )
+
+            case 0x67: UN_I32( a_ ? __builtin_clz( a_ ) : 32 )
+            case 0x68: UN_I32( a_ ? __builtin_ctz( a_ ) : 32 )
+            case 0x69: UN_I32( __builtin_popcount( a_ ) )
+            case 0x6a: BIN_I32( a_ + b_ )
+            case 0x6b: BIN_I32( a_ - b_ )
+            case 0x6c: BIN_I32( a_ * b_ )
+            case 0x6d: {
+               int32_t b_ = int32_t(POP_I32()), a_ = int32_t(POP_I32());
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               if( a_ == std::numeric_limits<int32_t>::min() && b_ == -1 ) throw trap( "integer overflow" );
+               push( uint32_t(a_ / b_) );
+               break;
+            }
+            case 0x6e: {
+               uint32_t b_ = POP_I32(), a_ = POP_I32();
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               push( a_ / b_ );
+               break;
+            }
+            case 0x6f: {
+               int32_t b_ = int32_t(POP_I32()), a_ = int32_t(POP_I32());
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               push( b_ == -1 ? 0 : uint32_t(a_ % b_) );
+               break;
+            }
+            case 0x70: {
+               uint32_t b_ = POP_I32(), a_ = POP_I32();
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               push( a_ % b_ );
+               break;
+            }
+            case 0x71: BIN_I32( a_ & b_ )
+            case 0x72: BIN_I32( a_ | b_ )
+            case 0x73: BIN_I32( a_ ^ b_ )
+            case 0x74: BIN_I32( a_ << (b_ & 31) )
+            case 0x75: BIN_I32( int32_t(a_) >> (b_ & 31) )
+            case 0x76: BIN_I32( a_ >> (b_ & 31) )
+            case 0x77: BIN_I32( (a_ << (b_ & 31)) | (a_ >> ((32 - (b_ & 31)) & 31)) )
+            case 0x78: BIN_I32( (a_ >> (b_ & 31)) | (a_ << ((32 - (b_ & 31)) & 31)) )
+
+            case 0x79: UN_I64( a_ ? __builtin_clzll( a_ ) : 64 )
+            case 0x7a: UN_I64( a_ ? __builtin_ctzll( a_ ) : 64 )
+            case 0x7b: UN_I64( __builtin_popcountll( a_ ) )
+            case 0x7c: BIN_I64( a_ + b_ )
+            case 0x7d: BIN_I64( a_ - b_ )
+            case 0x7e: BIN_I64( a_ * b_ )
+            case 0x7f: {
+               int64_t b_ = int64_t(POP_I64()), a_ = int64_t(POP_I64());
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               if( a_ == std::numeric_limits<int64_t>::min() && b_ == -1 ) throw trap( "integer overflow" );
+               push( uint64_t(a_ / b_) );
+               break;
+            }
+            case 0x80: {
+               uint64_t b_ = POP_I64(), a_ = POP_I64();
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               push( a_ / b_ );
+               break;
+            }
+            case 0x81: {
+               int64_t b_ = int64_t(POP_I64()), a_ = int64_t(POP_I64());
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               push( b_ == -1 ? 0 : uint64_t(a_ % b_) );
+               break;
+            }
+            case 0x82: {
+               uint64_t b_ = POP_I64(), a_ = POP_I64();
+               if( b_ == 0 ) throw trap( "integer divide by zero" );
+               push( a_ % b_ );
+               break;
+            }
+            case 0x83: BIN_I64( a_ & b_ )
+            case 0x84: BIN_I64( a_ | b_ )
+            case 0x85: BIN_I64( a_ ^ b_ )
+            case 0x86: BIN_I64( a_ << (b_ & 63) )
+            case 0x87: BIN_I64( int64_t(a_) >> (b_ & 63) )
+            case 0x88: BIN_I64( a_ >> (b_ & 63) )
+            case 0x89: BIN_I64( (a_ << (b_ & 63)) | (a_ >> ((64 - (b_ & 63)) & 63)) )
+            case 0x8a: BIN_I64( (a_ >> (b_ & 63)) | (a_ << ((64 - (b_ & 63)) & 63)) )
+
+            case 0x8b: { uint64_t v = pop(); push( v & 0x7fffffffu ); break; }
+            case 0x8c: { uint64_t v = pop(); push( (v ^ 0x80000000u) & 0xffffffffu ); break; }
+            case 0x8d: UN_F32( std::ceil( a_ ) )
+            case 0x8e: UN_F32( std::floor( a_ ) )
+            case 0x8f: UN_F32( std::trunc( a_ ) )
+            case 0x90: UN_F32( std::nearbyint( a_ ) )
+            case 0x91: UN_F32( std::sqrt( a_ ) )
+            case 0x92: BIN_F32( a_ + b_ )
+            case 0x93: BIN_F32( a_ - b_ )
+            case 0x94: BIN_F32( a_ * b_ )
+            case 0x95: BIN_F32( a_ / b_ )
+            case 0x96: BIN_F32( fmin_wasm( a_, b_ ) )
+            case 0x97: BIN_F32( fmax_wasm( a_, b_ ) )
+            case 0x98: { uint64_t b = pop(), a = pop(); push( (a & 0x7fffffffu) | (b & 0x80000000u) ); break; }
+            case 0x99: { uint64_t v = pop(); push( v & 0x7fffffffffffffffull ); break; }
+            case 0x9a: { uint64_t v = pop(); push( v ^ 0x8000000000000000ull ); break; }
+            case 0x9b: UN_F64( std::ceil( a_ ) )
+            case 0x9c: UN_F64( std::floor( a_ ) )
+            case 0x9d: UN_F64( std::trunc( a_ ) )
+            case 0x9e: UN_F64( std::nearbyint( a_ ) )
+            case 0x9f: UN_F64( std::sqrt( a_ ) )
+            case 0xa0: BIN_F64( a_ + b_ )
+            case 0xa1: BIN_F64( a_ - b_ )
+            case 0xa2: BIN_F64( a_ * b_ )
+            case 0xa3: BIN_F64( a_ / b_ )
+            case 0xa4: BIN_F64( fmin_wasm( a_, b_ ) )
+            case 0xa5: BIN_F64( fmax_wasm( a_, b_ ) )
+            case 0xa6: { uint64_t b = pop(), a = pop(); push( (a & 0x7fffffffffffffffull) | (b & 0x8000000000000000ull) ); break; }
+
+            case 0xa7: { uint64_t v = pop(); push( v & 0xffffffffu ); break; }
+            case 0xa8: { float v = POP_F32(); push( uint32_t(trunc_checked<int32_t>( v )) ); break; }
+            case 0xa9: { float v = POP_F32(); push( trunc_unsigned_checked<uint32_t>( v ) ); break; }
+            case 0xaa: { double v = POP_F64(); push( uint32_t(trunc_checked<int32_t>( v )) ); break; }
+            case 0xab: { double v = POP_F64(); push( trunc_unsigned_checked<uint32_t>( v ) ); break; }
+            case 0xac: { uint64_t v = pop(); push( uint64_t(int64_t(int32_t(uint32_t(v)))) ); break; }
+            case 0xad: { uint64_t v = pop(); push( v & 0xffffffffu ); break; }
+            case 0xae: { float v = POP_F32(); push( uint64_t(trunc_checked<int64_t>( v )) ); break; }
+            case 0xaf: { float v = POP_F32(); push( trunc_unsigned_checked<uint64_t>( v ) ); break; }
+            case 0xb0: { double v = POP_F64(); push( uint64_t(trunc_checked<int64_t>( v )) ); break; }
+            case 0xb1: { double v = POP_F64(); push( trunc_unsigned_checked<uint64_t>( v ) ); break; }
+            case 0xb2: { int32_t v = int32_t(POP_I32()); push( f32_bits( float(v) ) ); break; }
+            case 0xb3: { uint32_t v = POP_I32(); push( f32_bits( float(v) ) ); break; }
+            case 0xb4: { int64_t v = int64_t(POP_I64()); push( f32_bits( float(v) ) ); break; }
+            case 0xb5: { uint64_t v = POP_I64(); push( f32_bits( float(v) ) ); break; }
+            case 0xb6: { double v = POP_F64(); push( f32_bits( float(v) ) ); break; }
+            case 0xb7: { int32_t v = int32_t(POP_I32()); push( f64_bits( double(v) ) ); break; }
+            case 0xb8: { uint32_t v = POP_I32(); push( f64_bits( double(v) ) ); break; }
+            case 0xb9: { int64_t v = int64_t(POP_I64()); push( f64_bits( double(v) ) ); break; }
+            case 0xba: { uint64_t v = POP_I64(); push( f64_bits( double(v) ) ); break; }
+            case 0xbb: { float v = POP_F32(); push( f64_bits( double(v) ) ); break; }
+            case 0xbc: case 0xbd: case 0xbe: case 0xbf:
+               break;   // reinterpretations keep the raw bits
+
+            case 0xc0: UN_I32( int32_t(int8_t(a_)) )
+            case 0xc1: UN_I32( int32_t(int16_t(a_)) )
+            case 0xc2: UN_I64( int64_t(int8_t(a_)) )
+            case 0xc3: UN_I64( int64_t(int16_t(a_)) )
+            case 0xc4: UN_I64( int64_t(int32_t(a_)) )
+
+            case 0xfc00: { float v = POP_F32(); push( uint32_t(trunc_sat<int32_t>( v )) ); break; }
+            case 0xfc01: { float v = POP_F32(); push( trunc_sat<uint32_t>( v ) ); break; }
+            case 0xfc02: { double v = POP_F64(); push( uint32_t(trunc_sat<int32_t>( v )) ); break; }
+            case 0xfc03: { double v = POP_F64(); push( trunc_sat<uint32_t>( v ) ); break; }
+            case 0xfc04: { float v = POP_F32(); push( uint64_t(trunc_sat<int64_t>( v )) ); break; }
+            case 0xfc05: { float v = POP_F32(); push( trunc_sat<uint64_t>( v ) ); break; }
+            case 0xfc06: { double v = POP_F64(); push( uint64_t(trunc_sat<int64_t>( v )) ); break; }
+            case 0xfc07: { double v = POP_F64(); push( trunc_sat<uint64_t>( v ) ); break; }
+            case op::memory_copy: {
+               uint32_t len = POP_I32(), src = POP_I32(), dst = POP_I32();
+               std::memmove( writable( dst, len ), memory( src, len ), len );
+               break;
+            }
+            case op::memory_fill: {
+               uint32_t len = POP_I32(), val = POP_I32(), dst = POP_I32();
+               std::memset( writable( dst, len ), int(val & 0xff), len );
+               break;
+            }
+            default:
+               throw trap( "unsupported opcode " + std::to_string( in.op ) );
+         }
+
+#undef POP_I32
+#undef POP_I64
+#undef POP_F32
+#undef POP_F64
+#undef BIN_I32
+#undef BIN_I64
+#undef BIN_F32
+#undef BIN_F64
+#undef CMP_I32
+#undef CMP_I64
+#undef CMP_F32
+#undef CMP_F64
+#undef UN_I32
+#undef UN_I64
+#undef UN_F32
+#undef UN_F64
+#undef LOAD
+#undef STORE
+
+         pc = next;
+      }
+   }
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "wasm.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Instruction-counting WebAssembly interpreter. It is not fast; it is exact: every
+// executed instruction and host call is counted, which is what the profiling and
+// analysis tools need to compare builds of the contracts.
+
+namespace hagglex::wasm {
+
+   struct trap : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   class instance;
+
+   // host functions receive their arguments as raw bits and write at most one result
+   using host_function = std::function<void( instance&, const uint64_t* args, uint64_t* result )>;
+
+   // a parsed module with decoded bodies and its imports bound to host functions
+   class program {
+      public:
+         program( module m, const std::function<host_function( const import_entry& )>& resolve );
+
+         const module&                         mod() const { return m; }
+         const decoded_function&               code( uint32_t defined_index ) const { return bodies[defined_index]; }
+         const host_function&                  host( uint32_t import_index ) const { return hosts[import_index]; }
+         const std::vector<std::string>&       host_names() const { return names; }
+
+      private:
+         module                          m;
+         std::vector<decoded_function>   bodies;
+         std::vector<host_function>      hosts;
+         std::vector<std::string>        names;
+   };
+
+   struct exec_stats {
+      uint64_t              instructions = 0;
+      uint64_t              host_calls = 0;
+      std::vector<uint64_t> host_calls_by_import;   // indexed like the module's function imports
+      uint32_t              pages = 0;              // linear memory size at the end, in 64 KiB pages
+      uint64_t              high_water = 0;         // highest byte address written, plus one
+   };
+
+   // one instantiation: fresh memory, globals and table, as the chain gives every action
+   class instance {
+      public:
+         static constexpr uint32_t page_size = 65536;
+         static constexpr uint32_t max_pages = 528;      // 33 MiB, the chain's default limit
+         static constexpr uint32_t max_call_depth = 250;
+
+         explicit instance( const program& p );
+
+         // call an exported or internal function with raw-bit arguments
+         uint64_t call( uint32_t func_index, const std::vector<uint64_t>& args );
+
+         uint8_t* memory( uint64_t addr, uint64_t size );          // bounds-checked pointer into linear memory
+         uint8_t* writable( uint64_t addr, uint64_t size );        // same, counted towards the high-water mark
+         uint32_t memory_size() const { return uint32_t(mem.size()); }
+
+         exec_stats stats;
+
+      private:
+         const program&          prog;
+         std::vector<uint8_t>    mem;
+         std::vector<uint64_t>   globals;
+         std::vector<int64_t>    table;
+         std::vector<uint64_t>   stack;
+         uint32_t                depth = 0;
+
+         void invoke( uint32_t func_index );
+         void execute( uint32_t defined_index );
+         void push( uint64_t v ) { stack.push_back( v ); }
+         uint64_t pop() { uint64_t v = stack.back(); stack.pop_back(); return v; }
+   };
+
+}
@@ -0,0 +1,300 @@
+#include "json.hpp"
+
+#include <cstdlib>
+
+namespace hagglex {
+
+   namespace {
+
+      struct parser {
+         const std::string& text;
+         size_t             pos = 0;
+
+         [[noreturn]] void fail( const std::string& what ) const {
+            throw json_error( "json: " + what + " at offset " + std::to_string(pos) );
+         }
+
+         void skip_ws() {
+            while( pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r') )
+               ++pos;
+         }
+
+         char peek() {
+            skip_ws();
+            if( pos >= text.size() ) fail( "unexpected end" );
+            return text[pos];
+         }
+
+         void expect( char c ) {
+            if( peek() != c ) fail( std::string("expected '") + c + "'" );
+            ++pos;
+         }
+
+         bool consume( const char* word ) {
+            size_t n = std::char_traits<char>::length(word);
+            if( text.compare( pos, n, word ) != 0 ) return false;
+            pos += n;
+            return true;
+         }
+
+         static void put_utf8( std::string& out, uint32_t cp ) {
+            if( cp < 0x80 ) {
+               out += char(cp);
+            } else if( cp < 0x800 ) {
+               out += char(0xC0 | (cp >> 6));
+               out += char(0x80 | (cp & 0x3F));
+            } else if( cp < 0x10000 ) {
+               out += char(0xE0 | (cp >> 12));
+               out += char(0x80 | ((cp >> 6) & 0x3F));
+               out += char(0x80 | (cp & 0x3F));
+            } else {
+               out += char(0xF0 | (cp >> 18));
+               out += char(0x80 | ((cp >> 12) & 0x3F));
+               out += char(0x80 | ((cp >> 6) & 0x3F));
+               out += char(0x80 | (cp & 0x3F));
+            }
+         }
+
+         uint32_t hex4() {
+            if( pos + 4 > text.size() ) fail( "short \\u escape" );
+            uint32_t v = 0;
+            for( int i = 0; i < 4; ++i ) {
+               char c = text[pos++];
+               v <<= 4;
+               if( c >= '0' && c <= '9' ) v |= c - '0';
+               else if( c >= 'a' && c <= 'f' ) v |= c - 'a' + 10;
+               else if( c >= 'A' && c <= 'F' ) v |= c - 'A' + 10;
+               else fail( "bad \\u escape" );
+            }
+            return v;
+         }
+
+         std::string parse_string() {
+            expect( '"' );
+            std::string out;
+            while( true ) {
+               if( pos >= text.size() ) fail( "unterminated string" );
+               char c = text[pos++];
+               if( c == '"' ) return out;
+               if( c != '\\' ) { out += c; continue; }
+               if( pos >= text.size() ) fail( "unterminated escape" );
+               char e = text[pos++];
+               switch( e ) {
+                  case '"':  out += '"';  break;
+                  case '\\': out += '\\'; break;
+                  case '/':  out += '/';  break;
+                  case 'b':  out += '\b'; break;
+                  case 'f':  out += '\f'; break;
+                  case 'n':  out += '\n'; break;
+                  case 'r':  out += '\r'; break;
+                  case 't':  out += '\t'; break;
+                  case 'u': {
+                     uint32_t cp = hex4();
+                     if( cp >= 0xD800 && cp < 0xDC00 && text.compare( pos, 2, "\\u" ) == 0 ) {
+                        pos += 2;
+                        uint32_t lo = hex4();
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                     }
+                     put_utf8( out, cp );
+                     break;
+                  }
+                  default: fail( "bad escape" );
+               }
+            }
+         }
+
+         json parse_value() {
+            char c = peek();
+            if( c == '{' ) {
+               ++pos;
+               json o = json::object();
+               if( peek() == '}' ) { ++pos; return o; }
+               while( true ) {
+                  std::string key = parse_string();
+                  expect( ':' );
+                  o.set( key, parse_value() );
+                  char d = peek();
+                  ++pos;
+                  if( d == '}' ) return o;
+                  if( d != ',' ) fail( "expected ',' or '}'" );
+               }
+            }
+            if( c == '[' ) {
+               ++pos;
+               json a = json::array();
+               if( peek() == ']' ) { ++pos; return a; }
+               while( true ) {
+                  a.push_back( parse_value() );
+                  char d = peek();
+                  ++pos;
+                  if( d == ']' ) return a;
+                  if( d != ',' ) fail( "expected ',' or ']'" );
+               }
+            }
+            if( c == '"' ) return json( parse_string() );
+            if( consume( "true" ) )  return json( true );
+            if( consume( "false" ) ) return json( false );
+            if( consume( "null" ) )  return json();
+
+            size_t start = pos;
+            if( text[pos] == '-' || text[pos] == '+' ) ++pos;
+            while( pos < text.size() && ((text[pos] >= '0' && text[pos] <= '9') || text[pos] == '.' ||
+                                         text[pos] == 'e' || text[pos] == 'E' || text[pos] == '-' || text[pos] == '+') )
+               ++pos;
+            if( pos == start ) fail( "unexpected character" );
+            return json::number( text.substr( start, pos - start ) );
+         }
+      };
+
+   }
+
+   json json::parse( const std::string& text ) {
+      parser p{ text };
+      json v = p.parse_value();
+      p.skip_ws();
+      if( p.pos != text.size() ) p.fail( "trailing characters" );
+      return v;
+   }
+
+   bool json::as_bool() const {
+      if( k != kind::boolean ) throw json_error( "json: not a boolean" );
+      return b;
+   }
+
+   const std::string& json::as_string() const {
+      if( k != kind::string && k != kind::number ) throw json_error( "json: not a string" );
+      return s;
+   }
+
+   int64_t json::as_int64() const {
+      const std::string& t = as_string();
+      char* end = nullptr;
+      long long v = std::strtoll( t.c_str(), &end, 10 );
+      if( t.empty() || *end ) throw json_error( "json: not an integer: " + t );
+      return v;
+   }
+
+   uint64_t json::as_uint64() const {
+      const std::string& t = as_string();
+      char* end = nullptr;
+      unsigned long long v = std::strtoull( t.c_str(), &end, 10 );
+      if( t.empty() || *end || t[0] == '-' ) throw json_error( "json: not an unsigned integer: " + t );
+      return v;
+   }
+
+   double json::as_double() const {
+      const std::string& t = as_string();
+      char* end = nullptr;
+      double v = std::strtod( t.c_str(), &end );
+      if( t.empty() || *end ) throw json_error( "json: not a number: " + t );
+      return v;
+   }
+
+   const std::vector<json>& json::items() const {
+      if( k != kind::array ) throw json_error( "json: not an array" );
+      return arr;
+   }
+
+   std::vector<json>& json::items() {
+      if( k != kind::array ) throw json_error( "json: not an array" );
+      return arr;
+   }
+
+   void json::push_back( json v ) {
+      items().push_back( std::move(v) );
+   }
+
+   size_t json::size() const {
+      return k == kind::object ? obj.size() : items().size();
+   }
+
+   const std::vector<std::pair<std::string, json>>& json::members() const {
+      if( k != kind::object ) throw json_error( "json: not an object" );
+      return obj;
+   }
+
+   const json* json::find( const std::string& key ) const {
+      for( const auto& m : members() )
+         if( m.first == key ) return &m.second;
+      return nullptr;
+   }
+
+   bool json::has( const std::string& key ) const {
+      return find( key ) != nullptr;
+   }
+
+   const json& json::operator[]( const std::string& key ) const {
+      const json* v = find( key );
+      if( !v ) throw json_error( "json: missing member '" + key + "'" );
+      return *v;
+   }
+
+   json& json::set( const std::string& key, json v ) {
+      if( k != kind::object ) throw json_error( "json: not an object" );
+      for( auto& m : obj ) {
+         if( m.first == key ) {
+            m.second = std::move(v);
+            return m.second;
+         }
+      }
+      obj.emplace_back( key, std::move(v) );
+      return obj.back().second;
+   }
+
+   static void dump_string( std::string& out, const std::string& s ) {
+      static const char* hex = "0123456789abcdef";
+      out += '"';
+      for( unsigned char c : s ) {
+         switch( c ) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n";  break;
+            case '\r': out += "\\r";  break;
+            case '\t': out += "\\t";  break;
+            default:
+               if( c < 0x20 ) {
+                  out += "\\u00";
+                  out += hex[c >> 4];
+                  out += hex[c & 15];
+               } else {
+                  out += char(c);
+               }
+         }
+      }
+      out += '"';
+   }
+
+   void json::dump_to( std::string& out ) const {
+      switch( k ) {
+         case kind::null:    out += "null"; break;
+         case kind::boolean: out += b ? "true" : "false"; break;
+         case kind::number:  out += s; break;
+         case kind::string:  dump_string( out, s ); break;
+         case kind::array:
+            out += '[';
+            for( size_t i = 0; i < arr.size(); ++i ) {
+               if( i ) out += ',';
+               arr[i].dump_to( out );
+            }
+            out += ']';
+            break;
+         case kind::object:
+            out += '{';
+            for( size_t i = 0; i < obj.size(); ++i ) {
+               if( i ) out += ',';
+               dump_string( out, obj[i].first );
+               out += ':';
+               obj[i].second.dump_to( out );
+            }
+            out += '}';
+            break;
+      }
+   }
+
+   std::string json::dump() const {
+      std::string out;
+      dump_to( out );
+      return out;
+   }
+
+}
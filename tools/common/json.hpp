@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace hagglex {
+
+   // Minimal JSON value used for ABIs, scripts and tool output. Numbers keep their
+   // source text so 64-bit integers survive a round trip without going through double.
+   class json {
+      public:
+         enum class kind { null, boolean, number, string, array, object };
+
+         json() = default;
+         json( bool b ) : k(kind::boolean), b(b) {}
+         json( const char* s ) : k(kind::string), s(s) {}
+         json( std::string s ) : k(kind::string), s(std::move(s)) {}
+
+         static json number( std::string text ) { json j; j.k = kind::number; j.s = std::move(text); return j; }
+         static json number( int64_t v )        { return number( std::to_string(v) ); }
+         static json number( uint64_t v )       { return number( std::to_string(v) ); }
+         static json array()                    { json j; j.k = kind::array; return j; }
+         static json object()                   { json j; j.k = kind::object; return j; }
+
+         static json parse( const std::string& text );
+
+         kind type() const { return k; }
+         bool is_null() const   { return k == kind::null; }
+         bool is_string() const { return k == kind::string; }
+         bool is_number() const { return k == kind::number; }
+         bool is_array() const  { return k == kind::array; }
+         bool is_object() const { return k == kind::object; }
+
+         bool               as_bool() const;
+         const std::string& as_string() const;    // strings, and the text of numbers
+         int64_t            as_int64() const;
+         uint64_t           as_uint64() const;
+         double             as_double() const;
+
+         const std::vector<json>& items() const;
+         std::vector<json>&       items();
+         void push_back( json v );
+         size_t size() const;
+         const json& operator[]( size_t i ) const { return items().at(i); }
+
+         // object members keep insertion order, ABI structs rely on it
+         const std::vector<std::pair<std::string, json>>& members() const;
+         bool        has( const std::string& key ) const;
+         const json& operator[]( const std::string& key ) const;   // throws when missing
+         const json* find( const std::string& key ) const;
+         json&       set( const std::string& key, json v );
+
+         std::string dump() const;
+
+      private:
+         kind                                       k = kind::null;
+         bool                                       b = false;
+         std::string                                s;
+         std::vector<json>                          arr;
+         std::vector<std::pair<std::string, json>>  obj;
+
+         void dump_to( std::string& out ) const;
+   };
+
+   struct json_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+}
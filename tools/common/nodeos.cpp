@@ -0,0 +1,172 @@
+#include "nodeos.hpp"
+
+#include <cstring>
+
+namespace hagglex {
+
+   void transaction_header::set_reference_block( const std::string& block_id ) {
+      auto id = from_hex( block_id );
+      if( id.size() != 32 ) throw nodeos_error( "malformed block id " + block_id );
+      uint32_t num = 0;
+      for( int i = 0; i < 4; ++i ) num = (num << 8) | uint8_t(id[i]);
+      ref_block_num = uint16_t(num & 0xffff);
+      std::memcpy( &ref_block_prefix, id.data() + 8, 4 );
+   }
+
+   std::vector<char> pack_transaction( const transaction_header& header,
+                                       const std::vector<chain::action>& context_free_actions,
+                                       const std::vector<chain::action>& actions ) {
+      bin_writer w;
+      w.raw( header.expiration );
+      w.raw( header.ref_block_num );
+      w.raw( header.ref_block_prefix );
+      w.varuint32( header.max_net_usage_words );
+      w.raw( header.max_cpu_usage_ms );
+      w.varuint32( 0 );                      // delay_sec
+      for( const auto* list : { &context_free_actions, &actions } ) {
+         w.varuint32( list->size() );
+         for( const auto& a : *list ) {
+            auto packed = chain::pack_action( a );
+            w.bytes( packed.data(), packed.size() );
+         }
+      }
+      w.varuint32( 0 );                      // transaction_extensions
+      return w.data;
+   }
+
+   checksum256 signing_digest( const std::string& chain_id, const std::vector<char>& packed_trx ) {
+      auto id = from_hex( chain_id );
+      if( id.size() != 32 ) throw nodeos_error( "malformed chain id" );
+      std::vector<char> buf( id );
+      buf.insert( buf.end(), packed_trx.begin(), packed_trx.end() );
+      buf.insert( buf.end(), 32, 0 );
+      return sha256( buf.data(), buf.size() );
+   }
+
+   json packed_transaction_json( const std::vector<char>& packed_trx, const std::vector<std::string>& signatures ) {
+      json sigs = json::array();
+      for( const auto& s : signatures ) sigs.push_back( s );
+      json out = json::object();
+      out.set( "signatures", sigs );
+      out.set( "compression", "none" );
+      out.set( "packed_context_free_data", "" );
+      out.set( "packed_trx", to_hex( packed_trx.data(), packed_trx.size() ) );
+      return out;
+   }
+
+   chain::action nonce_action( const std::string& nonce ) {
+      chain::action a;
+      a.account = string_to_name( "eosio.null" );
+      a.name = string_to_name( "nonce" );
+      bin_writer w;
+      w.string( nonce );
+      a.data = w.data;
+      return a;
+   }
+
+   const abi& system_abi() {
+      static const abi def( json::parse( R"({
+         "version": "eosio::abi/1.1",
+         "structs": [
+            { "name": "permission_level", "base": "", "fields": [ { "name": "actor", "type": "name" }, { "name": "permission", "type": "name" } ] },
+            { "name": "key_weight", "base": "", "fields": [ { "name": "key", "type": "public_key" }, { "name": "weight", "type": "uint16" } ] },
+            { "name": "permission_level_weight", "base": "", "fields": [ { "name": "permission", "type": "permission_level" }, { "name": "weight", "type": "uint16" } ] },
+            { "name": "wait_weight", "base": "", "fields": [ { "name": "wait_sec", "type": "uint32" }, { "name": "weight", "type": "uint16" } ] },
+            { "name": "authority", "base": "", "fields": [ { "name": "threshold", "type": "uint32" }, { "name": "keys", "type": "key_weight[]" },
+                                                          { "name": "accounts", "type": "permission_level_weight[]" }, { "name": "waits", "type": "wait_weight[]" } ] },
+            { "name": "newaccount", "base": "", "fields": [ { "name": "creator", "type": "name" }, { "name": "name", "type": "name" },
+                                                           { "name": "owner", "type": "authority" }, { "name": "active", "type": "authority" } ] },
+            { "name": "setcode", "base": "", "fields": [ { "name": "account", "type": "name" }, { "name": "vmtype", "type": "uint8" },
+                                                        { "name": "vmversion", "type": "uint8" }, { "name": "code", "type": "bytes" } ] },
+            { "name": "setabi", "base": "", "fields": [ { "name": "account", "type": "name" }, { "name": "abi", "type": "bytes" } ] },
+
+            { "name": "type_def", "base": "", "fields": [ { "name": "new_type_name", "type": "string" }, { "name": "type", "type": "string" } ] },
+            { "name": "field_def", "base": "", "fields": [ { "name": "name", "type": "string" }, { "name": "type", "type": "string" } ] },
+            { "name": "struct_def", "base": "", "fields": [ { "name": "name", "type": "string" }, { "name": "base", "type": "string" }, { "name": "fields", "type": "field_def[]" } ] },
+            { "name": "action_def", "base": "", "fields": [ { "name": "name", "type": "name" }, { "name": "type", "type": "string" }, { "name": "ricardian_contract", "type": "string" } ] },
+            { "name": "table_def", "base": "", "fields": [ { "name": "name", "type": "name" }, { "name": "index_type", "type": "string" }, { "name": "key_names", "type": "string[]" },
+                                                          { "name": "key_types", "type": "string[]" }, { "name": "type", "type": "string" } ] },
+            { "name": "clause_pair", "base": "", "fields": [ { "name": "id", "type": "string" }, { "name": "body", "type": "string" } ] },
+            { "name": "error_message", "base": "", "fields": [ { "name": "error_code", "type": "uint64" }, { "name": "error_msg", "type": "string" } ] },
+            { "name": "extensions_entry", "base": "", "fields": [ { "name": "tag", "type": "uint16" }, { "name": "value", "type": "bytes" } ] },
+            { "name": "variant_def", "base": "", "fields": [ { "name": "name", "type": "string" }, { "name": "types", "type": "string[]" } ] },
+            { "name": "action_result_def", "base": "", "fields": [ { "name": "name", "type": "name" }, { "name": "result_type", "type": "string" } ] },
+            { "name": "abi_def", "base": "", "fields": [ { "name": "version", "type": "string" }, { "name": "types", "type": "type_def[]" },
+                                                        { "name": "structs", "type": "struct_def[]" }, { "name": "actions", "type": "action_def[]" },
+                                                        { "name": "tables", "type": "table_def[]" }, { "name": "ricardian_clauses", "type": "clause_pair[]" },
+                                                        { "name": "error_messages", "type": "error_message[]" }, { "name": "abi_extensions", "type": "extensions_entry[]" },
+                                                        { "name": "variants", "type": "variant_def[]$" }, { "name": "action_results", "type": "action_result_def[]$" } ] }
+         ],
+         "actions": [
+            { "name": "newaccount", "type": "newaccount", "ricardian_contract": "" },
+            { "name": "setcode", "type": "setcode", "ricardian_contract": "" },
+            { "name": "setabi", "type": "setabi", "ricardian_contract": "" }
+         ]
+      })" ) );
+      return def;
+   }
+
+   std::vector<char> pack_abi( const json& def ) {
+      // eosio-abigen leaves out empty sections; abi_def wants all of them up to the
+      // extensions, the binary-extension sections only when the ABI has them
+      json full = json::object();
+      for( const char* key : { "version", "types", "structs", "actions", "tables", "ricardian_clauses", "error_messages", "abi_extensions" } ) {
+         if( const json* v = def.find( key ) ) full.set( key, *v );
+         else if( std::string( key ) == "version" ) full.set( key, "eosio::abi/1.1" );
+         else full.set( key, json::array() );
+      }
+      for( const char* key : { "variants", "action_results" } ) {
+         const json* v = def.find( key );
+         if( !v ) break;
+         full.set( key, *v );
+      }
+      return system_abi().json_to_bin( "abi_def", full );
+   }
+
+   json nodeos_client::post( const std::string& path, const json& body ) {
+      http_response res = http.post( path, body.dump() );
+      json out = json::parse( res.body );
+      if( res.status != 200 && res.status != 202 ) throw nodeos_error( nodeos_error_message( out ) );
+      return out;
+   }
+
+   json nodeos_client::get_info() {
+      return post( "/v1/chain/get_info", json::object() );
+   }
+
+   json nodeos_client::get_table_rows( const std::string& code, const std::string& scope, const std::string& table,
+                                       uint32_t limit, const std::string& lower_bound ) {
+      json req = json::object();
+      req.set( "json", true );
+      req.set( "code", code );
+      req.set( "scope", scope );
+      req.set( "table", table );
+      req.set( "limit", json::number( uint64_t(limit) ) );
+      if( !lower_bound.empty() ) req.set( "lower_bound", lower_bound );
+      return post( "/v1/chain/get_table_rows", req );
+   }
+
+   json nodeos_client::push_transaction( const json& packed ) {
+      json res = post( "/v1/chain/push_transaction", packed );
+      const json* processed = res.find( "processed" );
+      if( !processed ) throw nodeos_error( "push_transaction returned no trace" );
+      if( const json* except = processed->find( "except" ); except && !except->is_null() ) throw nodeos_error( nodeos_error_message( res ) );
+      return *processed;
+   }
+
+   std::string nodeos_error_message( const json& response ) {
+      const json* err = response.find( "error" );
+      if( !err ) {
+         if( const json* processed = response.find( "processed" ) ) err = processed->find( "except" );
+      }
+      if( !err || !err->is_object() ) {
+         const json* msg = response.find( "message" );
+         return msg && msg->is_string() ? msg->as_string() : response.dump();
+      }
+      if( const json* details = err->find( "details" ); details && details->is_array() && details->size() )
+         if( const json* msg = (*details)[0].find( "message" ); msg && msg->is_string() ) return msg->as_string();
+      if( const json* what = err->find( "what" ); what && what->is_string() ) return what->as_string();
+      return err->dump();
+   }
+
+}
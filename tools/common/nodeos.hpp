@@ -0,0 +1,69 @@
+#pragma once
+
+#include "abi.hpp"
+#include "chain.hpp"
+#include "crypto.hpp"
+#include "http.hpp"
+
+#include <string>
+#include <vector>
+
+// Talking to a real nodeos: transaction packing and signing, the chain API calls the
+// tools need, and the native eosio ABI used to bootstrap a fresh local chain.
+
+namespace hagglex {
+
+   struct nodeos_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   struct transaction_header {
+      uint32_t expiration = 0;          // seconds since the epoch
+      uint16_t ref_block_num = 0;
+      uint32_t ref_block_prefix = 0;
+      uint32_t max_net_usage_words = 0;
+      uint8_t  max_cpu_usage_ms = 0;
+
+      // TaPoS fields taken from a block id (hex)
+      void set_reference_block( const std::string& block_id );
+   };
+
+   std::vector<char> pack_transaction( const transaction_header& header,
+                                       const std::vector<chain::action>& context_free_actions,
+                                       const std::vector<chain::action>& actions );
+
+   // sha256( chain_id || packed_trx || 32 zero bytes ), no context-free data
+   checksum256 signing_digest( const std::string& chain_id, const std::vector<char>& packed_trx );
+
+   // the body push_transaction and send_transaction expect
+   json packed_transaction_json( const std::vector<char>& packed_trx, const std::vector<std::string>& signatures );
+
+   // context-free eosio.null::nonce action, the cleos --force-unique trick for
+   // sending otherwise identical transactions
+   chain::action nonce_action( const std::string& nonce );
+
+   // newaccount, setcode, setabi and the abi_def serializer for setabi
+   const abi& system_abi();
+   std::vector<char> pack_abi( const json& def );
+
+   class nodeos_client {
+      public:
+         explicit nodeos_client( const std::string& url ) : http(url) {}
+
+         json get_info();
+         json get_table_rows( const std::string& code, const std::string& scope, const std::string& table,
+                              uint32_t limit, const std::string& lower_bound = "" );
+
+         // returns the "processed" trace; throws nodeos_error with the assertion message
+         json push_transaction( const json& packed );
+
+         json post( const std::string& path, const json& body );
+
+      private:
+         http_client http;
+   };
+
+   // the most specific message in a nodeos error response
+   std::string nodeos_error_message( const json& response );
+
+}
@@ -0,0 +1,121 @@
+#include "script.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace hagglex {
+
+   std::string directory_of( const std::string& path ) {
+      auto slash = path.find_last_of( '/' );
+      return slash == std::string::npos ? std::string( "." ) : path.substr( 0, slash );
+   }
+
+   std::string resolve_path( const std::string& base, const std::string& path ) {
+      return path.empty() || path[0] == '/' ? path : base + "/" + path;
+   }
+
+   std::vector<chain::permission_level> parse_auth( const std::string& s ) {
+      std::vector<chain::permission_level> out;
+      std::stringstream ss( s );
+      std::string item;
+      while( std::getline( ss, item, ',' ) ) {
+         auto at = item.find( '@' );
+         chain::permission_level p;
+         p.actor = string_to_name( item.substr( 0, at ) );
+         p.permission = string_to_name( at == std::string::npos ? "active" : item.substr( at + 1 ) );
+         out.push_back( p );
+      }
+      return out;
+   }
+
+   void script_runner::run( const std::string& path ) {
+      std::ifstream in( path );
+      if( !in ) throw script_error( "cannot open " + path );
+      std::string base = directory_of( path );
+      std::string line;
+      for( int lineno = 1; std::getline( in, line ); ++lineno ) {
+         try {
+            step( base, line );
+         } catch( const std::exception& e ) {
+            throw script_error( path + ":" + std::to_string( lineno ) + ": " + e.what() );
+         }
+      }
+   }
+
+   chain::action script_runner::make_action( const std::string& account, const std::string& action_name,
+                                             const std::string& auth, const json& data ) const {
+      chain::action act;
+      act.account = string_to_name( account );
+      act.name = string_to_name( action_name );
+      act.authorization = parse_auth( auth );
+      auto contract = abis.find( act.account );
+      if( contract == abis.end() ) throw script_error( account + " has no contract" );
+      std::string type = contract->second.action_type( act.name );
+      if( type.empty() ) throw script_error( account + " has no action " + action_name );
+      act.data = contract->second.json_to_bin( type, data );
+      return act;
+   }
+
+   void script_runner::step( const std::string& base, const std::string& line ) {
+      std::istringstream ss( line );
+      std::string cmd;
+      if( !(ss >> cmd) || cmd[0] == '#' ) return;
+
+      bool expect_failure = false;
+      if( cmd == "fail" ) {
+         expect_failure = true;
+         if( !(ss >> cmd) || cmd != "action" ) throw script_error( "fail must be followed by an action" );
+      }
+
+      if( cmd == "time" ) {
+         std::string t;
+         ss >> t;
+         chain.set_time( parse_time_point( t ) );
+      } else if( cmd == "advance" ) {
+         int64_t seconds = 0;
+         ss >> seconds;
+         chain.set_time( chain.now() + seconds * 1000000 );
+      } else if( cmd == "account" ) {
+         std::string a;
+         while( ss >> a ) chain.create_account( string_to_name( a ) );
+      } else if( cmd == "contract" ) {
+         std::string account, wasm_path, abi_path;
+         ss >> account >> wasm_path >> abi_path;
+         if( abi_path.empty() ) throw script_error( "usage: contract <account> <wasm> <abi>" );
+         uint64_t a = string_to_name( account );
+         auto o = wasm_overrides.find( account );
+         const std::string wasm = o != wasm_overrides.end() ? o->second : resolve_path( base, wasm_path );
+         chain.set_code( a, wasm );
+         code_sizes[account] = std::filesystem::file_size( wasm );
+         // a build deployed instead comes with its own ABI, next to the wasm, when it has one
+         std::string abi_file = resolve_path( base, abi_path );
+         if( o != wasm_overrides.end() && wasm.size() > 5 && wasm.compare( wasm.size() - 5, 5, ".wasm" ) == 0 ) {
+            const std::string built = wasm.substr( 0, wasm.size() - 5 ) + ".abi";
+            if( std::filesystem::exists( built ) ) abi_file = built;
+         }
+         abis[a] = abi::load( abi_file );
+      } else if( cmd == "action" ) {
+         std::string account, action_name, auth;
+         ss >> account >> action_name >> auth;
+         std::string data;
+         std::getline( ss, data );
+         chain::action act = make_action( account, action_name, auth, json::parse( data.empty() ? "{}" : data ) );
+
+         std::vector<chain::action_trace> traces;
+         try {
+            traces = chain.push_action( act );
+         } catch( const chain::chain_error& e ) {
+            if( expect_failure ) return;
+            throw;
+         }
+         if( expect_failure ) throw script_error( account + "::" + action_name + " was expected to fail" );
+         if( on_transaction ) on_transaction( traces );
+      } else if( cmd == "block" ) {
+         if( on_block ) on_block();
+      } else {
+         throw script_error( "unknown command " + cmd );
+      }
+   }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "abi.hpp"
+#include "chain.hpp"
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Action scripts run against the in-memory chain, shared by wasmprof and rowconflict.
+// Lines, with paths relative to the script:
+//
+//    time 2021-10-14T12:00:00
+//    advance <seconds>
+//    account <name>...
+//    contract <account> <wasm> <abi>
+//    action <account> <action> <actor[@perm][,...]> <json data>
+//    fail action ...          # the action must be rejected
+//    block                    # ends a block of transactions, for tools that group them
+
+namespace hagglex {
+
+   struct script_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   std::string directory_of( const std::string& path );
+   std::string resolve_path( const std::string& base, const std::string& path );
+
+   // "alice" or "alice@owner", comma separated
+   std::vector<chain::permission_level> parse_auth( const std::string& s );
+
+   class script_runner {
+      public:
+         chain::controller                  chain;
+         std::map<uint64_t, abi>            abis;
+         std::map<std::string, uint64_t>    code_sizes;   // wasm bytes by account
+         std::map<std::string, std::string> wasm_overrides;   // used instead of the contract line's wasm,
+                                                              // with the .abi beside it if there is one
+
+         // the traces of every action that was not expected to fail
+         std::function<void( const std::vector<chain::action_trace>& )>   on_transaction;
+         std::function<void()>                                            on_block;
+
+         void run( const std::string& path );
+
+         // an action of a contract the script deployed, its data converted through the ABI
+         chain::action make_action( const std::string& account, const std::string& action_name,
+                                    const std::string& auth, const json& data ) const;
+
+      private:
+         void step( const std::string& base, const std::string& line );
+   };
+
+}
@@ -0,0 +1,434 @@
+#include "wasm.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace hagglex::wasm {
+
+   namespace {
+
+      class reader {
+         public:
+            reader( const std::vector<uint8_t>& b, size_t pos, size_t end ) : b(b), pos(pos), end(end) {}
+
+            size_t offset() const { return pos; }
+            bool   done() const { return pos >= end; }
+
+            uint8_t u8() {
+               if( pos >= end ) throw wasm_error( "unexpected end of module" );
+               return b[pos++];
+            }
+
+            uint64_t uleb( int bits ) {
+               uint64_t v = 0;
+               int shift = 0;
+               while( true ) {
+                  uint8_t byte = u8();
+                  if( shift < 64 ) v |= uint64_t(byte & 0x7f) << shift;
+                  shift += 7;
+                  if( !(byte & 0x80) ) break;
+                  if( shift >= bits + 7 ) throw wasm_error( "leb128 too long" );
+               }
+               return v;
+            }
+
+            int64_t sleb( int bits ) {
+               int64_t v = 0;
+               int shift = 0;
+               uint8_t byte;
+               do {
+                  byte = u8();
+                  if( shift < 64 ) v |= int64_t(byte & 0x7f) << shift;
+                  shift += 7;
+                  if( shift >= bits + 7 && (byte & 0x80) ) throw wasm_error( "leb128 too long" );
+               } while( byte & 0x80 );
+               if( shift < 64 && (byte & 0x40) ) v |= -(int64_t(1) << shift);
+               return v;
+            }
+
+            uint32_t u32() { return uint32_t(uleb( 32 )); }
+
+            uint64_t fixed( size_t n ) {
+               if( end - pos < n ) throw wasm_error( "unexpected end of module" );
+               uint64_t v = 0;
+               std::memcpy( &v, &b[pos], n );
+               pos += n;
+               return v;
+            }
+
+            std::string name() {
+               uint32_t n = u32();
+               if( end - pos < n ) throw wasm_error( "name runs past section" );
+               std::string s( reinterpret_cast<const char*>(&b[pos]), n );
+               pos += n;
+               return s;
+            }
+
+            void skip( size_t n ) {
+               if( end - pos < n ) throw wasm_error( "unexpected end of module" );
+               pos += n;
+            }
+
+         private:
+            const std::vector<uint8_t>& b;
+            size_t                      pos;
+            size_t                      end;
+      };
+
+      limits read_limits( reader& r ) {
+         limits l;
+         l.present = true;
+         uint8_t flags = r.u8();
+         l.initial = r.u32();
+         if( flags & 1 ) {
+            l.has_max = true;
+            l.maximum = r.u32();
+         }
+         return l;
+      }
+
+      // constant initializer expressions: *.const or global.get, then end
+      uint64_t read_init_expr( reader& r, const std::vector<global_entry>& globals ) {
+         uint64_t v = 0;
+         uint8_t opcode = r.u8();
+         switch( opcode ) {
+            case op::i32_const: v = uint32_t(int32_t(r.sleb( 32 ))); break;
+            case op::i64_const: v = uint64_t(r.sleb( 64 )); break;
+            case op::f32_const: v = r.fixed( 4 ); break;
+            case op::f64_const: v = r.fixed( 8 ); break;
+            case op::global_get: {
+               uint32_t g = r.u32();
+               if( g >= globals.size() ) throw wasm_error( "init expression reads unknown global" );
+               v = globals[g].init;
+               break;
+            }
+            default: throw wasm_error( "unsupported init expression" );
+         }
+         if( r.u8() != op::end ) throw wasm_error( "init expression not terminated" );
+         return v;
+      }
+
+   }
+
+   module module::load( const std::string& path ) {
+      std::ifstream in( path, std::ios::binary );
+      if( !in ) throw wasm_error( "cannot open " + path );
+      std::vector<uint8_t> bytes( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+      return parse( std::move(bytes) );
+   }
+
+   module module::parse( std::vector<uint8_t> bytes ) {
+      module m;
+      m.bytes = std::move(bytes);
+      const auto& b = m.bytes;
+
+      static const uint8_t magic[8] = { 0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00 };
+      if( b.size() < 8 || std::memcmp( b.data(), magic, 8 ) != 0 ) throw wasm_error( "not a wasm v1 module" );
+
+      std::vector<uint32_t> function_types;
+      size_t pos = 8;
+      while( pos < b.size() ) {
+         reader hdr( b, pos, b.size() );
+         uint8_t id = hdr.u8();
+         uint32_t size = hdr.u32();
+         size_t begin = hdr.offset();
+         size_t end = begin + size;
+         if( end > b.size() ) throw wasm_error( "section runs past end of module" );
+         reader r( b, begin, end );
+
+         switch( id ) {
+            case 0: {   // custom: only the function names are used
+               std::string name = r.name();
+               if( name != "name" ) break;
+               while( !r.done() ) {
+                  uint8_t sub = r.u8();
+                  uint32_t sub_size = r.u32();
+                  if( sub != 1 ) { r.skip( sub_size ); continue; }
+                  uint32_t n = r.u32();
+                  for( uint32_t i = 0; i < n; ++i ) {
+                     uint32_t idx = r.u32();
+                     m.names[idx] = r.name();
+                  }
+               }
+               break;
+            }
+            case 1: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  if( r.u8() != 0x60 ) throw wasm_error( "bad function type" );
+                  func_type t;
+                  uint32_t np = r.u32();
+                  for( uint32_t j = 0; j < np; ++j ) t.params.push_back( r.u8() );
+                  uint32_t nr = r.u32();
+                  for( uint32_t j = 0; j < nr; ++j ) t.results.push_back( r.u8() );
+                  m.types.push_back( std::move(t) );
+               }
+               break;
+            }
+            case 2: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  import_entry e;
+                  e.module = r.name();
+                  e.field = r.name();
+                  e.kind = r.u8();
+                  switch( e.kind ) {
+                     case ext_func:
+                        e.index = r.u32();
+                        m.num_imported_functions++;
+                        break;
+                     case ext_table:
+                        r.u8();
+                        m.table = read_limits( r );
+                        break;
+                     case ext_memory:
+                        m.memory = read_limits( r );
+                        break;
+                     case ext_global:
+                        r.u8();
+                        r.u8();
+                        throw wasm_error( "imported globals are not supported" );
+                     default:
+                        throw wasm_error( "bad import kind" );
+                  }
+                  m.imports.push_back( std::move(e) );
+               }
+               break;
+            }
+            case 3: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) function_types.push_back( r.u32() );
+               break;
+            }
+            case 4: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  r.u8();
+                  m.table = read_limits( r );
+               }
+               break;
+            }
+            case 5: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) m.memory = read_limits( r );
+               break;
+            }
+            case 6: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  global_entry g;
+                  g.type = r.u8();
+                  g.mut = r.u8() != 0;
+                  g.init = read_init_expr( r, m.globals );
+                  m.globals.push_back( g );
+               }
+               break;
+            }
+            case 7: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  export_entry e;
+                  e.name = r.name();
+                  e.kind = r.u8();
+                  e.index = r.u32();
+                  m.exports.push_back( std::move(e) );
+               }
+               break;
+            }
+            case 8:
+               m.start = r.u32();
+               break;
+            case 9: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  if( r.u32() != 0 ) throw wasm_error( "only active table-0 element segments are supported" );
+                  elem_segment s;
+                  s.offset = uint32_t(read_init_expr( r, m.globals ));
+                  uint32_t count = r.u32();
+                  for( uint32_t j = 0; j < count; ++j ) s.functions.push_back( r.u32() );
+                  m.elements.push_back( std::move(s) );
+               }
+               break;
+            }
+            case 10: {
+               uint32_t n = r.u32();
+               if( n != function_types.size() ) throw wasm_error( "function and code section sizes differ" );
+               for( uint32_t i = 0; i < n; ++i ) {
+                  uint32_t body_size = r.u32();
+                  size_t body_end = r.offset() + body_size;
+                  reader br( b, r.offset(), body_end );
+                  function_body f;
+                  f.type = function_types[i];
+                  uint32_t groups = br.u32();
+                  for( uint32_t g = 0; g < groups; ++g ) {
+                     uint32_t count = br.u32();
+                     uint8_t type = br.u8();
+                     if( f.locals.size() + count > 50000 ) throw wasm_error( "too many locals" );
+                     f.locals.insert( f.locals.end(), count, type );
+                  }
+                  f.begin = br.offset();
+                  f.end = body_end;
+                  m.functions.push_back( std::move(f) );
+                  r.skip( body_size );
+               }
+               break;
+            }
+            case 11: {
+               uint32_t n = r.u32();
+               for( uint32_t i = 0; i < n; ++i ) {
+                  if( r.u32() != 0 ) throw wasm_error( "only active memory-0 data segments are supported" );
+                  data_segment s;
+                  s.offset = uint32_t(read_init_expr( r, m.globals ));
+                  uint32_t size = r.u32();
+                  size_t at = r.offset();
+                  r.skip( size );
+                  s.bytes.assign( b.begin() + at, b.begin() + at + size );
+                  m.data.push_back( std::move(s) );
+               }
+               break;
+            }
+            default:
+               break;
+         }
+         pos = end;
+      }
+
+      if( m.functions.size() != function_types.size() ) throw wasm_error( "missing code section" );
+      for( const auto& f : m.functions )
+         if( f.type >= m.types.size() ) throw wasm_error( "function uses unknown type" );
+      for( const auto& i : m.imports )
+         if( i.kind == ext_func && i.index >= m.types.size() ) throw wasm_error( "import uses unknown type" );
+      return m;
+   }
+
+   const import_entry& module::imported_function( uint32_t func_index ) const {
+      uint32_t seen = 0;
+      for( const auto& i : imports ) {
+         if( i.kind != ext_func ) continue;
+         if( seen++ == func_index ) return i;
+      }
+      throw wasm_error( "not an imported function" );
+   }
+
+   const func_type& module::function_type( uint32_t func_index ) const {
+      if( func_index < num_imported_functions ) return types[imported_function( func_index ).index];
+      func_index -= num_imported_functions;
+      if( func_index >= functions.size() ) throw wasm_error( "unknown function index" );
+      return types[functions[func_index].type];
+   }
+
+   std::string module::function_name( uint32_t func_index ) const {
+      auto it = names.find( func_index );
+      if( it != names.end() ) return it->second;
+      if( is_import( func_index ) ) return imported_function( func_index ).field;
+      return "f" + std::to_string( func_index );
+   }
+
+   int64_t module::export_index( const std::string& name ) const {
+      for( const auto& e : exports )
+         if( e.kind == ext_func && e.name == name ) return e.index;
+      return -1;
+   }
+
+   uint32_t block_arity( const module& m, int64_t block_type ) {
+      if( block_type == -64 ) return 0;          // 0x40, empty
+      if( block_type < 0 ) return 1;             // a single value type
+      if( size_t(block_type) >= m.types.size() ) throw wasm_error( "unknown block type" );
+      return uint32_t(m.types[block_type].results.size());
+   }
+
+   decoded_function decode( const module& m, const function_body& body ) {
+      decoded_function out;
+      reader r( m.bytes, body.begin, body.end );
+      std::vector<uint32_t> open;      // indices of enclosing block/loop/if
+
+      while( !r.done() ) {
+         instr in;
+         in.pos = uint32_t(r.offset());
+         uint8_t opcode = r.u8();
+         in.op = opcode;
+
+         switch( opcode ) {
+            case op::block:
+            case op::loop:
+            case op::if_:
+               in.a = block_arity( m, r.sleb( 33 ) );
+               open.push_back( uint32_t(out.code.size()) );
+               break;
+            case op::else_:
+               if( open.empty() || out.code[open.back()].op != op::if_ ) throw wasm_error( "else without if" );
+               out.code[open.back()].match = uint32_t(out.code.size());
+               in.match = open.back();
+               break;
+            case op::end:
+               if( !open.empty() ) {
+                  instr& head = out.code[open.back()];
+                  if( head.op == op::if_ && head.match == 0 ) head.match = uint32_t(out.code.size());
+                  head.b = out.code.size();
+                  open.pop_back();
+               }
+               break;
+            case op::br:
+            case op::br_if:
+               in.a = r.u32();
+               break;
+            case op::br_table: {
+               uint32_t n = r.u32();
+               std::vector<uint32_t> targets;
+               for( uint32_t i = 0; i <= n; ++i ) targets.push_back( r.u32() );
+               in.a = uint32_t(out.br_tables.size());
+               out.br_tables.push_back( std::move(targets) );
+               break;
+            }
+            case op::call:
+               in.a = r.u32();
+               break;
+            case op::call_indirect:
+               in.a = r.u32();
+               r.u8();
+               break;
+            case op::local_get:
+            case op::local_set:
+            case op::local_tee:
+            case op::global_get:
+            case op::global_set:
+               in.a = r.u32();
+               break;
+            case op::memory_size:
+            case op::memory_grow:
+               r.u8();
+               break;
+            case op::i32_const: in.b = uint32_t(int32_t(r.sleb( 32 ))); break;
+            case op::i64_const: in.b = uint64_t(r.sleb( 64 )); break;
+            case op::f32_const: in.b = r.fixed( 4 ); break;
+            case op::f64_const: in.b = r.fixed( 8 ); break;
+            case op::prefix_fc: {
+               uint32_t sub = r.u32();
+               in.op = uint16_t(0xfc00 | sub);
+               if( sub == 10 ) { r.u8(); r.u8(); }
+               else if( sub == 11 ) { r.u8(); }
+               else if( sub > 7 ) throw wasm_error( "unsupported 0xfc opcode " + std::to_string(sub) );
+               break;
+            }
+            default:
+               if( opcode >= 0x28 && opcode <= 0x3e ) {        // loads and stores
+                  in.a = r.u32();
+                  in.b = r.u32();
+               } else if( opcode == op::unreachable || opcode == op::nop || opcode == op::return_ ||
+                          opcode == op::drop || opcode == op::select ||
+                          (opcode >= 0x45 && opcode <= 0xc4) ) {
+                  // no immediates
+               } else {
+                  throw wasm_error( "unsupported opcode 0x" + std::to_string(opcode) + " at " + std::to_string(in.pos) );
+               }
+         }
+         out.code.push_back( in );
+      }
+
+      if( !open.empty() ) throw wasm_error( "unterminated block" );
+      if( out.code.empty() || out.code.back().op != op::end ) throw wasm_error( "function body not terminated" );
+      return out;
+   }
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// WebAssembly (MVP) module reader shared by the HaggleX wasm tools. It parses the
+// sections a contract build produces and decodes function bodies into a flat
+// instruction list that the profiler executes and the static analyzer walks.
+
+namespace hagglex::wasm {
+
+   struct wasm_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   enum valtype : uint8_t {
+      i32 = 0x7f,
+      i64 = 0x7e,
+      f32 = 0x7d,
+      f64 = 0x7c,
+   };
+
+   enum external_kind : uint8_t {
+      ext_func   = 0,
+      ext_table  = 1,
+      ext_memory = 2,
+      ext_global = 3,
+   };
+
+   struct func_type {
+      std::vector<uint8_t> params;
+      std::vector<uint8_t> results;
+   };
+
+   struct import_entry {
+      std::string module;
+      std::string field;
+      uint8_t     kind  = ext_func;
+      uint32_t    index = 0;          // type index for functions
+   };
+
+   struct export_entry {
+      std::string name;
+      uint8_t     kind  = ext_func;
+      uint32_t    index = 0;
+   };
+
+   struct function_body {
+      uint32_t              type = 0;
+      std::vector<uint8_t>  locals;   // one entry per local, params not included
+      size_t                begin = 0;  // byte range of the expression in module::bytes
+      size_t                end = 0;
+   };
+
+   struct global_entry {
+      uint8_t  type = i32;
+      bool     mut = false;
+      uint64_t init = 0;              // constant initializer, raw bits
+   };
+
+   struct elem_segment {
+      uint32_t              offset = 0;
+      std::vector<uint32_t> functions;
+   };
+
+   struct data_segment {
+      uint32_t              offset = 0;
+      std::vector<uint8_t>  bytes;
+   };
+
+   struct limits {
+      bool     present = false;
+      uint32_t initial = 0;
+      uint32_t maximum = 0;
+      bool     has_max = false;
+   };
+
+   struct module {
+      std::vector<uint8_t>             bytes;
+      std::vector<func_type>           types;
+      std::vector<import_entry>        imports;
+      uint32_t                         num_imported_functions = 0;
+      std::vector<function_body>       functions;    // defined functions, after the imports
+      limits                           table;
+      limits                           memory;
+      std::vector<global_entry>        globals;
+      std::vector<export_entry>        exports;
+      std::vector<elem_segment>        elements;
+      std::vector<data_segment>        data;
+      std::map<uint32_t, std::string>  names;        // from the "name" custom section
+      int64_t                          start = -1;
+
+      static module parse( std::vector<uint8_t> bytes );
+      static module load( const std::string& path );
+
+      const func_type&    function_type( uint32_t func_index ) const;
+      const import_entry& imported_function( uint32_t func_index ) const;
+      bool                is_import( uint32_t func_index ) const { return func_index < num_imported_functions; }
+      std::string         function_name( uint32_t func_index ) const;
+      int64_t             export_index( const std::string& name ) const;
+   };
+
+   // Opcodes with a 0xFC prefix are stored as 0xFC00 | sub-opcode.
+   namespace op {
+      enum : uint16_t {
+         unreachable = 0x00, nop = 0x01, block = 0x02, loop = 0x03, if_ = 0x04, else_ = 0x05,
+         end = 0x0b, br = 0x0c, br_if = 0x0d, br_table = 0x0e, return_ = 0x0f,
+         call = 0x10, call_indirect = 0x11, drop = 0x1a, select = 0x1b,
+         local_get = 0x20, local_set = 0x21, local_tee = 0x22, global_get = 0x23, global_set = 0x24,
+         i32_load = 0x28, i64_store32 = 0x3e, memory_size = 0x3f, memory_grow = 0x40,
+         i32_const = 0x41, i64_const = 0x42, f32_const = 0x43, f64_const = 0x44,
+         prefix_fc = 0xfc,
+         memory_copy = 0xfc0a, memory_fill = 0xfc0b,
+      };
+   }
+
+   struct instr {
+      uint16_t op = 0;
+      uint32_t a = 0;          // index, depth, alignment, block arity or br_table slot
+      uint64_t b = 0;          // constant bits, memory offset, or for block/loop/if the index of the matching end
+      uint32_t match = 0;      // if: index of its else (or end when there is none); else: index of its if
+      uint32_t pos = 0;        // byte offset of the opcode in the module
+   };
+
+   struct decoded_function {
+      std::vector<instr>                   code;
+      std::vector<std::vector<uint32_t>>   br_tables;   // br_table targets, the last entry is the default
+   };
+
+   decoded_function decode( const module& m, const function_body& body );
+
+   // number of values a block type produces
+   uint32_t block_arity( const module& m, int64_t block_type );
+
+}
@@ -0,0 +1,208 @@
+#include "websocket.hpp"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/sha.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <strings.h>
+
+namespace hagglex {
+
+   namespace {
+
+      std::string base64_encode( const uint8_t* data, size_t size ) {
+         static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+         std::string out;
+         for( size_t i = 0; i < size; i += 3 ) {
+            uint32_t n = uint32_t(data[i]) << 16;
+            if( i + 1 < size ) n |= uint32_t(data[i + 1]) << 8;
+            if( i + 2 < size ) n |= data[i + 2];
+            out += alphabet[(n >> 18) & 63];
+            out += alphabet[(n >> 12) & 63];
+            out += i + 1 < size ? alphabet[(n >> 6) & 63] : '=';
+            out += i + 2 < size ? alphabet[n & 63] : '=';
+         }
+         return out;
+      }
+
+      // Sec-WebSocket-Accept the server must answer for a key
+      std::string accept_key( const std::string& key ) {
+         std::string s = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+         uint8_t digest[SHA_DIGEST_LENGTH];
+         SHA1( reinterpret_cast<const uint8_t*>(s.data()), s.size(), digest );
+         return base64_encode( digest, sizeof(digest) );
+      }
+
+   }
+
+   websocket_client::websocket_client( const std::string& url ) {
+      std::string rest = url;
+      if( rest.rfind( "ws://", 0 ) == 0 ) rest = rest.substr( 5 );
+      else if( rest.find( "://" ) != std::string::npos ) throw websocket_error( "only ws:// endpoints are supported" );
+      auto slash = rest.find( '/' );
+      path = slash == std::string::npos ? "/" : rest.substr( slash );
+      if( slash != std::string::npos ) rest = rest.substr( 0, slash );
+      auto colon = rest.rfind( ':' );
+      host = colon == std::string::npos ? rest : rest.substr( 0, colon );
+      port = colon == std::string::npos ? "80" : rest.substr( colon + 1 );
+      connect();
+      handshake();
+   }
+
+   websocket_client::~websocket_client() {
+      if( fd >= 0 ) ::close( fd );
+   }
+
+   void websocket_client::connect() {
+      addrinfo hints{};
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      addrinfo* res = nullptr;
+      if( getaddrinfo( host.c_str(), port.c_str(), &hints, &res ) != 0 ) throw websocket_error( "cannot resolve " + host );
+      for( addrinfo* a = res; a; a = a->ai_next ) {
+         fd = ::socket( a->ai_family, a->ai_socktype, a->ai_protocol );
+         if( fd < 0 ) continue;
+         if( ::connect( fd, a->ai_addr, a->ai_addrlen ) == 0 ) break;
+         ::close( fd );
+         fd = -1;
+      }
+      freeaddrinfo( res );
+      if( fd < 0 ) throw websocket_error( "cannot connect to " + host + ":" + port );
+      int one = 1;
+      setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+   }
+
+   void websocket_client::handshake() {
+      uint8_t nonce[16];
+      std::random_device rd;
+      for( auto& b : nonce ) b = uint8_t(rd());
+      const std::string key = base64_encode( nonce, sizeof(nonce) );
+
+      const std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host + ":" + port +
+                                  "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + key +
+                                  "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+      for( size_t sent = 0; sent < request.size(); ) {
+         ssize_t n = ::send( fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL );
+         if( n <= 0 ) throw websocket_error( "send failed" );
+         sent += size_t(n);
+      }
+
+      size_t header_end;
+      while( (header_end = buffer.find( "\r\n\r\n" )) == std::string::npos )
+         if( !fill() ) throw websocket_error( "connection closed during handshake" );
+      std::string headers = buffer.substr( 0, header_end );
+      read_pos = header_end + 4;
+      if( headers.rfind( "HTTP/1.1 101", 0 ) != 0 ) throw websocket_error( "handshake rejected: " + headers.substr( 0, headers.find( "\r\n" ) ) );
+
+      std::string accept;
+      size_t pos = headers.find( "\r\n" );
+      while( pos != std::string::npos ) {
+         size_t next = headers.find( "\r\n", pos + 2 );
+         std::string line = headers.substr( pos + 2, next == std::string::npos ? std::string::npos : next - pos - 2 );
+         auto colon = line.find( ':' );
+         if( colon != std::string::npos && !strcasecmp( line.substr( 0, colon ).c_str(), "sec-websocket-accept" ) ) {
+            accept = line.substr( colon + 1 );
+            while( !accept.empty() && accept[0] == ' ' ) accept.erase( 0, 1 );
+         }
+         pos = next;
+      }
+      if( accept != accept_key( key ) ) throw websocket_error( "bad Sec-WebSocket-Accept" );
+   }
+
+   bool websocket_client::fill() {
+      // drop consumed bytes once they dominate the buffer
+      if( read_pos > 65536 && read_pos * 2 > buffer.size() ) {
+         buffer.erase( 0, read_pos );
+         read_pos = 0;
+      }
+      char chunk[65536];
+      ssize_t n = ::recv( fd, chunk, sizeof(chunk), 0 );
+      if( n <= 0 ) return false;
+      buffer.append( chunk, size_t(n) );
+      return true;
+   }
+
+   void websocket_client::need( size_t n ) {
+      while( buffer.size() - read_pos < n )
+         if( !fill() ) throw websocket_error( "connection closed" );
+   }
+
+   void websocket_client::send_frame( uint8_t opcode, const void* data, size_t size ) {
+      std::string frame;
+      frame += char(0x80 | opcode);
+      if( size < 126 ) frame += char(0x80 | size);
+      else if( size <= 0xffff ) {
+         frame += char(0x80 | 126);
+         for( int shift = 8; shift >= 0; shift -= 8 ) frame += char(size >> shift);
+      } else {
+         frame += char(0x80 | 127);
+         for( int shift = 56; shift >= 0; shift -= 8 ) frame += char(uint64_t(size) >> shift);
+      }
+      // client frames are masked; the mask only has to be unpredictable to proxies
+      static std::mt19937 rng{ std::random_device{}() };
+      uint8_t mask[4];
+      for( auto& b : mask ) b = uint8_t(rng());
+      frame.append( reinterpret_cast<const char*>(mask), 4 );
+      const char* p = static_cast<const char*>(data);
+      for( size_t i = 0; i < size; ++i ) frame += char(p[i] ^ mask[i & 3]);
+
+      for( size_t sent = 0; sent < frame.size(); ) {
+         ssize_t n = ::send( fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL );
+         if( n <= 0 ) throw websocket_error( "send failed" );
+         sent += size_t(n);
+      }
+   }
+
+   void websocket_client::send_binary( const void* data, size_t size ) {
+      send_frame( 0x2, data, size );
+   }
+
+   websocket_message websocket_client::receive() {
+      websocket_message msg;
+      bool started = false;
+      while( true ) {
+         need( 2 );
+         const uint8_t b0 = uint8_t(buffer[read_pos]);
+         const uint8_t b1 = uint8_t(buffer[read_pos + 1]);
+         const bool    fin = b0 & 0x80;
+         const uint8_t opcode = b0 & 0x0f;
+         const size_t extended = (b1 & 0x7f) == 126 ? 2 : (b1 & 0x7f) == 127 ? 8 : 0;
+         const size_t header = 2 + extended + ((b1 & 0x80) ? 4 : 0);
+         need( header );
+         uint64_t length = b1 & 0x7f;
+         if( extended ) {
+            length = 0;
+            for( size_t i = 0; i < extended; ++i ) length = (length << 8) | uint8_t(buffer[read_pos + 2 + i]);
+         }
+         need( header + length );
+         const char* payload = buffer.data() + read_pos + header;
+         std::string data( payload, size_t(length) );
+         if( b1 & 0x80 ) {
+            const char* mask = payload - 4;
+            for( size_t i = 0; i < data.size(); ++i ) data[i] ^= mask[i & 3];
+         }
+         read_pos += header + length;
+
+         if( opcode == 0x8 ) throw websocket_error( "connection closed by server" );
+         if( opcode == 0x9 ) { send_frame( 0xA, data.data(), data.size() ); continue; }
+         if( opcode == 0xA ) continue;
+         if( opcode == 0x1 || opcode == 0x2 ) {
+            if( started ) throw websocket_error( "unexpected frame inside a fragmented message" );
+            started = true;
+            msg.text = opcode == 0x1;
+         } else if( opcode != 0x0 || !started ) {
+            throw websocket_error( "unexpected websocket opcode" );
+         }
+         msg.data += data;
+         if( fin ) return msg;
+      }
+   }
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// Minimal blocking WebSocket client (RFC 6455) for the nodeos state-history endpoint:
+// plain ws://, no extensions, fragmented messages reassembled, pings answered.
+
+namespace hagglex {
+
+   struct websocket_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   struct websocket_message {
+      bool        text = false;
+      std::string data;
+   };
+
+   class websocket_client {
+      public:
+         explicit websocket_client( const std::string& url );     // ws://host[:port][/path]
+         ~websocket_client();
+         websocket_client( const websocket_client& ) = delete;
+         websocket_client& operator=( const websocket_client& ) = delete;
+
+         void send_binary( const void* data, size_t size );
+
+         // next complete message; throws websocket_error once the server closes
+         websocket_message receive();
+
+      private:
+         std::string host;
+         std::string port;
+         std::string path;
+         int         fd = -1;
+         std::string buffer;        // received bytes, consumed from read_pos
+         size_t      read_pos = 0;
+
+         void connect();
+         void handshake();
+         void send_frame( uint8_t opcode, const void* data, size_t size );
+         bool fill();
+         void need( size_t n );
+   };
+
+}
@@ -0,0 +1,140 @@
+#include "workload.hpp"
+
+#include "script.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace hagglex {
+
+   namespace {
+
+      // replaces $user, $other and $nonce inside every string of a template
+      json expand( const json& v, const std::string& user, const std::string& other, const std::string& nonce ) {
+         if( v.is_string() ) {
+            std::string s = v.as_string();
+            for( auto [key, value] : { std::pair<const char*, const std::string*>{ "$user", &user }, { "$other", &other }, { "$nonce", &nonce } } ) {
+               for( size_t pos; (pos = s.find( key )) != std::string::npos; ) s.replace( pos, std::strlen( key ), *value );
+            }
+            return json( s );
+         }
+         if( v.is_array() ) {
+            json out = json::array();
+            for( const auto& item : v.items() ) out.push_back( expand( item, user, other, nonce ) );
+            return out;
+         }
+         if( v.is_object() ) {
+            json out = json::object();
+            for( const auto& [key, item] : v.members() ) out.set( key, expand( item, user, other, nonce ) );
+            return out;
+         }
+         return v;
+      }
+
+      action_template parse_action( const json& j ) {
+         action_template t;
+         t.account = j["account"].as_string();
+         t.name = j["action"].as_string();
+         t.actor = j["actor"].as_string();
+         t.data = j.has( "data" ) ? j["data"] : json::object();
+         return t;
+      }
+
+      // "<prefix><4 letters>", e.g. hagloadaaab; valid names for any prefix of up to 8 characters
+      std::string user_name( const std::string& prefix, uint32_t i ) {
+         std::string suffix( 4, 'a' );
+         for( int pos = 3; pos >= 0; --pos, i /= 26 ) suffix[pos] = char('a' + i % 26);
+         return prefix + suffix;
+      }
+
+   }
+
+   workload::workload( const json& cfg, const std::string& base, const std::string& tool ) {
+      if( const json* users_cfg = cfg.find( "users" ) ) {
+         std::string prefix = (*users_cfg)["prefix"].as_string();
+         if( prefix.size() > 8 ) throw config_error( "users.prefix must be at most 8 characters" );
+         uint32_t count = uint32_t((*users_cfg)["count"].as_uint64());
+         for( uint32_t i = 0; i < count; ++i ) users.push_back( user_name( prefix, i ) );
+      }
+      if( users.size() < 2 ) throw config_error( "at least two users are needed" );
+      if( const json* a = cfg.find( "accounts" ) )
+         for( const auto& name : a->items() ) accounts.push_back( name.as_string() );
+
+      for( const auto& c : cfg["contracts"].items() ) {
+         contract ct;
+         ct.account = c["account"].as_string();
+         ct.wasm = resolve_path( base, c["wasm"].as_string() );
+         ct.abi_path = resolve_path( base, c["abi"].as_string() );
+         ct.optional = c.has( "optional" ) && c["optional"].as_bool();
+         try {
+            ct.def = abi::load( ct.abi_path );
+         } catch( const std::exception& e ) {
+            if( !ct.optional ) throw;
+            std::cerr << tool << ": skipping " << ct.account << ": " << e.what() << "\n";
+            continue;
+         }
+         contracts.push_back( std::move(ct) );
+      }
+
+      if( const json* setup_cfg = cfg.find( "setup" ) )
+         for( const auto& s : setup_cfg->items() ) {
+            setup_step st;
+            st.act = parse_action( s );
+            st.each_user = s.has( "each_user" ) && s["each_user"].as_bool();
+            if( known( st.act.account ) ) setup.push_back( std::move(st) );
+         }
+
+      for( const auto& m : cfg["mix"].items() ) {
+         mix_entry e;
+         e.name = m["name"].as_string();
+         e.weight = m.has( "weight" ) ? uint32_t(m["weight"].as_uint64()) : 1;
+         bool usable = true;
+         for( const auto& a : m["actions"].items() ) {
+            e.actions.push_back( parse_action( a ) );
+            usable = usable && known( e.actions.back().account );
+         }
+         if( usable ) mix.push_back( std::move(e) );
+         else std::cerr << tool << ": mix entry " << e.name << " needs a contract that is not deployed\n";
+      }
+      if( mix.empty() ) throw config_error( "no usable mix entries" );
+      for( const auto& e : mix ) total_weight += e.weight;
+   }
+
+   bool workload::known( const std::string& account ) const {
+      for( const auto& c : contracts ) if( c.account == account ) return true;
+      return false;
+   }
+
+   const abi& workload::abi_of( const std::string& account ) const {
+      for( const auto& c : contracts ) if( c.account == account ) return c.def;
+      throw config_error( "no contract " + account );
+   }
+
+   chain::action workload::make_action( const action_template& t, const std::string& user, const std::string& other,
+                                        const std::string& nonce ) const {
+      chain::action a;
+      a.account = string_to_name( t.account );
+      a.name = string_to_name( t.name );
+      std::string actor = expand( json( t.actor ), user, other, nonce ).as_string();
+      a.authorization.push_back( { string_to_name( actor ), string_to_name( "active" ) } );
+      const abi& def = abi_of( t.account );
+      std::string type = def.action_type( a.name );
+      if( type.empty() ) throw config_error( t.account + " has no action " + t.name );
+      a.data = def.json_to_bin( type, expand( t.data, user, other, nonce ) );
+      return a;
+   }
+
+   std::vector<chain::action> workload::build( uint32_t m, const std::string& user, const std::string& other,
+                                               const std::string& nonce ) const {
+      std::vector<chain::action> out;
+      for( const auto& t : mix[m].actions ) out.push_back( make_action( t, user, other, nonce ) );
+      return out;
+   }
+
+   uint32_t workload::pick( uint32_t draw ) const {
+      uint32_t m = 0;
+      while( draw >= mix[m].weight ) draw -= mix[m++].weight;
+      return m;
+   }
+
+}
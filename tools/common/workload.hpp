@@ -0,0 +1,71 @@
+#pragma once
+
+#include "abi.hpp"
+#include "chain.hpp"
+
+#include <string>
+#include <vector>
+
+// The workload half of a loadgen config: the contracts, accounts and users it needs,
+// the setup actions and the weighted mix of transactions. loadgen sends it to a node;
+// rowconflict runs it on the in-memory chain.
+
+namespace hagglex {
+
+   struct config_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   // one action of a mix entry or setup step, data still holding $user/$other/$nonce
+   struct action_template {
+      std::string account;
+      std::string name;
+      std::string actor;
+      json        data;
+   };
+
+   struct mix_entry {
+      std::string                   name;
+      uint32_t                      weight = 1;
+      std::vector<action_template>  actions;
+   };
+
+   class workload {
+      public:
+         struct contract {
+            std::string account;
+            std::string wasm;
+            std::string abi_path;
+            abi         def;
+            bool        optional = false;
+         };
+
+         struct setup_step {
+            action_template act;
+            bool            each_user = false;
+         };
+
+         // `base` is the directory paths in the config are relative to; `tool` prefixes
+         // the notes about skipped optional contracts
+         workload( const json& cfg, const std::string& base, const std::string& tool );
+
+         std::vector<std::string>      users;
+         std::vector<std::string>      accounts;
+         std::vector<contract>         contracts;
+         std::vector<setup_step>       setup;
+         std::vector<mix_entry>        mix;
+         uint32_t                      total_weight = 0;
+
+         bool known( const std::string& account ) const;
+         const abi& abi_of( const std::string& account ) const;
+
+         chain::action make_action( const action_template& t, const std::string& user, const std::string& other,
+                                    const std::string& nonce ) const;
+         // the actions of mix entry `m`
+         std::vector<chain::action> build( uint32_t m, const std::string& user, const std::string& other,
+                                           const std::string& nonce ) const;
+         // the mix entry a uniform draw in [0, total_weight) falls on
+         uint32_t pick( uint32_t draw ) const;
+   };
+
+}
@@ -0,0 +1,131 @@
+// errcodes: prints the HaggleX error code table from hagglex_common/error_codes.hpp,
+// for clients decoding the numeric failures of COMPACT_ERRORS builds. With --wasm it
+// lists the messages a contract build carries instead, to check that a build holds
+// only its own (and none at all with COMPACT_ERRORS).
+
+#include "json.hpp"
+
+#include <hagglex_common/error_codes.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace hagglex;
+
+namespace {
+
+   struct entry {
+      uint64_t    code;
+      const char* contract;
+      const char* id;
+      const char* message;
+   };
+
+   std::vector<entry> table() {
+      std::vector<entry> out;
+      const char* contract = nullptr;
+#define HAGGLEX_ERROR_ENTRY( code, id, message ) out.push_back( { code, contract, #id, message } );
+      contract = "hagglextoken";
+      HAGGLEX_TOKEN_ERRORS( HAGGLEX_ERROR_ENTRY )
+      contract = "hagglexsale";
+      HAGGLEX_SALE_ERRORS( HAGGLEX_ERROR_ENTRY )
+      contract = "hagglexstake";
+      HAGGLEX_STAKE_ERRORS( HAGGLEX_ERROR_ENTRY )
+      contract = "common";
+      HAGGLEX_COMMON_ERRORS( HAGGLEX_ERROR_ENTRY )
+#undef HAGGLEX_ERROR_ENTRY
+      return out;
+   }
+
+   int usage_error() {
+      std::cerr << "usage: errcodes [--json] [CODE...]\n"
+                   "       errcodes [--json] --wasm CONTRACT=WASM\n";
+      return 2;
+   }
+
+   // the entries whose message is in the wasm as a NUL-terminated string, leaving out
+   // other contracts' entries with the same text as one of its own; `foreign` counts
+   // the other contracts' entries left
+   std::vector<entry> messages_in( const std::string& contract, const std::string& bytes, size_t& foreign ) {
+      std::vector<entry> found;
+      foreign = 0;
+      const auto all = table();
+      auto own_text = [&]( const char* message ) {
+         for( const auto& e : all )
+            if( (e.contract == contract || !std::strcmp( e.contract, "common" )) && !std::strcmp( e.message, message ) ) return true;
+         return false;
+      };
+      for( const auto& e : all ) {
+         if( bytes.find( std::string( e.message ) + '\0' ) == std::string::npos ) continue;
+         const bool own = e.contract == contract || !std::strcmp( e.contract, "common" );
+         if( !own && own_text( e.message ) ) continue;
+         found.push_back( e );
+         if( !own ) ++foreign;
+      }
+      return found;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   bool as_json = false;
+   std::vector<uint64_t> wanted;
+   std::string wasm_spec;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( arg == "--json" ) as_json = true;
+      else if( arg == "--wasm" && i + 1 < argc ) wasm_spec = argv[++i];
+      else if( !arg.empty() && arg[0] != '-' ) wanted.push_back( std::strtoull( arg.c_str(), nullptr, 10 ) );
+      else return usage_error();
+   }
+
+   std::vector<entry> rows;
+   size_t foreign = 0;
+   std::string wasm_path;
+   if( !wasm_spec.empty() ) {
+      const auto eq = wasm_spec.find( '=' );
+      if( eq == std::string::npos || !wanted.empty() ) return usage_error();
+      wasm_path = wasm_spec.substr( eq + 1 );
+      std::ifstream in( wasm_path, std::ios::binary );
+      if( !in ) {
+         std::cerr << "errcodes: cannot open " << wasm_path << "\n";
+         return 2;
+      }
+      const std::string bytes( (std::istreambuf_iterator<char>( in )), std::istreambuf_iterator<char>() );
+      rows = messages_in( wasm_spec.substr( 0, eq ), bytes, foreign );
+   }
+   else for( const auto& e : table() ) {
+      bool keep = wanted.empty();
+      for( auto code : wanted ) keep = keep || code == e.code;
+      if( keep ) rows.push_back( e );
+   }
+   if( rows.size() < wanted.size() ) {
+      std::cerr << "errcodes: unknown error code\n";
+      return 1;
+   }
+
+   if( as_json ) {
+      json out = json::array();
+      for( const auto& e : rows ) {
+         json j = json::object();
+         j.set( "code", json::number( e.code ) );
+         j.set( "contract", e.contract );
+         j.set( "id", e.id );
+         j.set( "message", e.message );
+         out.push_back( j );
+      }
+      std::cout << out.dump() << "\n";
+   } else {
+      for( const auto& e : rows )
+         std::printf( "%llu %s %s %s\n", (unsigned long long)e.code, e.contract, e.id, e.message );
+      if( !wasm_path.empty() )
+         std::printf( "%zu messages in %s, %zu of other contracts\n", rows.size(), wasm_path.c_str(), foreign );
+   }
+   return 0;
+}
@@ -0,0 +1,394 @@
+// loadgen: boots the HaggleX contracts on a local single-producer nodeos and drives a
+// weighted mix of transactions at stepped target rates, recording the billed CPU, NET
+// and RAM of every action type and the rate at which the node stops keeping up.
+
+#include "nodeos.hpp"
+#include "script.hpp"
+#include "workload.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace hagglex;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+   struct sample {
+      uint32_t    mix = 0;
+      bool        ok = false;
+      uint64_t    latency_us = 0;
+      uint64_t    cpu_us = 0;
+      uint64_t    net_bytes = 0;
+      int64_t     ram_bytes = 0;
+      std::string error;
+   };
+
+   struct step_result {
+      uint32_t              target_tps = 0;
+      double                achieved_tps = 0;
+      uint64_t              sent = 0;
+      uint64_t              failed = 0;
+      std::vector<sample>   samples;
+   };
+
+   uint64_t percentile( std::vector<uint64_t> v, double p ) {
+      if( v.empty() ) return 0;
+      std::sort( v.begin(), v.end() );
+      size_t rank = size_t( p * double(v.size() - 1) + 0.5 );
+      return v[std::min( rank, v.size() - 1 )];
+   }
+
+   // the workload of a config and the node and rate settings it is driven with
+   class generator : public workload {
+      public:
+         explicit generator( const std::string& config_path )
+            : generator( json::parse( read_file( config_path ) ), directory_of( config_path ) ) {}
+
+         generator( const json& cfg, const std::string& base ) : workload( cfg, base, "loadgen" ) {
+            url = cfg.has( "url" ) ? cfg["url"].as_string() : "http://127.0.0.1:8888";
+            wif = cfg["key"].as_string();
+            if( cfg.has( "connections" ) ) connections = uint32_t(cfg["connections"].as_uint64());
+            if( cfg.has( "step_seconds" ) ) step_seconds = uint32_t(cfg["step_seconds"].as_uint64());
+            if( cfg.has( "saturation" ) ) saturation = cfg["saturation"].as_double();
+            for( const auto& s : cfg["steps"].items() ) steps.push_back( uint32_t(s.as_uint64()) );
+         }
+
+         // signs one transaction per mix entry against a dummy chain id, verifies the
+         // signatures and prints them; no node is contacted
+         int dry_run() {
+            private_key key( wif );
+            auto pub = key.public_key();
+            std::string chain_id( 64, '0' );
+            transaction_header h;
+            h.expiration = 1634212800;
+            h.set_reference_block( std::string( 64, '1' ) );
+            int failures = 0;
+            for( uint32_t i = 0; i < mix.size(); ++i ) {
+               auto packed = pack_transaction( h, { nonce_action( "dry" + std::to_string( i ) ) }, build( i, users[0], users[1], "dry" ) );
+               auto digest = signing_digest( chain_id, packed );
+               auto sig = key.sign( digest );
+               bool ok = recover_public_key( digest, sig ) == pub;
+               failures += !ok;
+               std::cout << mix[i].name << " " << (ok ? "ok " : "BAD ") << packed.size() << " bytes "
+                         << packed_transaction_json( packed, { signature_to_string( sig ) } ).dump() << "\n";
+            }
+            return failures ? 1 : 0;
+         }
+
+         void bootstrap() {
+            nodeos_client node( url );
+            refresh( node );
+            private_key key( wif );
+            std::string pub = key.public_key_string();
+
+            auto newaccount = [&]( const std::string& name, bool code_permission ) {
+               json auth = json::object();
+               auth.set( "threshold", json::number( uint64_t(1) ) );
+               json keys = json::array();
+               json kw = json::object();
+               kw.set( "key", pub );
+               kw.set( "weight", json::number( uint64_t(1) ) );
+               keys.push_back( kw );
+               auth.set( "keys", keys );
+               auth.set( "accounts", json::array() );
+               auth.set( "waits", json::array() );
+               json active = auth;
+               if( code_permission ) {
+                  // contracts send inline actions as themselves
+                  json perm = json::object();
+                  perm.set( "actor", name );
+                  perm.set( "permission", "eosio.code" );
+                  json plw = json::object();
+                  plw.set( "permission", perm );
+                  plw.set( "weight", json::number( uint64_t(1) ) );
+                  json list = json::array();
+                  list.push_back( plw );
+                  active.set( "accounts", list );
+               }
+               json data = json::object();
+               data.set( "creator", "eosio" );
+               data.set( "name", name );
+               data.set( "owner", auth );
+               data.set( "active", active );
+               send_system( node, key, "newaccount", data, true );
+            };
+
+            for( const auto& c : contracts ) newaccount( c.account, true );
+            for( const auto& a : accounts ) newaccount( a, false );
+            for( const auto& u : users ) newaccount( u, false );
+
+            for( const auto& c : contracts ) {
+               std::string wasm = read_file( c.wasm );
+               json code = json::object();
+               code.set( "account", c.account );
+               code.set( "vmtype", json::number( uint64_t(0) ) );
+               code.set( "vmversion", json::number( uint64_t(0) ) );
+               code.set( "code", to_hex( wasm.data(), wasm.size() ) );
+               send_system( node, key, "setcode", code, true );
+               auto packed_abi = pack_abi( json::parse( read_file( c.abi_path ) ) );
+               json abi_data = json::object();
+               abi_data.set( "account", c.account );
+               abi_data.set( "abi", to_hex( packed_abi.data(), packed_abi.size() ) );
+               send_system( node, key, "setabi", abi_data, true );
+            }
+
+            uint64_t nonce = 0;
+            for( const auto& s : setup ) {
+               auto run = [&]( const std::string& user ) {
+                  std::string n = "setup" + std::to_string( nonce++ );
+                  send( node, key, { make_action( s.act, user, user, n ) }, n );
+               };
+               if( s.each_user ) for( const auto& u : users ) run( u );
+               else run( users[0] );
+            }
+         }
+
+         void run( std::vector<step_result>& results ) {
+            for( uint32_t tps : steps ) {
+               step_result r = run_step( tps );
+               std::fprintf( stderr, "step %5u tps: achieved %8.1f, %llu sent, %llu failed\n", tps, r.achieved_tps,
+                             (unsigned long long)r.sent, (unsigned long long)r.failed );
+               bool saturated = r.achieved_tps < saturation * tps;
+               results.push_back( std::move(r) );
+               if( saturated ) break;
+            }
+         }
+
+         void report( const std::vector<step_result>& results, bool as_json ) const {
+            // the saturation point is the last step the node sustained
+            uint32_t sustained = 0;
+            for( const auto& r : results )
+               if( r.achieved_tps >= saturation * r.target_tps ) sustained = r.target_tps;
+
+            std::vector<std::vector<const sample*>> by_mix( mix.size() );
+            std::vector<std::map<std::string, uint64_t>> errors( mix.size() );
+            for( const auto& r : results )
+               for( const auto& s : r.samples ) {
+                  if( s.ok ) by_mix[s.mix].push_back( &s );
+                  else errors[s.mix][s.error]++;
+               }
+
+            json out = json::object();
+            json steps_json = json::array();
+            for( const auto& r : results ) {
+               json st = json::object();
+               st.set( "target_tps", json::number( uint64_t(r.target_tps) ) );
+               char buf[32];
+               std::snprintf( buf, sizeof(buf), "%.1f", r.achieved_tps );
+               st.set( "achieved_tps", json::number( std::string( buf ) ) );
+               st.set( "sent", json::number( r.sent ) );
+               st.set( "failed", json::number( r.failed ) );
+               steps_json.push_back( st );
+            }
+            out.set( "steps", steps_json );
+            out.set( "saturation_tps", json::number( uint64_t(sustained) ) );
+
+            if( !as_json ) {
+               std::printf( "%-10s %10s %8s %8s\n", "target", "achieved", "sent", "failed" );
+               for( const auto& r : results )
+                  std::printf( "%-10u %10.1f %8llu %8llu\n", r.target_tps, r.achieved_tps, (unsigned long long)r.sent, (unsigned long long)r.failed );
+               std::printf( "saturation point: %u tps\n\n", sustained );
+               std::printf( "%-12s %7s %9s %9s %9s %9s %9s %9s %10s %10s\n", "action", "ok",
+                            "cpu p50", "cpu p99", "net p50", "net p99", "ram p50", "ram p99", "lat p50", "lat p99" );
+            }
+
+            json actions = json::object();
+            for( size_t i = 0; i < mix.size(); ++i ) {
+               std::vector<uint64_t> cpu, net, ram, lat;
+               for( const sample* s : by_mix[i] ) {
+                  cpu.push_back( s->cpu_us );
+                  net.push_back( s->net_bytes );
+                  ram.push_back( uint64_t(std::max<int64_t>( s->ram_bytes, 0 )) );
+                  lat.push_back( s->latency_us );
+               }
+               json a = json::object();
+               a.set( "ok", json::number( uint64_t(by_mix[i].size()) ) );
+               for( auto [label, values] : { std::pair<const char*, const std::vector<uint64_t>*>{ "cpu_us", &cpu }, { "net_bytes", &net },
+                                             { "ram_bytes", &ram }, { "latency_us", &lat } } ) {
+                  json p = json::object();
+                  p.set( "p50", json::number( percentile( *values, 0.50 ) ) );
+                  p.set( "p99", json::number( percentile( *values, 0.99 ) ) );
+                  a.set( label, p );
+               }
+               json errs = json::object();
+               for( const auto& [msg, count] : errors[i] ) errs.set( msg, json::number( count ) );
+               a.set( "errors", errs );
+               actions.set( mix[i].name, a );
+
+               if( !as_json ) {
+                  std::printf( "%-12s %7zu %9llu %9llu %9llu %9llu %9llu %9llu %10llu %10llu\n", mix[i].name.c_str(), by_mix[i].size(),
+                               (unsigned long long)percentile( cpu, 0.5 ), (unsigned long long)percentile( cpu, 0.99 ),
+                               (unsigned long long)percentile( net, 0.5 ), (unsigned long long)percentile( net, 0.99 ),
+                               (unsigned long long)percentile( ram, 0.5 ), (unsigned long long)percentile( ram, 0.99 ),
+                               (unsigned long long)percentile( lat, 0.5 ), (unsigned long long)percentile( lat, 0.99 ) );
+                  for( const auto& [msg, count] : errors[i] ) std::printf( "    %6llu x %s\n", (unsigned long long)count, msg.c_str() );
+               }
+            }
+            out.set( "actions", actions );
+            if( as_json ) std::cout << out.dump() << "\n";
+         }
+
+      private:
+         std::string                   url;
+         std::string                   wif;
+         uint32_t                      connections = 8;
+         uint32_t                      step_seconds = 10;
+         double                        saturation = 0.9;
+         std::vector<uint32_t>         steps;
+
+         // TaPoS and chain id, refreshed from get_info and shared by the workers
+         std::mutex                    tapos_mutex;
+         std::string                   chain_id;
+         transaction_header            header;
+
+         void refresh( nodeos_client& node ) {
+            json info = node.get_info();
+            std::lock_guard<std::mutex> lock( tapos_mutex );
+            chain_id = info["chain_id"].as_string();
+            header.set_reference_block( info["last_irreversible_block_id"].as_string() );
+            header.expiration = uint32_t(parse_time_point( info["head_block_time"].as_string() ) / 1000000) + 120;
+         }
+
+         json send( nodeos_client& node, const private_key& key, const std::vector<chain::action>& actions, const std::string& nonce ) {
+            transaction_header h;
+            std::string id;
+            {
+               std::lock_guard<std::mutex> lock( tapos_mutex );
+               h = header;
+               id = chain_id;
+            }
+            auto packed = pack_transaction( h, { nonce_action( nonce ) }, actions );
+            auto sig = key.sign( signing_digest( id, packed ) );
+            return node.push_transaction( packed_transaction_json( packed, { signature_to_string( sig ) } ) );
+         }
+
+         void send_system( nodeos_client& node, const private_key& key, const std::string& action_name, const json& data, bool tolerate_existing ) {
+            chain::action a;
+            a.account = string_to_name( "eosio" );
+            a.name = string_to_name( action_name );
+            a.authorization.push_back( { a.account, string_to_name( "active" ) } );
+            a.data = system_abi().json_to_bin( action_name, data );
+            try {
+               const json* target = data.find( "account" );
+               send( node, key, { a }, action_name + ":" + (target ? *target : data["name"]).as_string() );
+            } catch( const nodeos_error& e ) {
+               // re-running against the same chain: accounts exist, code is unchanged
+               std::string what = e.what();
+               if( tolerate_existing && (what.find( "already" ) != std::string::npos || what.find( "existing" ) != std::string::npos) ) return;
+               throw;
+            }
+         }
+
+         step_result run_step( uint32_t tps ) {
+            step_result result;
+            result.target_tps = tps;
+            const auto start = clock_type::now() + std::chrono::milliseconds( 200 );
+            const auto end = start + std::chrono::seconds( step_seconds );
+            const auto interval = std::chrono::nanoseconds( 1000000000ull / std::max<uint32_t>( tps, 1 ) );
+            std::atomic<uint64_t> next_slot{ 0 };
+            std::atomic<bool>     done{ false };
+            std::mutex            results_mutex;
+
+            std::thread tapos( [&] {
+               nodeos_client node( url );
+               while( !done ) {
+                  std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+                  try { refresh( node ); } catch( const std::exception& ) {}
+               }
+            } );
+
+            std::vector<std::thread> workers;
+            for( uint32_t w = 0; w < connections; ++w ) {
+               workers.emplace_back( [&, w] {
+                  nodeos_client node( url );
+                  private_key key( wif );
+                  std::mt19937_64 rng( (uint64_t(tps) << 32) ^ w );
+                  std::vector<sample> local;
+                  while( true ) {
+                     uint64_t slot = next_slot++;
+                     auto when = start + interval * slot;
+                     if( when >= end ) break;
+                     std::this_thread::sleep_until( when );
+
+                     uint32_t m = pick( uint32_t(rng() % total_weight) );
+                     size_t u = rng() % users.size(), o = (u + 1 + rng() % (users.size() - 1)) % users.size();
+                     std::string nonce = std::to_string( tps ) + "." + std::to_string( slot );
+
+                     sample s;
+                     s.mix = m;
+                     auto t0 = clock_type::now();
+                     try {
+                        json trace = send( node, key, build( m, users[u], users[o], nonce ), nonce );
+                        s.ok = true;
+                        const json& receipt = trace["receipt"];
+                        s.cpu_us = receipt["cpu_usage_us"].as_uint64();
+                        s.net_bytes = receipt["net_usage_words"].as_uint64() * 8;
+                        if( const json* traces = trace.find( "action_traces" ) )
+                           for( const auto& at : traces->items() )
+                              if( const json* deltas = at.find( "account_ram_deltas" ) )
+                                 for( const auto& d : deltas->items() ) s.ram_bytes += d["delta"].as_int64();
+                     } catch( const std::exception& e ) {
+                        s.error = e.what();
+                     }
+                     s.latency_us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>( clock_type::now() - t0 ).count());
+                     local.push_back( std::move(s) );
+                  }
+                  std::lock_guard<std::mutex> lock( results_mutex );
+                  for( auto& s : local ) result.samples.push_back( std::move(s) );
+               } );
+            }
+            for( auto& t : workers ) t.join();
+            auto finished = clock_type::now();
+            done = true;
+            tapos.join();
+
+            double seconds = std::chrono::duration<double>( finished - start ).count();
+            for( const auto& s : result.samples ) {
+               result.sent++;
+               if( !s.ok ) result.failed++;
+            }
+            result.achieved_tps = double(result.sent - result.failed) / std::max( seconds, double(step_seconds) );
+            return result;
+         }
+   };
+
+   int usage() {
+      std::cerr << "usage: loadgen [--dry-run] [--skip-bootstrap] [--json] CONFIG\n";
+      return 2;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   std::string config;
+   bool dry = false, skip_bootstrap = false, as_json = false;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( arg == "--dry-run" ) dry = true;
+      else if( arg == "--skip-bootstrap" ) skip_bootstrap = true;
+      else if( arg == "--json" ) as_json = true;
+      else if( arg[0] != '-' && config.empty() ) config = arg;
+      else return usage();
+   }
+   if( config.empty() ) return usage();
+
+   try {
+      generator gen( config );
+      if( dry ) return gen.dry_run();
+      if( !skip_bootstrap ) gen.bootstrap();
+      std::vector<step_result> results;
+      gen.run( results );
+      gen.report( results, as_json );
+   } catch( const std::exception& e ) {
+      std::cerr << "loadgen: " << e.what() << "\n";
+      return 2;
+   }
+   return 0;
+}
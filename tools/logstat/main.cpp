@@ -0,0 +1,359 @@
+// logstat: streams nodeos logs and summarises, per time interval, transactions per
+// block, block timing drift, missed slots and warning/error rates. Files are mapped
+// and scanned in place; the per-line path does no allocation.
+
+#include "json.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <string_view>
+#include <vector>
+
+using namespace hagglex;
+
+namespace {
+
+   constexpr int      trx_buckets = 14;      // 0, 1, 2-3, 4-7, ... 4096+
+   constexpr int64_t  block_interval_ms = 500;
+
+   enum level { level_debug, level_info, level_warn, level_error, level_other };
+
+   struct interval_stats {
+      int64_t  start_ms = 0;
+      uint64_t lines = 0;
+      uint64_t by_level[5] = {};
+      uint64_t blocks = 0;
+      uint64_t trxs = 0;
+      uint64_t max_trxs = 0;
+      uint64_t trx_histogram[trx_buckets] = {};
+      int64_t  drift_sum_ms = 0;
+      int64_t  drift_max_ms = 0;
+      uint64_t late_blocks = 0;          // drift above the threshold
+      uint64_t missed_slots = 0;
+      uint64_t deadline_exceptions = 0;
+      int64_t  latency_sum_ms = 0;       // "Received block" latency, for relaying nodes
+      uint64_t latency_samples = 0;
+   };
+
+   int trx_bucket( uint64_t n ) {
+      if( n == 0 ) return 0;
+      int b = 1 + (63 - __builtin_clzll( n ));
+      return std::min( b, trx_buckets - 1 );
+   }
+
+   std::string bucket_label( int b ) {
+      if( b == 0 ) return "0";
+      if( b == 1 ) return "1";
+      uint64_t lo = 1ull << (b - 1);
+      if( b == trx_buckets - 1 ) return std::to_string( lo ) + "+";
+      return std::to_string( lo ) + "-" + std::to_string( (lo << 1) - 1 );
+   }
+
+   int64_t days_from_civil( int64_t y, unsigned m, unsigned d ) {
+      y -= m <= 2;
+      const int64_t era = (y >= 0 ? y : y - 399) / 400;
+      const unsigned yoe = unsigned(y - era * 400);
+      const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+      const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+      return era * 146097 + int64_t(doe) - 719468;
+   }
+
+   bool digits( std::string_view s, size_t pos, size_t n, int& out ) {
+      if( pos + n > s.size() ) return false;
+      out = 0;
+      for( size_t i = pos; i < pos + n; ++i ) {
+         if( s[i] < '0' || s[i] > '9' ) return false;
+         out = out * 10 + (s[i] - '0');
+      }
+      return true;
+   }
+
+   // "2019-01-29T05:03:58.501" -> milliseconds since the epoch
+   bool parse_time_ms( std::string_view s, int64_t& out ) {
+      int y, mo, d, h, mi, sec, ms = 0;
+      if( !digits( s, 0, 4, y ) || !digits( s, 5, 2, mo ) || !digits( s, 8, 2, d ) ||
+          !digits( s, 11, 2, h ) || !digits( s, 14, 2, mi ) || !digits( s, 17, 2, sec ) ) return false;
+      if( s.size() >= 23 && s[19] == '.' ) digits( s, 20, 3, ms );
+      out = ((days_from_civil( y, unsigned(mo), unsigned(d) ) * 24 + h) * 60 + mi) * 60000ll + sec * 1000ll + ms;
+      return true;
+   }
+
+   std::string format_time_ms( int64_t ms ) {
+      time_t t = time_t(ms / 1000);
+      tm tm_utc;
+      gmtime_r( &t, &tm_utc );
+      char buf[32];
+      std::strftime( buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm_utc );
+      return buf;
+   }
+
+   std::string_view next_token( std::string_view& s ) {
+      size_t b = s.find_first_not_of( ' ' );
+      if( b == std::string_view::npos ) { s = {}; return {}; }
+      size_t e = s.find( ' ', b );
+      std::string_view tok = s.substr( b, e == std::string_view::npos ? std::string_view::npos : e - b );
+      s = e == std::string_view::npos ? std::string_view{} : s.substr( e );
+      return tok;
+   }
+
+   // first unsigned integer after `key` in s
+   bool field_after( std::string_view s, std::string_view key, uint64_t& out ) {
+      size_t p = s.find( key );
+      if( p == std::string_view::npos ) return false;
+      p += key.size();
+      if( p >= s.size() || s[p] < '0' || s[p] > '9' ) return false;
+      out = 0;
+      while( p < s.size() && s[p] >= '0' && s[p] <= '9' ) out = out * 10 + uint64_t(s[p++] - '0');
+      return true;
+   }
+
+   class analyzer {
+      public:
+         int64_t interval_ms = 60000;
+         int64_t late_threshold_ms = 100;
+
+         std::vector<interval_stats>     intervals;
+         std::map<std::string, uint64_t> exceptions;      // "3080006 deadline_exception" -> count
+         uint64_t                        continuation_lines = 0;
+
+         void line( std::string_view l ) {
+            if( !l.empty() && l.back() == '\r' ) l.remove_suffix( 1 );
+            std::string_view rest = l;
+            std::string_view lvl = next_token( rest );
+            level lv = lvl == "info" ? level_info : lvl == "warn" ? level_warn : lvl == "error" ? level_error :
+                       lvl == "debug" ? level_debug : level_other;
+            int64_t t;
+            if( lv == level_other || !parse_time_ms( next_token( rest ), t ) ) {
+               ++continuation_lines;      // details and console output of the previous entry
+               return;
+            }
+            interval_stats& iv = at( t );
+            iv.lines++;
+            iv.by_level[lv]++;
+
+            size_t bracket = rest.find( "] " );
+            std::string_view msg = bracket == std::string_view::npos ? std::string_view{} : rest.substr( bracket + 2 );
+
+            if( msg.compare( 0, 16, "Produced block 0" ) == 0 || msg.compare( 0, 14, "Received block" ) == 0 )
+               block( iv, t, msg );
+            else if( msg.compare( 0, 19, "Exception Details: " ) == 0 )
+               exception( iv, msg.substr( 19 ) );
+         }
+
+         void finish_json( std::ostream& out ) const {
+            json root = json::object();
+            json list = json::array();
+            for( const auto& iv : intervals ) {
+               if( !iv.lines ) continue;
+               json j = json::object();
+               j.set( "start", format_time_ms( iv.start_ms ) );
+               j.set( "lines", json::number( iv.lines ) );
+               j.set( "warnings", json::number( iv.by_level[level_warn] ) );
+               j.set( "errors", json::number( iv.by_level[level_error] ) );
+               j.set( "blocks", json::number( iv.blocks ) );
+               j.set( "trxs", json::number( iv.trxs ) );
+               j.set( "max_trxs_per_block", json::number( iv.max_trxs ) );
+               json hist = json::object();
+               for( int b = 0; b < trx_buckets; ++b )
+                  if( iv.trx_histogram[b] ) hist.set( bucket_label( b ), json::number( iv.trx_histogram[b] ) );
+               j.set( "trxs_per_block", hist );
+               j.set( "avg_drift_ms", json::number( iv.blocks ? iv.drift_sum_ms / int64_t(iv.blocks) : int64_t(0) ) );
+               j.set( "max_drift_ms", json::number( iv.drift_max_ms ) );
+               j.set( "late_blocks", json::number( iv.late_blocks ) );
+               j.set( "missed_slots", json::number( iv.missed_slots ) );
+               j.set( "deadline_exceptions", json::number( iv.deadline_exceptions ) );
+               if( iv.latency_samples ) j.set( "avg_latency_ms", json::number( iv.latency_sum_ms / int64_t(iv.latency_samples) ) );
+               list.push_back( j );
+            }
+            root.set( "intervals", list );
+            json ex = json::object();
+            for( const auto& [k, v] : exceptions ) ex.set( k, json::number( v ) );
+            root.set( "exceptions", ex );
+            out << root.dump() << "\n";
+         }
+
+         void finish_text() const {
+            interval_stats total;
+            std::printf( "%-20s %7s %6s %6s %7s %7s %6s %9s %9s %5s %6s\n", "interval", "lines", "warn", "error",
+                         "blocks", "trxs", "max/b", "avg drift", "max drift", "late", "missed" );
+            for( const auto& iv : intervals ) {
+               if( !iv.lines ) continue;
+               std::printf( "%-20s %7llu %6llu %6llu %7llu %7llu %6llu %9lld %9lld %5llu %6llu\n", format_time_ms( iv.start_ms ).c_str(),
+                            (unsigned long long)iv.lines, (unsigned long long)iv.by_level[level_warn], (unsigned long long)iv.by_level[level_error],
+                            (unsigned long long)iv.blocks, (unsigned long long)iv.trxs, (unsigned long long)iv.max_trxs,
+                            (long long)(iv.blocks ? iv.drift_sum_ms / int64_t(iv.blocks) : 0), (long long)iv.drift_max_ms,
+                            (unsigned long long)iv.late_blocks, (unsigned long long)iv.missed_slots );
+               add( total, iv );
+            }
+            std::printf( "\ntotal: %llu lines, %llu warnings, %llu errors, %llu blocks, %llu trxs, %llu missed slots, %llu late blocks\n",
+                         (unsigned long long)total.lines, (unsigned long long)total.by_level[level_warn],
+                         (unsigned long long)total.by_level[level_error], (unsigned long long)total.blocks,
+                         (unsigned long long)total.trxs, (unsigned long long)total.missed_slots, (unsigned long long)total.late_blocks );
+            std::printf( "trxs per block:" );
+            for( int b = 0; b < trx_buckets; ++b )
+               if( total.trx_histogram[b] ) std::printf( " %s:%llu", bucket_label( b ).c_str(), (unsigned long long)total.trx_histogram[b] );
+            std::printf( "\n" );
+            for( const auto& [k, v] : exceptions ) std::printf( "exception %s: %llu\n", k.c_str(), (unsigned long long)v );
+         }
+
+      private:
+         int64_t last_block_time = -1;
+
+         interval_stats& at( int64_t t ) {
+            int64_t start = t - ((t % interval_ms) + interval_ms) % interval_ms;
+            if( intervals.empty() || start > intervals.back().start_ms ) {
+               // empty intervals in between are kept so rates stay comparable over time
+               int64_t from = intervals.empty() ? start : intervals.back().start_ms + interval_ms;
+               for( int64_t s = from; s <= start; s += interval_ms ) {
+                  intervals.emplace_back();
+                  intervals.back().start_ms = s;
+               }
+               return intervals.back();
+            }
+            // timestamps going backwards (merged logs): find the right interval
+            for( auto it = intervals.rbegin(); it != intervals.rend(); ++it )
+               if( it->start_ms <= t ) return *it;
+            intervals.insert( intervals.begin(), interval_stats{} );
+            intervals.front().start_ms = start;
+            return intervals.front();
+         }
+
+         // "Produced block 0000000226b8f7a4... #2 @ 2019-01-29T05:03:58.500 signed by eosio [trxs: 0, lib: 0, confirmed: 0]"
+         void block( interval_stats& iv, int64_t logged, std::string_view msg ) {
+            size_t at_pos = msg.find( " @ " );
+            int64_t block_time;
+            if( at_pos == std::string_view::npos || !parse_time_ms( msg.substr( at_pos + 3 ), block_time ) ) return;
+            uint64_t trxs = 0;
+            field_after( msg, "[trxs: ", trxs );
+
+            iv.blocks++;
+            iv.trxs += trxs;
+            iv.max_trxs = std::max( iv.max_trxs, trxs );
+            iv.trx_histogram[trx_bucket( trxs )]++;
+
+            int64_t drift = logged - block_time;
+            iv.drift_sum_ms += drift;
+            iv.drift_max_ms = std::max( iv.drift_max_ms, drift );
+            if( drift > late_threshold_ms ) iv.late_blocks++;
+
+            if( last_block_time >= 0 && block_time > last_block_time + block_interval_ms )
+               iv.missed_slots += uint64_t((block_time - last_block_time) / block_interval_ms - 1);
+            last_block_time = block_time;
+
+            uint64_t latency;
+            if( field_after( msg, "latency: ", latency ) ) {
+               iv.latency_sum_ms += int64_t(latency);
+               iv.latency_samples++;
+            }
+         }
+
+         // "3080006 deadline_exception: Transaction took too long"
+         void exception( interval_stats& iv, std::string_view details ) {
+            size_t colon = details.find( ':' );
+            std::string_view key = details.substr( 0, colon );
+            if( key.find( "deadline_exception" ) != std::string_view::npos ) iv.deadline_exceptions++;
+            auto it = exceptions.find( std::string( key ) );      // rare: allocation is fine here
+            if( it == exceptions.end() ) exceptions.emplace( std::string( key ), 1 );
+            else it->second++;
+         }
+
+         static void add( interval_stats& into, const interval_stats& iv ) {
+            into.lines += iv.lines;
+            for( int i = 0; i < 5; ++i ) into.by_level[i] += iv.by_level[i];
+            into.blocks += iv.blocks;
+            into.trxs += iv.trxs;
+            for( int b = 0; b < trx_buckets; ++b ) into.trx_histogram[b] += iv.trx_histogram[b];
+            into.late_blocks += iv.late_blocks;
+            into.missed_slots += iv.missed_slots;
+         }
+   };
+
+   void scan( const char* data, size_t size, analyzer& a ) {
+      const char* p = data;
+      const char* end = data + size;
+      while( p < end ) {
+         const char* nl = static_cast<const char*>( std::memchr( p, '\n', size_t(end - p) ) );
+         const char* e = nl ? nl : end;
+         a.line( std::string_view( p, size_t(e - p) ) );
+         p = e + 1;
+      }
+   }
+
+   bool analyze_file( const char* path, analyzer& a ) {
+      int fd = std::strcmp( path, "-" ) == 0 ? 0 : ::open( path, O_RDONLY );
+      if( fd < 0 ) return false;
+      struct stat st;
+      if( fd != 0 && fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) ) {
+         if( st.st_size == 0 ) { ::close( fd ); return true; }
+         void* m = mmap( nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+         if( m != MAP_FAILED ) {
+            madvise( m, size_t(st.st_size), MADV_SEQUENTIAL );
+            scan( static_cast<const char*>( m ), size_t(st.st_size), a );
+            munmap( m, size_t(st.st_size) );
+            ::close( fd );
+            return true;
+         }
+      }
+      // pipes and stdin: a fixed buffer, carrying the partial last line over
+      std::vector<char> buf( 1 << 20 );
+      size_t have = 0;
+      while( true ) {
+         ssize_t n = ::read( fd, buf.data() + have, buf.size() - have );
+         if( n <= 0 ) break;
+         have += size_t(n);
+         const char* last_nl = nullptr;
+         for( size_t i = have; i-- > 0; ) if( buf[i] == '\n' ) { last_nl = buf.data() + i; break; }
+         if( !last_nl ) {
+            if( have == buf.size() ) buf.resize( buf.size() * 2 );     // a single huge line
+            continue;
+         }
+         size_t used = size_t(last_nl - buf.data()) + 1;
+         scan( buf.data(), used - 1, a );
+         std::memmove( buf.data(), buf.data() + used, have - used );
+         have -= used;
+      }
+      if( have ) scan( buf.data(), have, a );
+      if( fd != 0 ) ::close( fd );
+      return true;
+   }
+
+   int usage() {
+      std::cerr << "usage: logstat [--interval SECONDS] [--late MS] [--json] LOG... (- for stdin)\n";
+      return 2;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   analyzer a;
+   bool as_json = false;
+   std::vector<const char*> files;
+   for( int i = 1; i < argc; ++i ) {
+      std::string_view arg = argv[i];
+      if( arg == "--interval" && i + 1 < argc ) a.interval_ms = std::max( 1l, std::atol( argv[++i] ) ) * 1000;
+      else if( arg == "--late" && i + 1 < argc ) a.late_threshold_ms = std::atol( argv[++i] );
+      else if( arg == "--json" ) as_json = true;
+      else if( arg == "-" || arg[0] != '-' ) files.push_back( argv[i] );
+      else return usage();
+   }
+   if( files.empty() ) return usage();
+
+   for( const char* f : files ) {
+      if( !analyze_file( f, a ) ) {
+         std::cerr << "logstat: cannot open " << f << "\n";
+         return 2;
+      }
+   }
+   if( as_json ) a.finish_json( std::cout );
+   else a.finish_text();
+   return 0;
+}
@@ -0,0 +1,378 @@
+// paypack: packs a treasury payout file into hagglextoken::transfer transactions, each
+// filled up to a CPU and NET budget from per-action cost estimates, serializes them with
+// the token ABI and signs them on all cores with a local key. The output is one packed
+// transaction per line, ready for push_transaction or send_transaction; nothing is sent.
+
+#include "nodeos.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace hagglex;
+
+namespace {
+
+   struct payout_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   // billed CPU in microseconds: once per transaction, and per transfer action
+   struct cost_model {
+      uint64_t transaction_cpu_us = 0;
+      uint64_t transfer_cpu_us = 0;
+   };
+
+   struct payout {
+      size_t            line = 0;
+      std::string       to;
+      std::string       quantity;
+      std::string       memo;
+      std::vector<char> action;       // the packed transfer action
+   };
+
+   struct options {
+      std::string                  payouts_path;
+      std::string                  costs_path;
+      std::string                  key_path;
+      std::string                  out_path;
+      std::string                  manifest_path;
+      std::string                  contract;
+      std::string                  abi_path;
+      std::string                  from;
+      std::string                  permission = "active";
+      std::string                  chain_id;
+      std::string                  ref_block;
+      std::string                  expiration;
+      std::string                  symbol;         // for bare amounts, e.g. "4,HAG"
+      uint64_t                     cpu_budget_us = 20000;
+      uint64_t                     net_budget_bytes = 65536;
+      unsigned                     threads = std::max( 1u, std::thread::hardware_concurrency() );
+   };
+
+   // nodeos bills NET for the packed transaction plus its signatures and context-free
+   // data (here one signature, none), and a fixed overhead, in 8-byte words
+   constexpr uint64_t signatures_bytes = 1 + 66;
+   constexpr uint64_t context_free_data_bytes = 1;
+   constexpr uint64_t fixed_net_overhead = 16;
+
+   uint64_t billed_net( uint64_t packed_trx_bytes ) {
+      const uint64_t bytes = packed_trx_bytes + signatures_bytes + context_free_data_bytes + fixed_net_overhead;
+      return (bytes + 7) / 8 * 8;
+   }
+
+   size_t varuint_size( uint64_t v ) {
+      size_t n = 1;
+      while( v >>= 7 ) ++n;
+      return n;
+   }
+
+   int usage() {
+      std::cerr << "usage: paypack --payouts CSV --costs JSON --from ACCOUNT[@PERMISSION] --key-file FILE\n"
+                   "               --contract ACCOUNT=ABI --chain-id HEX --ref-block BLOCK_ID --expiration TIME --out FILE\n"
+                   "               [--symbol P,SYM] [--cpu-budget US] [--net-budget BYTES]\n"
+                   "               [--manifest CSV] [--threads N]\n";
+      return 2;
+   }
+
+   bool is_name( const std::string& s ) {
+      try {
+         return !s.empty() && name_to_string( string_to_name( s ) ) == s;
+      } catch( const std::exception& ) {
+         return false;
+      }
+   }
+
+   // "12.5" as an asset of `symbol`, padded to its precision
+   asset bare_amount( std::string amount, uint64_t symbol ) {
+      const uint8_t precision = uint8_t(symbol & 0xff);
+      size_t dot = amount.find( '.' );
+      if( dot == std::string::npos ) {
+         dot = amount.size();
+         if( precision ) amount += '.';
+      }
+      const size_t decimals = amount.size() - dot - (dot < amount.size() ? 1 : 0);
+      if( decimals > precision ) throw format_error( "amount " + amount + " has more than " + std::to_string( precision ) + " decimals" );
+      amount.append( precision - decimals, '0' );
+      return string_to_asset( amount + " " + symbol_code_to_string( symbol >> 8 ) );
+   }
+
+   cost_model load_costs( const std::string& path ) {
+      const json def = json::parse( read_file( path ) );
+      cost_model costs;
+      const json* trx = def.find( "transaction" );
+      const json* actions = def.find( "actions" );
+      const json* transfer = actions ? actions->find( "transfer" ) : nullptr;
+      if( !trx || !trx->find( "cpu_us" ) || !transfer || !transfer->find( "cpu_us" ) )
+         throw payout_error( path + ": needs transaction.cpu_us and actions.transfer.cpu_us" );
+      costs.transaction_cpu_us = (*trx)["cpu_us"].as_uint64();
+      costs.transfer_cpu_us = (*transfer)["cpu_us"].as_uint64();
+      if( costs.transfer_cpu_us == 0 ) throw payout_error( path + ": transfer cost must be positive" );
+      return costs;
+   }
+
+   // "account,quantity[,memo]" per line; a first line starting with "account," is a header.
+   // The memo is the rest of the line, commas included.
+   std::vector<payout> load_payouts( const options& opts, const abi& def, const chain::permission_level& auth ) {
+      std::ifstream in( opts.payouts_path );
+      if( !in ) throw payout_error( "cannot read " + opts.payouts_path );
+      const uint64_t bare_symbol = opts.symbol.empty() ? 0 : string_to_symbol( opts.symbol );
+
+      std::vector<payout> out;
+      std::string text;
+      for( size_t line = 1; std::getline( in, text ); ++line ) {
+         if( !text.empty() && text.back() == '\r' ) text.pop_back();
+         if( text.empty() || (line == 1 && text.rfind( "account,", 0 ) == 0) ) continue;
+         auto fail = [&]( const std::string& why ) {
+            return payout_error( opts.payouts_path + ":" + std::to_string( line ) + ": " + why );
+         };
+
+         payout p;
+         p.line = line;
+         const size_t c1 = text.find( ',' );
+         if( c1 == std::string::npos ) throw fail( "expected account,quantity[,memo]" );
+         const size_t c2 = text.find( ',', c1 + 1 );
+         p.to = text.substr( 0, c1 );
+         std::string quantity = text.substr( c1 + 1, c2 == std::string::npos ? std::string::npos : c2 - c1 - 1 );
+         if( c2 != std::string::npos ) p.memo = text.substr( c2 + 1 );
+
+         if( !is_name( p.to ) ) throw fail( "invalid account name " + p.to );
+         if( p.to == opts.from ) throw fail( "cannot transfer to self" );
+         if( p.memo.size() > 256 ) throw fail( "memo has more than 256 bytes" );
+         asset a;
+         try {
+            if( quantity.find( ' ' ) == std::string::npos ) {
+               if( !bare_symbol ) throw fail( "amount without a symbol; pass --symbol" );
+               a = bare_amount( quantity, bare_symbol );
+            }
+            else a = string_to_asset( quantity );
+         } catch( const payout_error& ) {
+            throw;
+         } catch( const std::exception& e ) {
+            throw fail( e.what() );
+         }
+         if( a.amount <= 0 ) throw fail( "must transfer positive quantity" );
+         p.quantity = asset_to_string( a );
+
+         json data = json::object();
+         data.set( "from", opts.from );
+         data.set( "to", p.to );
+         data.set( "quantity", p.quantity );
+         data.set( "memo", p.memo );
+         chain::action act;
+         act.account = string_to_name( opts.contract );
+         act.name = string_to_name( "transfer" );
+         act.authorization = { auth };
+         act.data = def.json_to_bin( "transfer", data );
+         p.action = chain::pack_action( act );
+         out.push_back( std::move(p) );
+      }
+      return out;
+   }
+
+   struct bin {
+      std::vector<size_t> payouts;       // indexes into the payout list
+      uint64_t            cpu_us = 0;
+      uint64_t            action_bytes = 0;
+   };
+
+   // first-fit decreasing: the largest actions first, each into the first transaction
+   // with room left in both budgets. Transfers cost the same CPU but differ in NET (the
+   // memo), so this fills transactions to whichever budget binds first.
+   std::vector<bin> pack( const std::vector<payout>& payouts, const cost_model& costs, const options& opts,
+                          size_t header_bytes ) {
+      std::vector<size_t> order( payouts.size() );
+      for( size_t i = 0; i < order.size(); ++i ) order[i] = i;
+      std::stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b ) {
+         return payouts[a].action.size() > payouts[b].action.size();
+      });
+
+      auto net_with = [&]( const bin& b, size_t extra_bytes ) {
+         // header, action count, actions, and the empty extension list
+         return billed_net( header_bytes + varuint_size( b.payouts.size() + 1 ) + b.action_bytes + extra_bytes + 1 );
+      };
+
+      std::vector<bin> bins;
+      size_t first_open = 0;     // bins before it cannot take even the smallest action
+      const size_t smallest = payouts.empty() ? 0 : payouts[order.back()].action.size();
+      for( size_t i : order ) {
+         const size_t bytes = payouts[i].action.size();
+         bin* target = nullptr;
+         for( size_t b = first_open; b < bins.size() && !target; ++b ) {
+            if( bins[b].cpu_us + costs.transfer_cpu_us <= opts.cpu_budget_us && net_with( bins[b], bytes ) <= opts.net_budget_bytes )
+               target = &bins[b];
+         }
+         if( !target ) {
+            bins.emplace_back();
+            target = &bins.back();
+            target->cpu_us = costs.transaction_cpu_us;
+            if( target->cpu_us + costs.transfer_cpu_us > opts.cpu_budget_us || net_with( *target, bytes ) > opts.net_budget_bytes )
+               throw payout_error( "payout on line " + std::to_string( payouts[i].line ) + " does not fit an empty transaction" );
+         }
+         target->payouts.push_back( i );
+         target->cpu_us += costs.transfer_cpu_us;
+         target->action_bytes += bytes;
+         while( first_open < bins.size() &&
+                ( bins[first_open].cpu_us + costs.transfer_cpu_us > opts.cpu_budget_us ||
+                  net_with( bins[first_open], smallest ) > opts.net_budget_bytes ) )
+            ++first_open;
+      }
+      // payout file order inside each transaction, for whoever reconciles them
+      for( auto& b : bins ) std::sort( b.payouts.begin(), b.payouts.end() );
+      return bins;
+   }
+
+   std::vector<char> pack_bin( const transaction_header& header, const std::vector<payout>& payouts, const bin& b ) {
+      // pack_transaction takes actions, the payouts hold them packed already
+      bin_writer w;
+      w.raw( header.expiration );
+      w.raw( header.ref_block_num );
+      w.raw( header.ref_block_prefix );
+      w.varuint32( header.max_net_usage_words );
+      w.raw( header.max_cpu_usage_ms );
+      w.varuint32( 0 );                      // delay_sec
+      w.varuint32( 0 );                      // context_free_actions
+      w.varuint32( b.payouts.size() );
+      for( size_t i : b.payouts ) w.bytes( payouts[i].action.data(), payouts[i].action.size() );
+      w.varuint32( 0 );                      // transaction_extensions
+      return w.data;
+   }
+
+   int run( const options& opts ) {
+      const cost_model costs = load_costs( opts.costs_path );
+      const abi def = abi::load( opts.abi_path );
+      if( def.action_type( string_to_name( "transfer" ) ).empty() )
+         throw payout_error( opts.abi_path + " has no transfer action" );
+
+      std::string wif = read_file( opts.key_path );
+      while( !wif.empty() && std::isspace( uint8_t(wif.back()) ) ) wif.pop_back();
+      const std::string public_key = private_key( wif ).public_key_string();
+
+      const chain::permission_level auth{ string_to_name( opts.from ), string_to_name( opts.permission ) };
+      const std::vector<payout> payouts = load_payouts( opts, def, auth );
+      if( payouts.empty() ) throw payout_error( "no payouts in " + opts.payouts_path );
+
+      transaction_header header;
+      header.expiration = parse_time_point_sec( opts.expiration );
+      header.set_reference_block( opts.ref_block );
+      const size_t header_bytes = pack_transaction( header, {}, {} ).size() - 2;    // less the empty action and extension lists
+
+      const std::vector<bin> bins = pack( payouts, costs, opts, header_bytes );
+
+      // serialize and sign on all cores; each thread has its own key object
+      std::vector<std::vector<char>> packed( bins.size() );
+      std::vector<std::string> signatures( bins.size() );
+      std::atomic<size_t> next{ 0 };
+      std::exception_ptr failure;
+      std::mutex failure_mutex;
+      auto sign = [&] {
+         try {
+            private_key key( wif );
+            for( size_t i = next++; i < bins.size(); i = next++ ) {
+               packed[i] = pack_bin( header, payouts, bins[i] );
+               signatures[i] = signature_to_string( key.sign( signing_digest( opts.chain_id, packed[i] ) ) );
+            }
+         } catch( ... ) {
+            std::lock_guard<std::mutex> lock( failure_mutex );
+            if( !failure ) failure = std::current_exception();
+         }
+      };
+      std::vector<std::thread> workers;
+      for( unsigned t = 1; t < std::min<size_t>( opts.threads, bins.size() ); ++t ) workers.emplace_back( sign );
+      sign();
+      for( auto& t : workers ) t.join();
+      if( failure ) std::rethrow_exception( failure );
+
+      // identical transactions would share an id and nodeos would drop all but one
+      std::set<checksum256> ids;
+      std::vector<std::string> id_text( bins.size() );
+      for( size_t i = 0; i < bins.size(); ++i ) {
+         const checksum256 id = sha256( packed[i].data(), packed[i].size() );
+         if( !ids.insert( id ).second )
+            throw payout_error( "transactions " + std::to_string( i + 1 ) + " and an earlier one are identical; "
+                                "split or merge the duplicate payouts" );
+         id_text[i] = to_hex( id.data(), id.size() );
+      }
+
+      std::ofstream out( opts.out_path );
+      if( !out ) throw payout_error( "cannot write " + opts.out_path );
+      for( size_t i = 0; i < bins.size(); ++i ) out << packed_transaction_json( packed[i], { signatures[i] } ).dump() << "\n";
+      if( !opts.manifest_path.empty() ) {
+         std::ofstream manifest( opts.manifest_path );
+         if( !manifest ) throw payout_error( "cannot write " + opts.manifest_path );
+         manifest << "line,account,quantity,transaction\n";
+         for( size_t i = 0; i < bins.size(); ++i )
+            for( size_t p : bins[i].payouts )
+               manifest << payouts[p].line << ',' << payouts[p].to << ',' << payouts[p].quantity << ',' << id_text[i] << "\n";
+      }
+
+      uint64_t min_cpu = UINT64_MAX, max_cpu = 0, total_cpu = 0, min_net = UINT64_MAX, max_net = 0, total_net = 0;
+      for( size_t i = 0; i < bins.size(); ++i ) {
+         const uint64_t net = billed_net( packed[i].size() );
+         min_cpu = std::min( min_cpu, bins[i].cpu_us );
+         max_cpu = std::max( max_cpu, bins[i].cpu_us );
+         total_cpu += bins[i].cpu_us;
+         min_net = std::min( min_net, net );
+         max_net = std::max( max_net, net );
+         total_net += net;
+         if( net > opts.net_budget_bytes ) throw payout_error( "transaction " + std::to_string( i + 1 ) + " is over the NET budget" );
+      }
+      std::printf( "%zu transfers in %zu transactions, signed with %s\n", payouts.size(), bins.size(), public_key.c_str() );
+      std::printf( "cpu per transaction: %llu..%llu us (avg %llu, budget %llu)\n", (unsigned long long)min_cpu,
+                   (unsigned long long)max_cpu, (unsigned long long)(total_cpu / bins.size()), (unsigned long long)opts.cpu_budget_us );
+      std::printf( "net per transaction: %llu..%llu bytes (avg %llu, budget %llu)\n", (unsigned long long)min_net,
+                   (unsigned long long)max_net, (unsigned long long)(total_net / bins.size()), (unsigned long long)opts.net_budget_bytes );
+      return 0;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   options opts;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( i + 1 >= argc ) return usage();
+      std::string value = argv[++i];
+      if( arg == "--payouts" ) opts.payouts_path = value;
+      else if( arg == "--costs" ) opts.costs_path = value;
+      else if( arg == "--key-file" ) opts.key_path = value;
+      else if( arg == "--out" ) opts.out_path = value;
+      else if( arg == "--manifest" ) opts.manifest_path = value;
+      else if( arg == "--chain-id" ) opts.chain_id = value;
+      else if( arg == "--ref-block" ) opts.ref_block = value;
+      else if( arg == "--expiration" ) opts.expiration = value;
+      else if( arg == "--symbol" ) opts.symbol = value;
+      else if( arg == "--cpu-budget" ) opts.cpu_budget_us = std::strtoull( value.c_str(), nullptr, 10 );
+      else if( arg == "--net-budget" ) opts.net_budget_bytes = std::strtoull( value.c_str(), nullptr, 10 );
+      else if( arg == "--threads" ) opts.threads = unsigned(std::max( 1, std::atoi( value.c_str() ) ));
+      else if( arg == "--from" ) {
+         const size_t at = value.find( '@' );
+         opts.from = value.substr( 0, at );
+         if( at != std::string::npos ) opts.permission = value.substr( at + 1 );
+      }
+      else if( arg == "--contract" ) {
+         const size_t eq = value.find( '=' );
+         if( eq == std::string::npos ) return usage();
+         opts.contract = value.substr( 0, eq );
+         opts.abi_path = value.substr( eq + 1 );
+      }
+      else return usage();
+   }
+   if( opts.payouts_path.empty() || opts.costs_path.empty() || opts.key_path.empty() || opts.out_path.empty() ||
+       opts.chain_id.empty() || opts.ref_block.empty() || opts.expiration.empty() || opts.abi_path.empty() ||
+       !is_name( opts.from ) || !is_name( opts.permission ) || !is_name( opts.contract ) )
+      return usage();
+
+   try {
+      return run( opts );
+   } catch( const std::exception& e ) {
+      std::cerr << "paypack: " << e.what() << "\n";
+      return 1;
+   }
+}
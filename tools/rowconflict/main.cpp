@@ -0,0 +1,335 @@
+// rowconflict: runs a recorded action script or a generated loadgen mix through the
+// compiled contracts on the in-memory chain, takes every transaction's read and write
+// set at (contract, table, scope, primary key) granularity from the chain's access
+// records and builds the conflict graph of each block. It reports the parallelism a
+// node running non-conflicting transactions side by side could reach, and the rows
+// whose contention holds it back.
+
+#include "script.hpp"
+#include "workload.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+
+using namespace hagglex;
+
+namespace {
+
+   struct options {
+      std::string script;
+      std::string mix_path;
+      uint64_t    transactions = 1000;
+      uint64_t    block = 100;         // transactions per block; `block` lines also end one
+      uint64_t    seed = 1;
+      size_t      top = 10;
+      std::string time = "2021-10-14T12:00:00";
+      bool        as_json = false;
+      std::map<std::string, std::string> wasm_overrides;   // account -> wasm deployed instead
+   };
+
+   // a row, or with key_set the set of keys a table holds: scanning reads it, inserting
+   // or removing a row writes it
+   struct row_key {
+      chain::table_id table;
+      uint64_t        primary = 0;
+      bool            key_set = false;
+
+      bool operator<( const row_key& o ) const {
+         return std::tie( table, primary, key_set ) < std::tie( o.table, o.primary, o.key_set );
+      }
+      bool operator==( const row_key& o ) const { return !(*this < o) && !(o < *this); }
+   };
+
+   // what one transaction touched, every action, notification and inline action together
+   struct transaction {
+      std::set<row_key> reads;
+      std::set<row_key> writes;
+   };
+
+   using block = std::vector<transaction>;
+
+   transaction collect( const std::vector<chain::action_trace>& traces ) {
+      transaction tx;
+      for( const auto& t : traces )
+         for( const auto& a : t.accesses ) {
+            switch( a.kind ) {
+               case chain::access_kind::read:       tx.reads.insert( { a.table, a.primary, false } ); break;
+               case chain::access_kind::write:      tx.writes.insert( { a.table, a.primary, false } ); break;
+               case chain::access_kind::scan:       tx.reads.insert( { a.table, 0, true } ); break;
+               case chain::access_kind::membership: tx.writes.insert( { a.table, 0, true } ); break;
+            }
+         }
+      // a row the transaction writes is not also listed as read
+      for( const auto& w : tx.writes ) if( !w.key_set ) tx.reads.erase( w );
+      return tx;
+   }
+
+   // longest chain of conflicting transactions in block order, skipping the `ignored`
+   // rows: a read waits for earlier writes of its row, a write for earlier reads and
+   // writes, and a key set change only for earlier scans (two inserts into a table do not
+   // conflict)
+   uint64_t critical_path( const block& b, const std::set<row_key>& ignored ) {
+      struct depths { uint64_t read = 0, write = 0; };
+      std::map<row_key, depths> rows;
+      uint64_t longest = 0;
+      for( const auto& tx : b ) {
+         uint64_t d = 0;
+         for( const auto& r : tx.reads ) {
+            if( ignored.count( r ) ) continue;
+            auto it = rows.find( r );
+            if( it != rows.end() ) d = std::max( d, it->second.write );
+         }
+         for( const auto& w : tx.writes ) {
+            if( ignored.count( w ) ) continue;
+            auto it = rows.find( w );
+            if( it != rows.end() ) d = std::max( { d, it->second.read, w.key_set ? 0 : it->second.write } );
+         }
+         ++d;
+         for( const auto& r : tx.reads ) rows[r].read = std::max( rows[r].read, d );
+         for( const auto& w : tx.writes ) rows[w].write = std::max( rows[w].write, d );
+         longest = std::max( longest, d );
+      }
+      return longest;
+   }
+
+   struct contention {
+      uint64_t readers = 0;
+      uint64_t writers = 0;
+      uint64_t pairs = 0;        // transaction pairs within a block that conflict on the row
+      double   without = 0;      // parallelism if the row did not conflict
+      double   cumulative = 0;   // ... if neither it nor any row ranked above it did
+   };
+
+   std::map<row_key, contention> contended_rows( const std::vector<block>& blocks ) {
+      std::map<row_key, contention> out;
+      for( const auto& b : blocks ) {
+         struct users { uint64_t readers = 0, writers = 0, both = 0; };
+         std::map<row_key, users> rows;
+         for( const auto& tx : b ) {
+            for( const auto& r : tx.reads ) rows[r].readers++;
+            for( const auto& w : tx.writes ) {
+               rows[w].writers++;
+               if( w.key_set && tx.reads.count( w ) ) rows[w].both++;
+            }
+         }
+         for( const auto& [key, u] : rows ) {
+            contention& c = out[key];
+            c.readers += u.readers;
+            c.writers += u.writers;
+            if( key.key_set ) {
+               // scanners against key changers, not counting a transaction against itself
+               c.pairs += u.readers * u.writers - u.both;
+            } else {
+               // every pair but two readers; readers and writers of a row are disjoint
+               const uint64_t all = u.readers + u.writers;
+               c.pairs += all * (all - 1) / 2 - u.readers * (u.readers ? u.readers - 1 : 0) / 2;
+            }
+         }
+      }
+      return out;
+   }
+
+   std::string describe_table( uint64_t table ) {
+      // secondary indexes carry the index number in the low 4 bits of the name
+      if( table & 0xf ) return name_to_string( table & ~uint64_t(0xf) ) + "#" + std::to_string( table & 0xf );
+      return name_to_string( table );
+   }
+
+   // symbol codes (two or more capitals) as symbols, other small numbers as numbers,
+   // anything else as a name
+   std::string describe_key( uint64_t v ) {
+      std::string code;
+      for( uint64_t x = v; x; x >>= 8 ) {
+         const char c = char(x & 0xff);
+         if( c < 'A' || c > 'Z' || code.size() == 7 ) { code.clear(); break; }
+         code.push_back( c );
+      }
+      if( code.size() >= 2 ) return code;
+      if( v < (uint64_t(1) << 32) ) return std::to_string( v );
+      return name_to_string( v );
+   }
+
+   class analyzer {
+      public:
+         std::vector<block>                  blocks { 1 };
+         uint64_t                            transactions = 0;
+         std::map<std::string, uint64_t>     failures;       // by message
+         uint64_t                            block_size = 0;
+
+         void add( const std::vector<chain::action_trace>& traces ) {
+            if( block_size && blocks.back().size() == block_size ) end_block();
+            blocks.back().push_back( collect( traces ) );
+            ++transactions;
+         }
+
+         void end_block() {
+            if( !blocks.back().empty() ) blocks.emplace_back();
+         }
+   };
+
+   // deploys the mix's contracts and runs its setup, then pushes `count` transactions
+   // drawn from the mix; setup transactions are not analyzed
+   void run_mix( const options& opts, analyzer& an ) {
+      workload w( json::parse( read_file( opts.mix_path ) ), directory_of( opts.mix_path ), "rowconflict" );
+      chain::controller chain;
+      chain.set_time( parse_time_point( opts.time ) );
+      for( const auto& c : w.contracts ) {
+         auto o = opts.wasm_overrides.find( c.account );
+         chain.set_code( string_to_name( c.account ), o == opts.wasm_overrides.end() ? c.wasm : o->second );
+      }
+      for( const auto& a : w.accounts ) chain.create_account( string_to_name( a ) );
+      for( const auto& u : w.users ) chain.create_account( string_to_name( u ) );
+
+      uint64_t nonce = 0;
+      for( const auto& s : w.setup ) {
+         auto run = [&]( const std::string& user ) {
+            const std::string n = "setup" + std::to_string( nonce++ );
+            try {
+               chain.push_action( w.make_action( s.act, user, user, n ) );
+            } catch( const chain::chain_error& e ) {
+               throw config_error( "setup " + s.act.account + "::" + s.act.name + " failed: " + e.what() );
+            }
+         };
+         if( s.each_user ) for( const auto& u : w.users ) run( u );
+         else run( w.users[0] );
+      }
+
+      std::mt19937_64 rng( opts.seed );
+      for( uint64_t i = 0; i < opts.transactions; ++i ) {
+         if( i && opts.block && i % opts.block == 0 ) chain.set_time( chain.now() + 500000 );
+         const uint32_t m = w.pick( uint32_t(rng() % w.total_weight) );
+         const size_t u = rng() % w.users.size(), o = (u + 1 + rng() % (w.users.size() - 1)) % w.users.size();
+         try {
+            an.add( chain.push_transaction( w.build( m, w.users[u], w.users[o], "rc" + std::to_string( i ) ) ) );
+         } catch( const chain::chain_error& e ) {
+            an.failures[w.mix[m].name + ": " + e.what()]++;
+         }
+      }
+   }
+
+   int usage() {
+      std::cerr << "usage: rowconflict [--block N] [--top N] [--wasm ACCOUNT=PATH]... [--json] SCRIPT\n"
+                   "       rowconflict --mix CONFIG [--transactions N] [--seed N] [--time T] [--block N] [--top N]\n"
+                   "                   [--wasm ACCOUNT=PATH]... [--json]\n";
+      return 2;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   options opts;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( arg == "--mix" && i + 1 < argc ) opts.mix_path = argv[++i];
+      else if( arg == "--transactions" && i + 1 < argc ) opts.transactions = std::strtoull( argv[++i], nullptr, 10 );
+      else if( arg == "--block" && i + 1 < argc ) opts.block = std::strtoull( argv[++i], nullptr, 10 );
+      else if( arg == "--seed" && i + 1 < argc ) opts.seed = std::strtoull( argv[++i], nullptr, 10 );
+      else if( arg == "--top" && i + 1 < argc ) opts.top = size_t(std::strtoull( argv[++i], nullptr, 10 ));
+      else if( arg == "--time" && i + 1 < argc ) opts.time = argv[++i];
+      else if( arg == "--wasm" && i + 1 < argc ) {
+         std::string spec = argv[++i];
+         auto eq = spec.find( '=' );
+         if( eq == std::string::npos ) return usage();
+         opts.wasm_overrides[spec.substr( 0, eq )] = spec.substr( eq + 1 );
+      }
+      else if( arg == "--json" ) opts.as_json = true;
+      else if( arg[0] != '-' && opts.script.empty() ) opts.script = arg;
+      else return usage();
+   }
+   if( opts.script.empty() == opts.mix_path.empty() ) return usage();
+
+   analyzer an;
+   an.block_size = opts.block;
+   try {
+      if( !opts.mix_path.empty() ) {
+         run_mix( opts, an );
+      } else {
+         script_runner script;
+         script.wasm_overrides = opts.wasm_overrides;
+         script.on_transaction = [&]( const std::vector<chain::action_trace>& traces ) { an.add( traces ); };
+         script.on_block = [&] { an.end_block(); };
+         script.run( opts.script );
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << "rowconflict: " << e.what() << "\n";
+      return 2;
+   }
+   if( an.blocks.back().empty() ) an.blocks.pop_back();
+   if( an.transactions == 0 ) {
+      std::cerr << "rowconflict: no transaction succeeded\n";
+      return 2;
+   }
+
+   auto parallelism = [&]( const std::set<row_key>& ignored ) {
+      uint64_t path = 0;
+      for( const auto& b : an.blocks ) path += critical_path( b, ignored );
+      return std::make_pair( path, double(an.transactions) / double(path) );
+   };
+   const auto [path, overall] = parallelism( {} );
+
+   // rank by conflicting pairs, then measure what each of the top rows costs
+   auto rows = contended_rows( an.blocks );
+   std::vector<std::pair<row_key, contention>> hot;
+   for( const auto& [key, c] : rows ) if( c.pairs ) hot.push_back( { key, c } );
+   std::sort( hot.begin(), hot.end(), []( const auto& a, const auto& b ) {
+      return a.second.pairs != b.second.pairs ? a.second.pairs > b.second.pairs : a.first < b.first;
+   } );
+   if( hot.size() > opts.top ) hot.resize( opts.top );
+   std::set<row_key> above;
+   for( auto& [key, c] : hot ) {
+      c.without = parallelism( { key } ).second;
+      above.insert( key );
+      c.cumulative = parallelism( above ).second;
+   }
+
+   uint64_t failed = 0;
+   for( const auto& [msg, count] : an.failures ) failed += count;
+
+   auto key_text = []( const row_key& k ) { return k.key_set ? std::string( "(keys)" ) : describe_key( k.primary ); };
+   if( opts.as_json ) {
+      json out = json::object();
+      out.set( "transactions", json::number( an.transactions ) );
+      out.set( "blocks", json::number( uint64_t(an.blocks.size()) ) );
+      out.set( "failed", json::number( failed ) );
+      out.set( "critical_path", json::number( path ) );
+      char buf[32];
+      std::snprintf( buf, sizeof(buf), "%.2f", overall );
+      out.set( "parallelism", json::number( std::string( buf ) ) );
+      json list = json::array();
+      for( const auto& [key, c] : hot ) {
+         json r = json::object();
+         r.set( "contract", name_to_string( key.table.code ) );
+         r.set( "table", describe_table( key.table.table ) );
+         r.set( "scope", describe_key( key.table.scope ) );
+         r.set( "key", key_text( key ) );
+         r.set( "writers", json::number( c.writers ) );
+         r.set( "readers", json::number( c.readers ) );
+         r.set( "pairs", json::number( c.pairs ) );
+         std::snprintf( buf, sizeof(buf), "%.2f", c.without );
+         r.set( "parallelism_without", json::number( std::string( buf ) ) );
+         std::snprintf( buf, sizeof(buf), "%.2f", c.cumulative );
+         r.set( "parallelism_cumulative", json::number( std::string( buf ) ) );
+         list.push_back( r );
+      }
+      out.set( "rows", list );
+      std::cout << out.dump() << "\n";
+      return 0;
+   }
+
+   std::printf( "%llu transactions in %zu blocks, %llu failed\n", (unsigned long long)an.transactions, an.blocks.size(),
+                (unsigned long long)failed );
+   for( const auto& [msg, count] : an.failures ) std::printf( "    %6llu x %s\n", (unsigned long long)count, msg.c_str() );
+   std::printf( "parallelism %.2f: critical path of %llu transactions\n\n", overall, (unsigned long long)path );
+   std::printf( "%-14s %-14s %-14s %-14s %8s %8s %10s %8s %8s\n", "contract", "table", "scope", "key",
+                "writers", "readers", "pairs", "without", "cumul." );
+   for( const auto& [key, c] : hot )
+      std::printf( "%-14s %-14s %-14s %-14s %8llu %8llu %10llu %8.2f %8.2f\n", name_to_string( key.table.code ).c_str(),
+                   describe_table( key.table.table ).c_str(), describe_key( key.table.scope ).c_str(), key_text( key ).c_str(),
+                   (unsigned long long)c.writers, (unsigned long long)c.readers, (unsigned long long)c.pairs, c.without,
+                   c.cumulative );
+   return 0;
+}
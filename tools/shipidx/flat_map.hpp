@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash map with linear probing over one contiguous slot array, so a
+// lookup touches one or two cache lines instead of chasing node pointers. Erase uses
+// backward shifting, leaving no tombstones. Keys and values must be default
+// constructible; pointers returned by find are invalidated by inserts.
+
+namespace hagglex::shipidx {
+
+   inline uint64_t mix_hash( uint64_t x ) {
+      // splitmix64 finalizer: names and symbol codes have long runs of equal bits
+      x ^= x >> 30;
+      x *= 0xbf58476d1ce4e5b9ULL;
+      x ^= x >> 27;
+      x *= 0x94d049bb133111ebULL;
+      return x ^ (x >> 31);
+   }
+
+   template<typename Key>
+   struct flat_hash {
+      uint64_t operator()( const Key& k ) const { return mix_hash( uint64_t(k) ); }
+   };
+
+   template<typename Key, typename Value, typename Hash = flat_hash<Key>>
+   class flat_map {
+      public:
+         size_t size() const { return count; }
+         bool   empty() const { return count == 0; }
+
+         void clear() {
+            slots.clear();
+            used.clear();
+            count = 0;
+         }
+
+         void reserve( size_t n ) {
+            size_t want = 16;
+            while( want * 7 / 8 < n ) want *= 2;
+            if( want > slots.size() ) rehash( want );
+         }
+
+         Value* find( const Key& k ) {
+            if( slots.empty() ) return nullptr;
+            for( size_t i = index_of( k );; i = (i + 1) & mask() ) {
+               if( !used[i] ) return nullptr;
+               if( slots[i].first == k ) return &slots[i].second;
+            }
+         }
+         const Value* find( const Key& k ) const { return const_cast<flat_map*>(this)->find( k ); }
+
+         Value& operator[]( const Key& k ) {
+            if( (count + 1) * 8 > slots.size() * 7 ) rehash( slots.empty() ? 16 : slots.size() * 2 );
+            size_t i = index_of( k );
+            for( ; used[i]; i = (i + 1) & mask() )
+               if( slots[i].first == k ) return slots[i].second;
+            used[i] = 1;
+            slots[i].first = k;
+            slots[i].second = Value();
+            ++count;
+            return slots[i].second;
+         }
+
+         bool erase( const Key& k ) {
+            if( slots.empty() ) return false;
+            size_t i = index_of( k );
+            for( ;; i = (i + 1) & mask() ) {
+               if( !used[i] ) return false;
+               if( slots[i].first == k ) break;
+            }
+            // shift back every following entry whose probe sequence passes the hole
+            for( size_t j = (i + 1) & mask(); used[j]; j = (j + 1) & mask() ) {
+               const size_t home = index_of( slots[j].first );
+               const bool between = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+               if( between ) continue;
+               slots[i] = std::move( slots[j] );
+               i = j;
+            }
+            used[i] = 0;
+            slots[i] = std::pair<Key, Value>();
+            --count;
+            return true;
+         }
+
+         // f(const Key&, const Value&) for every entry, in slot order
+         template<typename F>
+         void for_each( F&& f ) const {
+            for( size_t i = 0; i < slots.size(); ++i )
+               if( used[i] ) f( slots[i].first, slots[i].second );
+         }
+
+      private:
+         std::vector<std::pair<Key, Value>>  slots;
+         std::vector<uint8_t>                used;
+         size_t                              count = 0;
+
+         size_t mask() const { return slots.size() - 1; }
+         size_t index_of( const Key& k ) const { return size_t(Hash()( k )) & mask(); }
+
+         void rehash( size_t capacity ) {
+            std::vector<std::pair<Key, Value>> old_slots( capacity );
+            std::vector<uint8_t> old_used( capacity );
+            old_slots.swap( slots );
+            old_used.swap( used );
+            count = 0;
+            for( size_t i = 0; i < old_slots.size(); ++i )
+               if( old_used[i] ) (*this)[old_slots[i].first] = std::move( old_slots[i].second );
+         }
+   };
+
+}
@@ -0,0 +1,495 @@
+// shipidx: follows the nodeos state-history plugin and keeps the HaggleX token balances,
+// stake positions and balances, and sale deposits in memory, serving balance, position
+// and rich-list queries without touching the chain API. Input is a live state-history
+// socket, a recording of one, or a text delta fixture; forks are rolled back through
+// an undo log and the whole index is checkpointed to disk for fast restarts.
+
+#include "state.hpp"
+
+#include "websocket.hpp"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <shared_mutex>
+#include <sstream>
+#include <thread>
+
+using namespace hagglex;
+using namespace hagglex::shipidx;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+   std::atomic<bool> stop_requested{ false };
+
+   void on_signal( int ) { stop_requested = true; }
+
+   struct options {
+      contract_set   contracts;
+      std::string    ship_url;
+      std::string    replay_file;
+      std::string    deltas_file;
+      std::string    record_file;
+      std::string    checkpoint_file;
+      std::string    query_file;
+      uint32_t       checkpoint_every = 1000;
+      uint32_t       start_block = 1;
+      int            listen_port = 0;
+   };
+
+   // the indexer, its lock and the outputs fed by every block
+   struct indexer {
+      const options&       opts;
+      state                st;
+      std::shared_mutex    mutex;        // writers: block ingestion; readers: queries
+      std::ofstream        record;
+      uint32_t             blocks_since_checkpoint = 0;
+
+      explicit indexer( const options& opts ) : opts(opts), st(opts.contracts) {
+         if( !opts.record_file.empty() ) {
+            record.open( opts.record_file, std::ios::binary | std::ios::app );
+            if( !record ) throw indexer_error( "cannot open " + opts.record_file );
+         }
+      }
+
+      // one get_blocks_result message, as received from the socket
+      void handle( const char* data, size_t size ) {
+         if( record.is_open() ) {
+            const uint32_t n = uint32_t(size);
+            record.write( reinterpret_cast<const char*>(&n), sizeof(n) );
+            record.write( data, std::streamsize(size) );
+         }
+         ship::blocks_result r;
+         if( !ship::parse_result( data, size, r ) || !r.this_block ) return;
+         {
+            std::unique_lock<std::shared_mutex> lock( mutex );
+            st.begin_block( *r.this_block, r.prev_block, r.last_irreversible.block_num );
+            if( r.deltas ) ship::for_each_contract_row( r.deltas, r.deltas_size, [&]( const ship::contract_row& row ) { st.apply( row ); } );
+            st.end_block();
+         }
+         if( !opts.checkpoint_file.empty() && ++blocks_since_checkpoint >= opts.checkpoint_every ) checkpoint();
+      }
+
+      void checkpoint() {
+         std::shared_lock<std::shared_mutex> lock( mutex );
+         st.save( opts.checkpoint_file );
+         blocks_since_checkpoint = 0;
+      }
+   };
+
+   // ---- inputs ----------------------------------------------------------------------
+
+   // follows the node from the indexed head, reconnecting after errors; have_positions
+   // lets the node detect a fork that happened while we were disconnected
+   void follow_ship( indexer& idx ) {
+      while( !stop_requested ) {
+         try {
+            websocket_client ws( idx.opts.ship_url );
+            ws.receive();     // the protocol ABI, sent as text on connect
+            uint32_t start;
+            std::vector<ship::block_position> have;
+            {
+               std::shared_lock<std::shared_mutex> lock( idx.mutex );
+               start = idx.st.head().block_num ? idx.st.head().block_num + 1 : idx.opts.start_block;
+               have = idx.st.reversible_blocks();
+            }
+            const uint32_t window = 1000;
+            auto request = ship::get_blocks_request( start, have, window );
+            ws.send_binary( request.data(), request.size() );
+            std::cerr << "shipidx: following " << idx.opts.ship_url << " from block " << start << "\n";
+
+            uint32_t unacked = 0;
+            while( !stop_requested ) {
+               auto msg = ws.receive();
+               idx.handle( msg.data.data(), msg.data.size() );
+               if( ++unacked >= window / 2 ) {
+                  auto ack = ship::get_blocks_ack( unacked );
+                  ws.send_binary( ack.data(), ack.size() );
+                  unacked = 0;
+               }
+            }
+         } catch( const websocket_error& e ) {
+            if( stop_requested ) break;
+            std::cerr << "shipidx: " << e.what() << ", reconnecting\n";
+            std::this_thread::sleep_for( std::chrono::seconds( 1 ) );
+         }
+      }
+   }
+
+   // a recording written by --record: [uint32 size][message] frames
+   void replay( indexer& idx, const std::string& path ) {
+      const std::string data = read_file( path );
+      bin_reader in( data.data(), data.size() );
+      while( in.remaining() && !stop_requested ) {
+         const uint32_t size = in.raw<uint32_t>();
+         idx.handle( in.skip( size ), size );
+      }
+   }
+
+   // numbers stay numbers, all-uppercase words are symbol codes, anything else a name
+   uint64_t parse_key( const std::string& s ) {
+      if( !s.empty() && s.find_first_not_of( "0123456789" ) == std::string::npos ) return std::stoull( s );
+      if( !s.empty() && s.find_first_not_of( "ABCDEFGHIJKLMNOPQRSTUVWXYZ" ) == std::string::npos ) return string_to_symbol_code( s );
+      return string_to_name( s );
+   }
+
+   const abi& abi_of( const contract_set& c, uint64_t code ) {
+      if( code && code == c.token ) return c.token_abi;
+      if( code && code == c.stake ) return c.stake_abi;
+      if( code && code == c.sale ) return c.sale_abi;
+      throw indexer_error( "no ABI for " + name_to_string( code ) );
+   }
+
+   // a text fixture, one block per `block` line followed by its rows:
+   //
+   //    block <num> [lib <num>] [id <label>]
+   //    row <code> <scope> <table> <primary key> <json row>
+   //    erase <code> <scope> <table> <primary key>
+   //
+   // Block ids are the sha256 of the label (default: the block number), so a fork is a
+   // block number repeated with a new label. Each block is encoded as a state-history
+   // result and handled exactly like one received from the node.
+   void replay_deltas( indexer& idx, const std::string& path ) {
+      std::ifstream in( path );
+      if( !in ) throw indexer_error( "cannot open " + path );
+
+      std::map<uint32_t, ship::block_position> blocks;      // latest block at each height
+      std::optional<ship::block_position> current;
+      uint32_t lib = 0;
+      std::vector<std::vector<char>> values;
+      std::vector<ship::contract_row> rows;
+
+      auto flush = [&]() {
+         if( !current ) return;
+         std::optional<ship::block_position> prev;
+         if( auto it = blocks.find( current->block_num - 1 ); it != blocks.end() ) prev = it->second;
+         auto msg = ship::encode_result( *current, prev, ship::block_position{ lib, {} }, rows );
+         idx.handle( msg.data(), msg.size() );
+         blocks[current->block_num] = *current;
+         rows.clear();
+         values.clear();
+      };
+
+      std::string line;
+      for( size_t line_no = 1; std::getline( in, line ); ++line_no ) {
+         std::istringstream ss( line );
+         std::string op;
+         if( !(ss >> op) || op[0] == '#' ) continue;
+         try {
+            if( op == "block" ) {
+               flush();
+               uint32_t num = 0;
+               ss >> num;
+               std::string label = std::to_string( num ), key;
+               while( ss >> key ) {
+                  if( key == "lib" ) ss >> lib;
+                  else if( key == "id" ) ss >> label;
+                  else throw indexer_error( "unknown block option " + key );
+               }
+               current = ship::block_position{ num, sha256( label.data(), label.size() ) };
+            } else if( op == "row" || op == "erase" ) {
+               if( !current ) throw indexer_error( "row before the first block" );
+               std::string code, scope, table, key;
+               ss >> code >> scope >> table >> key;
+               ship::contract_row row;
+               row.present     = op == "row";
+               row.code        = string_to_name( code );
+               row.scope       = parse_key( scope );
+               row.table       = string_to_name( table );
+               row.primary_key = parse_key( key );
+               row.payer       = row.code;
+               if( row.present ) {
+                  std::string text;
+                  std::getline( ss, text );
+                  const abi& def = abi_of( idx.opts.contracts, row.code );
+                  values.push_back( def.json_to_bin( def.table_type( row.table ), json::parse( text ) ) );
+                  row.value = values.back().data();
+                  row.value_size = values.back().size();
+               }
+               rows.push_back( row );
+            } else {
+               throw indexer_error( "unknown line " + op );
+            }
+         } catch( const std::exception& e ) {
+            throw indexer_error( path + ":" + std::to_string( line_no ) + ": " + e.what() );
+         }
+      }
+      flush();
+   }
+
+   // ---- queries ---------------------------------------------------------------------
+
+   struct query_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   using query_args = std::map<std::string, std::string>;
+
+   const std::string& arg( const query_args& args, const std::string& key ) {
+      auto it = args.find( key );
+      if( it == args.end() ) throw query_error( "missing " + key );
+      return it->second;
+   }
+
+   json position_json( const position& p ) {
+      json j = json::object();
+      j.set( "id", json::number( p.id ) );
+      j.set( "owner", name_to_string( p.owner ) );
+      j.set( "staked", asset_to_string( p.staked ) );
+      j.set( "interest_rate", json::number( std::to_string( p.interest_rate ) ) );
+      j.set( "interest_paid", asset_to_string( p.interest_paid ) );
+      j.set( "last_interest_paid_time", format_time_point_sec( p.last_interest_paid_time ) );
+      j.set( "staked_time", format_time_point_sec( p.staked_time ) );
+      j.set( "expiration_time", format_time_point_sec( p.expiration_time ) );
+      return j;
+   }
+
+   // caller holds the shared lock
+   json run_query( const state& st, const std::string& kind, const query_args& args ) {
+      json out = json::object();
+      if( kind == "head" ) {
+         out.set( "head", json::number( uint64_t(st.head().block_num) ) );
+         out.set( "head_id", to_hex( st.head().block_id.data(), st.head().block_id.size() ) );
+         out.set( "last_irreversible", json::number( uint64_t(st.last_irreversible()) ) );
+      } else if( kind == "balance" ) {
+         const uint64_t account = string_to_name( arg( args, "account" ) );
+         out.set( "account", name_to_string( account ) );
+         if( args.count( "symbol" ) ) {
+            out.set( "balance", asset_to_string( st.balance( account, string_to_symbol_code( args.at( "symbol" ) ) ) ) );
+         } else {
+            json list = json::array();
+            for( const auto& b : st.balances( account ) ) list.push_back( asset_to_string( b ) );
+            out.set( "balances", list );
+         }
+      } else if( kind == "supply" ) {
+         auto s = st.supply( string_to_symbol_code( arg( args, "symbol" ) ) );
+         if( !s ) throw query_error( "unknown symbol" );
+         out.set( "supply", asset_to_string( *s ) );
+      } else if( kind == "richlist" ) {
+         const std::string& sym = arg( args, "symbol" );
+         const size_t limit = args.count( "limit" ) ? std::stoul( args.at( "limit" ) ) : 10;
+         json list = json::array();
+         for( const auto& [owner, amount] : st.richlist( string_to_symbol_code( sym ), limit ) ) {
+            json j = json::object();
+            j.set( "account", name_to_string( owner ) );
+            j.set( "balance", asset_to_string( amount ) );
+            list.push_back( j );
+         }
+         out.set( "symbol", sym );
+         out.set( "holders", list );
+      } else if( kind == "positions" ) {
+         const uint64_t owner = string_to_name( arg( args, "owner" ) );
+         json list = json::array();
+         for( const auto& p : st.positions( owner ) ) list.push_back( position_json( p ) );
+         out.set( "owner", name_to_string( owner ) );
+         out.set( "positions", list );
+      } else if( kind == "position" ) {
+         auto p = st.find_position( std::stoull( arg( args, "id" ) ) );
+         if( !p ) throw query_error( "unknown position" );
+         out = position_json( *p );
+      } else if( kind == "stakebalance" ) {
+         const uint64_t account = string_to_name( arg( args, "account" ) );
+         auto b = st.find_stake_balance( account, string_to_symbol_code( arg( args, "symbol" ) ) );
+         out.set( "account", name_to_string( account ) );
+         out.set( "funds", b ? json( asset_to_string( b->funds ) ) : json() );
+         if( b ) out.set( "token_contract", name_to_string( b->token_contract ) );
+      } else if( kind == "deposit" ) {
+         const uint64_t account = string_to_name( arg( args, "account" ) );
+         auto d = st.deposit( account );
+         out.set( "account", name_to_string( account ) );
+         out.set( "tokens", d ? json( asset_to_string( *d ) ) : json() );
+      } else {
+         throw query_error( "unknown query " + kind );
+      }
+      return out;
+   }
+
+   json answer( indexer& idx, const std::string& kind, const query_args& args ) {
+      std::shared_lock<std::shared_mutex> lock( idx.mutex );
+      try {
+         return run_query( idx.st, kind, args );
+      } catch( const std::exception& e ) {
+         json err = json::object();
+         err.set( "error", e.what() );
+         return err;
+      }
+   }
+
+   // `kind key=value ...` per line; prints one JSON answer per query
+   void run_query_file( indexer& idx, const std::string& path ) {
+      std::ifstream file;
+      if( path != "-" ) {
+         file.open( path );
+         if( !file ) throw indexer_error( "cannot open " + path );
+      }
+      std::istream& in = path == "-" ? std::cin : file;
+      std::string line;
+      uint64_t count = 0;
+      clock_type::duration spent{};
+      while( std::getline( in, line ) ) {
+         std::istringstream ss( line );
+         std::string kind, word;
+         if( !(ss >> kind) || kind[0] == '#' ) continue;
+         query_args args;
+         while( ss >> word ) {
+            auto eq = word.find( '=' );
+            args[word.substr( 0, eq )] = eq == std::string::npos ? "" : word.substr( eq + 1 );
+         }
+         const auto start = clock_type::now();
+         json result = answer( idx, kind, args );
+         spent += clock_type::now() - start;
+         ++count;
+         std::cout << result.dump() << "\n";
+      }
+      if( count ) {
+         const double us = std::chrono::duration<double, std::micro>( spent ).count() / double(count);
+         std::fprintf( stderr, "shipidx: %llu queries, %.2f us average\n", (unsigned long long)count, us );
+      }
+   }
+
+   // GET /<query>?key=value&... over HTTP/1.1 keep-alive; answers are JSON
+   void serve_connection( indexer& idx, int fd ) {
+      std::string buffer;
+      char chunk[4096];
+      while( true ) {
+         size_t end;
+         while( (end = buffer.find( "\r\n\r\n" )) == std::string::npos ) {
+            ssize_t n = ::recv( fd, chunk, sizeof(chunk), 0 );
+            if( n <= 0 || buffer.size() > 65536 ) { ::close( fd ); return; }
+            buffer.append( chunk, size_t(n) );
+         }
+         const std::string request = buffer.substr( 0, end );
+         buffer.erase( 0, end + 4 );
+
+         std::istringstream ss( request );
+         std::string method, target;
+         ss >> method >> target;
+         const size_t qmark = target.find( '?' );
+         std::string kind = target.substr( 1, qmark == std::string::npos ? std::string::npos : qmark - 1 );
+         query_args args;
+         if( qmark != std::string::npos ) {
+            std::istringstream qs( target.substr( qmark + 1 ) );
+            std::string pair;
+            while( std::getline( qs, pair, '&' ) ) {
+               auto eq = pair.find( '=' );
+               args[pair.substr( 0, eq )] = eq == std::string::npos ? "" : pair.substr( eq + 1 );
+            }
+         }
+
+         const json result = method == "GET" ? answer( idx, kind, args ) : json( "GET only" );
+         const std::string body = result.dump();
+         const char* status = method != "GET" ? "405 Method Not Allowed" : result.is_object() && result.has( "error" ) ? "400 Bad Request" : "200 OK";
+         const std::string response = std::string( "HTTP/1.1 " ) + status + "\r\nContent-Type: application/json\r\nContent-Length: " +
+                                      std::to_string( body.size() ) + "\r\n\r\n" + body;
+         if( ::send( fd, response.data(), response.size(), MSG_NOSIGNAL ) < 0 ) { ::close( fd ); return; }
+      }
+   }
+
+   void listen_http( indexer& idx, int port ) {
+      int server = ::socket( AF_INET, SOCK_STREAM, 0 );
+      int one = 1;
+      setsockopt( server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one) );
+      sockaddr_in addr{};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl( INADDR_ANY );
+      addr.sin_port = htons( uint16_t(port) );
+      if( ::bind( server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr) ) != 0 || ::listen( server, 64 ) != 0 )
+         throw indexer_error( "cannot listen on port " + std::to_string( port ) );
+      std::thread( [&idx, server]() {
+         while( true ) {
+            int fd = ::accept( server, nullptr, nullptr );
+            if( fd < 0 ) continue;
+            std::thread( serve_connection, std::ref( idx ), fd ).detach();
+         }
+      } ).detach();
+      std::cerr << "shipidx: serving queries on port " << port << "\n";
+   }
+
+   // ACCOUNT=ABI
+   void parse_contract( const std::string& spec, uint64_t& account, abi& def ) {
+      auto eq = spec.find( '=' );
+      if( eq == std::string::npos ) throw indexer_error( "expected ACCOUNT=ABI, got " + spec );
+      account = string_to_name( spec.substr( 0, eq ) );
+      def = abi::load( spec.substr( eq + 1 ) );
+   }
+
+   int usage() {
+      std::cerr << "usage: shipidx [--token ACCOUNT=ABI] [--stake ACCOUNT=ABI] [--sale ACCOUNT=ABI]\n"
+                   "               [--ship ws://HOST:PORT [--start BLOCK] | --replay FILE | --deltas FILE] [--record FILE]\n"
+                   "               [--checkpoint FILE [--checkpoint-every BLOCKS]] [--listen PORT] [--query FILE]\n";
+      return 2;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   options opts;
+   try {
+      for( int i = 1; i < argc; ++i ) {
+         std::string arg = argv[i];
+         const bool has_value = i + 1 < argc;
+         if( arg == "--token" && has_value ) parse_contract( argv[++i], opts.contracts.token, opts.contracts.token_abi );
+         else if( arg == "--stake" && has_value ) parse_contract( argv[++i], opts.contracts.stake, opts.contracts.stake_abi );
+         else if( arg == "--sale" && has_value ) parse_contract( argv[++i], opts.contracts.sale, opts.contracts.sale_abi );
+         else if( arg == "--ship" && has_value ) opts.ship_url = argv[++i];
+         else if( arg == "--start" && has_value ) opts.start_block = uint32_t(std::stoul( argv[++i] ));
+         else if( arg == "--replay" && has_value ) opts.replay_file = argv[++i];
+         else if( arg == "--deltas" && has_value ) opts.deltas_file = argv[++i];
+         else if( arg == "--record" && has_value ) opts.record_file = argv[++i];
+         else if( arg == "--checkpoint" && has_value ) opts.checkpoint_file = argv[++i];
+         else if( arg == "--checkpoint-every" && has_value ) opts.checkpoint_every = uint32_t(std::max( 1ul, std::stoul( argv[++i] ) ));
+         else if( arg == "--listen" && has_value ) opts.listen_port = std::stoi( argv[++i] );
+         else if( arg == "--query" && has_value ) opts.query_file = argv[++i];
+         else return usage();
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << "shipidx: " << e.what() << "\n";
+      return 2;
+   }
+   if( !opts.contracts.token && !opts.contracts.stake && !opts.contracts.sale ) return usage();
+   if( int(!opts.ship_url.empty()) + int(!opts.replay_file.empty()) + int(!opts.deltas_file.empty()) > 1 ) return usage();
+
+   struct sigaction sa{};
+   sa.sa_handler = on_signal;     // no SA_RESTART: a blocking recv returns so the loop can stop
+   sigaction( SIGINT, &sa, nullptr );
+   sigaction( SIGTERM, &sa, nullptr );
+
+   try {
+      indexer idx( opts );
+      if( !opts.checkpoint_file.empty() && idx.st.load( opts.checkpoint_file ) )
+         std::cerr << "shipidx: resumed at block " << idx.st.head().block_num << " from " << opts.checkpoint_file << "\n";
+      if( opts.listen_port ) listen_http( idx, opts.listen_port );
+
+      const auto start = clock_type::now();
+      if( !opts.ship_url.empty() ) follow_ship( idx );
+      else if( !opts.replay_file.empty() ) replay( idx, opts.replay_file );
+      else if( !opts.deltas_file.empty() ) replay_deltas( idx, opts.deltas_file );
+      const double seconds = std::chrono::duration<double>( clock_type::now() - start ).count();
+
+      if( !opts.checkpoint_file.empty() ) idx.checkpoint();
+      const auto& s = idx.st.stats();
+      std::fprintf( stderr, "shipidx: %llu blocks, %llu rows, %llu rollbacks (%llu blocks) in %.3f s; head %u, %zu balances, %zu positions\n",
+                    (unsigned long long)s.blocks, (unsigned long long)s.rows, (unsigned long long)s.rollbacks,
+                    (unsigned long long)s.rolled_back_blocks, seconds, idx.st.head().block_num, idx.st.holders(),
+                    idx.st.position_count() );
+
+      if( !opts.query_file.empty() ) run_query_file( idx, opts.query_file );
+
+      // an offline run with --listen keeps serving the final state
+      if( opts.listen_port && opts.ship_url.empty() )
+         while( !stop_requested ) std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+   } catch( const std::exception& e ) {
+      std::cerr << "shipidx: " << e.what() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,113 @@
+#include "ship.hpp"
+
+namespace hagglex::ship {
+
+   namespace {
+
+      void write_position( bin_writer& out, const block_position& p ) {
+         out.raw( p.block_num );
+         out.bytes( p.block_id.data(), p.block_id.size() );
+      }
+
+      block_position read_position( bin_reader& in ) {
+         block_position p;
+         p.block_num = in.raw<uint32_t>();
+         in.bytes( p.block_id.data(), p.block_id.size() );
+         return p;
+      }
+
+      std::optional<block_position> read_optional_position( bin_reader& in ) {
+         if( !in.raw<uint8_t>() ) return std::nullopt;
+         return read_position( in );
+      }
+
+      // request variant: get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0
+      enum request_index : uint8_t { get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0 };
+
+   }
+
+   std::vector<char> get_blocks_request( uint32_t start_block_num, const std::vector<block_position>& have_positions,
+                                         uint32_t max_messages_in_flight ) {
+      bin_writer out;
+      out.varuint32( get_blocks_request_v0 );
+      out.raw( start_block_num );
+      out.raw( uint32_t(0xffffffff) );          // end_block_num
+      out.raw( max_messages_in_flight );
+      out.varuint32( have_positions.size() );
+      for( const auto& p : have_positions ) write_position( out, p );
+      out.raw( uint8_t(0) );                    // irreversible_only
+      out.raw( uint8_t(0) );                    // fetch_block
+      out.raw( uint8_t(0) );                    // fetch_traces
+      out.raw( uint8_t(1) );                    // fetch_deltas
+      return out.data;
+   }
+
+   std::vector<char> get_blocks_ack( uint32_t num_messages ) {
+      bin_writer out;
+      out.varuint32( get_blocks_ack_request_v0 );
+      out.raw( num_messages );
+      return out.data;
+   }
+
+   bool parse_result( const char* data, size_t size, blocks_result& out ) {
+      bin_reader in( data, size );
+      // result variant: get_status_result_v0, get_blocks_result_v0, get_blocks_result_v1; the
+      // two block results only differ in the block field, which is never requested
+      const uint64_t index = in.varuint32();
+      if( index == 0 ) return false;
+      if( index > 2 ) throw format_error( "unsupported state-history result version" );
+
+      out.head              = read_position( in );
+      out.last_irreversible = read_position( in );
+      out.this_block        = read_optional_position( in );
+      out.prev_block        = read_optional_position( in );
+      if( in.raw<uint8_t>() ) throw format_error( "unexpected block in result" );
+      if( in.raw<uint8_t>() ) in.skip( in.varuint32() );     // traces
+      out.deltas = nullptr;
+      out.deltas_size = 0;
+      if( in.raw<uint8_t>() ) {
+         out.deltas_size = in.varuint32();
+         out.deltas = in.skip( out.deltas_size );
+      }
+      return true;
+   }
+
+   std::vector<char> encode_result( const block_position& this_block, const std::optional<block_position>& prev_block,
+                                    const block_position& last_irreversible, const std::vector<contract_row>& rows ) {
+      bin_writer deltas;
+      deltas.varuint32( 1 );
+      deltas.varuint32( 0 );                    // table_delta_v0
+      deltas.string( "contract_row" );
+      deltas.varuint32( rows.size() );
+      for( const auto& row : rows ) {
+         bin_writer data;
+         data.varuint32( 0 );                   // contract_row_v0
+         data.raw( row.code );
+         data.raw( row.scope );
+         data.raw( row.table );
+         data.raw( row.primary_key );
+         data.raw( row.payer );
+         data.varuint32( row.value_size );
+         data.bytes( row.value, row.value_size );
+         deltas.raw( uint8_t(row.present) );
+         deltas.varuint32( data.data.size() );
+         deltas.bytes( data.data.data(), data.data.size() );
+      }
+
+      bin_writer out;
+      out.varuint32( 1 );                       // get_blocks_result_v0
+      write_position( out, this_block );        // head
+      write_position( out, last_irreversible );
+      out.raw( uint8_t(1) );
+      write_position( out, this_block );
+      out.raw( uint8_t(prev_block ? 1 : 0) );
+      if( prev_block ) write_position( out, *prev_block );
+      out.raw( uint8_t(0) );                    // block
+      out.raw( uint8_t(0) );                    // traces
+      out.raw( uint8_t(1) );
+      out.varuint32( deltas.data.size() );
+      out.bytes( deltas.data.data(), deltas.data.size() );
+      return out.data;
+   }
+
+}
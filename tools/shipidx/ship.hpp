@@ -0,0 +1,85 @@
+#pragma once
+
+#include "crypto.hpp"
+#include "eosio.hpp"
+
+#include <optional>
+#include <vector>
+
+// The parts of the nodeos state-history (SHiP) protocol the indexer uses, decoded by
+// hand rather than through the ABI the node sends: block requests and acks, block
+// results, and the contract_row entries of their table deltas.
+
+namespace hagglex::ship {
+
+   struct block_position {
+      uint32_t    block_num = 0;
+      checksum256 block_id{};
+   };
+
+   // get_blocks_result_v0/v1 without block and traces; `deltas` borrows the message
+   struct blocks_result {
+      block_position                head;
+      block_position                last_irreversible;
+      std::optional<block_position> this_block;
+      std::optional<block_position> prev_block;
+      const char*                   deltas = nullptr;
+      size_t                        deltas_size = 0;
+   };
+
+   // one contract_row_v0 delta; `value` borrows the message
+   struct contract_row {
+      bool        present = false;
+      uint64_t    code = 0;
+      uint64_t    scope = 0;
+      uint64_t    table = 0;
+      uint64_t    primary_key = 0;
+      uint64_t    payer = 0;
+      const char* value = nullptr;
+      size_t      value_size = 0;
+   };
+
+   // get_blocks_request_v0 for deltas only, from start_block_num on; the node compares
+   // have_positions with its fork database and restarts from the first mismatch
+   std::vector<char> get_blocks_request( uint32_t start_block_num, const std::vector<block_position>& have_positions,
+                                         uint32_t max_messages_in_flight );
+   std::vector<char> get_blocks_ack( uint32_t num_messages );
+
+   // false for results other than get_blocks_result (the status result)
+   bool parse_result( const char* data, size_t size, blocks_result& out );
+
+   // a get_blocks_result_v0 for this_block whose deltas hold only `rows`; the inverse of
+   // parse_result, used to run delta fixtures through the same decoding as live data
+   std::vector<char> encode_result( const block_position& this_block, const std::optional<block_position>& prev_block,
+                                    const block_position& last_irreversible, const std::vector<contract_row>& rows );
+
+   // calls f(const contract_row&) for every row of the contract_row table delta
+   template<typename F>
+   void for_each_contract_row( const char* deltas, size_t size, F&& f ) {
+      bin_reader in( deltas, size );
+      for( uint64_t tables = in.varuint32(); tables; --tables ) {
+         if( in.varuint32() != 0 ) throw format_error( "unsupported table_delta version" );
+         const bool wanted = in.string() == "contract_row";
+         for( uint64_t rows = in.varuint32(); rows; --rows ) {
+            contract_row row;
+            row.present = in.raw<uint8_t>() != 0;
+            const size_t data_size = in.varuint32();
+            if( !wanted ) {
+               in.skip( data_size );
+               continue;
+            }
+            bin_reader data( in.skip( data_size ), data_size );
+            if( data.varuint32() != 0 ) throw format_error( "unsupported contract_row version" );
+            row.code        = data.raw<uint64_t>();
+            row.scope       = data.raw<uint64_t>();
+            row.table       = data.raw<uint64_t>();
+            row.primary_key = data.raw<uint64_t>();
+            row.payer       = data.raw<uint64_t>();
+            row.value_size  = data.varuint32();
+            row.value       = data.skip( row.value_size );
+            f( row );
+         }
+      }
+   }
+
+}
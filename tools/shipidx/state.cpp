@@ -0,0 +1,474 @@
+#include "state.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace hagglex::shipidx {
+
+   namespace {
+
+      const uint64_t accounts_table  = string_to_name( "accounts" );
+      const uint64_t cbalances_table = string_to_name( "cbalances" );
+      const uint64_t stat_table      = string_to_name( "stat" );
+      const uint64_t positions_table = string_to_name( "positions" );
+      const uint64_t balances_table  = string_to_name( "balances" );
+      const uint64_t deposit_table   = string_to_name( "deposit" );
+
+      const char checkpoint_magic[8] = { 'H', 'A', 'G', 'I', 'D', 'X', '0', '1' };
+
+      uint64_t code_of( uint64_t symbol ) { return symbol >> 8; }
+
+      void write_asset( bin_writer& out, const asset& a ) {
+         out.raw( a.amount );
+         out.raw( a.symbol );
+      }
+
+      asset read_asset( bin_reader& in ) {
+         asset a;
+         a.amount = in.raw<int64_t>();
+         a.symbol = in.raw<uint64_t>();
+         return a;
+      }
+
+      void write_position( bin_writer& out, const position& p ) {
+         out.raw( p.id );
+         out.raw( p.owner );
+         write_asset( out, p.staked );
+         out.raw( p.interest_rate );
+         write_asset( out, p.interest_paid );
+         out.raw( p.last_interest_paid_time );
+         out.raw( p.staked_time );
+         out.raw( p.expiration_time );
+      }
+
+      position read_position( bin_reader& in ) {
+         position p;
+         p.id = in.raw<uint64_t>();
+         p.owner = in.raw<uint64_t>();
+         p.staked = read_asset( in );
+         p.interest_rate = in.raw<float>();
+         p.interest_paid = read_asset( in );
+         p.last_interest_paid_time = in.raw<uint32_t>();
+         p.staked_time = in.raw<uint32_t>();
+         p.expiration_time = in.raw<uint32_t>();
+         return p;
+      }
+
+      void write_block( bin_writer& out, const ship::block_position& b ) {
+         out.raw( b.block_num );
+         out.bytes( b.block_id.data(), b.block_id.size() );
+      }
+
+      ship::block_position read_block( bin_reader& in ) {
+         ship::block_position b;
+         b.block_num = in.raw<uint32_t>();
+         in.bytes( b.block_id.data(), b.block_id.size() );
+         return b;
+      }
+
+   }
+
+   void state::begin_block( const ship::block_position& block, const std::optional<ship::block_position>& prev,
+                            uint32_t last_irreversible ) {
+      if( head_block.block_num && block.block_num <= head_block.block_num ) {
+         rollback_to( block.block_num - 1 );
+         ++totals.rollbacks;
+      }
+      if( head_block.block_num && block.block_num != head_block.block_num + 1 )
+         throw indexer_error( "block " + std::to_string( block.block_num ) + " does not follow indexed head " +
+                              std::to_string( head_block.block_num ) );
+      if( prev && head_block.block_num == prev->block_num && head_block.block_id != checksum256{} &&
+          prev->block_id != head_block.block_id )
+         throw indexer_error( "block " + std::to_string( block.block_num ) + " does not link to the indexed chain" );
+
+      head_block = block;
+      irreversible = std::min( last_irreversible, block.block_num );
+      undo.push_back( undo_block{ block, {} } );
+      ++totals.blocks;
+   }
+
+   void state::end_block() {
+      while( !undo.empty() && undo.front().block.block_num <= irreversible ) undo.pop_front();
+   }
+
+   void state::rollback_to( uint32_t block_num ) {
+      if( block_num < irreversible )
+         throw indexer_error( "fork at block " + std::to_string( block_num + 1 ) + " is below the last irreversible block " +
+                              std::to_string( irreversible ) );
+      while( !undo.empty() && undo.back().block.block_num > block_num ) {
+         const auto& entries = undo.back().entries;
+         for( auto it = entries.rbegin(); it != entries.rend(); ++it ) set_row( it->kind, it->a, it->b, it->previous, false );
+         undo.pop_back();
+         ++totals.rolled_back_blocks;
+      }
+      if( head_block.block_num > block_num ) {
+         // the id of the new head is known only while its block is still reversible
+         head_block = undo.empty() ? ship::block_position{ block_num, {} } : undo.back().block;
+      }
+   }
+
+   std::vector<ship::block_position> state::reversible_blocks() const {
+      std::vector<ship::block_position> out;
+      for( const auto& u : undo ) out.push_back( u.block );
+      return out;
+   }
+
+   void state::apply( const ship::contract_row& row ) {
+      const abi* def = nullptr;
+      if( row.code == contracts.token ) {
+         if( row.table == accounts_table || row.table == cbalances_table || row.table == stat_table ) def = &contracts.token_abi;
+      } else if( row.code == contracts.stake ) {
+         if( row.table == positions_table || row.table == balances_table ) def = &contracts.stake_abi;
+      } else if( row.code == contracts.sale ) {
+         if( row.table == deposit_table ) def = &contracts.sale_abi;
+      }
+      if( !def ) return;
+      ++totals.rows;
+
+      json v;
+      if( row.present ) {
+         const std::string type = def->table_type( row.table );
+         if( type.empty() ) throw indexer_error( "ABI of " + name_to_string( row.code ) + " has no table " + name_to_string( row.table ) );
+         bin_reader in( row.value, row.value_size );
+         v = def->bin_to_json( type, in );
+      }
+
+      if( row.table == accounts_table ) {
+         row_value value;
+         if( row.present ) {
+            const asset b = string_to_asset( v["balance"].as_string() );
+            learn_symbol( b.symbol );
+            value = b.amount;
+         }
+         set_row( table_kind::account, row.scope, row.primary_key, value, true );
+      } else if( row.table == cbalances_table ) {
+         row_value value;
+         if( row.present ) value = v["amount"].as_int64();
+         set_row( table_kind::compact, row.primary_key, row.scope, value, true );
+      } else if( row.table == stat_table ) {
+         row_value value;
+         if( row.present ) {
+            const asset s = string_to_asset( v["supply"].as_string() );
+            learn_symbol( s.symbol );
+            value = s;
+         }
+         set_row( table_kind::stat, row.primary_key, 0, value, true );
+      } else if( row.table == positions_table ) {
+         row_value value;
+         if( row.present ) {
+            position p;
+            p.id                      = v["position_id"].as_uint64();
+            p.owner                   = string_to_name( v["position_owner"].as_string() );
+            p.staked                  = string_to_asset( v["staked_asset"].as_string() );
+            p.interest_rate           = float(v["interest_rate"].as_double());
+            p.interest_paid           = string_to_asset( v["interest_paid"].as_string() );
+            p.last_interest_paid_time = parse_time_point_sec( v["last_interest_paid_time"].as_string() );
+            p.staked_time             = parse_time_point_sec( v["position_staked_time"].as_string() );
+            p.expiration_time         = parse_time_point_sec( v["position_expiration_time"].as_string() );
+            value = p;
+         }
+         set_row( table_kind::position, row.primary_key, 0, value, true );
+      } else if( row.table == balances_table ) {
+         row_value value;
+         if( row.present ) value = stake_balance{ string_to_asset( v["funds"].as_string() ), string_to_name( v["token_contract"].as_string() ) };
+         set_row( table_kind::stake_balance, row.scope, row.primary_key, value, true );
+      } else if( row.table == deposit_table ) {
+         row_value value;
+         if( row.present ) value = string_to_asset( v["tokens"].as_string() );
+         set_row( table_kind::deposit, row.primary_key, 0, value, true );
+      }
+   }
+
+   void state::set_row( table_kind kind, uint64_t a, uint64_t b, const row_value& value, bool record ) {
+      const bool erase = std::holds_alternative<std::monostate>( value );
+      row_value previous;
+
+      // previous value of a map entry, then the update
+      auto update = [&]( auto& map, const auto& key, auto tag ) {
+         using value_type = decltype(tag);
+         if( auto* current = map.find( key ) ) previous = *current;
+         if( erase ) map.erase( key );
+         else map[key] = std::get<value_type>( value );
+      };
+
+      switch( kind ) {
+         case table_kind::account:
+            update( accounts, balance_key{ a, b }, int64_t() );
+            mark_richlist( b );
+            break;
+         case table_kind::compact:
+            update( compact, balance_key{ a, b }, int64_t() );
+            mark_richlist( b );
+            break;
+         case table_kind::stat:
+            update( supplies, a, asset() );
+            break;
+         case table_kind::position: {
+            update( positions_by_id, a, position() );
+            if( auto* old = std::get_if<position>( &previous ) ) {
+               auto& ids = positions_by_owner[old->owner];
+               ids.erase( std::remove( ids.begin(), ids.end(), a ), ids.end() );
+               if( ids.empty() ) positions_by_owner.erase( old->owner );
+            }
+            if( !erase ) {
+               auto& ids = positions_by_owner[std::get<position>( value ).owner];
+               ids.insert( std::lower_bound( ids.begin(), ids.end(), a ), a );
+            }
+            break;
+         }
+         case table_kind::stake_balance:
+            update( stake_balances, balance_key{ a, b }, stake_balance() );
+            break;
+         case table_kind::deposit:
+            update( deposits, a, asset() );
+            break;
+      }
+
+      if( record ) undo.back().entries.push_back( undo_entry{ kind, a, b, std::move( previous ) } );
+   }
+
+   void state::learn_symbol( uint64_t symbol ) {
+      symbols[code_of( symbol )] = symbol;
+   }
+
+   uint64_t state::symbol_of( uint64_t code ) const {
+      if( const asset* s = supplies.find( code ) ) return s->symbol;
+      if( const uint64_t* s = symbols.find( code ) ) return *s;
+      return code << 8;
+   }
+
+   void state::mark_richlist( uint64_t code ) {
+      std::lock_guard<std::mutex> lock( richlist_mutex );
+      richlists[code].dirty = true;
+   }
+
+   std::vector<asset> state::balances( uint64_t owner ) const {
+      std::vector<asset> out;
+      symbols.for_each( [&]( uint64_t code, uint64_t ) {
+         if( accounts.find( balance_key{ owner, code } ) || compact.find( balance_key{ owner, code } ) )
+            out.push_back( balance( owner, code ) );
+      } );
+      std::sort( out.begin(), out.end(), []( const asset& x, const asset& y ) { return x.symbol < y.symbol; } );
+      return out;
+   }
+
+   asset state::balance( uint64_t owner, uint64_t code ) const {
+      asset b{ 0, symbol_of( code ) };
+      if( const int64_t* v = accounts.find( balance_key{ owner, code } ) ) b.amount += *v;
+      if( const int64_t* v = compact.find( balance_key{ owner, code } ) ) b.amount += *v;
+      return b;
+   }
+
+   std::optional<asset> state::supply( uint64_t code ) const {
+      if( const asset* s = supplies.find( code ) ) return *s;
+      return std::nullopt;
+   }
+
+   std::vector<std::pair<uint64_t, asset>> state::richlist( uint64_t code, size_t limit ) const {
+      std::lock_guard<std::mutex> lock( richlist_mutex );
+      auto& cache = richlists[code];
+      if( cache.dirty ) {
+         // an owner has a legacy and a compact row only while it migrates; sum them
+         flat_map<uint64_t, int64_t> totals_by_owner;
+         auto add = [&]( const balance_key& k, int64_t amount ) {
+            if( k.code == code ) totals_by_owner[k.owner] += amount;
+         };
+         accounts.for_each( add );
+         compact.for_each( add );
+         cache.sorted.clear();
+         cache.sorted.reserve( totals_by_owner.size() );
+         totals_by_owner.for_each( [&]( uint64_t owner, int64_t amount ) {
+            if( amount > 0 ) cache.sorted.emplace_back( amount, owner );
+         } );
+         std::sort( cache.sorted.begin(), cache.sorted.end(), []( const auto& x, const auto& y ) {
+            return x.first != y.first ? x.first > y.first : x.second < y.second;
+         } );
+         cache.dirty = false;
+      }
+      std::vector<std::pair<uint64_t, asset>> out;
+      const uint64_t symbol = symbol_of( code );
+      for( size_t i = 0; i < cache.sorted.size() && i < limit; ++i )
+         out.emplace_back( cache.sorted[i].second, asset{ cache.sorted[i].first, symbol } );
+      return out;
+   }
+
+   std::vector<position> state::positions( uint64_t owner ) const {
+      std::vector<position> out;
+      if( const auto* ids = positions_by_owner.find( owner ) )
+         for( uint64_t id : *ids ) out.push_back( *positions_by_id.find( id ) );
+      return out;
+   }
+
+   std::optional<position> state::find_position( uint64_t id ) const {
+      if( const position* p = positions_by_id.find( id ) ) return *p;
+      return std::nullopt;
+   }
+
+   std::optional<stake_balance> state::find_stake_balance( uint64_t owner, uint64_t code ) const {
+      if( const stake_balance* b = stake_balances.find( balance_key{ owner, code } ) ) return *b;
+      return std::nullopt;
+   }
+
+   std::optional<asset> state::deposit( uint64_t account ) const {
+      if( const asset* d = deposits.find( account ) ) return *d;
+      return std::nullopt;
+   }
+
+   namespace {
+
+      // row_value: variant index, then the value
+      template<typename Value>
+      void write_value( bin_writer& out, const Value& v ) {
+         out.raw( uint8_t(v.index()) );
+         if( auto* x = std::get_if<int64_t>( &v ) ) out.raw( *x );
+         else if( auto* x = std::get_if<asset>( &v ) ) write_asset( out, *x );
+         else if( auto* x = std::get_if<position>( &v ) ) write_position( out, *x );
+         else if( auto* x = std::get_if<stake_balance>( &v ) ) { write_asset( out, x->funds ); out.raw( x->token_contract ); }
+      }
+
+      template<typename Value>
+      Value read_value( bin_reader& in ) {
+         switch( in.raw<uint8_t>() ) {
+            case 0: return Value();
+            case 1: return in.raw<int64_t>();
+            case 2: return read_asset( in );
+            case 3: return read_position( in );
+            case 4: {
+               stake_balance b;
+               b.funds = read_asset( in );
+               b.token_contract = in.raw<uint64_t>();
+               return b;
+            }
+         }
+         throw indexer_error( "corrupt checkpoint" );
+      }
+
+   }
+
+   void state::save( const std::string& path ) const {
+      bin_writer out;
+      out.bytes( checkpoint_magic, sizeof(checkpoint_magic) );
+      write_block( out, head_block );
+      out.raw( irreversible );
+
+      auto write_balances = [&]( const auto& map ) {
+         out.varuint32( map.size() );
+         map.for_each( [&]( const balance_key& k, int64_t amount ) { out.raw( k.owner ); out.raw( k.code ); out.raw( amount ); } );
+      };
+      write_balances( accounts );
+      write_balances( compact );
+      out.varuint32( supplies.size() );
+      supplies.for_each( [&]( uint64_t code, const asset& s ) { out.raw( code ); write_asset( out, s ); } );
+      out.varuint32( positions_by_id.size() );
+      positions_by_id.for_each( [&]( uint64_t, const position& p ) { write_position( out, p ); } );
+      out.varuint32( stake_balances.size() );
+      stake_balances.for_each( [&]( const balance_key& k, const stake_balance& b ) {
+         out.raw( k.owner ); out.raw( k.code ); write_asset( out, b.funds ); out.raw( b.token_contract );
+      } );
+      out.varuint32( deposits.size() );
+      deposits.for_each( [&]( uint64_t account, const asset& d ) { out.raw( account ); write_asset( out, d ); } );
+      out.varuint32( symbols.size() );
+      symbols.for_each( [&]( uint64_t code, uint64_t symbol ) { out.raw( code ); out.raw( symbol ); } );
+
+      out.varuint32( undo.size() );
+      for( const auto& u : undo ) {
+         write_block( out, u.block );
+         out.varuint32( u.entries.size() );
+         for( const auto& e : u.entries ) {
+            out.raw( uint8_t(e.kind) );
+            out.raw( e.a );
+            out.raw( e.b );
+            write_value( out, e.previous );
+         }
+      }
+
+      const std::string tmp = path + ".tmp";
+      {
+         std::ofstream f( tmp, std::ios::binary | std::ios::trunc );
+         f.write( out.data.data(), std::streamsize(out.data.size()) );
+         if( !f.flush() ) throw indexer_error( "cannot write " + tmp );
+      }
+      if( std::rename( tmp.c_str(), path.c_str() ) != 0 ) throw indexer_error( "cannot rename " + tmp + " to " + path );
+   }
+
+   bool state::load( const std::string& path ) {
+      if( !std::ifstream( path ) ) return false;
+      const std::string data = read_file( path );
+      bin_reader in( data.data(), data.size() );
+      char magic[sizeof(checkpoint_magic)];
+      in.bytes( magic, sizeof(magic) );
+      if( !std::equal( magic, magic + sizeof(magic), checkpoint_magic ) ) throw indexer_error( path + " is not an indexer checkpoint" );
+
+      head_block = read_block( in );
+      irreversible = in.raw<uint32_t>();
+
+      auto read_balances = [&]( auto& map ) {
+         map.clear();
+         uint64_t n = in.varuint32();
+         map.reserve( n );
+         for( ; n; --n ) {
+            balance_key k;
+            k.owner = in.raw<uint64_t>();
+            k.code = in.raw<uint64_t>();
+            map[k] = in.raw<int64_t>();
+         }
+      };
+      read_balances( accounts );
+      read_balances( compact );
+      supplies.clear();
+      for( uint64_t n = in.varuint32(); n; --n ) {
+         const uint64_t code = in.raw<uint64_t>();
+         supplies[code] = read_asset( in );
+      }
+      positions_by_id.clear();
+      positions_by_owner.clear();
+      for( uint64_t n = in.varuint32(); n; --n ) {
+         const position p = read_position( in );
+         positions_by_id[p.id] = p;
+         auto& ids = positions_by_owner[p.owner];
+         ids.insert( std::lower_bound( ids.begin(), ids.end(), p.id ), p.id );
+      }
+      stake_balances.clear();
+      for( uint64_t n = in.varuint32(); n; --n ) {
+         balance_key k;
+         k.owner = in.raw<uint64_t>();
+         k.code = in.raw<uint64_t>();
+         stake_balance b;
+         b.funds = read_asset( in );
+         b.token_contract = in.raw<uint64_t>();
+         stake_balances[k] = b;
+      }
+      deposits.clear();
+      for( uint64_t n = in.varuint32(); n; --n ) {
+         const uint64_t account = in.raw<uint64_t>();
+         deposits[account] = read_asset( in );
+      }
+      symbols.clear();
+      for( uint64_t n = in.varuint32(); n; --n ) {
+         const uint64_t code = in.raw<uint64_t>();
+         symbols[code] = in.raw<uint64_t>();
+      }
+
+      undo.clear();
+      for( uint64_t n = in.varuint32(); n; --n ) {
+         undo_block u;
+         u.block = read_block( in );
+         for( uint64_t m = in.varuint32(); m; --m ) {
+            undo_entry e;
+            e.kind = table_kind( in.raw<uint8_t>() );
+            e.a = in.raw<uint64_t>();
+            e.b = in.raw<uint64_t>();
+            e.previous = read_value<row_value>( in );
+            u.entries.push_back( std::move( e ) );
+         }
+         undo.push_back( std::move( u ) );
+      }
+      if( in.remaining() ) throw indexer_error( "trailing data in checkpoint " + path );
+
+      std::lock_guard<std::mutex> lock( richlist_mutex );
+      richlists.clear();
+      return true;
+   }
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "abi.hpp"
+#include "flat_map.hpp"
+#include "ship.hpp"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <variant>
+
+// The indexed contract tables, kept in flat hash maps keyed like the contract rows:
+//
+//    hagglextoken   accounts, cbalances, stat     token balances and supplies
+//    hagglexstake   positions, balances           stake positions and deposited funds
+//    hagglexsale    deposit                       sale deposits
+//
+// Every change records the previous row in the undo log of its block, so blocks
+// above the last irreversible one can be rolled back when the chain forks. The rich
+// list of a symbol is a sorted vector, rebuilt on the first query after a change.
+
+namespace hagglex::shipidx {
+
+   struct indexer_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   // the accounts running each contract and their ABIs; a zero account is not indexed
+   struct contract_set {
+      uint64_t token = 0;
+      uint64_t stake = 0;
+      uint64_t sale = 0;
+      abi      token_abi;
+      abi      stake_abi;
+      abi      sale_abi;
+   };
+
+   struct balance_key {
+      uint64_t owner = 0;
+      uint64_t code = 0;      // symbol code
+
+      bool operator==( const balance_key& o ) const { return owner == o.owner && code == o.code; }
+   };
+
+   struct balance_key_hash {
+      uint64_t operator()( const balance_key& k ) const { return mix_hash( k.owner ^ mix_hash( k.code ) ); }
+   };
+
+   struct position {
+      uint64_t id = 0;
+      uint64_t owner = 0;
+      asset    staked;
+      float    interest_rate = 0;
+      asset    interest_paid;
+      uint32_t last_interest_paid_time = 0;
+      uint32_t staked_time = 0;
+      uint32_t expiration_time = 0;
+   };
+
+   struct stake_balance {
+      asset    funds;
+      uint64_t token_contract = 0;
+   };
+
+   class state {
+      public:
+         explicit state( const contract_set& contracts ) : contracts(contracts) {}
+
+         // applies one block: rolls back to block.block_num - 1 first when the block
+         // replaces indexed ones, then takes its rows, then drops undo data at or
+         // below last_irreversible
+         void begin_block( const ship::block_position& block, const std::optional<ship::block_position>& prev,
+                           uint32_t last_irreversible );
+         void apply( const ship::contract_row& row );
+         void end_block();
+
+         const ship::block_position& head() const { return head_block; }
+         uint32_t last_irreversible() const { return irreversible; }
+         // blocks that can still be rolled back, for get_blocks_request have_positions
+         std::vector<ship::block_position> reversible_blocks() const;
+
+         struct counters {
+            uint64_t blocks = 0;
+            uint64_t rows = 0;
+            uint64_t rollbacks = 0;
+            uint64_t rolled_back_blocks = 0;
+         };
+         const counters& stats() const { return totals; }
+
+         // queries; amounts carry the precision of the token's supply when it is known
+         std::vector<asset>   balances( uint64_t owner ) const;
+         asset                balance( uint64_t owner, uint64_t code ) const;
+         std::optional<asset> supply( uint64_t code ) const;
+         std::vector<std::pair<uint64_t, asset>> richlist( uint64_t code, size_t limit ) const;
+         std::vector<position> positions( uint64_t owner ) const;
+         std::optional<position> find_position( uint64_t id ) const;
+         std::optional<stake_balance> find_stake_balance( uint64_t owner, uint64_t code ) const;
+         std::optional<asset> deposit( uint64_t account ) const;
+
+         size_t holders() const { return accounts.size() + compact.size(); }
+         size_t position_count() const { return positions_by_id.size(); }
+
+         // compact binary checkpoint of the tables, the head and the undo log;
+         // save writes a temporary file and renames it over `path`
+         void save( const std::string& path ) const;
+         bool load( const std::string& path );      // false when the file does not exist
+
+      private:
+         enum class table_kind : uint8_t { account, compact, stat, position, stake_balance, deposit };
+         using row_value = std::variant<std::monostate, int64_t, asset, position, stake_balance>;
+
+         struct undo_entry {
+            table_kind  kind;
+            uint64_t    a = 0;
+            uint64_t    b = 0;
+            row_value   previous;
+         };
+
+         struct undo_block {
+            ship::block_position    block;
+            std::vector<undo_entry> entries;
+         };
+
+         struct richlist_cache {
+            bool                                      dirty = true;
+            std::vector<std::pair<int64_t, uint64_t>> sorted;    // amount descending, then owner
+         };
+
+         const contract_set&  contracts;
+
+         flat_map<balance_key, int64_t, balance_key_hash>         accounts;         // (owner, code)
+         flat_map<balance_key, int64_t, balance_key_hash>         compact;          // (owner, code)
+         flat_map<uint64_t, asset>                                supplies;         // code -> supply
+         flat_map<uint64_t, position>                             positions_by_id;
+         flat_map<uint64_t, std::vector<uint64_t>>                positions_by_owner;   // sorted ids
+         flat_map<balance_key, stake_balance, balance_key_hash>   stake_balances;   // (owner, code)
+         flat_map<uint64_t, asset>                                deposits;         // account -> tokens
+         flat_map<uint64_t, uint64_t>                             symbols;          // code -> symbol, as last seen
+
+         ship::block_position    head_block;
+         uint32_t                irreversible = 0;
+         std::deque<undo_block>  undo;
+         counters                totals;
+
+         mutable std::mutex                            richlist_mutex;
+         mutable std::map<uint64_t, richlist_cache>    richlists;
+
+         // sets (or erases, for monostate) one row, recording its previous value when record is set
+         void set_row( table_kind kind, uint64_t a, uint64_t b, const row_value& value, bool record );
+         void rollback_to( uint32_t block_num );
+         uint64_t symbol_of( uint64_t code ) const;
+         void learn_symbol( uint64_t symbol );
+         void mark_richlist( uint64_t code );
+   };
+
+}
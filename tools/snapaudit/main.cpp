@@ -0,0 +1,513 @@
+// snapaudit: reads a nodeos portable snapshot in place, extracts the contract tables of
+// the HaggleX accounts and decodes their rows on all cores into CSV or per-column files,
+// checking the cross-table invariants (balances against supply, stake positions against
+// deposited funds, sale deposit keys) in the same pass.
+
+#include "abi.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <tuple>
+
+using namespace hagglex;
+
+namespace {
+
+   struct snapshot_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   constexpr uint32_t snapshot_magic = 0x30510550;
+   constexpr uint64_t end_marker = ~uint64_t(0);
+
+   // packed sizes of the secondary index rows (primary_key, payer, key), in the order
+   // contract_database_index_set walks them after the key_value rows
+   constexpr size_t secondary_row_sizes[] = { 8 + 8 + 8,      // index64
+                                              8 + 8 + 16,     // index128
+                                              8 + 8 + 32,     // index256
+                                              8 + 8 + 8,      // index_double
+                                              8 + 8 + 16 };   // index_long_double
+
+   struct section {
+      std::string name;
+      uint64_t    row_count = 0;
+      const char* rows = nullptr;
+      size_t      size = 0;
+   };
+
+   // one table of the contract_tables section; `rows` spans its key_value rows
+   struct table_instance {
+      uint64_t    code = 0;
+      uint64_t    scope = 0;
+      uint64_t    table = 0;
+      uint32_t    count = 0;
+      const char* rows = nullptr;
+      size_t      rows_size = 0;
+   };
+
+   struct contract {
+      uint64_t account = 0;
+      abi      def;
+   };
+
+   // a decoded table instance: cells row by row, and the field names of its struct
+   struct decoded {
+      std::vector<std::string> fields;
+      std::vector<std::string> cells;     // (scope, primary_key, payer, fields...) per row
+      size_t                   rows = 0;
+   };
+
+   // ---- invariants ------------------------------------------------------------------
+
+   using amount_key = std::tuple<uint64_t, uint64_t, uint64_t>;    // contract, account or 0, symbol code
+
+   struct audit_totals {
+      std::map<amount_key, __int128> supply;          // stat
+      std::map<amount_key, __int128> balances;        // accounts + cbalances, summed per symbol
+      std::map<amount_key, __int128> staked;          // positions per owner
+      std::map<amount_key, __int128> funds;           // stake balances per owner
+      std::vector<std::string>       violations;      // row-level problems
+
+      void merge( audit_totals& o ) {
+         for( auto [mine, theirs] : { std::pair{ &supply, &o.supply }, { &balances, &o.balances }, { &staked, &o.staked }, { &funds, &o.funds } } )
+            for( const auto& [k, v] : *theirs ) (*mine)[k] += v;
+         violations.insert( violations.end(), o.violations.begin(), o.violations.end() );
+      }
+   };
+
+   std::string format_amount( __int128 amount, uint64_t code, const std::map<uint64_t, uint64_t>& symbols ) {
+      auto it = symbols.find( code );
+      const uint64_t symbol = it == symbols.end() ? code << 8 : it->second;
+      if( amount >= INT64_MIN && amount <= INT64_MAX ) return asset_to_string( asset{ int64_t(amount), symbol } );
+      return "(overflow) " + symbol_code_to_string( code );
+   }
+
+   const uint64_t accounts_table  = string_to_name( "accounts" );
+   const uint64_t cbalances_table = string_to_name( "cbalances" );
+   const uint64_t stat_table      = string_to_name( "stat" );
+   const uint64_t positions_table = string_to_name( "positions" );
+   const uint64_t balances_table  = string_to_name( "balances" );
+   const uint64_t deposit_table   = string_to_name( "deposit" );
+
+   // feeds one decoded row into the totals
+   void audit_row( const table_instance& t, uint64_t primary_key, const json& row, audit_totals& totals,
+                   std::map<uint64_t, uint64_t>& symbols ) {
+      auto where = [&]() {
+         return name_to_string( t.code ) + "/" + name_to_string( t.table ) + " scope " + name_to_string( t.scope ) +
+                " key " + std::to_string( primary_key );
+      };
+      if( t.table == accounts_table ) {
+         const asset b = string_to_asset( row["balance"].as_string() );
+         symbols[b.symbol >> 8] = b.symbol;
+         totals.balances[{ t.code, 0, b.symbol >> 8 }] += b.amount;
+         if( b.amount < 0 ) totals.violations.push_back( where() + ": negative balance" );
+         if( primary_key != b.symbol >> 8 ) totals.violations.push_back( where() + ": key is not the balance symbol" );
+      } else if( t.table == cbalances_table ) {
+         const int64_t amount = row["amount"].as_int64();
+         totals.balances[{ t.code, 0, t.scope }] += amount;
+         if( amount < 0 ) totals.violations.push_back( where() + ": negative balance" );
+      } else if( t.table == stat_table ) {
+         const asset s = string_to_asset( row["supply"].as_string() );
+         const asset m = string_to_asset( row["max_supply"].as_string() );
+         symbols[s.symbol >> 8] = s.symbol;
+         totals.supply[{ t.code, 0, s.symbol >> 8 }] += s.amount;
+         if( s.amount > m.amount ) totals.violations.push_back( where() + ": supply above max_supply" );
+      } else if( t.table == positions_table ) {
+         const asset staked = string_to_asset( row["staked_asset"].as_string() );
+         totals.staked[{ t.code, string_to_name( row["position_owner"].as_string() ), staked.symbol >> 8 }] += staked.amount;
+         if( row["position_id"].as_uint64() != primary_key ) totals.violations.push_back( where() + ": key is not position_id" );
+      } else if( t.table == balances_table ) {
+         const asset funds = string_to_asset( row["funds"].as_string() );
+         totals.funds[{ t.code, t.scope, funds.symbol >> 8 }] += funds.amount;
+      } else if( t.table == deposit_table ) {
+         if( string_to_name( row["account"].as_string() ) != primary_key ) totals.violations.push_back( where() + ": key is not the account" );
+         if( string_to_asset( row["tokens"].as_string() ).amount < 0 ) totals.violations.push_back( where() + ": negative deposit" );
+      }
+   }
+
+   // ---- snapshot layout -------------------------------------------------------------
+
+   // sections of a binary snapshot: [uint64 size][uint64 row count][name\0][rows], the
+   // size counting everything after itself, then an all-ones end marker
+   std::vector<section> read_sections( const char* data, size_t size, uint32_t& version ) {
+      bin_reader in( data, size );
+      if( in.raw<uint32_t>() != snapshot_magic ) throw snapshot_error( "not a binary nodeos snapshot" );
+      version = in.raw<uint32_t>();
+      std::vector<section> out;
+      while( true ) {
+         const uint64_t section_size = in.raw<uint64_t>();
+         if( section_size == end_marker ) break;
+         bin_reader body( in.skip( section_size ), section_size );
+         section s;
+         s.row_count = body.raw<uint64_t>();
+         const char* name = body.cursor();
+         const void* nul = std::memchr( name, 0, body.remaining() );
+         if( !nul ) throw snapshot_error( "unterminated section name" );
+         s.name.assign( name, static_cast<const char*>(nul) );
+         body.skip( s.name.size() + 1 );
+         s.rows = body.cursor();
+         s.size = body.remaining();
+         out.push_back( std::move( s ) );
+      }
+      return out;
+   }
+
+   // walks contract_tables: per table a table_id row (code, scope, table, payer, count),
+   // then for the key_value index and each secondary index a varuint row count and the
+   // rows; keeps the tables of `contracts`, skipping everything else without decoding
+   std::vector<table_instance> scan_contract_tables( const section& s, const std::vector<contract>& contracts ) {
+      std::vector<table_instance> out;
+      bin_reader in( s.rows, s.size );
+      while( in.remaining() ) {
+         table_instance t;
+         t.code  = in.raw<uint64_t>();
+         t.scope = in.raw<uint64_t>();
+         t.table = in.raw<uint64_t>();
+         in.raw<uint64_t>();                   // payer
+         t.count = in.raw<uint32_t>();
+
+         const uint64_t kv_rows = in.varuint32();
+         t.rows = in.cursor();
+         for( uint64_t i = 0; i < kv_rows; ++i ) {
+            in.skip( 16 );                     // primary_key, payer
+            in.skip( in.varuint32() );         // value
+         }
+         t.rows_size = size_t(in.cursor() - t.rows);
+         for( size_t row_size : secondary_row_sizes ) in.skip( in.varuint32() * row_size );
+
+         const bool wanted = std::any_of( contracts.begin(), contracts.end(), [&]( const contract& c ) { return c.account == t.code; } );
+         if( wanted && kv_rows ) out.push_back( t );
+      }
+      return out;
+   }
+
+   // block number of the snapshot: the first field of the block header state
+   std::optional<uint32_t> snapshot_block( const std::vector<section>& sections ) {
+      for( const auto& s : sections )
+         if( s.name == "eosio::chain::block_state" && s.size >= 4 ) {
+            uint32_t num;
+            std::memcpy( &num, s.rows, 4 );
+            return num;
+         }
+      return std::nullopt;
+   }
+
+   // ---- decoding --------------------------------------------------------------------
+
+   std::string cell( const json& v ) {
+      switch( v.type() ) {
+         case json::kind::null:    return "";
+         case json::kind::boolean: return v.as_bool() ? "true" : "false";
+         case json::kind::number:
+         case json::kind::string:  return v.as_string();
+         default:                  return v.dump();
+      }
+   }
+
+   decoded decode_table( const table_instance& t, const abi& def, const std::string& type, audit_totals& totals,
+                         std::map<uint64_t, uint64_t>& symbols, bool keep_cells ) {
+      decoded out;
+      bin_reader in( t.rows, t.rows_size );
+      while( in.remaining() ) {
+         const uint64_t primary_key = in.raw<uint64_t>();
+         const uint64_t payer = in.raw<uint64_t>();
+         const size_t size = in.varuint32();
+         bin_reader value( in.skip( size ), size );
+         const json row = def.bin_to_json( type, value );
+         audit_row( t, primary_key, row, totals, symbols );
+         ++out.rows;
+         if( !keep_cells ) continue;
+         if( out.fields.empty() )
+            for( const auto& m : row.members() ) out.fields.push_back( m.first );
+         out.cells.push_back( name_to_string( t.scope ) );
+         out.cells.push_back( std::to_string( primary_key ) );
+         out.cells.push_back( name_to_string( payer ) );
+         for( const auto& m : row.members() ) out.cells.push_back( cell( m.second ) );
+      }
+      return out;
+   }
+
+   // ---- output ----------------------------------------------------------------------
+
+   std::string csv_escape( const std::string& s ) {
+      if( s.find_first_of( ",\"\n\r" ) == std::string::npos ) return s;
+      std::string out = "\"";
+      for( char c : s ) {
+         if( c == '"' ) out += '"';
+         out += c;
+      }
+      return out + "\"";
+   }
+
+   // csv: <out>/<contract>.<table>.csv with a header line; columns: a directory
+   // <out>/<contract>.<table>/ holding one <column>.txt per column, one value per line
+   class table_writer {
+      public:
+         table_writer( const std::string& dir, const std::string& base, bool columnar ) : dir(dir), base(base), columnar(columnar) {}
+
+         void write( const decoded& d ) {
+            if( d.cells.empty() ) return;
+            if( files.empty() ) open( d.fields );
+            const size_t width = header_width;
+            for( size_t r = 0; r < d.cells.size(); r += width ) {
+               if( columnar ) {
+                  for( size_t c = 0; c < width; ++c ) {
+                     std::string v = d.cells[r + c];
+                     std::replace( v.begin(), v.end(), '\n', ' ' );
+                     *files[c] << v << '\n';
+                  }
+               } else {
+                  for( size_t c = 0; c < width; ++c ) *files[0] << (c ? "," : "") << csv_escape( d.cells[r + c] );
+                  *files[0] << '\n';
+               }
+            }
+         }
+
+      private:
+         std::string                                 dir;
+         std::string                                 base;
+         bool                                        columnar;
+         size_t                                      header_width = 0;
+         std::vector<std::unique_ptr<std::ofstream>> files;
+
+         void open( const std::vector<std::string>& fields ) {
+            std::vector<std::string> columns = { "scope", "primary_key", "payer" };
+            columns.insert( columns.end(), fields.begin(), fields.end() );
+            header_width = columns.size();
+            auto open_file = [&]( const std::string& path ) {
+               files.push_back( std::make_unique<std::ofstream>( path, std::ios::trunc ) );
+               if( !*files.back() ) throw snapshot_error( "cannot write " + path );
+            };
+            if( columnar ) {
+               const std::string table_dir = dir + "/" + base;
+               ::mkdir( table_dir.c_str(), 0755 );
+               for( const auto& c : columns ) open_file( table_dir + "/" + c + ".txt" );
+            } else {
+               open_file( dir + "/" + base + ".csv" );
+               for( size_t c = 0; c < columns.size(); ++c ) *files[0] << (c ? "," : "") << columns[c];
+               *files[0] << '\n';
+            }
+         }
+   };
+
+   // ---- driver ----------------------------------------------------------------------
+
+   struct table_summary {
+      uint64_t tables = 0;
+      uint64_t rows = 0;
+   };
+
+   struct options {
+      std::vector<contract> contracts;
+      std::string           out_dir;
+      bool                  columnar = false;
+      bool                  as_json = false;
+      unsigned              threads = std::max( 1u, std::thread::hardware_concurrency() );
+   };
+
+   int usage() {
+      std::cerr << "usage: snapaudit --contract ACCOUNT=ABI... [--out DIR [--format csv|columns]] [--threads N] [--json] SNAPSHOT\n";
+      return 2;
+   }
+
+   int audit( const options& opts, const char* data, size_t size ) {
+      uint32_t version = 0;
+      const auto sections = read_sections( data, size, version );
+      auto ct = std::find_if( sections.begin(), sections.end(), []( const section& s ) { return s.name == "contract_tables"; } );
+      if( ct == sections.end() ) throw snapshot_error( "snapshot has no contract_tables section" );
+      const auto tables = scan_contract_tables( *ct, opts.contracts );
+
+      // table instances in snapshot order, decoded by all threads in batches and written
+      // in order, so the output does not depend on the thread count
+      std::vector<std::pair<const abi*, std::string>> types( tables.size() );
+      std::map<std::pair<uint64_t, uint64_t>, uint64_t> skipped;      // (contract, table) not in the ABI
+      for( size_t i = 0; i < tables.size(); ++i ) {
+         for( const auto& c : opts.contracts )
+            if( c.account == tables[i].code ) types[i] = { &c.def, c.def.table_type( tables[i].table ) };
+         if( types[i].second.empty() ) ++skipped[{ tables[i].code, tables[i].table }];
+      }
+
+      std::map<std::pair<uint64_t, uint64_t>, table_summary> summary;
+      std::map<std::pair<uint64_t, uint64_t>, std::unique_ptr<table_writer>> writers;
+      std::vector<audit_totals> totals( opts.threads );
+      std::vector<std::map<uint64_t, uint64_t>> symbols( opts.threads );
+      std::vector<std::string> errors( opts.threads );
+
+      const size_t batch = 8192;
+      for( size_t begin = 0; begin < tables.size(); begin += batch ) {
+         const size_t end = std::min( tables.size(), begin + batch );
+         std::vector<decoded> results( end - begin );
+         std::atomic<size_t> next{ begin };
+         auto work = [&]( unsigned worker ) {
+            try {
+               for( size_t i; (i = next++) < end; )
+                  if( !types[i].second.empty() )
+                     results[i - begin] = decode_table( tables[i], *types[i].first, types[i].second, totals[worker],
+                                                        symbols[worker], !opts.out_dir.empty() );
+            } catch( const std::exception& e ) {
+               errors[worker] = e.what();
+               next = end;
+            }
+         };
+         std::vector<std::thread> pool;
+         for( unsigned w = 1; w < opts.threads; ++w ) pool.emplace_back( work, w );
+         work( 0 );
+         for( auto& t : pool ) t.join();
+         for( const auto& e : errors )
+            if( !e.empty() ) throw snapshot_error( e );
+
+         for( size_t i = begin; i < end; ++i ) {
+            const auto key = std::make_pair( tables[i].code, tables[i].table );
+            if( types[i].second.empty() ) continue;
+            auto& s = summary[key];
+            ++s.tables;
+            s.rows += results[i - begin].rows;
+            if( opts.out_dir.empty() ) continue;
+            auto& w = writers[key];
+            if( !w ) w = std::make_unique<table_writer>( opts.out_dir, name_to_string( key.first ) + "." + name_to_string( key.second ), opts.columnar );
+            w->write( results[i - begin] );
+         }
+      }
+
+      audit_totals all;
+      std::map<uint64_t, uint64_t> all_symbols;
+      for( unsigned w = 0; w < opts.threads; ++w ) {
+         all.merge( totals[w] );
+         all_symbols.insert( symbols[w].begin(), symbols[w].end() );
+      }
+
+      // cross-table invariants
+      std::vector<std::pair<std::string, std::string>> checks;      // description, failure or empty
+      for( const auto& [k, supply] : all.supply ) {
+         const auto it = all.balances.find( k );
+         const __int128 held = it == all.balances.end() ? 0 : it->second;
+         const std::string what = name_to_string( std::get<0>( k ) ) + " " + symbol_code_to_string( std::get<2>( k ) ) +
+                                  ": balances sum to supply " + format_amount( supply, std::get<2>( k ), all_symbols );
+         checks.emplace_back( what, held == supply ? "" : "balances sum to " + format_amount( held, std::get<2>( k ), all_symbols ) );
+      }
+      for( const auto& [k, held] : all.balances )
+         if( !all.supply.count( k ) )
+            checks.emplace_back( name_to_string( std::get<0>( k ) ) + " " + symbol_code_to_string( std::get<2>( k ) ) + ": balances have a stat row",
+                                 "no stat row for " + format_amount( held, std::get<2>( k ), all_symbols ) + " of balances" );
+      uint64_t overstaked = 0;
+      std::string first_overstaked;
+      for( const auto& [k, staked] : all.staked ) {
+         const auto it = all.funds.find( k );
+         const __int128 funds = it == all.funds.end() ? 0 : it->second;
+         if( staked > funds && !overstaked++ )
+            first_overstaked = name_to_string( std::get<1>( k ) ) + " stakes " + format_amount( staked, std::get<2>( k ), all_symbols ) +
+                               " with " + format_amount( funds, std::get<2>( k ), all_symbols ) + " deposited";
+      }
+      if( !all.staked.empty() )
+         checks.emplace_back( "positions stay within deposited funds",
+                              overstaked ? std::to_string( overstaked ) + " owners stake more than they deposited, e.g. " + first_overstaked : "" );
+      checks.emplace_back( "row-level checks", all.violations.empty() ? "" : std::to_string( all.violations.size() ) + " rows, e.g. " + all.violations.front() );
+
+      const auto block = snapshot_block( sections );
+      const bool ok = std::all_of( checks.begin(), checks.end(), []( const auto& c ) { return c.second.empty(); } );
+      if( opts.as_json ) {
+         json out = json::object();
+         out.set( "snapshot_version", json::number( uint64_t(version) ) );
+         out.set( "block", block ? json::number( uint64_t(*block) ) : json() );
+         json list = json::array();
+         for( const auto& [key, s] : summary ) {
+            json j = json::object();
+            j.set( "contract", name_to_string( key.first ) );
+            j.set( "table", name_to_string( key.second ) );
+            j.set( "scopes", json::number( s.tables ) );
+            j.set( "rows", json::number( s.rows ) );
+            list.push_back( j );
+         }
+         out.set( "tables", list );
+         json jc = json::array();
+         for( const auto& [what, failure] : checks ) {
+            json j = json::object();
+            j.set( "check", what );
+            j.set( "ok", failure.empty() );
+            if( !failure.empty() ) j.set( "failure", failure );
+            jc.push_back( j );
+         }
+         out.set( "checks", jc );
+         std::cout << out.dump() << "\n";
+      } else {
+         std::printf( "snapshot v%u, block %s\n", version, block ? std::to_string( *block ).c_str() : "unknown" );
+         for( const auto& [key, s] : summary )
+            std::printf( "%-14s %-12s %8llu scopes %10llu rows\n", name_to_string( key.first ).c_str(), name_to_string( key.second ).c_str(),
+                         (unsigned long long)s.tables, (unsigned long long)s.rows );
+         for( const auto& [key, n] : skipped )
+            std::printf( "%-14s %-12s %8llu scopes not in the ABI, skipped\n", name_to_string( key.first ).c_str(),
+                         name_to_string( key.second ).c_str(), (unsigned long long)n );
+         for( const auto& [what, failure] : checks )
+            std::printf( "%s %s%s%s\n", failure.empty() ? "ok  " : "FAIL", what.c_str(), failure.empty() ? "" : ": ", failure.c_str() );
+      }
+      return ok ? 0 : 1;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   options opts;
+   const char* path = nullptr;
+   try {
+      for( int i = 1; i < argc; ++i ) {
+         std::string arg = argv[i];
+         if( arg == "--contract" && i + 1 < argc ) {
+            std::string spec = argv[++i];
+            auto eq = spec.find( '=' );
+            if( eq == std::string::npos ) return usage();
+            opts.contracts.push_back( { string_to_name( spec.substr( 0, eq ) ), abi::load( spec.substr( eq + 1 ) ) } );
+         }
+         else if( arg == "--out" && i + 1 < argc ) opts.out_dir = argv[++i];
+         else if( arg == "--format" && i + 1 < argc ) {
+            std::string f = argv[++i];
+            if( f != "csv" && f != "columns" ) return usage();
+            opts.columnar = f == "columns";
+         }
+         else if( arg == "--threads" && i + 1 < argc ) opts.threads = unsigned(std::max( 1, std::atoi( argv[++i] ) ));
+         else if( arg == "--json" ) opts.as_json = true;
+         else if( arg[0] != '-' && !path ) path = argv[i];
+         else return usage();
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << "snapaudit: " << e.what() << "\n";
+      return 2;
+   }
+   if( !path || opts.contracts.empty() ) return usage();
+   if( !opts.out_dir.empty() ) ::mkdir( opts.out_dir.c_str(), 0755 );
+
+   int fd = ::open( path, O_RDONLY );
+   struct stat st;
+   if( fd < 0 || fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+      std::cerr << "snapaudit: cannot open " << path << "\n";
+      return 2;
+   }
+   void* m = mmap( nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+   if( m == MAP_FAILED ) {
+      std::cerr << "snapaudit: cannot map " << path << "\n";
+      return 2;
+   }
+   int rc;
+   try {
+      rc = audit( opts, static_cast<const char*>( m ), size_t(st.st_size) );
+   } catch( const std::exception& e ) {
+      std::cerr << "snapaudit: " << e.what() << "\n";
+      rc = 2;
+   }
+   munmap( m, size_t(st.st_size) );
+   ::close( fd );
+   return rc;
+}
@@ -0,0 +1,237 @@
+// stakesim: Monte Carlo projection of staking interest, pool liabilities and mint timing
+// over years, running the contracts' own economics (hagglex_common/economics.hpp) against
+// an in-memory model of their tables in virtual time. Scenarios run on all cores through
+// a work-stealing pool; the output is percentile curves across scenarios, per value of a
+// swept parameter.
+
+#include "model.hpp"
+#include "work_stealing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace hagglex;
+using namespace hagglex::stakesim;
+
+namespace {
+
+   struct options {
+      params                   base;
+      size_t                   scenarios = 1000;
+      uint64_t                 seed = 1;
+      unsigned                 threads = std::max( 1u, std::thread::hardware_concurrency() );
+      std::vector<double>      percentiles = { 5, 50, 95 };
+      std::string              sweep_name;
+      std::vector<std::string> sweep_values;
+      std::string              csv_path;
+   };
+
+   int usage() {
+      std::cerr << "usage: stakesim [--scenarios N] [--seed N] [--threads N] [--percentiles P/P/...] [--csv FILE]\n"
+                   "                [--sweep NAME=VALUE,VALUE...] [--NAME VALUE]...\n"
+                   "parameters: rates P/P/P, mix S/S/S, tiers SUPPLY:REWARD/..., years, step-days, stakers,\n"
+                   "            stakers-spread, arrival-days, amount, amount-sigma, restake, restake-spread,\n"
+                   "            claim-days, unstake-days, supply, pool, mint-share, mint-every-hours, mint-miss\n";
+      return 2;
+   }
+
+   // splitmix64, so neighbouring scenario numbers get unrelated generator seeds
+   uint64_t scenario_seed( uint64_t seed, uint64_t scenario ) {
+      uint64_t z = seed + (scenario + 1) * 0x9e3779b97f4a7c15ULL;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+   }
+
+   std::string tokens( int64_t amount ) {
+      char buf[40];
+      std::snprintf( buf, sizeof(buf), "%s%lld.%04lld", amount < 0 ? "-" : "",
+                     (long long)(std::llabs( amount ) / 10000), (long long)(std::llabs( amount ) % 10000) );
+      return buf;
+   }
+
+   std::string format( metric m, int64_t value ) {
+      return m == positions ? std::to_string( value ) : tokens( value );
+   }
+
+   // nearest-rank percentile of sorted values
+   template<typename T>
+   T percentile( const std::vector<T>& sorted, double p ) {
+      size_t rank = size_t(std::ceil( p / 100 * sorted.size() ));
+      return sorted[std::min( sorted.size() - 1, rank ? rank - 1 : 0 )];
+   }
+
+   struct run_summary {
+      std::vector<std::vector<std::vector<int64_t>>> curves;   // [metric][sample][percentile]
+      std::vector<int64_t>                           mint_end;     // per percentile, -1 never
+      std::vector<int64_t>                           pool_empty;
+   };
+
+   run_summary run( const options& opts, const params& p ) {
+      const size_t samples = sample_count( p );
+      std::vector<scenario_result> results( opts.scenarios );
+      work_stealing_pool pool( opts.threads );
+      pool.run( opts.scenarios, [&]( size_t scenario, unsigned ) {
+         simulate( p, scenario_seed( opts.seed, scenario ), results[scenario] );
+      });
+
+      run_summary summary;
+      summary.curves.assign( metric_count, std::vector<std::vector<int64_t>>( samples ) );
+      std::vector<int64_t> values( results.size() );
+      for( size_t m = 0; m < metric_count; ++m ) {
+         for( size_t i = 0; i < samples; ++i ) {
+            for( size_t s = 0; s < results.size(); ++s ) values[s] = results[s].curve( metric(m), samples )[i];
+            std::sort( values.begin(), values.end() );
+            for( double pc : opts.percentiles ) summary.curves[m][i].push_back( percentile( values, pc ) );
+         }
+      }
+      // "never" sorts after every day
+      auto event_percentiles = [&]( int64_t scenario_result::*event ) {
+         std::vector<int64_t> days;
+         for( const auto& r : results ) days.push_back( r.*event < 0 ? INT64_MAX : r.*event );
+         std::sort( days.begin(), days.end() );
+         std::vector<int64_t> out;
+         for( double pc : opts.percentiles ) {
+            const int64_t d = percentile( days, pc );
+            out.push_back( d == INT64_MAX ? -1 : d );
+         }
+         return out;
+      };
+      summary.mint_end   = event_percentiles( &scenario_result::mint_end_day );
+      summary.pool_empty = event_percentiles( &scenario_result::pool_empty_day );
+      return summary;
+   }
+
+   void print_summary( const options& opts, const params& p, const run_summary& summary ) {
+      auto header = [&]( const char* first ) {
+         std::printf( "  %-26s", first );
+         for( double pc : opts.percentiles ) std::printf( " %16s", ("p" + std::to_string( int(pc) )).c_str() );
+         std::printf( "\n" );
+      };
+      header( "" );
+      // one row per metric at the end of every year
+      for( uint32_t year = 1; year <= p.years; ++year ) {
+         const size_t sample = std::min( summary.curves[0].size() - 1, size_t(year) * 365 / p.step_days );
+         for( size_t m = 0; m < metric_count; ++m ) {
+            char label[40];
+            std::snprintf( label, sizeof(label), "year %u %s", year, metric_names[m] );
+            std::printf( "  %-26s", label );
+            for( int64_t v : summary.curves[m][sample] ) std::printf( " %16s", format( metric(m), v ).c_str() );
+            std::printf( "\n" );
+         }
+      }
+      auto event = [&]( const char* label, const std::vector<int64_t>& days ) {
+         std::printf( "  %-26s", label );
+         for( int64_t d : days ) std::printf( " %16s", d < 0 ? "never" : ("day " + std::to_string( d )).c_str() );
+         std::printf( "\n" );
+      };
+      event( "mint ends", summary.mint_end );
+      event( "pool runs out", summary.pool_empty );
+   }
+
+   void write_csv( std::ofstream& csv, const params& p, const std::string& label,
+                   const run_summary& summary ) {
+      for( size_t m = 0; m < metric_count; ++m ) {
+         for( size_t i = 0; i < summary.curves[m].size(); ++i ) {
+            csv << label << ',' << i * p.step_days << ',' << metric_names[m];
+            for( int64_t v : summary.curves[m][i] ) csv << ',' << format( metric(m), v );
+            csv << '\n';
+         }
+      }
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   options opts;
+   try {
+      for( int i = 1; i < argc; ++i ) {
+         std::string arg = argv[i];
+         if( arg.rfind( "--", 0 ) != 0 || i + 1 >= argc ) return usage();
+         const std::string name = arg.substr( 2 );
+         const std::string value = argv[++i];
+         if( name == "scenarios" ) opts.scenarios = std::max( 1L, std::atol( value.c_str() ) );
+         else if( name == "seed" ) opts.seed = std::strtoull( value.c_str(), nullptr, 10 );
+         else if( name == "threads" ) opts.threads = unsigned(std::max( 1, std::atoi( value.c_str() ) ));
+         else if( name == "csv" ) opts.csv_path = value;
+         else if( name == "percentiles" ) {
+            opts.percentiles.clear();
+            size_t start = 0;
+            while( start <= value.size() ) {
+               size_t end = value.find( '/', start );
+               if( end == std::string::npos ) end = value.size();
+               const double pc = std::atof( value.substr( start, end - start ).c_str() );
+               if( pc <= 0 || pc > 100 ) return usage();
+               opts.percentiles.push_back( pc );
+               start = end + 1;
+            }
+         }
+         else if( name == "sweep" ) {
+            const size_t eq = value.find( '=' );
+            if( eq == std::string::npos ) return usage();
+            opts.sweep_name = value.substr( 0, eq );
+            size_t start = eq + 1;
+            while( start <= value.size() ) {
+               size_t end = value.find( ',', start );
+               if( end == std::string::npos ) end = value.size();
+               opts.sweep_values.push_back( value.substr( start, end - start ) );
+               start = end + 1;
+            }
+            params check = opts.base;
+            for( const auto& v : opts.sweep_values )
+               if( !set_param( check, opts.sweep_name, v ) ) return usage();
+         }
+         else if( !set_param( opts.base, name, value ) ) return usage();
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << "stakesim: " << e.what() << "\n";
+      return 2;
+   }
+
+   // without a sweep, one run of the base parameters
+   std::vector<std::pair<std::string, params>> runs;
+   if( opts.sweep_name.empty() ) runs.push_back( { "base", opts.base } );
+   for( const auto& v : opts.sweep_values ) {
+      params p = opts.base;
+      set_param( p, opts.sweep_name, v );
+      runs.push_back( { opts.sweep_name + "=" + v, p } );
+   }
+
+   std::ofstream csv;
+   if( !opts.csv_path.empty() ) {
+      csv.open( opts.csv_path );
+      if( !csv ) {
+         std::cerr << "stakesim: cannot write " << opts.csv_path << "\n";
+         return 2;
+      }
+      csv << "run,day,metric";
+      for( double pc : opts.percentiles ) csv << ",p" << pc;
+      csv << '\n';
+   }
+
+   std::printf( "%zu scenarios, %.0f stakers (median), %u years, seed %llu\n",
+                opts.scenarios, opts.base.stakers, opts.base.years, (unsigned long long)opts.seed );
+   try {
+      for( const auto& [label, p] : runs ) {
+         const auto began = std::chrono::steady_clock::now();
+         const run_summary summary = run( opts, p );
+         const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - began ).count();
+         std::printf( "%s\n", label.c_str() );
+         print_summary( opts, p, summary );
+         std::fflush( stdout );
+         if( csv.is_open() ) write_csv( csv, p, label, summary );
+         std::fprintf( stderr, "%s: %zu scenarios in %.2f s on %u threads\n", label.c_str(), opts.scenarios, seconds, opts.threads );
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << "stakesim: " << e.what() << "\n";
+      return 2;
+   }
+   return 0;
+}
@@ -0,0 +1,233 @@
+#include "model.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace hagglex::stakesim {
+
+   namespace {
+
+      constexpr double base_units = 10000;      // HAG has 4 decimals
+
+      std::vector<std::string> split( const std::string& s, char sep ) {
+         std::vector<std::string> parts;
+         size_t start = 0;
+         for( size_t i = 0; i <= s.size(); ++i ) {
+            if( i == s.size() || s[i] == sep ) {
+               parts.push_back( s.substr( start, i - start ) );
+               start = i + 1;
+            }
+         }
+         return parts;
+      }
+
+      double to_double( const std::string& s ) {
+         size_t used = 0;
+         const double v = std::stod( s, &used );
+         if( used != s.size() || !std::isfinite( v ) || v < 0 ) throw std::invalid_argument( "bad number: " + s );
+         return v;
+      }
+
+      uint32_t to_uint( const std::string& s ) {
+         const double v = to_double( s );
+         if( v != std::floor( v ) || v > 1e9 ) throw std::invalid_argument( "bad count: " + s );
+         return uint32_t(v);
+      }
+
+      double to_share( const std::string& s ) {
+         const double v = to_double( s );
+         if( v > 1 ) throw std::invalid_argument( "not between 0 and 1: " + s );
+         return v;
+      }
+
+      // virtual time is seconds since the token was created and the stake contract opened
+      struct curves {
+         size_t                               samples;
+         uint32_t                             step;
+         std::vector<int64_t>                 diff;      // per metric, samples + 1 for events past the end
+
+         curves( size_t samples, uint32_t step ) : samples( samples ), step( step ), diff( metric_count * (samples + 1) ) {}
+
+         // from the first sample at or after `time` on
+         void add( metric m, uint64_t time, int64_t delta ) {
+            const size_t sample = std::min<uint64_t>( (time + step - 1) / step, samples );
+            diff[m * (samples + 1) + sample] += delta;
+         }
+
+         void finish( scenario_result& out ) const {
+            out.curves.assign( metric_count * samples, 0 );
+            for( size_t m = 0; m < metric_count; ++m ) {
+               int64_t value = 0;
+               for( size_t i = 0; i < samples; ++i ) {
+                  value += diff[m * (samples + 1) + i];
+                  out.curves[m * samples + i] = value;
+               }
+            }
+         }
+      };
+
+   }
+
+   bool set_param( params& p, const std::string& name, const std::string& value ) {
+      if( name == "rates" ) {
+         const auto parts = split( value, '/' );
+         if( parts.size() != p.terms.size() ) throw std::invalid_argument( "rates takes one percent per stake term" );
+         for( size_t i = 0; i < parts.size(); ++i ) {
+            const uint32_t percent = to_uint( parts[i] );
+            if( percent == 0 || percent > 65535 ) throw std::invalid_argument( "bad rate: " + parts[i] );
+            p.terms[i].percent = uint16_t(percent);
+         }
+      }
+      else if( name == "mix" ) {
+         const auto parts = split( value, '/' );
+         if( parts.size() != p.mix.size() ) throw std::invalid_argument( "mix takes one share per stake term" );
+         for( size_t i = 0; i < parts.size(); ++i ) p.mix[i] = to_double( parts[i] );
+         if( p.mix[0] + p.mix[1] + p.mix[2] <= 0 ) throw std::invalid_argument( "mix is all zero" );
+      }
+      else if( name == "tiers" ) {
+         const auto parts = split( value, '/' );
+         if( parts.size() > p.schedule.size() ) throw std::invalid_argument( "at most 6 reward tiers" );
+         for( size_t i = 0; i < p.schedule.size(); ++i ) {
+            if( i >= parts.size() ) {
+               p.schedule[i] = { -1, 0 };      // never matches
+               continue;
+            }
+            const auto tier = split( parts[i], ':' );
+            if( tier.size() != 2 ) throw std::invalid_argument( "reward tier is SUPPLY:REWARD: " + parts[i] );
+            p.schedule[i] = { int64_t(to_uint( tier[0] )), int64_t(to_uint( tier[1] )) };
+         }
+      }
+      else if( name == "years" ) {
+         p.years = to_uint( value );
+         if( p.years == 0 || p.years > 100 ) throw std::invalid_argument( "years must be 1 to 100" );
+      }
+      else if( name == "step-days" ) {
+         p.step_days = to_uint( value );
+         if( p.step_days == 0 ) throw std::invalid_argument( "step-days must be positive" );
+      }
+      else if( name == "stakers" )          p.stakers = to_double( value );
+      else if( name == "stakers-spread" )   p.stakers_spread = to_double( value );
+      else if( name == "arrival-days" )     p.arrival_days = to_uint( value );
+      else if( name == "amount" )           p.amount_median = to_double( value );
+      else if( name == "amount-sigma" )     p.amount_sigma = to_double( value );
+      else if( name == "restake" )          p.restake = to_share( value );
+      else if( name == "restake-spread" )   p.restake_spread = to_share( value );
+      else if( name == "claim-days" )       p.claim_days = to_uint( value );
+      else if( name == "unstake-days" )     p.unstake_days = to_double( value );
+      else if( name == "supply" )           p.supply = to_double( value );
+      else if( name == "pool" )             p.pool = to_double( value );
+      else if( name == "mint-share" )       p.mint_share = to_share( value );
+      else if( name == "mint-miss" )        p.mint_miss = to_share( value );
+      else if( name == "mint-every-hours" ) {
+         p.mint_every_hours = to_uint( value );
+         if( p.mint_every_hours == 0 ) throw std::invalid_argument( "mint-every-hours must be positive" );
+      }
+      else return false;
+      return true;
+   }
+
+   size_t sample_count( const params& p ) {
+      return size_t(p.years) * 365 / p.step_days + 1;
+   }
+
+   void simulate( const params& p, uint64_t seed, scenario_result& out ) {
+      using economics::seconds_per_day;
+
+      std::mt19937_64 rng( seed );
+      std::normal_distribution<double> normal;
+      std::uniform_real_distribution<double> unit;
+      std::discrete_distribution<size_t> pick_term( p.mix.begin(), p.mix.end() );
+
+      const size_t   samples = sample_count( p );
+      const uint32_t step    = p.step_days * seconds_per_day;
+      const uint64_t horizon = uint64_t(samples - 1) * step;
+      curves c( samples, step );
+      out.mint_end_day = -1;
+
+      // scenario-wide draws: how many stakers come, and how loyal they are
+      const uint64_t stakers = uint64_t(std::llround( p.stakers * std::exp( p.stakers_spread * normal( rng ) ) ));
+      const double restake = std::clamp( p.restake + p.restake_spread * (2 * unit( rng ) - 1), 0.0, 1.0 );
+
+      // most claims cover exactly claim_every seconds; their factor is worked out once
+      const uint64_t claim_every = uint64_t(p.claim_days) * seconds_per_day;
+      std::array<fixed_point, 3> rates, claim_factors;
+      for( size_t i = 0; i < rates.size(); ++i ) {
+         rates[i] = fixed_point::percent( p.terms[i].percent );
+         claim_factors[i] = economics::accrual_factor( rates[i], uint32_t(claim_every) );
+      }
+
+      for( uint64_t s = 0; s < stakers; ++s ) {
+         uint64_t start = uint64_t(unit( rng ) * p.arrival_days * seconds_per_day);
+         const int64_t amount = std::max<int64_t>( 1, std::llround( p.amount_median * std::exp( p.amount_sigma * normal( rng ) ) * base_units ) );
+
+         // one position after another until the staker leaves or time runs out
+         while( start < horizon ) {
+            const size_t   term       = pick_term( rng );
+            const uint64_t expiration = start + uint64_t(p.terms[term].days) * seconds_per_day;
+            const uint64_t delay      = p.unstake_days > 0
+                                        ? uint64_t(-std::log( 1 - unit( rng ) ) * p.unstake_days * seconds_per_day) : 0;
+            const uint64_t unstake    = expiration + delay;
+
+            c.add( staked, start, amount );
+            c.add( staked, unstake, -amount );
+            c.add( positions, start, 1 );
+            c.add( positions, unstake, -1 );
+
+            // claim pays economics::claimable; an amount that truncates to zero is left
+            // accruing
+            uint64_t last_paid = start;
+            auto claim = [&]( uint64_t now ) {
+               const int64_t pay = now <= expiration && now - last_paid == claim_every
+                                   ? claim_factors[term].apply( amount )
+                                   : economics::claimable( amount, rates[term], uint32_t(last_paid),
+                                                           uint32_t(expiration), uint32_t(now) );
+               if( pay == 0 ) return;
+               c.add( interest_paid, now, pay );
+               c.add( liability, start, pay );
+               c.add( liability, now, -pay );
+               last_paid = now;
+            };
+            if( claim_every )
+               for( uint64_t t = start + claim_every; t < expiration; t += claim_every ) claim( t );
+            claim( unstake );
+
+            if( unit( rng ) >= restake ) break;
+            start = unstake;
+         }
+      }
+
+      // the issuer calls mint every few hours; a call issues when mint_due allows it
+      int64_t supply_now = std::llround( p.supply * base_units );
+      uint32_t minetime = 0;
+      const uint32_t call_every = p.mint_every_hours * 3600;
+      c.add( supply, 0, supply_now );
+      for( uint64_t now = call_every; now <= horizon; now += call_every ) {
+         const int64_t reward = economics::reward( supply_now, p.schedule ) * economics::mint_scale;
+         // issue rejects a zero quantity, and supply only grows, so either ends minting
+         if( reward == 0 || !economics::mint_due( supply_now, 0, 0, UINT32_MAX ) ) {
+            out.mint_end_day = int64_t(now / seconds_per_day);
+            break;
+         }
+         if( p.mint_miss > 0 && unit( rng ) < p.mint_miss ) continue;
+         if( !economics::mint_due( supply_now, 0, minetime, uint32_t(now) ) ) continue;
+         supply_now += reward;
+         minetime = uint32_t(now);
+         c.add( supply, now, reward );
+         c.add( pool, now, int64_t(double(reward) * p.mint_share) );
+      }
+      c.add( pool, 0, std::llround( p.pool * base_units ) );
+
+      c.finish( out );
+      // the pool pays out every claim
+      int64_t* pool_curve = out.curves.data() + pool * samples;
+      const int64_t* paid_curve = out.curves.data() + interest_paid * samples;
+      out.pool_empty_day = -1;
+      for( size_t i = 0; i < samples; ++i ) {
+         pool_curve[i] -= paid_curve[i];
+         if( pool_curve[i] < 0 && out.pool_empty_day < 0 ) out.pool_empty_day = int64_t(i) * p.step_days;
+      }
+   }
+
+}
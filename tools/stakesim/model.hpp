@@ -0,0 +1,65 @@
+#pragma once
+
+#include <hagglex_common/economics.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One Monte Carlo scenario of the staking and mint economics, in virtual time. Stake
+// terms, accrual and the mint schedule are the contracts' own code from
+// hagglex_common/economics.hpp; the chain around them is reduced to what they read:
+// position rows, the token supply and the mint timestamps.
+
+namespace hagglex::stakesim {
+
+   // the assumptions of a run; token amounts are in whole HAG
+   struct params {
+      economics::stake_terms     terms    = economics::default_stake_terms;
+      economics::reward_schedule schedule = economics::default_reward_schedule;
+      std::array<double, 3>      mix      = { { 50, 30, 20 } };   // relative share of stakes per term
+
+      uint32_t years            = 5;
+      uint32_t step_days        = 30;       // spacing of the curve samples
+      double   stakers          = 10000;    // median stakers per scenario
+      double   stakers_spread   = 0.25;     // lognormal sigma of the staker count across scenarios
+      uint32_t arrival_days     = 365;      // stakers make their first stake uniformly over these days
+      double   amount_median    = 1000;
+      double   amount_sigma     = 1.0;      // lognormal sigma of a staker's amount
+      double   restake          = 0.6;      // chance a staker stakes again when a position ends
+      double   restake_spread   = 0.1;      // the chance varies by up to this much across scenarios
+      uint32_t claim_days       = 30;       // 0: interest is only claimed by unstake
+      double   unstake_days     = 3;        // mean delay between expiration and unstake
+      double   supply           = 0;        // token supply at the start
+      double   pool             = 1000000;  // tokens hagglexstake holds to pay interest
+      double   mint_share       = 0;        // share of each mint added to the pool
+      uint32_t mint_every_hours = 1;        // how often the issuer calls mint
+      double   mint_miss        = 0;        // chance a mint call is not made
+   };
+
+   // sets the parameter called `name` (the option name without --); false when unknown,
+   // throws std::invalid_argument on a bad value
+   bool set_param( params& p, const std::string& name, const std::string& value );
+
+   enum metric : uint8_t { staked, positions, interest_paid, liability, supply, pool, metric_count };
+
+   inline constexpr const char* metric_names[metric_count] =
+      { "staked", "positions", "interest_paid", "liability", "supply", "pool" };
+
+   // the curves of one scenario: value of each metric at every sample, metric-major;
+   // token amounts in base units. liability is the interest open positions will still be
+   // paid, accrued or not.
+   struct scenario_result {
+      std::vector<int64_t> curves;
+      int64_t              mint_end_day   = -1;    // first day mint can no longer issue, -1 never
+      int64_t              pool_empty_day = -1;    // first sample with the pool below zero, -1 never
+
+      const int64_t* curve( metric m, size_t samples ) const { return curves.data() + m * samples; }
+   };
+
+   size_t sample_count( const params& p );
+
+   void simulate( const params& p, uint64_t seed, scenario_result& out );
+
+}
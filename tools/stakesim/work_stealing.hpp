@@ -0,0 +1,80 @@
+#pragma once
+
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hagglex::stakesim {
+
+   // Runs tasks 0..count-1 on a fixed number of threads. Each worker starts with an even
+   // share of the tasks in its own deque and takes from its back; a worker whose deque is
+   // empty steals from the front of the others, so scenarios that run long (many stakers,
+   // many restakes) do not leave the other cores idle at the end. No task adds tasks, so
+   // a worker that finds every deque empty is done.
+   class work_stealing_pool {
+      public:
+         explicit work_stealing_pool( unsigned threads ) : threads( threads ? threads : 1 ) {}
+
+         // calls f(task, worker) once per task; rethrows the first exception a task threw
+         template<typename F>
+         void run( size_t count, F&& f ) {
+            std::vector<std::unique_ptr<queue>> queues;
+            for( unsigned w = 0; w < threads; ++w ) queues.push_back( std::make_unique<queue>() );
+            for( size_t task = 0; task < count; ++task )
+               queues[task * threads / count]->tasks.push_back( task );
+
+            std::exception_ptr failure;
+            std::mutex failure_mutex;
+            auto work = [&]( unsigned self ) {
+               size_t task;
+               while( take( queues, self, task ) ) {
+                  try {
+                     f( task, self );
+                  } catch( ... ) {
+                     std::lock_guard<std::mutex> lock( failure_mutex );
+                     if( !failure ) failure = std::current_exception();
+                  }
+               }
+            };
+            std::vector<std::thread> workers;
+            for( unsigned w = 1; w < threads; ++w ) workers.emplace_back( work, w );
+            work( 0 );
+            for( auto& t : workers ) t.join();
+            if( failure ) std::rethrow_exception( failure );
+         }
+
+      private:
+         struct queue {
+            std::mutex         mutex;
+            std::deque<size_t> tasks;
+         };
+
+         unsigned threads;
+
+         bool take( std::vector<std::unique_ptr<queue>>& queues, unsigned self, size_t& task ) {
+            {
+               queue& own = *queues[self];
+               std::lock_guard<std::mutex> lock( own.mutex );
+               if( !own.tasks.empty() ) {
+                  task = own.tasks.back();
+                  own.tasks.pop_back();
+                  return true;
+               }
+            }
+            for( unsigned i = 1; i < threads; ++i ) {
+               queue& victim = *queues[(self + i) % threads];
+               std::lock_guard<std::mutex> lock( victim.mutex );
+               if( !victim.tasks.empty() ) {
+                  task = victim.tasks.front();
+                  victim.tasks.pop_front();
+                  return true;
+               }
+            }
+            return false;
+         }
+   };
+
+}
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# Writes loops.wasm and loops.abi, the wasmcost fixture: a contract whose actions scan a
+# table the way CDT builds do, each with a different exit test. page stops at a limit it
+# reads through the pointer execute_action passes, collect when a vector filled in the
+# loop reaches that limit, sweep counts a budget passed by value down to zero, drain the
+# same budget kept in memory, as a lambda capturing it by reference does, and fixed stops
+# after 10 rows; scan has no exit test but the end of the table, and bykey stops at the
+# end of a key, so its count argument bounds nothing.
+import json
+import struct
+
+def name(s):
+    charmap = '.12345abcdefghijklmnopqrstuvwxyz'
+    v = 0
+    for i in range(13):
+        c = charmap.index(s[i]) if i < len(s) else 0
+        v |= (c & (0x1f if i < 12 else 0x0f)) << (64 - 5 * (i + 1) if i < 12 else 0)
+    return v
+
+def uleb(n):
+    out = b''
+    while True:
+        b = n & 0x7f
+        n >>= 7
+        out += bytes([b | (0x80 if n else 0)])
+        if not n:
+            return out
+
+def sleb(n):
+    out = b''
+    while True:
+        b = n & 0x7f
+        n >>= 7
+        done = (n == 0 and not b & 0x40) or (n == -1 and b & 0x40)
+        out += bytes([b | (0 if done else 0x80)])
+        if done:
+            return out
+
+def vec(items):
+    return uleb(len(items)) + b''.join(items)
+
+def string(s):
+    return uleb(len(s)) + s.encode()
+
+def section(sid, body):
+    return bytes([sid]) + uleb(len(body)) + body
+
+I32, I64 = 0x7f, 0x7e
+
+def functype(params, results):
+    return b'\x60' + vec([bytes([p]) for p in params]) + vec([bytes([r]) for r in results])
+
+# instructions
+block, loop, end, ret = b'\x02\x40', b'\x03\x40', b'\x0b', b'\x0f'
+br = lambda d: b'\x0c' + uleb(d)
+br_if = lambda d: b'\x0d' + uleb(d)
+call = lambda f: b'\x10' + uleb(f)
+drop = b'\x1a'
+get = lambda i: b'\x20' + uleb(i)
+put = lambda i: b'\x21' + uleb(i)
+i32c = lambda v: b'\x41' + sleb(v)
+i64c = lambda v: b'\x42' + sleb(v - (1 << 64) if v >= 1 << 63 else v)
+i32_load = lambda off: b'\x28\x02' + uleb(off)
+i64_load = lambda off: b'\x29\x03' + uleb(off)
+i32_store = lambda off: b'\x36\x02' + uleb(off)
+i32_eqz, i32_eq, i32_lt_s, i64_ne = b'\x45', b'\x46', b'\x48', b'\x52'
+i32_add, i32_sub, i32_div_u = b'\x6a', b'\x6b', b'\x6e'
+i64_extend = b'\xac'
+
+types = [
+    functype([I32, I32], [I32]),              # 0 read_action_data
+    functype([], [I32]),                      # 1 action_data_size
+    functype([I64, I64, I64, I64], [I32]),    # 2 db_lowerbound_i64
+    functype([I32, I32], [I32]),              # 3 db_next_i64
+    functype([I64, I64, I64], []),            # 4 apply
+    functype([], []),                         # 5 execute_action
+    functype([I32], []),                      # 6 an action taking one argument
+]
+imports = [('read_action_data', 0), ('action_data_size', 1), ('db_lowerbound_i64', 2), ('db_next_i64', 3)]
+READ, SIZE, LOWERBOUND, NEXT = range(4)
+
+DATA = 64           # where execute_action reads the action data to
+
+first = i64c(0) * 4 + call(LOWERBOUND)
+advance = lambda itr: get(itr) + i32c(0) + call(NEXT) + put(itr)
+at_end = lambda itr: get(itr) + i32c(0) + i32_lt_s + br_if(1)
+
+# name -> (fields, execute_action body, (action params, locals, body))
+actions = {
+    'scan': ([], call, ([], [I32],
+        first + put(0) + block + loop + at_end(0) + advance(0) + br(0) + end + end)),
+    'bykey': ([('key', 'uint64'), ('count', 'uint32')], lambda impl: i32c(DATA) + call(impl), ([I32], [I32],
+        first + put(1) + block + loop + at_end(1) +
+        get(1) + i64_extend + get(0) + i64_load(0) + i64_ne + br_if(1) +
+        advance(1) + br(0) + end + end)),
+    'page': ([('owner', 'name'), ('limit', 'uint32')], lambda impl: i32c(DATA + 8) + call(impl), ([I32], [I32, I32],
+        first + put(1) + block + loop + at_end(1) +
+        get(2) + get(0) + i32_load(0) + i32_eq + br_if(1) +
+        advance(1) + get(2) + i32c(1) + i32_add + put(2) + br(0) + end + end)),
+    'collect': ([('owner', 'name'), ('limit', 'uint32')], lambda impl: i32c(DATA + 8) + call(impl), ([I32], [I32, I32],
+        i32c(256) + put(2) + first + put(1) + block + loop + at_end(1) +
+        get(2) + i32_load(4) + get(2) + i32_load(0) + i32_sub + i32c(8) + i32_div_u +
+        get(0) + i32_load(0) + i32_eq + br_if(1) +
+        get(2) + get(2) + i32_load(4) + i32c(8) + i32_add + i32_store(4) +
+        advance(1) + br(0) + end + end)),
+    'sweep': ([('max_rows', 'uint32')], lambda impl: i32c(DATA) + i32_load(0) + call(impl), ([I32], [I32],
+        first + put(1) + block + loop + at_end(1) +
+        get(0) + i32_eqz + br_if(1) + get(0) + i32c(1) + i32_sub + put(0) +
+        advance(1) + br(0) + end + end)),
+    'drain': ([('max_rows', 'uint32')], lambda impl: i32c(DATA) + i32_load(0) + call(impl), ([I32], [I32, I32],
+        i32c(512) + put(1) + get(1) + get(0) + i32_store(0) + first + put(2) + block + loop + at_end(2) +
+        get(1) + i32_load(0) + i32_eqz + br_if(1) +
+        get(1) + get(1) + i32_load(0) + i32c(1) + i32_sub + i32_store(0) +
+        advance(2) + br(0) + end + end)),
+    'fixed': ([], call, ([], [I32, I32],
+        first + put(0) + block + loop + at_end(0) +
+        get(1) + i32c(10) + i32_eq + br_if(1) + get(1) + i32c(1) + i32_add + put(1) +
+        advance(0) + br(0) + end + end)),
+}
+
+APPLY = len(imports)
+functions = []      # (type, locals, body)
+dispatch = b''
+for i, (act, (fields, execute, (params, locals, body))) in enumerate(actions.items()):
+    execute_index = APPLY + 1 + 2 * i
+    impl_index = execute_index + 1
+    execute_body = i32c(DATA) + call(SIZE) + call(READ) + drop + execute(impl_index)
+    functions.append((5, [], execute_body))
+    functions.append((6 if params else 5, locals, body))
+    dispatch += block + get(2) + i64c(name(act)) + i64_ne + br_if(0) + call(execute_index) + ret + end
+functions.insert(0, (4, [], dispatch))
+
+def code(locals, body):
+    groups = vec([uleb(1) + bytes([t]) for t in locals])
+    fn = groups + body + end
+    return uleb(len(fn)) + fn
+
+module = b'\0asm' + struct.pack('<I', 1)
+module += section(1, vec(types))
+module += section(2, vec([string('env') + string(f) + b'\x00' + uleb(t) for f, t in imports]))
+module += section(3, vec([uleb(t) for t, _, _ in functions]))
+module += section(5, vec([b'\x00' + uleb(1)]))
+module += section(7, vec([string('apply') + b'\x00' + uleb(APPLY)]))
+module += section(10, vec([code(l, b) for _, l, b in functions]))
+
+with open('loops.wasm', 'wb') as f:
+    f.write(module)
+
+abi = {
+    '____comment': 'Actions of the wasmcost fixture, written by make_loops_wasm.py.',
+    'version': 'eosio::abi/1.1',
+    'types': [],
+    'structs': [{'name': act, 'base': '', 'fields': [{'name': n, 'type': t} for n, t in fields]}
+                for act, (fields, _, _) in actions.items()],
+    'actions': [{'name': act, 'type': act, 'ricardian_contract': ''} for act in actions],
+    'tables': [],
+}
+with open('loops.abi', 'w') as f:
+    json.dump(abi, f, indent=4)
+    f.write('\n')
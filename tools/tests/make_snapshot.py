@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Writes snapshot.bin, the snapaudit fixture: a binary nodeos snapshot holding only the
+# sections snapaudit reads, with HaggleX token, stake and sale tables (secondary index
+# rows included) next to an unrelated contract's table that must be skipped.
+import struct
+import sys
+
+def name(s):
+    charmap = '.12345abcdefghijklmnopqrstuvwxyz'
+    v = 0
+    for i in range(13):
+        c = charmap.index(s[i]) if i < len(s) else 0
+        v |= (c & (0x1f if i < 12 else 0x0f)) << (64 - 5 * (i + 1) if i < 12 else 0)
+    return v
+
+def symbol(precision, code):
+    v = precision
+    for i, c in enumerate(code):
+        v |= ord(c) << (8 * (i + 1))
+    return v
+
+def varuint(n):
+    out = b''
+    while True:
+        b = n & 0x7f
+        n >>= 7
+        out += bytes([b | (0x80 if n else 0)])
+        if not n:
+            return out
+
+u32 = lambda v: struct.pack('<I', v)
+u64 = lambda v: struct.pack('<Q', v)
+i64 = lambda v: struct.pack('<q', v)
+nm = lambda s: u64(name(s))
+HAG = symbol(4, 'HAG')
+asset = lambda amount: i64(amount) + u64(HAG)
+
+def table(code, scope, tbl, rows, idx64=()):
+    # table_id row, then key_value rows and the five secondary index groups
+    out = nm(code) + u64(scope) + nm(tbl) + nm(code) + u32(len(rows) + len(idx64))
+    out += varuint(len(rows))
+    for pk, value in rows:
+        out += u64(pk) + nm(code) + varuint(len(value)) + value
+    out += varuint(len(idx64))
+    for pk, key in idx64:
+        out += u64(pk) + nm(code) + u64(key)
+    out += varuint(0) * 4
+    return out
+
+def section(title, rows, count):
+    body = u64(count) + title.encode() + b'\0' + rows
+    return u64(len(body)) + body
+
+position = (u64(0) + nm('alice') + asset(1000000) + struct.pack('<f', 0.15) + asset(0) +
+            u32(0) + u32(1634212800) + u32(1641988800) + u64(1) + u64(1) + u64(1))
+tables = [
+    table('hagglextoken', symbol(0, 'HAG') >> 8, 'stat',
+          [(symbol(0, 'HAG') >> 8, asset(10000000) + asset(10000000000) + nm('hagglexsale') + u32(0) + u32(0))]),
+    table('hagglextoken', name('alice'), 'accounts', [(symbol(0, 'HAG') >> 8, asset(6000000))]),
+    table('hagglextoken', name('bob'), 'accounts', [(symbol(0, 'HAG') >> 8, asset(4000000))]),
+    table('hagglextoken', name('hagglextoken'), 'blacklist', [(name('carol'), nm('carol'))]),
+    table('eosio.token', name('alice'), 'accounts', [(symbol(0, 'EOS') >> 8, b'\x01\x02\x03')]),
+    table('hagglexstake', name('hagglexstake'), 'positions', [(0, position)],
+          idx64=[(0, name('alice'))]),
+    table('hagglexstake', name('alice'), 'balances', [(symbol(0, 'HAG') >> 8, asset(1500000) + nm('hagglextoken'))]),
+    table('hagglexsale', name('hagglexsale'), 'deposit', [(name('alice'), nm('alice') + asset(2500000))]),
+]
+
+out = u32(0x30510550) + u32(1)
+out += section('eosio::chain::chain_snapshot_header', u32(4), 1)
+out += section('eosio::chain::block_state', u32(123456) + b'\0' * 28, 1)
+out += section('contract_tables', b''.join(tables), len(tables))
+out += u64(0xffffffffffffffff)
+open(sys.argv[1] if len(sys.argv) > 1 else 'snapshot.bin', 'wb').write(out)
@@ -0,0 +1,906 @@
+// wasmcost: static cost analysis of contract builds. It recovers each action's code from
+// the dispatcher in `apply`, walks the call graph from there and finds the loops that
+// advance a table iterator (db_*_next or db_*_previous, called in the loop or in anything
+// it calls). Every action gets a worst-case host call count as a polynomial in n, the rows
+// such a loop visits. A loop is bounded when one of its exit tests compares a counter it
+// steps with a limit it does not change, and wasmcost traces that limit back through the
+// calls to a constant or to the action's data. An action with a loop that has no such
+// test is unbounded: wasmcost exits 1 unless the action is listed in --allow.
+
+#include "abi.hpp"
+#include "wasm.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+using namespace hagglex;
+
+namespace {
+
+   struct contract_spec {
+      std::string account;
+      std::string wasm_path;
+      std::string abi_path;
+   };
+
+   // host calls as a polynomial in n; terms[i] is the coefficient of n^i
+   struct cost {
+      std::vector<uint64_t> terms { 0 };
+
+      static uint64_t sat_add( uint64_t a, uint64_t b ) { return a + b < a ? UINT64_MAX : a + b; }
+
+      void add( const cost& o ) {
+         if( terms.size() < o.terms.size() ) terms.resize( o.terms.size(), 0 );
+         for( size_t i = 0; i < o.terms.size(); ++i ) terms[i] = sat_add( terms[i], o.terms[i] );
+      }
+
+      void add_constant( uint64_t v ) { terms[0] = sat_add( terms[0], v ); }
+
+      cost times_n() const {
+         cost c;
+         c.terms = terms;
+         c.terms.insert( c.terms.begin(), 0 );
+         return c;
+      }
+
+      void max_with( const cost& o ) {
+         if( terms.size() < o.terms.size() ) terms.resize( o.terms.size(), 0 );
+         for( size_t i = 0; i < o.terms.size(); ++i ) terms[i] = std::max( terms[i], o.terms[i] );
+      }
+
+      size_t degree() const {
+         for( size_t i = terms.size(); i-- > 1; ) if( terms[i] ) return i;
+         return 0;
+      }
+
+      // "12 + 5n + 2n^2", with `var` for n
+      std::string str( const std::string& var = "n" ) const {
+         std::string out;
+         for( size_t i = 0; i <= degree(); ++i ) {
+            if( i > 0 && terms[i] == 0 ) continue;
+            if( !out.empty() ) out += " + ";
+            if( i == 0 || terms[i] != 1 ) out += std::to_string( terms[i] );
+            if( i > 0 ) out += (i > 1 || var.size() > 1) && terms[i] != 1 ? "*" + var : var;
+            if( i > 1 ) out += "^" + std::to_string( i );
+         }
+         return out;
+      }
+   };
+
+   // where the limit of a loop's exit test comes from. Inside a function it can be one of
+   // the function's parameters, or a value read through one; the caller's summary turns
+   // that into what it passed.
+   struct bound {
+      enum kind_t : uint8_t {
+         none,          // no exit test on a counter: unbounded
+         invariant,     // a value the loop does not change, traced no further
+         param,         // parameter `value` of the function
+         deref,         // loaded through pointer parameter `value`
+         data,          // the action's data, as read_action_data delivered it
+         constant,      // `value` itself
+      };
+
+      kind_t   kind = none;
+      uint64_t value = 0;
+      uint8_t  width = 0;       // bytes the limit was loaded as, 0 when it was not loaded
+
+      int rank() const {
+         switch( kind ) {
+            case none:      return 0;
+            case invariant: return 1;
+            case param:
+            case deref:     return 2;
+            default:        return 3;
+         }
+      }
+
+      // of two bounds of one loop reached on different paths, the one to trust
+      static bound weaker( const bound& a, const bound& b ) { return b.rank() < a.rank() ? b : a; }
+   };
+
+   // a loop that advances a table iterator
+   struct loop_site {
+      uint32_t    function = 0;
+      uint32_t    pos = 0;          // byte offset of the loop opcode in the module
+      std::string advance;          // the iterator import it reaches
+
+      bool operator<( const loop_site& o ) const { return std::tie( function, pos ) < std::tie( o.function, o.pos ); }
+   };
+
+   // what running a function, or a range of its code, may cost
+   struct summary {
+      cost                           host_calls;
+      std::string                    advances;     // an iterator import reached, empty if none
+      std::map<loop_site, bound>     loops;
+      std::set<uint32_t>             recursion;    // functions reached again while being analysed
+      bool                           reads_data = false;   // calls read_action_data
+
+      void add( const summary& o ) {
+         host_calls.add( o.host_calls );
+         if( advances.empty() ) advances = o.advances;
+         add_loops( o );
+         recursion.insert( o.recursion.begin(), o.recursion.end() );
+         reads_data = reads_data || o.reads_data;
+      }
+
+      void add_loops( const summary& o ) {
+         for( const auto& [site, b] : o.loops ) {
+            auto [it, added] = loops.emplace( site, b );
+            if( !added ) it->second = bound::weaker( it->second, b );
+         }
+      }
+   };
+
+   bool advances_iterator( const std::string& import ) {
+      if( import.compare( 0, 3, "db_" ) != 0 ) return false;
+      auto ends_with = [&]( const std::string& suffix ) {
+         return import.size() >= suffix.size() && import.compare( import.size() - suffix.size(), suffix.size(), suffix ) == 0;
+      };
+      return ends_with( "_next" ) || ends_with( "_previous" ) || ends_with( "_next_i64" ) || ends_with( "_previous_i64" );
+   }
+
+   // ---- values --------------------------------------------------------------------------
+
+   // what the analyzer knows of a value on the operand stack or in a local: where it comes
+   // from, the local or memory cell it was read from plus a constant, and every local and
+   // cell it was computed from. Locals are keyed "L<index>", globals "G<index>", and a
+   // cell "[<address key>+<offset>]" when its address is such a value.
+   struct value {
+      bound                    origin;
+      std::string              key;
+      int64_t                  step = 0;
+      std::set<std::string>    reads;
+      std::vector<uint32_t>    compared;     // the comparisons a condition is made of
+
+      static value constant( uint64_t v ) {
+         value out;
+         out.origin = bound{ bound::constant, v, 0 };
+         return out;
+      }
+
+      bool is_constant() const { return origin.kind == bound::constant && key.empty(); }
+
+      // the same value with `delta` added, e.g. a counter stepped by one
+      value plus( int64_t delta ) const {
+         value out = *this;
+         out.compared.clear();
+         if( is_constant() ) out.origin.value += uint64_t(delta);
+         else out.step += delta;
+         return out;
+      }
+
+      // a value computed from `a` and `b` that neither is a constant offset of
+      static value combined( const value& a, const value& b ) {
+         value out;
+         out.reads = a.reads;
+         out.reads.insert( b.reads.begin(), b.reads.end() );
+         return out;
+      }
+
+      static std::string cell( const value& address, uint64_t offset ) {
+         if( address.key.empty() ) return {};
+         return "[" + address.key + "+" + std::to_string( address.step + int64_t(offset) ) + "]";
+      }
+   };
+
+   // bytes a load opcode reads
+   uint8_t load_width( uint16_t op ) {
+      switch( op ) {
+         case 0x29: case 0x2b: return 8;                       // i64.load, f64.load
+         case 0x2c: case 0x2d: case 0x30: case 0x31: return 1;
+         case 0x2e: case 0x2f: case 0x32: case 0x33: return 2;
+         default: return 4;
+      }
+   }
+
+   // call graph walker with per-function summaries; a loop whose body advances an
+   // iterator costs n times its body, any other loop once
+   class analyzer {
+      public:
+         explicit analyzer( const wasm::module& m ) : m(m) {
+            for( const auto& seg : m.elements )
+               for( uint32_t f : seg.functions )
+                  if( !m.is_import( f ) ) table_functions.insert( f );
+         }
+
+         const summary& function( uint32_t index ) {
+            auto it = done.find( index );
+            if( it != done.end() ) return it->second;
+            if( !visiting.insert( index ).second ) {
+               recursive_stub.recursion = { index };
+               return recursive_stub;
+            }
+            summary s = simulate( index );
+            visiting.erase( index );
+            s.recursion.erase( index );
+            return done[index] = std::move(s);
+         }
+
+         // one call instruction: a host call, a direct call or an indirect one. `args` are
+         // the values passed, for tracing the callee's loop limits into the caller;
+         // `data_read` says whether the caller has read the action data by then.
+         summary call( const wasm::instr& in, const std::vector<value>& args = {}, bool data_read = false ) {
+            summary s;
+            if( in.op == wasm::op::call && m.is_import( in.a ) ) {
+               s.host_calls.add_constant( 1 );
+               const std::string& field = m.imported_function( in.a ).field;
+               if( advances_iterator( field ) ) s.advances = field;
+               if( field == "read_action_data" ) s.reads_data = true;
+            } else if( in.op == wasm::op::call ) {
+               s = function( in.a );
+            } else {
+               // any table function of the signature could be called; take the costliest
+               const wasm::func_type& want = m.types.at( in.a );
+               for( uint32_t f : table_functions ) {
+                  const wasm::func_type& t = m.function_type( f );
+                  if( t.params != want.params || t.results != want.results ) continue;
+                  const summary& callee = function( f );
+                  s.host_calls.max_with( callee.host_calls );
+                  if( s.advances.empty() ) s.advances = callee.advances;
+                  s.add_loops( callee );
+                  s.recursion.insert( callee.recursion.begin(), callee.recursion.end() );
+                  s.reads_data = s.reads_data || callee.reads_data;
+               }
+            }
+            for( auto& [site, b] : s.loops ) b = passed( b, args, data_read );
+            return s;
+         }
+
+      private:
+         const wasm::module&           m;
+         std::map<uint32_t, summary>   done;
+         std::set<uint32_t>            visiting;
+         std::set<uint32_t>            table_functions;
+         summary                       recursive_stub;
+
+         // a callee's loop limit in terms of what the caller passed it
+         static bound passed( const bound& b, const std::vector<value>& args, bool data_read ) {
+            if( b.kind != bound::param && b.kind != bound::deref ) return b;
+            if( b.value >= args.size() ) return bound{ bound::invariant };
+            const bound& arg = args[b.value].origin;
+            if( b.kind == bound::param ) {
+               if( arg.kind == bound::none || arg.kind == bound::invariant ) return bound{ bound::invariant };
+               return bound{ arg.kind, arg.value, arg.width ? arg.width : b.width };
+            }
+            // read through a pointer: one the caller was given, or into its unpacked action data
+            if( arg.kind == bound::param ) return bound{ bound::deref, arg.value, b.width };
+            if( data_read ) return bound{ bound::data, 0, b.width };
+            return bound{ bound::invariant };
+         }
+
+         struct frame {
+            uint16_t                      op = 0;
+            size_t                        height = 0;     // operand stack height at entry
+            uint32_t                      arity = 0;
+            uint32_t                      pos = 0;
+            summary                       cost;
+            // loops only
+            std::vector<value>            entry;          // the locals when the loop was entered
+            std::map<std::string, value>  entry_cells;    // and the cells stored to before
+            std::map<std::string, bool>   writes;         // local or cell written: stepped by a constant
+            std::vector<std::pair<value, value>>   tests; // comparisons its branches take
+         };
+
+         // the limit of a loop's exit tests: a comparison of a value the loop steps with one
+         // it does not write. A counter tested against a constant, such as a budget counted
+         // down to zero, is limited by where it started.
+         static bound loop_bound( const frame& loop ) {
+            auto stepped = [&]( const value& v ) -> const std::string* {
+               for( const auto& r : v.reads ) {
+                  auto w = loop.writes.find( r );
+                  if( w != loop.writes.end() && w->second ) return &w->first;
+               }
+               return nullptr;
+            };
+            auto unchanged = [&]( const value& v ) {
+               for( const auto& r : v.reads ) if( loop.writes.count( r ) ) return false;
+               return true;
+            };
+
+            bound best;
+            for( const auto& [x, y] : loop.tests ) {
+               for( int side = 0; side < 2; ++side ) {
+                  const value& counter = side ? y : x;
+                  const value& limit   = side ? x : y;
+                  const std::string* c = stepped( counter );
+                  if( !c || !unchanged( limit ) ) continue;
+                  bound found{ bound::invariant };
+                  if( limit.is_constant() ) {
+                     const value* start = nullptr;
+                     if( (*c)[0] == 'L' ) start = &loop.entry.at( std::stoul( c->substr( 1 ) ) );
+                     else if( auto e = loop.entry_cells.find( *c ); e != loop.entry_cells.end() ) start = &e->second;
+                     if( start && start->origin.kind == bound::constant )
+                        found = bound{ bound::constant, std::max( start->origin.value, limit.origin.value ), 0 };
+                     else if( start && start->origin.kind != bound::none )
+                        found = start->origin;
+                  } else if( limit.origin.kind != bound::none ) {
+                     found = limit.origin;
+                  }
+                  if( found.rank() > best.rank() ) best = found;
+               }
+            }
+            return best;
+         }
+
+         // runs a function's code over symbolic values, in order, both arms of every
+         // branch one after the other
+         summary simulate( uint32_t f ) {
+            const wasm::function_body& body = m.functions[f - m.num_imported_functions];
+            const wasm::decoded_function d = wasm::decode( m, body );
+            const wasm::func_type& type = m.function_type( f );
+
+            std::vector<value> locals( type.params.size() + body.locals.size(), value::constant( 0 ) );
+            for( size_t i = 0; i < type.params.size(); ++i ) locals[i].origin = bound{ bound::param, i, 0 };
+
+            std::vector<std::pair<value, value>> comparisons;
+            std::map<std::string, value> cells;      // the last value stored to each cell
+            std::vector<value> stack;
+            std::vector<frame> frames( 1 );
+            frames[0].arity = uint32_t(type.results.size());
+            bool data_read = false;
+
+            auto pop = [&]() {
+               if( stack.size() <= frames.back().height ) return value{};
+               value v = std::move( stack.back() );
+               stack.pop_back();
+               return v;
+            };
+            auto write = [&]( const std::string& key, const value& v ) {
+               if( key.empty() ) return;
+               const bool step = v.key == key && v.step != 0;
+               for( auto& fr : frames ) {
+                  if( fr.op != wasm::op::loop ) continue;
+                  bool& w = fr.writes[key];
+                  w = w || step;
+               }
+            };
+            auto read = [&]( const std::string& key, value v ) {
+               v.key = key;
+               v.step = 0;
+               v.compared.clear();
+               if( !key.empty() ) v.reads.insert( key );
+               return v;
+            };
+            auto test = [&]( const value& cond ) {
+               for( auto fr = frames.rbegin(); fr != frames.rend(); ++fr ) {
+                  if( fr->op != wasm::op::loop ) continue;
+                  for( uint32_t c : cond.compared ) fr->tests.push_back( comparisons[c] );
+                  return;
+               }
+            };
+            auto compare = [&]( const value& x, const value& y ) {
+               value out = value::combined( x, y );
+               out.compared.push_back( uint32_t(comparisons.size()) );
+               comparisons.emplace_back( x, y );
+               return out;
+            };
+
+            for( size_t i = 0; i < d.code.size(); ++i ) {
+               const wasm::instr& in = d.code[i];
+               const uint16_t op = in.op;
+               switch( op ) {
+                  case wasm::op::block:
+                  case wasm::op::loop:
+                  case wasm::op::if_: {
+                     if( op == wasm::op::if_ ) test( pop() );
+                     frame fr;
+                     fr.op = op;
+                     fr.height = stack.size();
+                     fr.arity = in.a;
+                     fr.pos = in.pos;
+                     if( op == wasm::op::loop ) {
+                        fr.entry = locals;
+                        fr.entry_cells = cells;
+                     }
+                     frames.push_back( std::move(fr) );
+                     break;
+                  }
+                  case wasm::op::else_:
+                     stack.resize( std::min( stack.size(), frames.back().height ) );
+                     break;
+                  case wasm::op::end: {
+                     frame fr = std::move( frames.back() );
+                     std::vector<value> results( fr.arity );
+                     for( size_t k = fr.arity; k-- > 0; ) results[k] = pop();
+                     stack.resize( std::min( stack.size(), fr.height ) );
+                     if( frames.size() == 1 ) return std::move( fr.cost );
+                     frames.pop_back();
+                     for( auto& v : results ) stack.push_back( std::move(v) );
+                     if( fr.op == wasm::op::loop && !fr.cost.advances.empty() ) {
+                        fr.cost.host_calls = fr.cost.host_calls.times_n();
+                        fr.cost.loops[loop_site{ f, fr.pos, fr.cost.advances }] = loop_bound( fr );
+                     }
+                     frames.back().cost.add( fr.cost );
+                     break;
+                  }
+                  case wasm::op::br:
+                  case wasm::op::return_:
+                  case wasm::op::unreachable:
+                     stack.resize( std::min( stack.size(), frames.back().height ) );
+                     break;
+                  case wasm::op::br_if:
+                     test( pop() );
+                     break;
+                  case wasm::op::br_table:
+                     pop();
+                     stack.resize( std::min( stack.size(), frames.back().height ) );
+                     break;
+                  case wasm::op::call:
+                  case wasm::op::call_indirect: {
+                     if( op == wasm::op::call_indirect ) pop();
+                     const wasm::func_type& t = op == wasm::op::call ? m.function_type( in.a ) : m.types.at( in.a );
+                     std::vector<value> args( t.params.size() );
+                     for( size_t k = args.size(); k-- > 0; ) args[k] = pop();
+                     summary s = call( in, args, data_read );
+                     data_read = data_read || s.reads_data;
+                     frames.back().cost.add( s );
+                     for( size_t k = 0; k < t.results.size(); ++k ) stack.push_back( value{} );
+                     break;
+                  }
+                  case wasm::op::drop:
+                     pop();
+                     break;
+                  case wasm::op::select: {
+                     pop();
+                     value b = pop(), a = pop();
+                     stack.push_back( value::combined( a, b ) );
+                     break;
+                  }
+                  case wasm::op::local_get:
+                     stack.push_back( read( "L" + std::to_string( in.a ), locals.at( in.a ) ) );
+                     break;
+                  case wasm::op::local_set:
+                  case wasm::op::local_tee: {
+                     value v = pop();
+                     const std::string key = "L" + std::to_string( in.a );
+                     write( key, v );
+                     locals.at( in.a ) = v;
+                     if( op == wasm::op::local_tee ) stack.push_back( read( key, v ) );
+                     break;
+                  }
+                  case wasm::op::global_get:
+                     stack.push_back( read( "G" + std::to_string( in.a ), value{} ) );
+                     break;
+                  case wasm::op::global_set:
+                     write( "G" + std::to_string( in.a ), pop() );
+                     break;
+                  case wasm::op::memory_size:
+                     stack.push_back( value{} );
+                     break;
+                  case wasm::op::memory_grow:
+                     pop();
+                     stack.push_back( value{} );
+                     break;
+                  case wasm::op::i32_const:
+                     stack.push_back( value::constant( uint64_t(int64_t(int32_t(uint32_t(in.b)))) ) );
+                     break;
+                  case wasm::op::i64_const:
+                     stack.push_back( value::constant( in.b ) );
+                     break;
+                  case wasm::op::f32_const:
+                  case wasm::op::f64_const:
+                     stack.push_back( value{} );
+                     break;
+                  case wasm::op::nop:
+                     break;
+                  default:
+                     if( op >= 0x28 && op <= 0x35 ) {                  // loads
+                        value address = pop();
+                        const std::string key = value::cell( address, in.b );
+                        value v;
+                        auto stored = cells.find( key );
+                        if( stored != cells.end() && stored->second.origin.kind != bound::none )
+                           v.origin = stored->second.origin;
+                        else if( address.origin.kind == bound::param )
+                           v.origin = bound{ bound::deref, address.origin.value, load_width( op ) };
+                        else if( data_read )
+                           v.origin = bound{ bound::data, 0, load_width( op ) };
+                        v.reads = address.reads;
+                        stack.push_back( read( key, v ) );
+                     } else if( op >= 0x36 && op <= 0x3e ) {           // stores
+                        value v = pop(), address = pop();
+                        const std::string key = value::cell( address, in.b );
+                        write( key, v );
+                        if( !key.empty() ) cells[key] = v;
+                     } else if( op == 0x45 || op == 0x50 ) {           // eqz: a test against 0
+                        value x = pop();
+                        if( !x.compared.empty() ) { stack.push_back( x ); break; }
+                        stack.push_back( compare( x, value::constant( 0 ) ) );
+                     } else if( (op >= 0x46 && op <= 0x4f) || (op >= 0x51 && op <= 0x5a) ) {
+                        value y = pop(), x = pop();
+                        stack.push_back( compare( x, y ) );
+                     } else if( op == 0x6a || op == 0x7c || op == 0x6b || op == 0x7d ) {   // add, sub
+                        value y = pop(), x = pop();
+                        const bool sub = op == 0x6b || op == 0x7d;
+                        if( y.is_constant() ) stack.push_back( x.plus( sub ? -int64_t(y.origin.value) : int64_t(y.origin.value) ) );
+                        else if( x.is_constant() && !sub ) stack.push_back( y.plus( int64_t(x.origin.value) ) );
+                        else stack.push_back( value::combined( x, y ) );
+                     } else if( op == 0x71 || op == 0x72 ) {           // and, or: of tests, all of them
+                        value y = pop(), x = pop();
+                        value out = value::combined( x, y );
+                        out.compared = x.compared;
+                        out.compared.insert( out.compared.end(), y.compared.begin(), y.compared.end() );
+                        stack.push_back( out );
+                     } else if( op == 0xa7 || op == 0xac || op == 0xad || (op >= 0xc0 && op <= 0xc4) ) {
+                        // wrap, extend and sign extension keep the value
+                     } else if( (op >= 0x67 && op <= 0x69) || (op >= 0x79 && op <= 0x7b) ||
+                                (op >= 0x8b && op <= 0x91) || (op >= 0x99 && op <= 0x9f) ||
+                                (op >= 0xa8 && op <= 0xbf) || (op >= 0xfc00 && op <= 0xfc07) ) {
+                        value x = pop();
+                        stack.push_back( value::combined( x, value{} ) );
+                     } else if( op >= 0x5b && op <= 0xa6 ) {           // the other binary operators
+                        value y = pop(), x = pop();
+                        stack.push_back( value::combined( x, y ) );
+                     } else if( op == wasm::op::memory_copy || op == wasm::op::memory_fill ) {
+                        pop(); pop(); pop();
+                     }
+               }
+            }
+            return std::move( frames[0].cost );
+         }
+   };
+
+   // ---- dispatch recovery ---------------------------------------------------------------
+
+   // apply(receiver, code, action): which code runs for which action value. The walk
+   // keeps the set of action names still possible at each instruction, narrowing it at
+   // every branch on a comparison of the action with a constant, and charges each call
+   // to every name that can reach it. The last slot stands for any other action.
+   class dispatch {
+      public:
+         std::vector<uint64_t>  names;
+         std::vector<summary>   paths;          // per name, then the catch-all
+
+         dispatch( const wasm::module& m, analyzer& an ) {
+            const int64_t apply = m.export_index( "apply" );
+            if( apply < 0 || m.is_import( uint32_t(apply) ) ) throw wasm::wasm_error( "no apply export" );
+            d = wasm::decode( m, m.functions[uint32_t(apply) - m.num_imported_functions] );
+
+            // locals holding the action, and the names it is compared against
+            aliases.insert( 2 );
+            for( size_t i = 0; i + 1 < d.code.size(); ++i ) {
+               if( d.code[i].op == wasm::op::local_get && aliases.count( d.code[i].a ) &&
+                   (d.code[i + 1].op == wasm::op::local_set || d.code[i + 1].op == wasm::op::local_tee) )
+                  aliases.insert( d.code[i + 1].a );
+            }
+            std::set<uint64_t> seen;
+            for( size_t i = 0; i < d.code.size(); ++i ) {
+               uint64_t c;
+               bool const_first;
+               // the dispatcher's binary search also orders on midpoints that name nothing;
+               // only equality tests pick an action
+               const bool equality = d.code[i].op == 0x51 || d.code[i].op == 0x52;
+               if( equality && comparison( i, c, const_first ) ) seen.insert( c );
+            }
+            names.assign( seen.begin(), seen.end() );
+            paths.resize( names.size() + 1 );
+            walk( an );
+         }
+
+      private:
+         using state = std::vector<bool>;
+
+         wasm::decoded_function  d;
+         std::set<uint32_t>      aliases;
+
+         // is instruction i an i64 comparison of the action with a constant?
+         bool comparison( size_t i, uint64_t& c, bool& const_first ) const {
+            if( i < 2 || d.code[i].op < 0x51 || d.code[i].op > 0x5a ) return false;
+            const wasm::instr& x = d.code[i - 2];
+            const wasm::instr& y = d.code[i - 1];
+            auto is_action = [&]( const wasm::instr& in ) { return in.op == wasm::op::local_get && aliases.count( in.a ); };
+            if( is_action( x ) && y.op == wasm::op::i64_const ) { c = y.b; const_first = false; return true; }
+            if( x.op == wasm::op::i64_const && is_action( y ) ) { c = x.b; const_first = true; return true; }
+            return false;
+         }
+
+         static bool holds( uint16_t op, uint64_t l, uint64_t r ) {
+            const int64_t ls = int64_t(l), rs = int64_t(r);
+            switch( op ) {
+               case 0x51: return l == r;
+               case 0x52: return l != r;
+               case 0x53: return ls < rs;
+               case 0x54: return l < r;
+               case 0x55: return ls > rs;
+               case 0x56: return l > r;
+               case 0x57: return ls <= rs;
+               case 0x58: return l <= r;
+               case 0x59: return ls >= rs;
+               default:   return l >= r;
+            }
+         }
+
+         // splits `s` on the condition consumed by instruction i (a br_if or an if);
+         // without a recognised comparison both sides keep all of `s`
+         void split( size_t i, const state& s, state& taken, state& not_taken ) const {
+            taken = s;
+            not_taken = s;
+            uint64_t c;
+            bool const_first;
+            if( !comparison( i - 1, c, const_first ) ) return;
+            const uint16_t op = d.code[i - 1].op;
+            for( size_t k = 0; k < names.size(); ++k ) {
+               if( !s[k] ) continue;
+               const bool h = const_first ? holds( op, c, names[k] ) : holds( op, names[k], c );
+               (h ? not_taken : taken)[k] = false;
+            }
+         }
+
+         static void merge( state& into, const state& s ) {
+            for( size_t k = 0; k < s.size(); ++k ) if( s[k] ) into[k] = true;
+         }
+
+         void charge( const state& s, const summary& cost ) {
+            for( size_t k = 0; k < s.size(); ++k ) if( s[k] ) paths[k].add( cost );
+         }
+
+         struct frame {
+            uint16_t op = 0;
+            state    at_end;       // states branching to the end of the block
+            state    at_else;      // an if's state for its else arm
+            bool     has_else = false;
+         };
+
+         void walk( analyzer& an ) {
+            const state none( names.size() + 1, false );
+            state cur( names.size() + 1, true );
+            std::vector<frame> stack;
+
+            auto target = [&]( uint32_t depth ) -> frame* {
+               return depth < stack.size() ? &stack[stack.size() - 1 - depth] : nullptr;
+            };
+            auto branch = [&]( uint32_t depth, const state& s ) {
+               frame* t = target( depth );
+               if( t && t->op != wasm::op::loop ) merge( t->at_end, s );
+            };
+
+            for( size_t i = 0; i < d.code.size(); ++i ) {
+               const wasm::instr& in = d.code[i];
+               switch( in.op ) {
+                  case wasm::op::block:
+                  case wasm::op::loop:
+                     stack.push_back( frame{ in.op, none, none, false } );
+                     break;
+                  case wasm::op::if_: {
+                     frame f{ in.op, none, none, false };
+                     state taken, not_taken;
+                     split( i, cur, taken, not_taken );
+                     f.at_else = not_taken;
+                     cur = taken;
+                     stack.push_back( f );
+                     break;
+                  }
+                  case wasm::op::else_:
+                     merge( stack.back().at_end, cur );
+                     cur = stack.back().at_else;
+                     stack.back().has_else = true;
+                     break;
+                  case wasm::op::end: {
+                     if( stack.empty() ) break;
+                     frame f = stack.back();
+                     stack.pop_back();
+                     if( f.op == wasm::op::if_ && !f.has_else ) merge( cur, f.at_else );
+                     if( f.op != wasm::op::loop ) merge( cur, f.at_end );
+                     break;
+                  }
+                  case wasm::op::br:
+                     branch( in.a, cur );
+                     cur = none;
+                     break;
+                  case wasm::op::br_if: {
+                     state taken, not_taken;
+                     split( i, cur, taken, not_taken );
+                     branch( in.a, taken );
+                     cur = not_taken;
+                     break;
+                  }
+                  case wasm::op::br_table:
+                     for( uint32_t depth : d.br_tables[in.a] ) branch( depth, cur );
+                     cur = none;
+                     break;
+                  case wasm::op::return_:
+                  case wasm::op::unreachable:
+                     cur = none;
+                     break;
+                  case wasm::op::call:
+                  case wasm::op::call_indirect:
+                     if( cur != none ) charge( cur, an.call( in ) );
+                     break;
+               }
+            }
+         }
+   };
+
+   // ---- reporting -----------------------------------------------------------------------
+
+   struct action_report {
+      std::string           key;          // receiver:action, or receiver<-*::action for a notification
+      summary               cost;
+      std::string           bound;        // what limits its loops, when they all are
+      std::map<loop_site, std::string>   limits;   // per loop, empty when it has none
+      bool                  unbounded = false;
+      bool                  allowed = false;
+   };
+
+   // a loop limit as shown: a constant, the action argument it was loaded from, or
+   // "budget" for a limit traced no further than the loop's own function
+   std::string describe( const bound& b, const abi& def, uint64_t action ) {
+      if( b.kind == bound::constant ) return std::to_string( b.value );
+      if( b.kind != bound::data ) return "budget";
+      // the argument is the one integer field of the width the limit was loaded as
+      static const std::map<std::string, uint8_t> widths {
+         { "uint8", 1 }, { "int8", 1 }, { "uint16", 2 }, { "int16", 2 }, { "uint32", 4 }, { "int32", 4 },
+         { "varuint32", 4 }, { "varint32", 4 }, { "uint64", 8 }, { "int64", 8 } };
+      std::string found;
+      int matches = 0;
+      const std::string type = def.action_type( action );
+      if( !type.empty() ) {
+         for( const auto& [name, field_type] : def.struct_fields( type ) ) {
+            auto w = widths.find( field_type );
+            if( w == widths.end() || w->second != b.width ) continue;
+            found = name;
+            ++matches;
+         }
+      }
+      return matches == 1 ? found : "argument";
+   }
+
+   std::vector<action_report> analyse( const contract_spec& spec, const std::set<std::string>& allow, uint64_t& code_bytes ) {
+      wasm::module m = wasm::module::load( spec.wasm_path );
+      code_bytes = m.bytes.size();
+      abi def = abi::load( spec.abi_path );
+      analyzer an( m );
+      dispatch dp( m, an );
+
+      std::vector<action_report> out;
+      for( size_t k = 0; k < dp.names.size(); ++k ) {
+         const bool declared = !def.action_type( dp.names[k] ).empty();
+         action_report r;
+         r.key = declared ? spec.account + ":" + name_to_string( dp.names[k] )
+                          : spec.account + "<-*::" + name_to_string( dp.names[k] );
+         r.cost = dp.paths[k];
+         std::set<std::string> limits;
+         bool open = false;
+         for( const auto& [site, b] : r.cost.loops ) {
+            if( b.kind == bound::none ) {
+               open = true;
+               r.limits[site] = {};
+            } else {
+               limits.insert( r.limits[site] = describe( b, def, dp.names[k] ) );
+            }
+         }
+         if( !open )
+            for( const auto& l : limits ) r.bound += (r.bound.empty() ? "" : ", ") + l;
+         r.unbounded = open || !r.cost.recursion.empty();
+         r.allowed = allow.count( r.key ) > 0;
+         out.push_back( std::move(r) );
+      }
+      // declared actions the dispatcher never names
+      for( const auto& [action, type] : def.action_types() ) {
+         if( std::find( dp.names.begin(), dp.names.end(), action ) != dp.names.end() ) continue;
+         std::cerr << "wasmcost: " << spec.account << ":" << name_to_string( action ) << " is in the ABI but not dispatched\n";
+      }
+      return out;
+   }
+
+   // "account:action  # why" lines
+   std::set<std::string> load_allow( const std::string& path ) {
+      std::set<std::string> out;
+      std::ifstream in( path );
+      if( !in ) throw std::runtime_error( "cannot open " + path );
+      std::string line;
+      while( std::getline( in, line ) ) {
+         std::istringstream ss( line );
+         std::string key;
+         if( ss >> key && key[0] != '#' ) out.insert( key );
+      }
+      return out;
+   }
+
+   std::string hex( uint32_t v ) {
+      char buf[16];
+      std::snprintf( buf, sizeof(buf), "0x%x", v );
+      return buf;
+   }
+
+   int usage() {
+      std::cerr << "usage: wasmcost [--allow FILE] [--json] --contract ACCOUNT=WASM,ABI...\n";
+      return 2;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   std::vector<contract_spec> contracts;
+   std::string allow_path;
+   bool as_json = false;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( arg == "--contract" && i + 1 < argc ) {
+         std::string spec = argv[++i];
+         auto eq = spec.find( '=' ), comma = spec.find( ',' );
+         if( eq == std::string::npos || comma == std::string::npos || comma < eq ) return usage();
+         contracts.push_back( { spec.substr( 0, eq ), spec.substr( eq + 1, comma - eq - 1 ), spec.substr( comma + 1 ) } );
+      }
+      else if( arg == "--allow" && i + 1 < argc ) allow_path = argv[++i];
+      else if( arg == "--json" ) as_json = true;
+      else return usage();
+   }
+   if( contracts.empty() ) return usage();
+
+   std::set<std::string> allow;
+   std::vector<std::pair<uint64_t, std::vector<action_report>>> reports;
+   try {
+      if( !allow_path.empty() ) allow = load_allow( allow_path );
+      for( const auto& c : contracts ) {
+         uint64_t bytes = 0;
+         auto r = analyse( c, allow, bytes );
+         reports.push_back( { bytes, std::move(r) } );
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << "wasmcost: " << e.what() << "\n";
+      return 2;
+   }
+
+   int failed = 0;
+   for( const auto& [bytes, rs] : reports )
+      for( const auto& r : rs ) if( r.unbounded && !r.allowed ) ++failed;
+
+   if( as_json ) {
+      json out = json::object();
+      for( size_t c = 0; c < contracts.size(); ++c ) {
+         for( const auto& r : reports[c].second ) {
+            json entry = json::object();
+            entry.set( "host_calls", json( r.cost.host_calls.str() ) );
+            json terms = json::array();
+            for( size_t i = 0; i <= r.cost.host_calls.degree(); ++i ) terms.push_back( json::number( r.cost.host_calls.terms[i] ) );
+            entry.set( "terms", terms );
+            if( !r.bound.empty() ) entry.set( "bound", json( r.bound ) );
+            entry.set( "unbounded", json( r.unbounded ) );
+            entry.set( "allowed", json( r.allowed ) );
+            json loops = json::array();
+            for( const auto& [l, limit] : r.limits ) {
+               json lj = json::object();
+               lj.set( "function", json::number( uint64_t(l.function) ) );
+               lj.set( "offset", json::number( uint64_t(l.pos) ) );
+               lj.set( "advances", json( l.advance ) );
+               if( !limit.empty() ) lj.set( "limit", json( limit ) );
+               loops.push_back( lj );
+            }
+            entry.set( "loops", loops );
+            out.set( r.key, entry );
+         }
+      }
+      std::cout << out.dump() << "\n";
+      return failed ? 1 : 0;
+   }
+
+   for( size_t c = 0; c < contracts.size(); ++c ) {
+      std::printf( "%s: %llu bytes\n", contracts[c].wasm_path.c_str(), (unsigned long long)reports[c].first );
+      std::printf( "%-40s %-24s %s\n", "receiver:action", "host calls", "loops" );
+      for( const auto& r : reports[c].second ) {
+         // n stands for the limit when there is one argument or budget limiting every loop
+         const bool named = !r.bound.empty() && !std::isdigit( (unsigned char)r.bound[0] ) &&
+                            r.bound.find( ',' ) == std::string::npos;
+         const std::string var = named ? r.bound : "n";
+         std::string verdict;
+         if( !r.cost.recursion.empty() ) verdict = "recursive";
+         else if( r.unbounded ) verdict = "UNBOUNDED";
+         else if( r.cost.host_calls.degree() > 0 ) verdict = "bounded by " + r.bound;
+         if( r.unbounded && r.allowed ) verdict += " (allowed)";
+         std::printf( "%-40s %-24s %s\n", r.key.c_str(), r.cost.host_calls.str( var ).c_str(), verdict.c_str() );
+         for( const auto& [l, limit] : r.limits )
+            std::printf( "    loop at %s in function %u advances with %s, %s\n", hex( l.pos ).c_str(), l.function,
+                         l.advance.c_str(), limit.empty() ? "no exit test on a counter" : ("stops at " + limit).c_str() );
+      }
+      std::printf( "\n" );
+   }
+   if( failed ) std::printf( "%d unbounded action%s\n", failed, failed == 1 ? "" : "s" );
+   return failed ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+// wasmprof: runs a scripted sequence of actions against the compiled contracts and
+// reports, per receiver and action, the wasm instructions executed, host calls made
+// and linear memory touched. With --budget it fails when any of them regress; with
+// --compare it reports the change against a baseline taken from another build.
+
+#include "script.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace hagglex;
+
+namespace {
+
+   struct usage {
+      uint64_t runs = 0;
+      uint64_t instructions = 0;        // worst run
+      uint64_t total_instructions = 0;
+      uint64_t host_calls = 0;          // worst run
+      uint64_t high_water = 0;          // worst run
+      int64_t  ram = 0;                 // worst change of billed RAM, top-level actions only
+      std::map<std::string, uint64_t> imports;   // host calls by import, summed over runs
+   };
+
+   struct limit {
+      uint64_t instructions = 0;
+      uint64_t host_calls = UINT64_MAX;
+      uint64_t high_water = UINT64_MAX;
+      int64_t  ram = INT64_MAX;
+   };
+
+   std::string trace_key( const chain::action_trace& t ) {
+      std::string action = name_to_string( t.act.name );
+      if( t.receiver == t.act.account ) return name_to_string( t.receiver ) + ":" + action;
+      return name_to_string( t.receiver ) + "<-" + name_to_string( t.act.account ) + "::" + action;
+   }
+
+   class runner {
+      public:
+         std::map<std::string, usage> report;
+         bool verbose = false;
+
+         const std::map<std::string, uint64_t>& code_sizes() const { return script.code_sizes; }
+
+         // deploy `path` wherever the script deploys `account`, e.g. another build of it
+         void use_wasm( const std::string& account, const std::string& path ) { script.wasm_overrides[account] = path; }
+
+         void run( const std::string& path ) {
+            script.on_transaction = [this]( const std::vector<chain::action_trace>& traces ) { record( traces ); };
+            script.run( path );
+         }
+
+      private:
+         script_runner script;
+
+         uint64_t ram_bytes = 0;     // billed RAM after the last recorded transaction
+
+         void record( const std::vector<chain::action_trace>& traces ) {
+            // scripts run one action per transaction; the RAM its whole tree billed goes to it
+            const uint64_t now = script.chain.ram_bytes();
+            if( !traces.empty() ) {
+               usage& top = report[trace_key( traces.front() )];
+               const int64_t delta = int64_t(now) - int64_t(ram_bytes);
+               top.ram = top.runs ? std::max( top.ram, delta ) : delta;
+            }
+            ram_bytes = now;
+            for( const auto& t : traces ) {
+               if( !t.executed ) continue;
+               if( verbose && !t.console.empty() ) std::cerr << trace_key( t ) << ": " << t.console << "\n";
+               usage& u = report[trace_key( t )];
+               u.runs++;
+               u.instructions = std::max( u.instructions, t.stats.instructions );
+               u.total_instructions += t.stats.instructions;
+               u.host_calls = std::max( u.host_calls, t.stats.host_calls );
+               u.high_water = std::max( u.high_water, t.stats.high_water );
+               const auto& mod = script.chain.code_of( t.receiver )->mod();
+               for( size_t i = 0; i < t.stats.host_calls_by_import.size(); ++i )
+                  if( t.stats.host_calls_by_import[i] ) u.imports[mod.imported_function( uint32_t(i) ).field] += t.stats.host_calls_by_import[i];
+            }
+         }
+   };
+
+   std::map<std::string, limit> load_budget( const std::string& path ) {
+      std::ifstream in( path );
+      if( !in ) throw script_error( "cannot open " + path );
+      std::map<std::string, limit> out;
+      std::string line;
+      for( int lineno = 1; std::getline( in, line ); ++lineno ) {
+         std::istringstream ss( line );
+         std::string key;
+         if( !(ss >> key) || key[0] == '#' || key[0] == '@' ) continue;
+         limit l;
+         if( !(ss >> l.instructions) ) throw script_error( path + ":" + std::to_string( lineno ) + ": missing instruction budget" );
+         uint64_t v;
+         if( ss >> v ) l.host_calls = v;
+         if( ss >> v ) l.high_water = v;
+         int64_t bytes;
+         if( ss >> bytes ) l.ram = bytes;
+         out[key] = l;
+      }
+      return out;
+   }
+
+   // "@code <account> <bytes>" lines of a budget file
+   std::map<std::string, uint64_t> load_code_sizes( const std::string& path ) {
+      std::ifstream in( path );
+      std::map<std::string, uint64_t> out;
+      std::string line;
+      while( std::getline( in, line ) ) {
+         std::istringstream ss( line );
+         std::string tag, account;
+         uint64_t bytes;
+         if( ss >> tag >> account >> bytes && tag == "@code" ) out[account] = bytes;
+      }
+      return out;
+   }
+
+   std::string percent_change( uint64_t base, uint64_t now ) {
+      if( base == 0 ) return "-";
+      char buf[32];
+      std::snprintf( buf, sizeof(buf), "%+.1f%%", 100.0 * (double(now) - double(base)) / double(base) );
+      return buf;
+   }
+
+   // prints the run against a baseline written by --emit-budget 0 on another build
+   void print_comparison( const runner& r, const std::string& baseline_path ) {
+      auto baseline = load_budget( baseline_path );
+      auto sizes = load_code_sizes( baseline_path );
+      std::printf( "%-40s %14s %14s %8s\n", "wasm", "base bytes", "bytes", "change" );
+      for( const auto& [account, bytes] : r.code_sizes() ) {
+         auto it = sizes.find( account );
+         uint64_t base = it == sizes.end() ? 0 : it->second;
+         std::printf( "%-40s %14llu %14llu %8s\n", account.c_str(), (unsigned long long)base,
+                      (unsigned long long)bytes, percent_change( base, bytes ).c_str() );
+      }
+      std::printf( "\n%-40s %14s %14s %8s %10s %10s %8s %9s %9s\n", "receiver:action", "base instr", "max instr", "change",
+                   "base mem", "mem bytes", "change", "base ram", "ram" );
+      for( const auto& [key, u] : r.report ) {
+         auto it = baseline.find( key );
+         limit base = it == baseline.end() ? limit{} : it->second;
+         if( it == baseline.end() ) base.high_water = 0;
+         char base_ram[24] = "-";
+         if( base.ram != INT64_MAX ) std::snprintf( base_ram, sizeof(base_ram), "%+lld", (long long)base.ram );
+         std::printf( "%-40s %14llu %14llu %8s %10llu %10llu %8s %9s %+9lld\n", key.c_str(),
+                      (unsigned long long)base.instructions, (unsigned long long)u.instructions,
+                      percent_change( base.instructions, u.instructions ).c_str(),
+                      (unsigned long long)base.high_water, (unsigned long long)u.high_water,
+                      percent_change( base.high_water, u.high_water ).c_str(), base_ram, (long long)u.ram );
+      }
+   }
+
+   int usage_error() {
+      std::cerr << "usage: wasmprof [--budget FILE | --compare FILE] [--emit-budget PERCENT [--out FILE]]\n"
+                   "                [--wasm ACCOUNT=PATH]... [--imports] [--json] [--verbose] SCRIPT\n";
+      return 2;
+   }
+
+}
+
+int main( int argc, char** argv ) {
+   std::string script, budget_path, compare_path, out_path;
+   int  headroom = -1;
+   bool show_imports = false, as_json = false, verbose = false;
+   std::map<std::string, std::string> wasm_overrides;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( arg == "--budget" && i + 1 < argc ) budget_path = argv[++i];
+      else if( arg == "--compare" && i + 1 < argc ) compare_path = argv[++i];
+      else if( arg == "--emit-budget" && i + 1 < argc ) headroom = std::atoi( argv[++i] );
+      else if( arg == "--out" && i + 1 < argc ) out_path = argv[++i];
+      else if( arg == "--wasm" && i + 1 < argc ) {
+         std::string spec = argv[++i];
+         auto eq = spec.find( '=' );
+         if( eq == std::string::npos ) return usage_error();
+         wasm_overrides[spec.substr( 0, eq )] = spec.substr( eq + 1 );
+      }
+      else if( arg == "--imports" ) show_imports = true;
+      else if( arg == "--json" ) as_json = true;
+      else if( arg == "--verbose" ) verbose = true;
+      else if( arg[0] != '-' && script.empty() ) script = arg;
+      else return usage_error();
+   }
+   if( script.empty() ) return usage_error();
+
+   runner r;
+   r.verbose = verbose;
+   for( const auto& [account, path] : wasm_overrides ) r.use_wasm( account, path );
+   try {
+      r.run( script );
+   } catch( const std::exception& e ) {
+      std::cerr << "wasmprof: " << e.what() << "\n";
+      return 2;
+   }
+
+   if( headroom >= 0 ) {
+      // a starting budget: the measured worst case plus the requested headroom
+      auto pad = [headroom]( uint64_t v ) { return v + v * uint64_t(headroom) / 100; };
+      std::ofstream file;
+      if( !out_path.empty() ) {
+         file.open( out_path );
+         if( !file ) {
+            std::cerr << "wasmprof: cannot write " << out_path << "\n";
+            return 2;
+         }
+      }
+      std::ostream& out = out_path.empty() ? std::cout : file;
+      // billed RAM is exact for a given script, so it gets no headroom
+      out << "# key instructions host_calls memory_high_water ram_bytes\n";
+      for( const auto& [key, u] : r.report )
+         out << key << " " << pad( u.instructions ) << " " << pad( u.host_calls ) << " " << pad( u.high_water ) << " "
+             << u.ram << "\n";
+      for( const auto& [account, bytes] : r.code_sizes() ) out << "@code " << account << " " << bytes << "\n";
+      return 0;
+   }
+
+   if( !compare_path.empty() ) {
+      try {
+         print_comparison( r, compare_path );
+      } catch( const std::exception& e ) {
+         std::cerr << "wasmprof: " << e.what() << "\n";
+         return 2;
+      }
+      return 0;
+   }
+
+   if( as_json ) {
+      json out = json::object();
+      for( const auto& [key, u] : r.report ) {
+         json entry = json::object();
+         entry.set( "runs", json::number( u.runs ) );
+         entry.set( "instructions", json::number( u.instructions ) );
+         entry.set( "avg_instructions", json::number( u.total_instructions / u.runs ) );
+         entry.set( "host_calls", json::number( u.host_calls ) );
+         entry.set( "memory_high_water", json::number( u.high_water ) );
+         entry.set( "ram_bytes", json::number( u.ram ) );
+         if( show_imports ) {
+            json imports = json::object();
+            for( const auto& [name, count] : u.imports ) imports.set( name, json::number( count ) );
+            entry.set( "imports", imports );
+         }
+         out.set( key, entry );
+      }
+      std::cout << out.dump() << "\n";
+   } else {
+      std::printf( "%-40s %6s %14s %14s %10s %10s %9s\n", "receiver:action", "runs", "max instr", "avg instr", "host calls", "mem bytes",
+                   "ram" );
+      for( const auto& [key, u] : r.report ) {
+         std::printf( "%-40s %6llu %14llu %14llu %10llu %10llu %+9lld\n", key.c_str(), (unsigned long long)u.runs,
+                      (unsigned long long)u.instructions, (unsigned long long)(u.total_instructions / u.runs),
+                      (unsigned long long)u.host_calls, (unsigned long long)u.high_water, (long long)u.ram );
+         if( show_imports )
+            for( const auto& [name, count] : u.imports ) std::printf( "    %-36s %6llu\n", name.c_str(), (unsigned long long)count );
+      }
+   }
+
+   if( budget_path.empty() ) return 0;
+
+   std::map<std::string, limit> budget;
+   try {
+      budget = load_budget( budget_path );
+   } catch( const std::exception& e ) {
+      std::cerr << "wasmprof: " << e.what() << "\n";
+      return 2;
+   }
+   int failures = 0;
+   auto over = [&]( const std::string& key, const char* what, uint64_t got, uint64_t max ) {
+      if( got <= max ) return;
+      std::cerr << "over budget: " << key << " " << what << " " << got << " > " << max << "\n";
+      ++failures;
+   };
+   for( const auto& [key, l] : budget ) {
+      auto it = r.report.find( key );
+      if( it == r.report.end() ) {
+         std::cerr << "not exercised: " << key << "\n";
+         ++failures;
+         continue;
+      }
+      over( key, "instructions", it->second.instructions, l.instructions );
+      over( key, "host_calls", it->second.host_calls, l.host_calls );
+      over( key, "memory", it->second.high_water, l.high_water );
+      if( it->second.ram > l.ram ) {
+         std::cerr << "over budget: " << key << " ram " << it->second.ram << " > " << l.ram << "\n";
+         ++failures;
+      }
+   }
+   for( const auto& [key, u] : r.report )
+      if( !budget.count( key ) ) std::cerr << "no budget for " << key << "\n";
+   return failures ? 1 : 0;
+}